@@ -0,0 +1,112 @@
+#include <cstddef>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+
+#include "board.h"
+#include "timer.h"
+
+using namespace blunder;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help  Print this help message.\n"
+     << "   -r|--runs  The number of runs to use for copying boards and for\n"
+     << "              generating the next positions.\n"
+     << std::endl;
+}
+
+// Plays |plies| moves from a new game to get a board with a move history.
+Board
+play_moves(unsigned plies)
+{
+  auto board = Board::new_board();
+  for (unsigned i = 0; i < plies; ++i) {
+    auto children = board.next();
+    if (children.empty())
+      break;
+    board = children[i % children.size()];
+  }
+  return board;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"runs", required_argument, nullptr, 'r'},
+    {0, 0, 0, 0},
+  };
+
+  unsigned runs = 100000;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hr:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'r':
+        try {
+          runs = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--runs needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cout);
+        return EXIT_FAILURE;
+    }
+  }
+
+  Board::register_magics();
+
+  auto board = play_moves(60);
+
+  // Copy the board into a buffer that is reused to avoid measuring the cost
+  // of allocating the buffer.
+  std::vector<Board> boards;
+  boards.reserve(64);
+
+  Timer copy_timer;
+  copy_timer.start();
+  for (unsigned i = 0; i < runs; ++i) {
+    if (boards.size() == 64)
+      boards.clear();
+    boards.push_back(board);
+  }
+  copy_timer.end();
+
+  Timer next_timer;
+  std::size_t num_children = 0;
+  for (unsigned i = 0; i < runs / 100; ++i) {
+    next_timer.start();
+    num_children += board.next().size();
+    next_timer.end();
+  }
+
+  std::cout << "Bench stats with " << runs << " runs:\n"
+            << "\tsizeof(Board): " << sizeof(Board) << " bytes\n"
+            << "\ttrivially copyable: "
+            << std::is_trivially_copyable_v<Board> << '\n'
+            << "\tcopy: "
+            << static_cast<double>(copy_timer.total_nanos()) / runs
+            << " ns\n"
+            << "\tnext(): " << next_timer.avg_micros() << " us"
+            << " (" << num_children << " children)\n"
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
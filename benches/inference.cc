@@ -0,0 +1,263 @@
+#include <cstdlib>
+#include <functional>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "alpha_zero_encoder.h"
+#include "board.h"
+#include "chess_data_set.h"
+#include "coding_util.h"
+#include "folded_net.h"
+#include "net.h"
+#include "packed_board.h"
+#include "quantized_net.h"
+#include "replay_buffer.h"
+#include "script_net.h"
+#include "timer.h"
+
+using namespace blunder;
+
+using NetFn = std::function<std::pair<torch::Tensor, torch::Tensor>()>;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help   Print this help message.\n"
+     << "   -r|--runs   The number of batches to run through each network.\n"
+     << "   -b|--batch  The number of positions in a batch.\n"
+     << std::endl;
+}
+
+// Collects |n| positions from random games, with a placeholder policy since
+// only the boards are used.
+std::vector<TrainingPosition>
+random_positions(unsigned n, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::vector<TrainingPosition> positions;
+  positions.reserve(n);
+
+  auto board = Board::new_board();
+  while (positions.size() < n) {
+    auto children = board.next();
+    if (children.empty()) {
+      board = Board::new_board();
+      continue;
+    }
+    board = children[gen() % children.size()];
+    positions.push_back(TrainingPosition{
+      .board=PackedBoard::from(board),
+      .policy={PolicyEntry{.index=0, .visits=1}},
+      .value=0
+    });
+  }
+
+  return positions;
+}
+
+// Runs |net_fn| |runs| times after a warm up run, and returns the timer.
+Timer
+run_bench(const NetFn& net_fn, unsigned runs)
+{
+  net_fn();
+
+  Timer timer;
+  for (unsigned i = 0; i < runs; ++i) {
+    timer.start();
+    net_fn();
+    timer.end();
+  }
+  return timer;
+}
+
+// Returns the max absolute difference between the elements of |left| and
+// |right|.
+float
+max_diff(const torch::Tensor& left, const torch::Tensor& right)
+{ return (left - right).abs().max().item<float>(); }
+
+// Returns the max absolute difference between the move probabilities of two
+// batches of policy logits.
+float
+max_prob_diff(const torch::Tensor& left, const torch::Tensor& right)
+{
+  return max_diff(torch::softmax(left.flatten(/*start_dim=*/1), 1),
+                  torch::softmax(right.flatten(/*start_dim=*/1), 1));
+}
+
+// Returns the fraction of positions where both batches of policy logits agree
+// on the best move.
+float
+top_move_agreement(const torch::Tensor& left, const torch::Tensor& right)
+{
+  auto left_best = left.flatten(/*start_dim=*/1).argmax(1);
+  auto right_best = right.flatten(/*start_dim=*/1).argmax(1);
+  return left_best.eq(right_best).to(torch::kFloat).mean().item<float>();
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"runs", required_argument, nullptr, 'r'},
+    {"batch", required_argument, nullptr, 'b'},
+    {0, 0, 0, 0},
+  };
+
+  unsigned runs = 20;
+  unsigned batch = 16;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hr:b:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'r':
+        try {
+          runs = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--runs needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'b':
+        try {
+          batch = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--batch needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cout);
+        return EXIT_FAILURE;
+    }
+  }
+
+  Board::register_magics();
+
+  AlphaZeroNet net;
+  net.on_device(torch::kCPU);
+
+  auto encoder = std::make_shared<AlphaZeroEncoder>();
+
+  // The batch is a fixed set of positions from random games, which is also
+  // used to measure the drift of the quantized network.
+  std::vector<torch::Tensor> boards;
+  for (const auto& position : random_positions(batch, /*seed=*/1))
+    boards.push_back(encoder->encode_board(position.board.to_board()));
+  auto input = torch::stack(boards);
+
+  // Run a few batches in training mode so that the BatchNorm running
+  // statistics are not the defaults, which are trivial to fold.
+  {
+    torch::NoGradGuard no_grad;
+    net.set_training_mode();
+    for (int i = 0; i < 4; ++i)
+      net.forward(torch::randn({batch, 119, 8, 8}));
+  }
+  net.set_eval_mode();
+
+  FoldedNet folded_net(net);
+  ScriptNet script_net(ScriptNet::export_module(folded_net), torch::kCPU);
+
+  // Calibrate the quantized network on positions from other random games.
+  auto calibration_positions = random_positions(512, /*seed=*/2);
+  ChessDataSet data_set(calibration_positions, encoder, torch::kCPU);
+  QuantizedNet quantized_net(
+      folded_net, calibration_inputs(data_set, calibration_positions.size()));
+
+  std::cout << "Running bench on CPU with " << runs << " batches of "
+            << batch << " positions" << std::endl;
+
+  auto eager_timer = run_bench([&] {
+    torch::NoGradGuard no_grad;
+    return net.forward(input);
+  }, runs);
+
+  auto inference_timer = run_bench([&] {
+    c10::InferenceMode inference_mode;
+    return net.forward(input);
+  }, runs);
+
+  auto folded_timer = run_bench([&] {
+    return folded_net.predict(input);
+  }, runs);
+
+  auto script_timer = run_bench([&] {
+    return script_net.predict(input);
+  }, runs);
+
+  auto quantized_timer = run_bench([&] {
+    return quantized_net.predict(input);
+  }, runs);
+
+  torch::NoGradGuard no_grad;
+  auto [eager_pol, eager_val] = net.forward(input);
+  auto [folded_pol, folded_val] = folded_net.predict(input);
+  auto [script_pol, script_val] = script_net.predict(input);
+  auto [quantized_pol, quantized_val] = quantized_net.predict(input);
+
+  // Returns the number of positions evaluated per second.
+  auto throughput = [batch](const Timer& timer) {
+    return 1000.0 * batch / timer.avg_millis();
+  };
+
+  std::cout << "Bench stats:\n"
+            << "\teager:\n"
+            << "\t\tavg: " << eager_timer.avg_millis() << " ms/batch\n"
+            << "\teager with inference mode:\n"
+            << "\t\tavg: " << inference_timer.avg_millis() << " ms/batch\n"
+            << "\tfolded:\n"
+            << "\t\tavg: " << folded_timer.avg_millis() << " ms/batch\n"
+            << "\t\tthroughput: " << throughput(folded_timer)
+            << " positions/s\n"
+            << "\tfrozen script:\n"
+            << "\t\tavg: " << script_timer.avg_millis() << " ms/batch\n"
+            << "\t\tthroughput: " << throughput(script_timer)
+            << " positions/s\n"
+            << "\tint8:\n"
+            << "\t\tavg: " << quantized_timer.avg_millis() << " ms/batch\n"
+            << "\t\tthroughput: " << throughput(quantized_timer)
+            << " positions/s\n"
+            << "\tspeedup:\n"
+            << "\t\tfolded vs eager: "
+            << eager_timer.avg_millis() / folded_timer.avg_millis() << '\n'
+            << "\t\tscript vs folded: "
+            << folded_timer.avg_millis() / script_timer.avg_millis() << '\n'
+            << "\t\tint8 vs folded: "
+            << folded_timer.avg_millis() / quantized_timer.avg_millis() << '\n'
+            << "\tfolded max abs diff vs eager:\n"
+            << "\t\tpolicy: " << max_diff(eager_pol, folded_pol) << '\n'
+            << "\t\tvalue:  " << max_diff(eager_val, folded_val) << '\n'
+            << "\tscript max abs diff vs folded:\n"
+            << "\t\tpolicy: " << max_diff(folded_pol, script_pol) << '\n'
+            << "\t\tvalue:  " << max_diff(folded_val, script_val) << '\n'
+            << "\tint8 drift vs folded:\n"
+            << "\t\tmax policy prob diff: "
+            << max_prob_diff(folded_pol, quantized_pol) << '\n'
+            << "\t\tsame best move: "
+            << top_move_agreement(folded_pol, quantized_pol) << '\n'
+            << "\t\tmax value diff: "
+            << max_diff(folded_val, quantized_val) << '\n'
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include <cstdlib>
+#include <functional>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "folded_net.h"
+#include "net.h"
+#include "timer.h"
+
+using namespace blunder;
+
+// The batch sizes in the table, from a single search thread up to a full
+// batch of self play games.
+constexpr long kBatchSizes[] = {1, 4, 16, 64, 256};
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help   Print this help message.\n"
+     << "   -r|--runs   The number of batches to run through each network.\n"
+     << std::endl;
+}
+
+// Runs |net_fn| |runs| times after a warm up run, and returns the number of
+// positions evaluated per second.
+double
+throughput(const std::function<void()>& net_fn, unsigned runs, long batch)
+{
+  net_fn();
+
+  Timer timer;
+  for (unsigned i = 0; i < runs; ++i) {
+    timer.start();
+    net_fn();
+    timer.end();
+  }
+  return 1000.0 * batch / timer.avg_millis();
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"runs", required_argument, nullptr, 'r'},
+    {0, 0, 0, 0},
+  };
+
+  unsigned runs = 10;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hr:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'r':
+        try {
+          runs = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--runs needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cout);
+        return EXIT_FAILURE;
+    }
+  }
+
+  AlphaZeroNet net;
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+
+  AlphaZeroNet channels_last_net = net.clone();
+  channels_last_net.on_device(torch::kCPU);
+  channels_last_net.set_eval_mode();
+  channels_last_net.set_memory_format(torch::MemoryFormat::ChannelsLast);
+
+  FoldedNet folded_net(net);
+  FoldedNet channels_last_folded_net(net, torch::MemoryFormat::ChannelsLast);
+
+  std::cout << "Running bench on CPU with " << runs << " batches per size, "
+            << "in positions/s\n\n"
+            << std::setw(6) << "batch"
+            << std::setw(12) << "eager"
+            << std::setw(14) << "eager nhwc"
+            << std::setw(12) << "folded"
+            << std::setw(14) << "folded nhwc"
+            << std::setw(10) << "speedup" << '\n'
+            << std::fixed << std::setprecision(0);
+
+  for (auto batch : kBatchSizes) {
+    auto input = torch::randn({batch, 119, 8, 8});
+
+    auto eager = throughput([&] {
+      c10::InferenceMode inference_mode;
+      net.forward(input);
+    }, runs, batch);
+
+    auto eager_channels_last = throughput([&] {
+      c10::InferenceMode inference_mode;
+      channels_last_net.forward(input);
+    }, runs, batch);
+
+    auto folded = throughput([&] {
+      folded_net.predict(input);
+    }, runs, batch);
+
+    auto folded_channels_last = throughput([&] {
+      channels_last_folded_net.predict(input);
+    }, runs, batch);
+
+    std::cout << std::setw(6) << batch
+              << std::setw(12) << eager
+              << std::setw(14) << eager_channels_last
+              << std::setw(12) << folded
+              << std::setw(14) << folded_channels_last
+              << std::setw(10) << std::setprecision(2)
+              << folded_channels_last / folded
+              << std::setprecision(0) << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
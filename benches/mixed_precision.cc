@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "alpha_zero_encoder.h"
+#include "board.h"
+#include "chess_data_set.h"
+#include "coding_util.h"
+#include "net.h"
+#include "packed_board.h"
+#include "replay_buffer.h"
+#include "search_result.h"
+#include "timer.h"
+#include "train_step.h"
+
+using namespace blunder;
+
+// The number of steps between rows of the loss curves.
+constexpr unsigned kReportSteps = 10;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help        Print this help message.\n"
+     << "   -s|--steps       The number of training steps for each precision.\n"
+     << "   -b|--batch       The number of positions in a batch.\n"
+     << "   -l|--loss_scale  The factor to scale the loss by with bf16.\n"
+     << std::endl;
+}
+
+// Collects |n| positions from random games, with a policy that is uniform over
+// the legal moves and a value of zero, such that the loss curves are
+// reproducible without search.
+std::vector<TrainingPosition>
+random_positions(unsigned n, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::vector<TrainingPosition> positions;
+  positions.reserve(n);
+
+  auto board = Board::new_board();
+  while (positions.size() < n) {
+    auto children = board.next();
+    if (children.empty()) {
+      board = Board::new_board();
+      continue;
+    }
+
+    std::vector<MoveProb> moves;
+    for (const auto& child : children)
+      moves.push_back(MoveProb{.mv=*child.last_move(), .visits=1});
+
+    positions.push_back(TrainingPosition{
+      .board=PackedBoard::from(board),
+      .policy=encode_policy(moves),
+      .value=0
+    });
+
+    board = children[gen() % children.size()];
+  }
+
+  return positions;
+}
+
+// The result of training a network with one precision.
+struct TrainingRun {
+  std::vector<float> losses;
+  double samples_per_sec = 0;
+};
+
+// Trains |net| on |batches| in order, and records the loss at every step.
+TrainingRun
+run_training(
+    AlphaZeroNet& net,
+    const std::vector<ChessDataExample>& batches,
+    TrainingPrecision precision,
+    float loss_scale)
+{
+  torch::optim::SGD optimizer(net.all_parameters(), /*lr=*/0.01);
+  net.set_training_mode();
+
+  // Warm up, e.g. to select the convolution algorithms, on a copy of the
+  // network so that both precisions start from the same weights.
+  {
+    auto warm_up_net = net.clone();
+    warm_up_net.on_device(net.device());
+    warm_up_net.set_training_mode();
+    torch::optim::SGD warm_up_optimizer(
+        warm_up_net.all_parameters(), /*lr=*/0.01);
+    train_step(warm_up_net, warm_up_optimizer, batches.front(), precision,
+               loss_scale);
+  }
+
+  std::vector<torch::Tensor> losses;
+  losses.reserve(batches.size());
+
+  Timer timer;
+  timer.start();
+  for (const auto& batch : batches)
+    losses.push_back(train_step(net, optimizer, batch, precision, loss_scale));
+  auto all_losses = torch::stack(losses).to(torch::kCPU);
+  timer.end();
+
+  TrainingRun run;
+  auto loss_data = all_losses.accessor<float, 1>();
+  for (std::int64_t i = 0; i < loss_data.size(0); ++i)
+    run.losses.push_back(loss_data[i]);
+
+  std::size_t samples = 0;
+  for (const auto& batch : batches)
+    samples += batch.data.size(0);
+  run.samples_per_sec = 1000.0 * samples / timer.total_millis();
+
+  return run;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"steps", required_argument, nullptr, 's'},
+    {"batch", required_argument, nullptr, 'b'},
+    {"loss_scale", required_argument, nullptr, 'l'},
+    {0, 0, 0, 0},
+  };
+
+  unsigned steps = 100;
+  unsigned batch = 64;
+  float loss_scale = 1;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hs:b:l:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 's':
+        try {
+          steps = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--steps needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'b':
+        try {
+          batch = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--batch needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'l':
+        try {
+          loss_scale = std::stof(optarg);
+        } catch (...) {
+          std::cerr << "--loss_scale needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cout);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (not steps or not batch) {
+    std::cerr << "--steps and --batch need to be greater than 0" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Board::register_magics();
+  torch::manual_seed(1);
+
+  // The batches are encoded up front, so both precisions train on the same
+  // batches in the same order, and the timings do not include the encoding.
+  auto encoder = std::make_shared<AlphaZeroEncoder>();
+  auto positions = random_positions(steps * batch, /*seed=*/1);
+  ChessDataSet data_set(positions, encoder, torch::kCPU);
+
+  std::vector<ChessDataExample> batches;
+  batches.reserve(steps);
+  for (unsigned i = 0; i < steps; ++i) {
+    std::vector<ChessDataExample> examples;
+    for (unsigned j = 0; j < batch; ++j)
+      examples.push_back(data_set.get(i * batch + j));
+    batches.push_back(stack_examples(std::move(examples)));
+  }
+
+  AlphaZeroNet fp32_net;
+  fp32_net.on_device(torch::kCPU);
+  auto bf16_net = fp32_net.clone();
+  bf16_net.on_device(torch::kCPU);
+
+  std::cout << "Training on CPU for " << steps << " steps with batches of "
+            << batch << " positions" << std::endl;
+
+  auto fp32_run = run_training(
+      fp32_net, batches, TrainingPrecision::Float32, /*loss_scale=*/1);
+  auto bf16_run = run_training(
+      bf16_net, batches, TrainingPrecision::BFloat16, loss_scale);
+
+  std::cout << "\nLoss curves:\n"
+            << std::setw(6) << "step"
+            << std::setw(10) << "fp32"
+            << std::setw(10) << "bf16"
+            << std::setw(10) << "diff" << '\n'
+            << std::fixed << std::setprecision(4);
+
+  float max_diff = 0;
+  for (unsigned i = 0; i < steps; ++i) {
+    auto diff = std::abs(bf16_run.losses[i] - fp32_run.losses[i]);
+    max_diff = std::max(max_diff, diff);
+    if (i % kReportSteps == 0 or i + 1 == steps) {
+      std::cout << std::setw(6) << i
+                << std::setw(10) << fp32_run.losses[i]
+                << std::setw(10) << bf16_run.losses[i]
+                << std::setw(10) << diff << '\n';
+    }
+  }
+
+  std::cout << "\nBench stats:\n"
+            << std::setprecision(1)
+            << "\tfp32: " << fp32_run.samples_per_sec << " samples/s\n"
+            << "\tbf16: " << bf16_run.samples_per_sec << " samples/s\n"
+            << std::setprecision(2)
+            << "\tspeedup: "
+            << bf16_run.samples_per_sec / fp32_run.samples_per_sec << '\n'
+            << std::setprecision(4)
+            << "\tmax loss diff: " << max_diff << '\n'
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,278 @@
+#include <cmath>
+#include <cstdlib>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "alpha_zero_encoder.h"
+#include "board.h"
+#include "chess_data_set.h"
+#include "coding_util.h"
+#include "folded_net.h"
+#include "net.h"
+#include "packed_board.h"
+#include "piece_set.h"
+#include "replay_buffer.h"
+#include "search_result.h"
+#include "timer.h"
+
+using namespace blunder;
+
+// The sizes in the table, from a small CPU network up to the AlphaZero size.
+constexpr NetConfig kConfigs[] = {
+  {.blocks=6, .filters=64, .value_hidden=64},
+  {.blocks=10, .filters=128, .value_hidden=128},
+  {.blocks=15, .filters=192, .value_hidden=256},
+  {.blocks=19, .filters=256, .value_hidden=256},
+};
+
+constexpr unsigned kTrainBatch = 64;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help   Print this help message.\n"
+     << "   -s|--steps  The number of training steps for each network.\n"
+     << "   -r|--runs   The number of batches to time for each network.\n"
+     << "   -b|--batch  The number of positions in a timed batch.\n"
+     << std::endl;
+}
+
+// Returns the material balance of |board| from the perspective of the player
+// moving next, in pawns.
+int
+material(const Board& board)
+{
+  auto score = [](const PieceSet& pieces) {
+    return 9 * pieces.queen().count() + 5 * pieces.rook().count()
+           + 3 * pieces.bishop().count() + 3 * pieces.knight().count()
+           + pieces.pawn().count();
+  };
+  return static_cast<int>(score(board.mine()))
+         - static_cast<int>(score(board.other()));
+}
+
+// Collects |n| positions from random games. Since there are no search results
+// to learn from, the targets are synthetic, but still need to be learned from
+// the board: the policy is uniform over the legal moves, and the value is the
+// squashed material balance.
+std::vector<TrainingPosition>
+random_positions(unsigned n, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::vector<TrainingPosition> positions;
+  positions.reserve(n);
+
+  auto board = Board::new_board();
+  while (positions.size() < n) {
+    auto children = board.next();
+    if (children.empty()) {
+      board = Board::new_board();
+      continue;
+    }
+
+    std::vector<MoveProb> moves;
+    for (const auto& child : children)
+      moves.push_back(MoveProb{.mv=*child.last_move(), .visits=1});
+
+    positions.push_back(TrainingPosition{
+      .board=PackedBoard::from(board),
+      .policy=encode_policy(moves),
+      .value=std::tanh(material(board) / 10.0f)
+    });
+
+    board = children[gen() % children.size()];
+  }
+
+  return positions;
+}
+
+// The accuracy of a network on held out positions.
+struct Accuracy {
+  // The average probability mass on the legal moves.
+  float legal_mass = 0;
+  // The fraction of positions where the most likely move is legal.
+  float legal_top1 = 0;
+  // The mean squared error of the value.
+  float value_mse = 0;
+};
+
+// Trains |net| for |steps| batches on |positions|.
+void
+train(AlphaZeroNet& net,
+      std::span<const TrainingPosition> positions,
+      std::shared_ptr<AlphaZeroEncoder> encoder,
+      unsigned steps)
+{
+  ChessDataSet data_set(positions, encoder, torch::kCPU);
+  torch::optim::SGD optimizer(
+      net.all_parameters(), torch::optim::SGDOptions(0.01).momentum(0.9));
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<std::size_t> dist(0, positions.size() - 1);
+
+  net.set_training_mode();
+  for (unsigned step = 0; step < steps; ++step) {
+    std::vector<ChessDataExample> examples;
+    for (unsigned i = 0; i < kTrainBatch; ++i)
+      examples.push_back(data_set.get(dist(gen)));
+    auto batch = stack_examples(std::move(examples));
+
+    optimizer.zero_grad();
+    auto [policy_pred, value_pred] = net.forward(batch.data);
+    auto& [policy_target, value_target] = batch.target;
+    auto loss = sparse_policy_loss(policy_pred, policy_target)
+                + torch::mse_loss(value_pred, value_target);
+    loss.backward();
+    optimizer.step();
+  }
+  net.set_eval_mode();
+}
+
+// Measures the accuracy of |folded_net| on |positions|.
+Accuracy
+evaluate(FoldedNet& folded_net,
+         std::span<const TrainingPosition> positions,
+         std::shared_ptr<AlphaZeroEncoder> encoder)
+{
+  ChessDataSet data_set(positions, encoder, torch::kCPU);
+  std::vector<ChessDataExample> examples;
+  for (std::size_t i = 0; i < positions.size(); ++i)
+    examples.push_back(data_set.get(i));
+  auto batch = stack_examples(std::move(examples));
+
+  auto [policy_pred, value_pred] = folded_net.predict(batch.data);
+  auto& [policy_target, value_target] = batch.target;
+
+  // The stacked targets are padded with zero probabilities, which are not
+  // legal moves, and which may share an index with a legal move.
+  auto probs = torch::softmax(policy_pred.flatten(/*start_dim=*/1), 1);
+  auto legal = torch::zeros_like(probs).scatter_add_(
+      1, policy_target.indices, policy_target.probs.gt(0).to(torch::kFloat));
+  legal.clamp_max_(1);
+  auto best = probs.argmax(1, /*keepdim=*/true);
+
+  return Accuracy{
+    .legal_mass=(probs * legal).sum(1).mean().item<float>(),
+    .legal_top1=legal.gather(1, best).mean().item<float>(),
+    .value_mse=torch::mse_loss(value_pred, value_target).item<float>()
+  };
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"steps", required_argument, nullptr, 's'},
+    {"runs", required_argument, nullptr, 'r'},
+    {"batch", required_argument, nullptr, 'b'},
+    {0, 0, 0, 0},
+  };
+
+  unsigned steps = 200;
+  unsigned runs = 10;
+  unsigned batch = 16;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hs:r:b:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 's':
+        try {
+          steps = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--steps needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'r':
+        try {
+          runs = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--runs needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'b':
+        try {
+          batch = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--batch needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cout);
+        return EXIT_FAILURE;
+    }
+  }
+
+  Board::register_magics();
+
+  auto encoder = std::make_shared<AlphaZeroEncoder>();
+  auto train_positions = random_positions(4096, /*seed=*/1);
+  auto test_positions = random_positions(512, /*seed=*/2);
+
+  std::vector<torch::Tensor> boards;
+  for (unsigned i = 0; i < batch; ++i) {
+    const auto& position = test_positions[i % test_positions.size()];
+    boards.push_back(encoder->encode_board(position.board.to_board()));
+  }
+  auto input = torch::stack(boards);
+
+  std::cout << "Training each network for " << steps << " steps, and timing "
+            << runs << " batches of " << batch << " positions on CPU\n\n"
+            << std::setw(8) << "blocks" << std::setw(9) << "filters"
+            << std::setw(8) << "hidden" << std::setw(14) << "positions/s"
+            << std::setw(12) << "legal mass" << std::setw(12) << "legal top1"
+            << std::setw(11) << "value mse" << '\n';
+
+  for (const auto& config : kConfigs) {
+    AlphaZeroNet net(config);
+    net.on_device(torch::kCPU);
+    train(net, train_positions, encoder, steps);
+
+    FoldedNet folded_net(net);
+    auto accuracy = evaluate(folded_net, test_positions, encoder);
+
+    folded_net.predict(input);
+    Timer timer;
+    for (unsigned i = 0; i < runs; ++i) {
+      timer.start();
+      folded_net.predict(input);
+      timer.end();
+    }
+
+    std::cout << std::setw(8) << config.blocks
+              << std::setw(9) << config.filters
+              << std::setw(8) << config.value_hidden
+              << std::setw(14) << std::fixed << std::setprecision(0)
+              << 1000.0 * batch / timer.avg_millis()
+              << std::setprecision(3)
+              << std::setw(12) << accuracy.legal_mass
+              << std::setw(12) << accuracy.legal_top1
+              << std::setw(11) << accuracy.value_mse << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,177 @@
+#include <cstdlib>
+#include <filesystem>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <string_view>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "folded_net.h"
+#include "net.h"
+#include "timer.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help   Print this help message.\n"
+     << "   -r|--runs   The number of processes to start for each format.\n"
+     << "   -m|--mode   Loads the network from --path, with checkpoint or\n"
+     << "               flat, and exits after the first evaluation. Without\n"
+     << "               a mode, the bench writes both formats and times\n"
+     << "               processes started in each mode.\n"
+     << "   -p|--path   The checkpoint directory or the flat weight file.\n"
+     << std::endl;
+}
+
+// Loads the network from |path| in |mode| and evaluates a single position.
+void
+first_eval(std::string_view mode, const fs::path& path)
+{
+  auto input = torch::zeros({1, 119, 8, 8});
+
+  if (mode == "flat") {
+    FoldedNet::load(path).predict(input);
+    return;
+  }
+
+  auto config = AlphaZeroNet::checkpoint_config(path);
+  if (not config)
+    throw std::runtime_error("Unable to read the checkpoint config.");
+
+  AlphaZeroNet net(*config);
+  if (not net.load_checkpoint(path))
+    throw std::runtime_error("Unable to load the checkpoint.");
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+  FoldedNet(net).predict(input);
+}
+
+// Starts |runs| processes of |prog| in |mode|, and returns the timer with the
+// wall time of each process.
+Timer
+time_processes(
+    const fs::path& prog,
+    std::string_view mode,
+    const fs::path& path,
+    unsigned runs)
+{
+  auto command = std::string("'") + prog.string() + "' --mode "
+                 + std::string(mode) + " --path '" + path.string() + "'";
+
+  Timer timer;
+  for (unsigned i = 0; i < runs; ++i) {
+    timer.start();
+    auto ret = std::system(command.c_str());
+    timer.end();
+    if (ret != 0)
+      throw std::runtime_error("Process failed: " + command);
+  }
+  return timer;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"runs", required_argument, nullptr, 'r'},
+    {"mode", required_argument, nullptr, 'm'},
+    {"path", required_argument, nullptr, 'p'},
+    {0, 0, 0, 0},
+  };
+
+  unsigned runs = 5;
+  std::string_view mode;
+  fs::path path;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hr:m:p:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'r':
+        try {
+          runs = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--runs needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'm':
+        mode = optarg;
+        break;
+      case 'p':
+        path = optarg;
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cout);
+        return EXIT_FAILURE;
+    }
+  }
+
+  try {
+    if (not mode.empty()) {
+      if (mode != "checkpoint" and mode != "flat") {
+        std::cerr << "--mode needs to be checkpoint or flat" << std::endl;
+        return EXIT_FAILURE;
+      }
+      first_eval(mode, path);
+      return EXIT_SUCCESS;
+    }
+
+    // Write both formats from the same network, which is only used to
+    // create the files.
+    auto dir = fs::temp_directory_path() / "blunder-startup-bench";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto checkpoint_dir = dir / "checkpoint";
+    auto flat_file = dir / "net.bin";
+    {
+      AlphaZeroNet net;
+      net.on_device(torch::kCPU);
+      net.set_eval_mode();
+      if (not net.create_checkpoint(checkpoint_dir))
+        throw std::runtime_error("Unable to create the checkpoint.");
+      FoldedNet(net).save(flat_file);
+    }
+
+    // The files were just written, so both formats load from the page cache,
+    // which is the common case for workers started on the same host.
+    auto prog = fs::canonical("/proc/self/exe");
+    auto checkpoint_timer =
+      time_processes(prog, "checkpoint", checkpoint_dir, runs);
+    auto flat_timer = time_processes(prog, "flat", flat_file, runs);
+
+    std::cout << "Time to first eval of a new process, over " << runs
+              << " processes:\n"
+              << "\tcheckpoint:\n"
+              << "\t\tavg: " << checkpoint_timer.avg_millis() << " ms\n"
+              << "\tflat weight file:\n"
+              << "\t\tavg: " << flat_timer.avg_millis() << " ms\n"
+              << "\t\tfile size: " << fs::file_size(flat_file) << " bytes\n"
+              << "\tspeedup: "
+              << checkpoint_timer.avg_millis() / flat_timer.avg_millis()
+              << '\n'
+              << std::endl;
+
+    fs::remove_all(dir);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,778 @@
+#include "alpha_beta.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "move.h"
+#include "nnue.h"
+#include "pieces.h"
+#include "piece_set.h"
+#include "timer.h"
+
+namespace blunder {
+namespace {
+
+constexpr int kInfinity = 32500;
+constexpr int kMate = 32000;
+// Scores beyond this are mates, where the distance to the mate is the
+// difference to kMate.
+constexpr int kMateBound = kMate - 1000;
+
+// The maximum ply of a branch, including checks and quiescence.
+constexpr unsigned kMaxPly = 128;
+
+// Iterative deepening stops here when only a time, node, or stop limit is set.
+constexpr unsigned kMaxDepth = 64;
+
+// The time and stop limits are checked once every this many nodes.
+constexpr unsigned kCheckInterval = 1024;
+
+// The value of the piece types in centipawns, indexed by Type.
+constexpr int kPieceValues[] = {0, 900, 500, 330, 320, 100};
+
+// The total value of the pieces other than pawns and kings, below which the
+// king is safe to come out.
+constexpr int kEndgameMaterial = 1800;
+
+// Piece-square tables from the perspective of white, in the order the board is
+// printed, i.e. a8 to h8 first and a1 to h1 last.
+using SquareTable = std::array<int, 64>;
+
+constexpr SquareTable kPawnTable = {
+    0,   0,   0,   0,   0,   0,   0,   0,
+   50,  50,  50,  50,  50,  50,  50,  50,
+   10,  10,  20,  30,  30,  20,  10,  10,
+    5,   5,  10,  25,  25,  10,   5,   5,
+    0,   0,   0,  20,  20,   0,   0,   0,
+    5,  -5, -10,   0,   0, -10,  -5,   5,
+    5,  10,  10, -20, -20,  10,  10,   5,
+    0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+constexpr SquareTable kKnightTable = {
+  -50, -40, -30, -30, -30, -30, -40, -50,
+  -40, -20,   0,   0,   0,   0, -20, -40,
+  -30,   0,  10,  15,  15,  10,   0, -30,
+  -30,   5,  15,  20,  20,  15,   5, -30,
+  -30,   0,  15,  20,  20,  15,   0, -30,
+  -30,   5,  10,  15,  15,  10,   5, -30,
+  -40, -20,   0,   5,   5,   0, -20, -40,
+  -50, -40, -30, -30, -30, -30, -40, -50,
+};
+
+constexpr SquareTable kBishopTable = {
+  -20, -10, -10, -10, -10, -10, -10, -20,
+  -10,   0,   0,   0,   0,   0,   0, -10,
+  -10,   0,   5,  10,  10,   5,   0, -10,
+  -10,   5,   5,  10,  10,   5,   5, -10,
+  -10,   0,  10,  10,  10,  10,   0, -10,
+  -10,  10,  10,  10,  10,  10,  10, -10,
+  -10,   5,   0,   0,   0,   0,   5, -10,
+  -20, -10, -10, -10, -10, -10, -10, -20,
+};
+
+constexpr SquareTable kRookTable = {
+    0,   0,   0,   0,   0,   0,   0,   0,
+    5,  10,  10,  10,  10,  10,  10,   5,
+   -5,   0,   0,   0,   0,   0,   0,  -5,
+   -5,   0,   0,   0,   0,   0,   0,  -5,
+   -5,   0,   0,   0,   0,   0,   0,  -5,
+   -5,   0,   0,   0,   0,   0,   0,  -5,
+   -5,   0,   0,   0,   0,   0,   0,  -5,
+    0,   0,   0,   5,   5,   0,   0,   0,
+};
+
+constexpr SquareTable kQueenTable = {
+  -20, -10, -10,  -5,  -5, -10, -10, -20,
+  -10,   0,   0,   0,   0,   0,   0, -10,
+  -10,   0,   5,   5,   5,   5,   0, -10,
+   -5,   0,   5,   5,   5,   5,   0,  -5,
+   -5,   0,   5,   5,   5,   5,   0,  -5,
+  -10,   0,   5,   5,   5,   5,   0, -10,
+  -10,   0,   0,   0,   0,   0,   0, -10,
+  -20, -10, -10,  -5,  -5, -10, -10, -20,
+};
+
+constexpr SquareTable kKingTable = {
+  -30, -40, -40, -50, -50, -40, -40, -30,
+  -30, -40, -40, -50, -50, -40, -40, -30,
+  -30, -40, -40, -50, -50, -40, -40, -30,
+  -30, -40, -40, -50, -50, -40, -40, -30,
+  -20, -30, -30, -40, -40, -30, -30, -20,
+  -10, -20, -20, -20, -20, -20, -20, -10,
+   20,  20,   0,   0,   0,   0,  20,  20,
+   20,  30,  10,   0,   0,  10,  30,  20,
+};
+
+constexpr SquareTable kKingEndgameTable = {
+  -50, -40, -30, -20, -20, -30, -40, -50,
+  -30, -20, -10,   0,   0, -10, -20, -30,
+  -30, -10,  20,  30,  30,  20, -10, -30,
+  -30, -10,  30,  40,  40,  30, -10, -30,
+  -30, -10,  30,  40,  40,  30, -10, -30,
+  -30, -10,  20,  30,  30,  20, -10, -30,
+  -30, -30,   0,   0,   0,   0, -30, -30,
+  -50, -30, -30, -30, -30, -30, -30, -50,
+};
+
+// The tables indexed by Type, where the king uses the middle game table.
+constexpr const SquareTable* kSquareTables[] = {
+  &kKingTable,
+  &kQueenTable,
+  &kRookTable,
+  &kBishopTable,
+  &kKnightTable,
+  &kPawnTable
+};
+
+constexpr Type kPieceTypes[] = {
+  Type::King,
+  Type::Queen,
+  Type::Rook,
+  Type::Bishop,
+  Type::Knight,
+  Type::Pawn
+};
+
+// Returns the index in a SquareTable of |square| for white, or of the mirrored
+// square for black.
+unsigned
+table_index(unsigned square, bool is_white) noexcept
+{
+  const unsigned rank = square / 8;
+  const unsigned file = square % 8;
+  return is_white ? (7 - rank) * 8 + file : rank * 8 + file;
+}
+
+// Returns the value of the pieces other than pawns and kings.
+int
+piece_material(const PieceSet& pieces) noexcept
+{
+  int material = 0;
+  for (auto type : {Type::Queen, Type::Rook, Type::Bishop, Type::Knight})
+    material += kPieceValues[to_int(type)] * pieces.get(type).count();
+  return material;
+}
+
+// Returns the material and piece-square score of |pieces|.
+int
+score_pieces(const PieceSet& pieces, bool is_white, bool is_endgame) noexcept
+{
+  int score = 0;
+  for (auto type : kPieceTypes) {
+    const auto& table = type == Type::King and is_endgame
+      ? kKingEndgameTable
+      : *kSquareTables[to_int(type)];
+
+    auto bb = pieces.get(type);
+    while (bb) {
+      auto square = bb.first_bit_and_clear();
+      score += kPieceValues[to_int(type)] + table[table_index(square, is_white)];
+    }
+  }
+  return score;
+}
+
+// Whether the score of an entry is exact, or a bound from a cutoff.
+enum class Bound : std::uint8_t {
+  Exact,
+  // The score is at least this, i.e. it failed high.
+  Lower,
+  // The score is at most this, i.e. it failed low.
+  Upper
+};
+
+// Returns true if the score is a mate for either player.
+bool
+is_mate_score(int score) noexcept
+{ return std::abs(score) >= kMateBound; }
+
+// Mate scores are relative to the root, but the table stores them relative to
+// the position, since the position can be reached at different plies.
+int
+to_table_score(int score, unsigned ply) noexcept
+{
+  if (score >= kMateBound)
+    return score + ply;
+  if (score <= -kMateBound)
+    return score - ply;
+  return score;
+}
+
+int
+from_table_score(int score, unsigned ply) noexcept
+{
+  if (score >= kMateBound)
+    return score - ply;
+  if (score <= -kMateBound)
+    return score + ply;
+  return score;
+}
+
+// Returns true if |mv| is neither a capture nor a promotion.
+bool
+is_quiet(const Move& mv) noexcept
+{ return not mv.is_capture() and not mv.is_promo(); }
+
+// Returns the move that leads to |board|.
+Move
+move_to(const Board& board) noexcept
+{
+  auto last_move = board.last_move();
+  assert(last_move);
+  return *last_move;
+}
+
+} // namespace
+
+struct AlphaBeta::Table {
+  struct Entry {
+    std::uint64_t key = 0;
+    std::optional<Move> mv;
+    std::int16_t score = 0;
+    std::uint8_t depth = 0;
+    Bound bound = Bound::Exact;
+  };
+
+  explicit
+  Table(std::size_t bytes)
+    : entries(std::max<std::size_t>(1, bytes / sizeof(Entry))) {}
+
+  // Returns the entry for |key|, or nullptr if there is none.
+  const Entry*
+  probe(std::uint64_t key) const noexcept
+  {
+    const auto& entry = entries[key % entries.size()];
+    return entry.mv and entry.key == key ? &entry : nullptr;
+  }
+
+  // Stores the entry, unless it would replace a deeper entry of the same
+  // position. Entries of other positions are always replaced, since the newer
+  // entry is more likely to be needed again.
+  void
+  store(const Entry& entry) noexcept
+  {
+    auto& old_entry = entries[entry.key % entries.size()];
+    if (old_entry.mv and old_entry.key == entry.key
+        and old_entry.depth > entry.depth)
+      return;
+    old_entry = entry;
+  }
+
+  std::vector<Entry> entries;
+};
+
+class AlphaBeta::Searcher {
+public:
+  Searcher(Table& table, const Nnue* nnue, const SearchLimits& limits)
+    : table(table),
+      nnue(nnue),
+      limits(limits),
+      accumulators(nnue ? kMaxPly + 1 : 0)
+  { timer.start(); }
+
+  // Runs the iterative deepening up to |max_depth| from the root of
+  // |board_path|.
+  SearchResult
+  run(const EvalBoardPath& board_path, unsigned max_depth);
+
+private:
+  // Searches |board| to |depth| within the window (|alpha|, |beta|).
+  int
+  search(const Board& board, int depth, int alpha, int beta, unsigned ply,
+         bool is_pv);
+
+  // Searches the captures and promotions from |board|, or all the moves if in
+  // check, until the position is quiet.
+  int
+  quiesce(const Board& board, int alpha, int beta, unsigned ply);
+
+  // Searches the root moves in |order| to |depth|, and moves the best one to
+  // the front. Returns the score of the best move, or nullopt if the search was
+  // stopped before the score of any move was known.
+  std::optional<int>
+  search_root(std::span<const Board> children, std::vector<unsigned>& order,
+              int depth);
+
+  // Returns the indices of |children| ordered by how likely they are to cause a
+  // cutoff, with |table_move| first.
+  std::vector<unsigned>
+  order_moves(std::span<const Board> children,
+              const std::optional<Move>& table_move,
+              unsigned ply) const;
+
+  // Records a quiet move that caused a cutoff.
+  void
+  add_cutoff(const Move& mv, int depth, unsigned ply) noexcept;
+
+  // Returns true if |board| repeats a position since the last capture or pawn
+  // move on the path from the start of the history.
+  bool
+  is_repetition(const Board& board) const noexcept;
+
+  // Counts a node, and returns true if the search should stop.
+  bool
+  count_node() noexcept;
+
+  // Updates the accumulator at |ply| for |child| from the accumulator of its
+  // parent, when evaluating with a network.
+  void
+  update_accumulator(const Board& child, unsigned ply) noexcept
+  {
+    if (nnue)
+      nnue->update(accumulators[ply - 1], child, accumulators[ply]);
+  }
+
+  // Returns the evaluation of |board| at |ply|.
+  int
+  evaluate(const Board& board, unsigned ply) const noexcept
+  {
+    return nnue
+      ? nnue->evaluate(accumulators[ply], board.is_white_next())
+      : AlphaBeta::evaluate(board);
+  }
+
+  Table& table;
+  const Nnue* nnue;
+  const SearchLimits& limits;
+  Timer timer;
+
+  unsigned nodes = 0;
+  unsigned nodes_expanded = 0;
+  bool stopped = false;
+
+  // The hashes of the positions from the oldest board in the history to the
+  // parent of the current node.
+  std::vector<std::uint64_t> path;
+
+  // The accumulators of the network along the current branch, by ply.
+  std::vector<Nnue::Accumulator> accumulators;
+
+  // Two quiet moves per ply that recently caused a cutoff at that ply.
+  std::array<std::array<std::optional<Move>, 2>, kMaxPly> killers{};
+
+  // How often quiet moves caused cutoffs, indexed by from and to squares.
+  std::array<std::array<int, 64>, 64> history{};
+};
+
+SearchResult
+AlphaBeta::Searcher::run(const EvalBoardPath& board_path, unsigned max_depth)
+{
+  const auto& root = board_path.root()->get();
+
+  // The board path goes from the root back in time, so walk it in reverse.
+  std::vector<const Board*> boards;
+  for (const auto& board : board_path)
+    boards.push_back(&board);
+  for (auto iter = boards.rbegin(); iter != boards.rend(); ++iter)
+    path.push_back((*iter)->hash());
+  path.pop_back();
+
+  auto children = root.next();
+  if (children.empty())
+    throw std::length_error("children should be non-empty.");
+
+  std::vector<unsigned> order = order_moves(children, std::nullopt, 0);
+
+  unsigned best_index = order.front();
+  int best_score = 0;
+  unsigned completed_depth = 0;
+  bool has_score = false;
+
+  path.push_back(root.hash());
+  if (nnue)
+    nnue->refresh(root, accumulators[0]);
+
+  for (unsigned depth = 1; depth <= max_depth; ++depth) {
+    auto score = search_root(children, order, depth);
+    if (score) {
+      best_index = order.front();
+      best_score = *score;
+      has_score = true;
+    }
+    if (stopped)
+      break;
+    completed_depth = depth;
+
+    // A mate within the depth is found with every move searched, so deeper
+    // searches cannot find a shorter one.
+    if (is_mate_score(best_score)
+        and kMate - std::abs(best_score) <= static_cast<int>(depth))
+      break;
+  }
+
+  if (not has_score)
+    best_score = evaluate(root, 0);
+
+  timer.end();
+
+  SearchResult result;
+  result.moves.reserve(children.size());
+  for (unsigned i = 0; i < children.size(); ++i) {
+    result.moves.push_back(MoveProb{
+      .mv=move_to(children[i]),
+      .visits=i == best_index ? 1u : 0u
+    });
+  }
+  result.best = BoardProb{
+    .board=std::move(children[best_index]),
+    .prior=1,
+    .visits=1
+  };
+  result.value = std::tanh(best_score / 400.0f);
+  result.nodes_expanded = nodes_expanded;
+  result.nodes_visited = nodes;
+  result.depth = completed_depth;
+  result.millis_search_time = timer.total_millis();
+  return result;
+}
+
+std::optional<int>
+AlphaBeta::Searcher::search_root(
+    std::span<const Board> children,
+    std::vector<unsigned>& order,
+    int depth)
+{
+  int alpha = -kInfinity;
+  const int beta = kInfinity;
+  std::optional<unsigned> best;
+
+  for (unsigned i = 0; i < order.size(); ++i) {
+    const auto& child = children[order[i]];
+    update_accumulator(child, 1);
+
+    int score = 0;
+    if (i == 0) {
+      score = -search(child, depth - 1, -beta, -alpha, 1, true);
+    } else {
+      score = -search(child, depth - 1, -alpha - 1, -alpha, 1, false);
+      if (score > alpha and not stopped)
+        score = -search(child, depth - 1, -beta, -alpha, 1, true);
+    }
+    if (stopped)
+      break;
+
+    if (score > alpha) {
+      alpha = score;
+      best = i;
+    }
+  }
+
+  if (not best)
+    return std::nullopt;
+
+  // Keep the order of the other moves, which had the best scores so far.
+  std::rotate(order.begin(), order.begin() + *best, order.begin() + *best + 1);
+  return alpha;
+}
+
+int
+AlphaBeta::Searcher::search(
+    const Board& board,
+    int depth,
+    int alpha,
+    int beta,
+    unsigned ply,
+    bool is_pv)
+{
+  if (board.is_terminal())
+    return board.is_mate() ? -kMate + static_cast<int>(ply) : 0;
+  if (is_repetition(board))
+    return 0;
+  if (ply >= kMaxPly)
+    return evaluate(board, ply);
+
+  // Extend checks, since the forced replies are cheap to search, and often
+  // lead to a mate or a loss of material that is beyond the horizon otherwise.
+  const bool in_check = board.is_check();
+  if (in_check)
+    ++depth;
+  if (depth <= 0)
+    return quiesce(board, alpha, beta, ply);
+
+  if (count_node())
+    return 0;
+
+  const auto key = board.hash();
+  std::optional<Move> table_move;
+  if (const auto* entry = table.probe(key)) {
+    table_move = entry->mv;
+    if (not is_pv and entry->depth >= depth) {
+      int score = from_table_score(entry->score, ply);
+      if (entry->bound == Bound::Exact
+          or (entry->bound == Bound::Lower and score >= beta)
+          or (entry->bound == Bound::Upper and score <= alpha))
+        return score;
+    }
+  }
+
+  auto children = board.next();
+  ++nodes_expanded;
+  auto order = order_moves(children, table_move, ply);
+
+  const int orig_alpha = alpha;
+  int best_score = -kInfinity;
+  std::optional<Move> best_move;
+
+  path.push_back(key);
+  for (unsigned i = 0; i < order.size(); ++i) {
+    const auto& child = children[order[i]];
+    const auto mv = move_to(child);
+    update_accumulator(child, ply + 1);
+
+    int score = 0;
+    if (i == 0) {
+      score = -search(child, depth - 1, -beta, -alpha, ply + 1, is_pv);
+    } else {
+      // Late quiet moves are unlikely to be best, so search them less deeply,
+      // and only search them fully if they turn out better than expected.
+      const int reduction =
+        i >= 4 and depth >= 3 and not in_check and is_quiet(mv)
+        and not child.is_check() ? 1 : 0;
+
+      score = -search(
+          child, depth - 1 - reduction, -alpha - 1, -alpha, ply + 1, false);
+      if (score > alpha and reduction)
+        score = -search(child, depth - 1, -alpha - 1, -alpha, ply + 1, false);
+      if (score > alpha and score < beta)
+        score = -search(child, depth - 1, -beta, -alpha, ply + 1, true);
+    }
+    if (stopped)
+      break;
+
+    if (score > best_score) {
+      best_score = score;
+      best_move = mv;
+    }
+    if (score > alpha)
+      alpha = score;
+    if (alpha >= beta) {
+      if (is_quiet(mv))
+        add_cutoff(mv, depth, ply);
+      break;
+    }
+  }
+  path.pop_back();
+
+  if (stopped)
+    return 0;
+
+  const auto bound = best_score <= orig_alpha
+    ? Bound::Upper
+    : best_score >= beta ? Bound::Lower : Bound::Exact;
+  table.store(Table::Entry{
+    .key=key,
+    .mv=best_move,
+    .score=static_cast<std::int16_t>(to_table_score(best_score, ply)),
+    .depth=static_cast<std::uint8_t>(depth),
+    .bound=bound
+  });
+
+  return best_score;
+}
+
+int
+AlphaBeta::Searcher::quiesce(
+    const Board& board,
+    int alpha,
+    int beta,
+    unsigned ply)
+{
+  if (board.is_terminal())
+    return board.is_mate() ? -kMate + static_cast<int>(ply) : 0;
+  if (count_node())
+    return 0;
+  if (ply >= kMaxPly)
+    return evaluate(board, ply);
+
+  // The player can choose not to capture, unless in check.
+  const bool in_check = board.is_check();
+  int best_score = -kInfinity;
+  if (not in_check) {
+    best_score = evaluate(board, ply);
+    if (best_score >= beta)
+      return best_score;
+    alpha = std::max(alpha, best_score);
+  }
+
+  auto children = board.next();
+  ++nodes_expanded;
+  auto order = order_moves(children, std::nullopt, ply);
+
+  for (auto index : order) {
+    const auto& child = children[index];
+    if (not in_check and is_quiet(move_to(child)))
+      continue;
+
+    update_accumulator(child, ply + 1);
+    int score = -quiesce(child, -beta, -alpha, ply + 1);
+    if (stopped)
+      return 0;
+
+    best_score = std::max(best_score, score);
+    alpha = std::max(alpha, score);
+    if (alpha >= beta)
+      break;
+  }
+
+  return best_score;
+}
+
+std::vector<unsigned>
+AlphaBeta::Searcher::order_moves(
+    std::span<const Board> children,
+    const std::optional<Move>& table_move,
+    unsigned ply) const
+{
+  const auto& ply_killers = killers[std::min(ply, kMaxPly - 1)];
+
+  std::vector<std::pair<int, unsigned>> scores;
+  scores.reserve(children.size());
+  for (unsigned i = 0; i < children.size(); ++i) {
+    const auto mv = move_to(children[i]);
+
+    int score = 0;
+    if (table_move and mv == *table_move) {
+      score = 1 << 30;
+    } else if (not is_quiet(mv)) {
+      // Most valuable victim first, and the least valuable attacker to break
+      // ties.
+      int gain = mv.capture() ? 10 * kPieceValues[to_int(mv.capture()->type())]
+                              : 0;
+      if (auto promoted = mv.promoted())
+        gain += kPieceValues[to_int(promoted->type())];
+      score = (1 << 20) + gain - kPieceValues[to_int(mv.piece().type())] / 10;
+    } else if (ply_killers[0] and mv == *ply_killers[0]) {
+      score = (1 << 19) + 1;
+    } else if (ply_killers[1] and mv == *ply_killers[1]) {
+      score = 1 << 19;
+    } else {
+      score = history[mv.from()][mv.to()];
+    }
+    scores.emplace_back(score, i);
+  }
+
+  std::stable_sort(scores.begin(), scores.end(),
+      [](const auto& left, const auto& right) {
+        return left.first > right.first;
+      });
+
+  std::vector<unsigned> order;
+  order.reserve(scores.size());
+  for (const auto& [score, index] : scores)
+    order.push_back(index);
+  return order;
+}
+
+void
+AlphaBeta::Searcher::add_cutoff(const Move& mv, int depth, unsigned ply) noexcept
+{
+  auto& ply_killers = killers[ply];
+  if (not ply_killers[0] or not (mv == *ply_killers[0])) {
+    ply_killers[1] = ply_killers[0];
+    ply_killers[0] = mv;
+  }
+
+  // Keep the history below the killers.
+  auto& count = history[mv.from()][mv.to()];
+  count = std::min(count + depth * depth, (1 << 19) - 1);
+}
+
+bool
+AlphaBeta::Searcher::is_repetition(const Board& board) const noexcept
+{
+  // Only positions with the same player moving next can repeat, and neither
+  // captures nor pawn moves can be undone.
+  const auto n = path.size();
+  for (unsigned ply = 2; ply <= board.hm_count() and ply <= n; ply += 2) {
+    if (path[n - ply] == board.hash())
+      return true;
+  }
+  return false;
+}
+
+bool
+AlphaBeta::Searcher::count_node() noexcept
+{
+  if (stopped)
+    return true;
+
+  ++nodes;
+  if (limits.nodes and nodes >= limits.nodes)
+    stopped = true;
+  else if (nodes % kCheckInterval == 0)
+    stopped = (limits.time != Milliseconds(0)
+               and timer.elapsed() >= limits.time)
+              or limits.stop_token.stop_requested();
+  return stopped;
+}
+
+AlphaBeta::AlphaBeta(unsigned depth, std::size_t table_bytes)
+  : max_depth(depth),
+    table(std::make_unique<Table>(table_bytes))
+{
+  if (not depth)
+    throw std::invalid_argument("depth must be non-zero.");
+}
+
+AlphaBeta::~AlphaBeta() = default;
+
+SearchResult
+AlphaBeta::run(const EvalBoardPath& board_path) const
+{ return run(board_path, SearchLimits{.depth=max_depth}); }
+
+SearchResult
+AlphaBeta::run(const EvalBoardPath& board_path, const SearchLimits& limits) const
+{
+  auto root = board_path.root();
+  if (not root)
+    throw std::invalid_argument("EvalBoardPath should have a root.");
+  if (root->get().is_terminal())
+    throw std::invalid_argument("Board is in a terminal state.");
+
+  // The simulation limit does not apply, so it does not bound the search.
+  const bool is_bounded = limits.nodes or limits.time != Milliseconds(0)
+                          or limits.stop_token.stop_possible();
+
+  unsigned depth = max_depth;
+  if (limits.depth)
+    depth = limits.depth;
+  else if (is_bounded)
+    depth = kMaxDepth;
+
+  std::lock_guard lock(table_mtx);
+  Searcher searcher(*table, nnue.get(), limits);
+  return searcher.run(board_path, depth);
+}
+
+void
+AlphaBeta::set_network(std::shared_ptr<const Nnue> nnue)
+{
+  std::lock_guard lock(table_mtx);
+  this->nnue = std::move(nnue);
+}
+
+int
+AlphaBeta::evaluate(const Board& board) noexcept
+{
+  const auto& white = board.white();
+  const auto& black = board.black();
+  const bool is_endgame =
+    piece_material(white) + piece_material(black) <= kEndgameMaterial;
+
+  const int score = score_pieces(white, true, is_endgame)
+                    - score_pieces(black, false, is_endgame);
+  return board.is_white_next() ? score : -score;
+}
+
+} // namespace blunder
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "board.h"
+#include "board_path.h"
+#include "nnue.h"
+#include "search.h"
+#include "search_limits.h"
+
+namespace blunder {
+
+// A classical chess search, i.e. iterative deepening alpha-beta with principal
+// variation search, a transposition table, quiescence search over captures,
+// and a material and piece-square table evaluation. It does not need a network,
+// so it serves as a baseline opponent and a source of games to bootstrap
+// training from.
+class AlphaBeta : public Search {
+public:
+  // Initializes the search with the depth to search to in plies, and the size
+  // of the transposition table in bytes. The table is kept between runs.
+  explicit
+  AlphaBeta(unsigned depth, std::size_t table_bytes = 16 << 20);
+
+  ~AlphaBeta();
+
+  // Evaluates the positions with |nnue| rather than with the material and
+  // piece-square tables, where the accumulators are updated incrementally along
+  // the branch being searched. A null network restores the tables.
+  void
+  set_network(std::shared_ptr<const Nnue> nnue);
+
+  // Searches to the depth set in the constructor.
+  SearchResult
+  run(const EvalBoardPath& board_path) const override;
+
+  // Deepens the search until one of |limits| is reached, where the simulation
+  // limit does not apply. Without a depth, node, time, or stop limit, it
+  // searches to the depth set in the constructor. The move is from the last
+  // completed depth, or from the unfinished depth if it already improved on it.
+  //
+  // The result has a visit only for the best move, so its policy is one-hot,
+  // and the value is the score of the best move squashed to (-1, 1).
+  SearchResult
+  run(const EvalBoardPath& board_path,
+      const SearchLimits& limits) const override;
+
+  // Returns the static evaluation of |board| in centipawns from the
+  // perspective of the player moving next.
+  static int
+  evaluate(const Board& board) noexcept;
+
+private:
+  // The transposition table.
+  struct Table;
+  // The state of a single run.
+  class Searcher;
+
+  unsigned max_depth;
+  std::unique_ptr<Table> table;
+  std::shared_ptr<const Nnue> nnue;
+  // Only one run at a time can use the table, and the network is only replaced
+  // between runs.
+  mutable std::mutex table_mtx;
+};
+
+} // namespace blunder
@@ -1,10 +1,12 @@
 #include "alpha_zero_encoder.h"
 
 #include <cassert>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
 #include <span>
 #include <stdexcept>
+#include <utility>
 
 #include "board.h"
 #include "board_path.h"
@@ -39,6 +41,20 @@ encode_pieces(int plane, const PieceSet& pieces, torch::Tensor& tensor) {
   }
 }
 
+// Encodes the number of times the board's position occurred earlier in the
+// game in the two repetition planes, i.e. the first plane is set if the position
+// occurred before, and the second if it occurred twice before.
+void
+encode_repetitions(int plane, const Board& board, torch::Tensor& tensor) {
+  for (unsigned i = 0; i < 2; ++i, ++plane) {
+    if (board.repetitions() > i) {
+      auto index = std::initializer_list<tix::TensorIndex>{
+        plane, tix::Slice(), tix::Slice()};
+      tensor.index_put_(index, 1.0);
+    }
+  }
+}
+
 } // namespace
 
 
@@ -78,7 +94,7 @@ AlphaZeroEncoder::encode_state(const EvalBoardPath& board_path) const
       encode_pieces(plane, *black, tensor);
       plane += 6;
 
-      // TODO: Set repetition planes for each board.
+      encode_repetitions(plane, board, tensor);
       plane += 2;
     }
   } else {
@@ -93,7 +109,7 @@ AlphaZeroEncoder::encode_state(const EvalBoardPath& board_path) const
       encode_pieces(plane, black->flip(), tensor);
       plane += 6;
 
-      // TODO: Set repetition planes for each board.
+      encode_repetitions(plane, board, tensor);
       plane += 2;
     }
   }
@@ -129,18 +145,20 @@ AlphaZeroEncoder::encode_moves(std::span<const BoardProb> moves) const
   for (const auto& mv : moves)
     total += mv.visits;
 
-  auto tensor = torch::zeros({73, 8, 8},
-                             torch::requires_grad(with_grad_enabled));
+  // Fill the planes through an accessor rather than with index_put_, which
+  // dispatches a full tensor operation for every move.
+  auto tensor = torch::zeros({73, 8, 8});
+  auto planes = tensor.accessor<float, 3>();
 
   for (const auto& mv : moves) {
     auto last_move = mv.board.last_move();
     assert(last_move.has_value());
     auto mv_code = encode_move(*last_move);
     float prob = static_cast<float>(mv.visits) / total;
-    tensor.index_put_({mv_code.code, mv_code.row, mv_code.col}, prob);
+    planes[mv_code.code][mv_code.row][mv_code.col] = prob;
   }
 
-  return tensor;
+  return tensor.requires_grad_(with_grad_enabled);
 }
 
 torch::Tensor
@@ -152,16 +170,42 @@ AlphaZeroEncoder::encode_moves(std::span<const MoveProb> moves) const
   for (const auto& mv : moves)
     total += mv.visits;
 
-  auto tensor = torch::zeros({73, 8, 8},
-                             torch::requires_grad(with_grad_enabled));
+  auto tensor = torch::zeros({73, 8, 8});
+  auto planes = tensor.accessor<float, 3>();
 
   for (const auto& mv : moves) {
     auto mv_code = encode_move(mv.mv);
     float prob = static_cast<float>(mv.visits) / total;
-    tensor.index_put_({mv_code.code, mv_code.row, mv_code.col}, prob);
+    planes[mv_code.code][mv_code.row][mv_code.col] = prob;
   }
 
-  return tensor;
+  return tensor.requires_grad_(with_grad_enabled);
+}
+
+SparsePolicy
+AlphaZeroEncoder::encode_policy(std::span<const PolicyEntry> policy) const
+{
+  assert(not policy.empty());
+
+  unsigned total = 0;
+  for (const auto& entry : policy)
+    total += entry.visits;
+
+  const std::int64_t n = policy.size();
+  auto indices = torch::empty({n}, torch::kLong);
+  auto probs = torch::empty({n});
+  auto index_data = indices.data_ptr<std::int64_t>();
+  auto prob_data = probs.data_ptr<float>();
+
+  for (const auto& entry : policy) {
+    *index_data++ = entry.index;
+    *prob_data++ = total ? static_cast<float>(entry.visits) / total : 0;
+  }
+
+  return SparsePolicy{
+    .indices=std::move(indices),
+    .probs=std::move(probs)
+  };
 }
 
 } // namespace blunder
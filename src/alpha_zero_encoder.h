@@ -4,6 +4,7 @@
 
 #include "board.h"
 #include "board_path.h"
+#include "coding_util.h"
 #include "search_result.h"
 #include "tensor_encoder.h"
 
@@ -26,6 +27,11 @@ public:
   // Encodes the moves for the Board as a tensor for training.
   torch::Tensor
   encode_moves(std::span<const MoveProb> moves) const override;
+
+  // Encodes the sparse policy as pairs of (index, probability) tensors for
+  // training.
+  SparsePolicy
+  encode_policy(std::span<const PolicyEntry> policy) const override;
 };
 
 } // namespace
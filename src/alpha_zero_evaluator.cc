@@ -12,8 +12,11 @@ AlphaZeroEvaluator::predict(const EvalBoardPath& board_path) const
   if (not root)
     throw std::invalid_argument("board_path should have at least one board.");
 
+  // Evaluation never needs gradients, so skip the autograd bookkeeping.
+  c10::InferenceMode inference_mode;
+
   auto input_tensor = tensor_encoder->encode_state(board_path);
-  input_tensor = input_tensor.unsqueeze(0).to(torch::kCUDA);
+  input_tensor = input_tensor.unsqueeze(0).to(net->device());
 
   auto [policy_tensor, value_tensor] = net->forward(input_tensor);
   policy_tensor = policy_tensor.to(torch::kCPU);
@@ -14,10 +14,13 @@ namespace blunder {
 
 class AlphaZeroEvaluator : public Evaluator {
 public:
+  // The weights of |net| are converted to |memory_format| once here, e.g. to
+  // channels last for faster convolutions on CPU.
   AlphaZeroEvaluator(
       std::shared_ptr<AlphaZeroNet> net,
       std::shared_ptr<TensorDecoder> tensor_decoder,
-      std::shared_ptr<TensorEncoder> tensor_encoder)
+      std::shared_ptr<TensorEncoder> tensor_encoder,
+      torch::MemoryFormat memory_format = torch::MemoryFormat::Contiguous)
     : net(std::move(net)),
       tensor_decoder(std::move(tensor_decoder)),
       tensor_encoder(std::move(tensor_encoder))
@@ -26,6 +29,7 @@ public:
     assert(this->tensor_decoder);
     assert(this->tensor_encoder);
     this->net->set_eval_mode();
+    this->net->set_memory_format(memory_format);
   }
 
   Prediction
@@ -1,12 +1,112 @@
 #include "blunder_player.h"
 
+#include <exception>
+#include <random>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include "search_limits.h"
+
 namespace blunder {
 
 SearchResult
 BlunderPlayer::make_move(const GameBoardPath& boards)
 {
+  stop_pondering();
+
+  // The first board is the start of the game.
+  if (book and boards.size() <= book_options.max_plies) {
+    auto result = book->sample(boards.fast_back(), book_options, rand_gen);
+    if (result)
+      return *result;
+  }
+
   auto board_path = EvalBoardPath::rev(boards);
-  return mcts->run(board_path);
+  auto result = search(board_path);
+
+  if (ponder_simulations and not result.best.board.is_terminal())
+    ponder(boards, result.best.board);
+
+  return result;
+}
+
+void
+BlunderPlayer::set_pondering(unsigned max_simulations)
+{
+  stop_pondering();
+  ponder_simulations = max_simulations;
+}
+
+void
+BlunderPlayer::set_opening_book(
+    std::shared_ptr<const OpeningBook> book,
+    BookOptions options)
+{
+  this->book = std::move(book);
+  book_options = options;
+}
+
+SearchResult
+BlunderPlayer::search(const EvalBoardPath& board_path)
+{
+  if (not playout_cap.is_enabled())
+    return mcts->run(board_path);
+
+  std::bernoulli_distribution full_search(playout_cap.full_search_prob);
+  if (full_search(rand_gen))
+    return mcts->run(board_path);
+
+  auto result = mcts->run(board_path, SearchLimits{
+    .simulations=playout_cap.fast_simulations,
+    .root_noise=false
+  });
+  result.policy_target = false;
+  return result;
+}
+
+void
+BlunderPlayer::ponder(const GameBoardPath& boards, const Board& next_board)
+{
+  // Copy the boards needed for the board path of the ponder position, since
+  // the game may not keep them around while the opponent thinks.
+  const unsigned skip = boards.size() >= EvalBoardPath::capacity()
+    ? boards.size() - EvalBoardPath::capacity() + 1
+    : 0;
+
+  ponder_boards.clear();
+  unsigned i = 0;
+  for (const auto& board : boards) {
+    if (i++ >= skip)
+      ponder_boards.push_back(board);
+  }
+  ponder_boards.push_back(next_board);
+
+  ponder_thread = std::jthread([this](std::stop_token stop_token) {
+    try {
+      auto board_path = EvalBoardPath::rev(ponder_boards);
+      mcts->run(board_path, SearchLimits{
+        .simulations=ponder_simulations,
+        .stop_token=std::move(stop_token),
+        .stop_when_decided=false,
+        .root_noise=false
+      });
+    } catch (...) {
+      ponder_error = std::current_exception();
+    }
+  });
+}
+
+void
+BlunderPlayer::stop_pondering()
+{
+  if (ponder_thread.joinable()) {
+    ponder_thread.request_stop();
+    ponder_thread.join();
+  }
+
+  if (auto error = std::exchange(ponder_error, nullptr))
+    std::rethrow_exception(error);
 }
 
 } // namespace blunder
@@ -1,17 +1,41 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <exception>
 #include <memory>
+#include <random>
 #include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
+#include "board.h"
 #include "board_path.h"
+#include "opening_book.h"
 #include "player.h"
 #include "search.h"
 #include "search_result.h"
 
 namespace blunder {
 
+// Playout cap randomization for self play: most moves are played with a cheap
+// search, and only a random fraction of the moves with the full search, whose
+// visit counts are the policy targets. The cheap searches still play the games
+// to the end, and hence add value targets, at a fraction of the cost.
+struct PlayoutCap {
+  // The number of simulations of a cheap search.
+  unsigned fast_simulations = 0;
+
+  // The probability of running the full search on a move.
+  float full_search_prob = 1;
+
+  // Returns true if some of the moves use a cheap search.
+  bool
+  is_enabled() const noexcept
+  { return fast_simulations and full_search_prob < 1; }
+};
+
 class BlunderPlayer : public Player {
 public:
   explicit
@@ -21,15 +45,73 @@ public:
     assert(this->mcts);
   }
 
+  // Initializes the player with playout cap randomization, where |seed| seeds
+  // the choice between the cheap and the full search.
+  BlunderPlayer(
+      std::shared_ptr<Search> mcts,
+      PlayoutCap playout_cap,
+      std::uint64_t seed)
+    : mcts(std::move(mcts)),
+      playout_cap(playout_cap),
+      rand_gen(seed)
+  {
+    assert(this->mcts);
+  }
+
+  // Returns the move for the last board in |boards|. With pondering, the ponder
+  // search is stopped first, and an error from it is rethrown here.
   SearchResult
   make_move(const GameBoardPath& boards) override;
 
+  // Ponders on the opponent's turn, i.e. after returning a move, keeps
+  // searching the position after the move in the background, for up to
+  // |max_simulations| simulations or until the next call to make_move. This
+  // only pays off with a search that keeps its tree between runs, e.g. Mcts
+  // with tree reuse, such that the next search continues from the subtree of
+  // the opponent's move. Zero disables pondering, which is the default.
+  void
+  set_pondering(unsigned max_simulations);
+
+  // Plays the moves from |book| with |options| in the first plies of the game
+  // instead of searching, as long as the position is in the book. A null book
+  // disables the book, which is the default.
+  void
+  set_opening_book(
+      std::shared_ptr<const OpeningBook> book,
+      BookOptions options);
+
   std::string_view
   name() const noexcept
   { return "Blunder"; }
 
 private:
+  // Runs the search for the move.
+  SearchResult
+  search(const EvalBoardPath& board_path);
+
+  // Starts pondering on |next_board|, the position after the move played from
+  // the last board in |boards|.
+  void
+  ponder(const GameBoardPath& boards, const Board& next_board);
+
+  // Stops the ponder search and waits for it to finish.
+  void
+  stop_pondering();
+
   std::shared_ptr<Search> mcts;
+  PlayoutCap playout_cap;
+  std::mt19937_64 rand_gen;
+  unsigned ponder_simulations = 0;
+  std::shared_ptr<const OpeningBook> book;
+  BookOptions book_options;
+
+  // The boards that lead up to the ponder position, which the ponder search
+  // points to.
+  std::vector<Board> ponder_boards;
+  std::exception_ptr ponder_error;
+  // Declared last, since the thread is stopped and joined on destruction before
+  // the members it uses are destroyed.
+  std::jthread ponder_thread;
 };
 
 } // namespace  blunder
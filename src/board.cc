@@ -1,13 +1,16 @@
 #include "board.h"
 
 #include <algorithm>
+#include <array>
 #include <bit>
+#include <cstdint>
 #include <format>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <type_traits>
 
 #include "bitboard.h"
 #include "magic_attacks.h"
@@ -17,26 +20,77 @@
 #include "square.h"
 
 namespace blunder {
+
+// Boards are copied for every child during move generation and search, so make
+// sure that copies remain cheap.
+static_assert(std::is_trivially_copyable_v<Board>);
+
 namespace {
 
 namespace rng = std::ranges;
 
+constexpr Type kPieceTypes[] = {
+  Type::King,
+  Type::Queen,
+  Type::Rook,
+  Type::Bishop,
+  Type::Knight,
+  Type::Pawn
+};
+
+// Random keys to compute the Zobrist hash of a position. A position is hashed
+// by XOR-ing the keys for every piece on a square, for black moving next, and
+// for every castling and en passant right.
+struct ZobristKeys {
+  // Indexed by piece type, plus 6 for black pieces, and square.
+  std::array<std::array<std::uint64_t, 64>, 12> pieces;
+  std::uint64_t black_next;
+  std::array<std::uint64_t, 4> castling;
+  std::array<std::uint64_t, 8> en_passant;
+};
+
+// Generates the Zobrist keys at compile time with SplitMix64, so the hashes are
+// stable across runs.
+constexpr ZobristKeys
+make_zobrist_keys() noexcept
+{
+  std::uint64_t state = 0x9e3779b97f4a7c15ull;
+  auto next_key = [&state] {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  };
+
+  ZobristKeys keys{};
+  for (auto& piece_keys : keys.pieces)
+    for (auto& key : piece_keys)
+      key = next_key();
+  keys.black_next = next_key();
+  for (auto& key : keys.castling)
+    key = next_key();
+  for (auto& key : keys.en_passant)
+    key = next_key();
+  return keys;
+}
+
+constexpr ZobristKeys kZobristKeys = make_zobrist_keys();
+
+// Returns the Zobrist key of |piece| of |color| on |square|.
+std::uint64_t
+piece_key(Color color, Piece piece, unsigned square) noexcept
+{
+  auto i = to_int(piece.type()) + (color == Color::White ? 0 : 6);
+  return kZobristKeys.pieces[i][square];
+}
+
 void
 fill_ascii_board(
     const PieceSet& pieces,
     Color color,
     std::array<char, 64>& board)  noexcept
 {
-  const Type piece_type[] = {
-    Type::King,
-    Type::Queen,
-    Type::Rook,
-    Type::Bishop,
-    Type::Knight,
-    Type::Pawn
-  };
-
-  for (auto type : piece_type) {
+  for (auto type : kPieceTypes) {
     auto bb = pieces.get(type);
     auto squares = to_set_of_sq(bb);
     for (auto sq : squares) {
@@ -232,6 +286,7 @@ Board::new_board() noexcept
 
   board.set_attacked_by_mine();
   board.set_attacked_by_other();
+  board.zobrist = board.compute_hash();
 
   return board;
 }
@@ -251,6 +306,65 @@ Board::eq(const Board& bs) const noexcept
      and bq_castle == bs.bq_castle;
 }
 
+bool
+Board::is_same_position(const Board& bs) const noexcept
+{
+  return bb_mine == bs.bb_mine
+     and bb_other == bs.bb_other
+     and next_to_move == bs.next_to_move
+     and en_passant == bs.en_passant
+     and en_passant_file == bs.en_passant_file
+     and wk_castle == bs.wk_castle
+     and wq_castle == bs.wq_castle
+     and bk_castle == bs.bk_castle
+     and bq_castle == bs.bq_castle;
+}
+
+std::uint64_t
+Board::compute_hash() const noexcept
+{
+  std::uint64_t hash = 0;
+  auto [white_pieces, black_pieces] = white_black();
+
+  for (auto type : kPieceTypes) {
+    auto i = to_int(type);
+    for (auto square : white_pieces->get(type).square_iter())
+      hash ^= kZobristKeys.pieces[i][square];
+    for (auto square : black_pieces->get(type).square_iter())
+      hash ^= kZobristKeys.pieces[i + 6][square];
+  }
+
+  if (not is_white_next())
+    hash ^= kZobristKeys.black_next;
+
+  return hash ^ rights_hash();
+}
+
+std::uint64_t
+Board::rights_hash() const noexcept
+{
+  std::uint64_t hash = 0;
+
+  const bool castling[] = {wk_castle, wq_castle, bk_castle, bq_castle};
+  for (unsigned i = 0; i < 4; ++i) {
+    if (castling[i])
+      hash ^= kZobristKeys.castling[i];
+  }
+
+  if (en_passant)
+    hash ^= kZobristKeys.en_passant[en_passant_file];
+
+  return hash;
+}
+
+void
+Board::set_repetition(const Board& earlier) noexcept
+{
+  reps = earlier.reps + 1;
+  if (reps >= 2)
+    game_state = GameState::Draw;
+}
+
 std::string
 Board::str() const
 {
@@ -502,13 +616,9 @@ Board::compute_game_state(bool is_king_captured) noexcept
     compute_game_state();
 }
 
-// TODO: need to figure out how to check for 3 move repetition. To check for
-// 3-move repetation, it's not actually checking the move, but that the position
-// of the board is not repeated three times after both players move. One way of
-// doing this would be to keep a history of every position leading up to the
-// current position, or enough state to be able to reconstruct it. We could also
-// compute a hash from the position to speed up comparison, and only do a full
-// state comparison when the hash values are equal.
+// Note that a Board does not keep the positions leading up to it, so threefold
+// repetition is detected by find_repetition, which is called by whoever holds
+// the game or search path.
 void
 Board::compute_game_state() noexcept
 {
@@ -528,8 +638,9 @@ Board::compute_game_state() noexcept
   // check mate.
   auto moves = all_moves();
   if (moves.empty()) {
-    // For now, we'll assume this means stalemate.
-    game_state = GameState::Draw;
+    // Without moves, e.g. a lone king with every square attacked, it is mate
+    // if in check, and stalemate otherwise.
+    game_state = is_check() ? GameState::Mate : GameState::Draw;
     return;
   }
 
@@ -643,8 +754,10 @@ Board::quick_update(Move mv)
       bq_castle = false;
     }
   }
-  // Remove castling right for specific rook if the rook is captured.
-  else if (mv.is_capture(Type::Rook)) {
+
+  // Remove castling right for specific rook if the rook is captured, which may
+  // also be by a rook or the king.
+  if (mv.is_capture(Type::Rook)) {
     if (is_white_next()) {
       if (to_square == 56)
         bq_castle = false;
@@ -670,9 +783,31 @@ Board::quick_update(Move mv)
 Board&
 Board::update(Move mv)
 {
+  // Only the keys of the pieces that moved or were captured, of the rights
+  // that changed, and of the color moving next are toggled in the hash.
+  const auto mover = next_to_move;
+  const auto other = is_white_next() ? Color::Black : Color::White;
+  auto hash = zobrist ^ rights_hash() ^ kZobristKeys.black_next;
+  hash ^= piece_key(mover, mv.piece(), mv.from());
+  hash ^= piece_key(mover, mv.promoted().value_or(mv.piece()), mv.to());
+
+  if (mv.is_enpassant())
+    hash ^= piece_key(other, *mv.capture(), mv.passant());
+  else if (mv.is_capture())
+    hash ^= piece_key(other, *mv.capture(), mv.to());
+
+  if (auto rk_from_to = mv.get_rook_from_to()) {
+    auto [rk_from, rk_to] = *rk_from_to;
+    hash ^= piece_key(mover, Piece::rook(), rk_from);
+    hash ^= piece_key(mover, Piece::rook(), rk_to);
+  }
+
   quick_update(mv);
   compute_game_state(mv.is_capture(Type::King));
-  prev_moves.push_back(mv);
+  prev_moves.push(mv);
+  zobrist = hash ^ rights_hash();
+  assert(zobrist == compute_hash());
+  reps = 0;
   return *this;
 }
 
@@ -864,7 +999,7 @@ Board::is_enough_material() const noexcept
     return false;
 
   if (my_count == 2 and other_count == 1)
-    return mine().bishop().count() == 0 and mine().knight().count() == 1;
+    return mine().bishop().count() == 0 and mine().knight().count() == 0;
 
   if (my_count == 1 and other_count == 2)
     return other().bishop().count() == 0 and other().knight().count() == 0;
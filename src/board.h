@@ -18,6 +18,7 @@
 #include "game_state.h"
 #include "magics.h"
 #include "move.h"
+#include "move_history.h"
 #include "moves.h"
 #include "pieces.h"
 #include "piece_set.h"
@@ -155,6 +156,70 @@ public:
   is_mate() const noexcept
   { return game_state == GameState::Mate; }
 
+  // Returns true if the player moving next is in check.
+  bool
+  is_check() const noexcept
+  {
+    assert(mine().king().count() == 1);
+    return mine().king() & other_attacks.pieces;
+  }
+
+  // Returns true if the player not moving next is in check, i.e. the position
+  // cannot be reached with legal moves.
+  bool
+  is_check_other() const noexcept
+  {
+    assert(other().king().count() == 1);
+    return other().king() & mine_attacks.pieces;
+  }
+
+  //-----------------------
+  // Repetition detection.
+  //-----------------------
+
+  // Returns the Zobrist hash of the position, i.e. of the pieces, the color
+  // moving next, and the castling and en passant rights. The move counters and
+  // the move history are not part of the hash.
+  std::uint64_t
+  hash() const noexcept
+  { return zobrist; }
+
+  // Returns the number of times this position occurred earlier in the game,
+  // as recorded by find_repetition. The game is drawn on the third occurrence,
+  // i.e. when this is 2.
+  unsigned
+  repetitions() const noexcept
+  { return reps; }
+
+  // Returns true if |other| has the same pieces, color moving next, and
+  // castling and en passant rights as this board.
+  bool
+  is_same_position(const Board& other) const noexcept;
+
+  // Looks for the most recent occurrence of this position in |history|, the
+  // boards leading up to this one ordered from the previous board to the
+  // oldest, and records the repetition if one is found. Only the boards since
+  // the last capture or pawn move are compared, since neither can be undone.
+  // Returns true if a repetition is found.
+  template<typename BoardRange>
+  bool
+  find_repetition(const BoardRange& history) noexcept
+  {
+    unsigned ply = 1;
+    for (const Board& earlier : history) {
+      if (ply > half_move)
+        break;
+      // Only boards with the same color moving next can be repetitions.
+      if (ply++ % 2)
+        continue;
+      if (earlier.zobrist == zobrist and is_same_position(earlier)) {
+        set_repetition(earlier);
+        return true;
+      }
+    }
+    return false;
+  }
+
   //---------------------------
   // Check for castling rights.
   //---------------------------
@@ -301,11 +366,12 @@ public:
   // string, which do not contain the game history.
   std::optional<Move>
   last_move() const noexcept
-  {
-    return prev_moves.empty()
-      ? std::nullopt
-      : std::make_optional(prev_moves.back());
-  }
+  { return prev_moves.last(); }
+
+  // Returns the most recent moves leading up to the current position.
+  const MoveHistory&
+  move_history() const noexcept
+  { return prev_moves; }
 
   // Updates this board with move |mv| if the move is pseudo-legal. Returns
   // true if the update succeeds, false otherwise.
@@ -365,6 +431,20 @@ private:
   Board&
   update(Move mv);
 
+  // Computes the Zobrist hash of the position from scratch.
+  std::uint64_t
+  compute_hash() const noexcept;
+
+  // Returns the part of the Zobrist hash for the castling and en passant
+  // rights.
+  std::uint64_t
+  rights_hash() const noexcept;
+
+  // Records that this position repeats |earlier|, and draws the game if this
+  // is the third occurrence of the position.
+  void
+  set_repetition(const Board& earlier) noexcept;
+
   // Computes simples moves for Bishops, Kights, Rooks, and Queens. Simple moves
   // consists of non-attack moves and attacks. |piece| is the piece moving, and
   // |moves_fn| is a function to compute moves for the given piece, including
@@ -429,22 +509,6 @@ private:
   bool
   is_enough_material() const noexcept;
 
-  // Returns true if the player moving next is in check.
-  bool
-  is_check() const noexcept
-  {
-    assert(mine().king().count() == 1);
-    return mine().king() & other_attacks.pieces;
-  }
-
-  // Returns true if the other player is in check.
-  bool
-  is_check_other() const noexcept
-  {
-    assert(other().king().count() == 1);
-    return other().king() & mine_attacks.pieces;
-  }
-
   friend BoardBuilder;
 
   // Note that we use static members for bmagics and rmagics below to avoid
@@ -473,10 +537,9 @@ private:
   PieceSet bb_mine;
   PieceSet bb_other;
 
-  // Previous moves. Most recent move is last move leading up to current position.
-  // TODO: consider creating a short ring buffer to only hold a few moves, e.g.
-  // enough to be able to detect 3 repetitions.
-  MoveVec prev_moves;
+  // The most recent moves leading up to the current position. This is bounded to
+  // keep Board trivially copyable and of a fixed size.
+  MoveHistory prev_moves;
 
   // Members to hold all of the squares that are attacked by each player.
   // |mine_attacks| are squares attacked by the player moving next, and
@@ -484,9 +547,15 @@ private:
   AttackSquares mine_attacks;
   AttackSquares other_attacks;
 
+  // The Zobrist hash of the position.
+  std::uint64_t zobrist = 0;
+
   std::uint16_t half_move = 0;
   std::uint16_t full_move = 0;
 
+  // The number of times the position occurred earlier in the game.
+  std::uint8_t reps = 0;
+
   // The next color to move.
   Color next_to_move;
 
@@ -555,6 +624,7 @@ public:
     board.set_attacked_by_mine()
          .set_attacked_by_other()
          .compute_game_state();
+    board.zobrist = board.compute_hash();
 
     return board;
   }
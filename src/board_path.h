@@ -66,6 +66,11 @@ public:
   is_full() const noexcept
   { return n == N; }
 
+  // Returns the maximum number of boards in the path.
+  static constexpr unsigned
+  capacity() noexcept
+  { return N; }
+
   // Pushes a board onto the board path if not full yet.
   void
   push(const Board& board) noexcept
@@ -195,4 +200,9 @@ using EvalBoardPath = BoardPath<8>;
 // A game can go up to 300 moves, and then it's declared a draw.
 using GameBoardPath = BoardPath<300>;
 
+// Positions can only repeat since the last capture or pawn move, and the game
+// is drawn before 100 half moves go by without one, so this is long enough to
+// find any repetition.
+using RepetitionBoardPath = BoardPath<100>;
+
 } // namespace blunder
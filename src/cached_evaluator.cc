@@ -0,0 +1,115 @@
+#include "cached_evaluator.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "hash.h"
+
+namespace blunder {
+namespace {
+
+// The number of moves assumed per entry to size the table. Most positions have
+// fewer legal moves.
+constexpr std::size_t kMovesPerEntry = 32;
+
+// Returns the key of |board_path|, i.e. a hash of the positions and the
+// repetitions in the path, and the move counters of the root, which are all
+// inputs to the network.
+std::uint64_t
+path_key(const EvalBoardPath& board_path) noexcept
+{
+  const auto& root = board_path.root()->get();
+  std::size_t key = combine_hash(root.hm_count(), root.fm_count());
+  for (const auto& board : board_path)
+    key = compute_hash(key, board.hash(), board.repetitions());
+  return key;
+}
+
+} // namespace
+
+CachedEvaluator::CachedEvaluator(
+    std::shared_ptr<Evaluator> evaluator,
+    std::size_t bytes)
+  : evaluator(std::move(evaluator))
+{
+  if (not this->evaluator)
+    throw std::invalid_argument("evaluator cannot be null.");
+
+  auto entry_bytes = sizeof(Entry)
+    + kMovesPerEntry * sizeof(std::pair<Move, float>);
+  if (bytes < entry_bytes)
+    throw std::invalid_argument("The cache is too small for a single entry.");
+
+  table.resize(bytes / entry_bytes);
+}
+
+Prediction
+CachedEvaluator::predict(const EvalBoardPath& board_path) const
+{
+  auto root = board_path.root();
+  if (not root)
+    throw std::invalid_argument("board_path should have at least one board.");
+
+  ++num_lookups;
+  auto key = path_key(board_path);
+  auto& entry = table[key % table.size()];
+
+  std::vector<std::pair<Move, float>> priors;
+  float value = 0;
+  {
+    std::lock_guard lock(mtx);
+    if (entry.key == key and not entry.priors.empty()) {
+      priors = entry.priors;
+      value = entry.value;
+    }
+  }
+
+  // Rebuild the children from the cached moves, in the order of the cached
+  // prediction.
+  if (not priors.empty()) {
+    auto children = root->get().next();
+    Prediction pred;
+    pred.value = value;
+    pred.move_probs.reserve(priors.size());
+    for (const auto& [mv, prior] : priors) {
+      for (auto& child : children) {
+        if (child.last_move() == mv) {
+          pred.move_probs.emplace_back(std::move(child), prior);
+          break;
+        }
+      }
+    }
+
+    // A hash collision with another position is unlikely, but then the cached
+    // moves do not match the legal moves.
+    if (pred.move_probs.size() == priors.size()) {
+      ++num_hits;
+      return pred;
+    }
+  }
+
+  auto pred = evaluator->predict(board_path);
+
+  Entry new_entry{.key=key, .value=pred.value, .priors={}};
+  new_entry.priors.reserve(pred.move_probs.size());
+  for (const auto& [child, prior] : pred.move_probs) {
+    auto last_move = child.last_move();
+    assert(last_move);
+    new_entry.priors.emplace_back(*last_move, prior);
+  }
+
+  {
+    std::lock_guard lock(mtx);
+    entry = std::move(new_entry);
+  }
+
+  return pred;
+}
+
+} // namespace blunder
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "board_path.h"
+#include "evaluator.h"
+#include "move.h"
+
+namespace blunder {
+
+// An evaluator that caches the predictions of another evaluator in a fixed
+// size table, such that positions reached again, e.g. by transposition, in the
+// subtree kept from the last move, or by another search thread, are not
+// evaluated again. The key covers every board in the board path, since the
+// network sees the history, and a new entry replaces the entry in its slot.
+// The cache is safe to use from multiple threads.
+class CachedEvaluator : public Evaluator {
+public:
+  // Initializes the cache with the evaluator to cache and the size of the
+  // table in bytes. Throws an exception if the evaluator is null or the table
+  // cannot hold a single entry.
+  CachedEvaluator(std::shared_ptr<Evaluator> evaluator, std::size_t bytes);
+
+  Prediction
+  predict(const EvalBoardPath& board_path) const override;
+
+  // Returns the number of predictions found in the cache.
+  std::uint64_t
+  hits() const noexcept
+  { return num_hits; }
+
+  // Returns the number of predictions requested.
+  std::uint64_t
+  lookups() const noexcept
+  { return num_lookups; }
+
+  // Returns the number of entries in the table.
+  std::size_t
+  capacity() const noexcept
+  { return table.size(); }
+
+private:
+  // The priors are stored by move, since the boards of the children depend on
+  // the path that led to the position.
+  struct Entry {
+    std::uint64_t key = 0;
+    float value = 0;
+    std::vector<std::pair<Move, float>> priors;
+  };
+
+  std::shared_ptr<Evaluator> evaluator;
+  mutable std::vector<Entry> table;
+  mutable std::mutex mtx;
+  mutable std::atomic<std::uint64_t> num_hits = 0;
+  mutable std::atomic<std::uint64_t> num_lookups = 0;
+};
+
+} // namespace blunder
@@ -0,0 +1,152 @@
+#include "checkpoint_writer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace blunder {
+
+namespace fs = std::filesystem;
+
+CheckpointWriter::CheckpointWriter()
+  : writer([this](std::stop_token stop_token) { run(stop_token); })
+{}
+
+CheckpointWriter::~CheckpointWriter()
+{
+  writer.request_stop();
+  cond.notify_all();
+}
+
+void
+CheckpointWriter::submit(
+    const AlphaZeroNet& net,
+    const torch::optim::Optimizer& optimizer,
+    fs::path checkpoint_dir,
+    std::string optimizer_file)
+{
+  // Serialize the optimizer state to memory rather than copying its tensors,
+  // since the optimizer has no API to copy its state.
+  torch::serialize::OutputArchive archive;
+  optimizer.save(archive);
+  std::ostringstream optimizer_stream;
+  archive.save_to(optimizer_stream);
+
+  Snapshot snapshot{
+    .net=net.snapshot(),
+    .optimizer=std::move(optimizer_stream).str(),
+    .checkpoint_dir=std::move(checkpoint_dir),
+    .optimizer_file=std::move(optimizer_file)
+  };
+
+  {
+    std::lock_guard lock(mtx);
+    if (pending)
+      ++num_dropped;
+    pending = std::move(snapshot);
+  }
+  cond.notify_all();
+}
+
+void
+CheckpointWriter::wait()
+{
+  std::unique_lock lock(mtx);
+  cond.wait(lock, [this] { return not pending and not writing; });
+}
+
+std::size_t
+CheckpointWriter::dropped() const
+{
+  std::lock_guard lock(mtx);
+  return num_dropped;
+}
+
+std::size_t
+CheckpointWriter::failed() const
+{
+  std::lock_guard lock(mtx);
+  return num_failed;
+}
+
+bool
+CheckpointWriter::write(const Snapshot& snapshot)
+{
+  const auto& checkpoint_dir = snapshot.checkpoint_dir;
+
+  // Check that the dir does not exist or that it is empty, since an empty
+  // directory is replaced by the rename.
+  if (fs::exists(checkpoint_dir) and
+      (not fs::is_directory(checkpoint_dir) or not fs::is_empty(checkpoint_dir)))
+    return false;
+
+  auto tmp_dir = checkpoint_dir;
+  tmp_dir += ".tmp";
+
+  std::error_code err;
+  fs::remove_all(tmp_dir, err);
+  fs::create_directories(tmp_dir, err);
+  if (err) return false;
+
+  try {
+    snapshot.net.save(tmp_dir);
+
+    std::ofstream optimizer_file(
+        tmp_dir / snapshot.optimizer_file, std::ios::binary);
+    optimizer_file << snapshot.optimizer;
+    optimizer_file.close();
+    if (not optimizer_file)
+      throw std::runtime_error("Unable to write the optimizer state.");
+  } catch (const std::exception&) {
+    fs::remove_all(tmp_dir, err);
+    return false;
+  }
+
+  fs::rename(tmp_dir, checkpoint_dir, err);
+  if (err) {
+    fs::remove_all(tmp_dir, err);
+    return false;
+  }
+
+  return true;
+}
+
+void
+CheckpointWriter::run(std::stop_token stop_token)
+{
+  std::unique_lock lock(mtx);
+
+  while (true) {
+    // Keep writing the waiting snapshot after a stop is requested, so the
+    // last checkpoint is not lost when the writer is destroyed.
+    cond.wait(lock, stop_token, [this] { return pending.has_value(); });
+    if (not pending)
+      return;
+
+    auto snapshot = std::move(*pending);
+    pending.reset();
+    writing = true;
+
+    lock.unlock();
+    bool ok = write(snapshot);
+    if (not ok) {
+      std::cerr << "Unable to write checkpoint "
+                << snapshot.checkpoint_dir << std::endl;
+    }
+    lock.lock();
+
+    writing = false;
+    if (not ok)
+      ++num_failed;
+    cond.notify_all();
+  }
+}
+
+} // namespace blunder
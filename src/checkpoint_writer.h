@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include <torch/torch.h>
+
+#include "net.h"
+
+namespace blunder {
+
+// Writes checkpoints on a background thread, so that training does not wait on
+// the disk. A checkpoint is a snapshot of the network, including its BatchNorm
+// statistics, and the optimizer state in memory, which is written to a
+// temporary directory next to the checkpoint directory, and then renamed to it,
+// such that a checkpoint directory is either complete or missing, even if the
+// process dies during the write.
+//
+// The writer keeps at most one snapshot waiting to be written. If a snapshot is
+// submitted while another one is waiting, then the waiting one is dropped,
+// i.e. when the writer falls behind only the most recent snapshot is written.
+class CheckpointWriter {
+public:
+  CheckpointWriter();
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  // Writes the waiting snapshot, if any, before stopping the writer thread.
+  ~CheckpointWriter();
+
+  // Snapshots |net| and |optimizer| and queues them to be written to
+  // |checkpoint_dir|, where the optimizer state is saved as |optimizer_file|.
+  // The checkpoint directory is expected to not exist or to be empty.
+  void
+  submit(
+      const AlphaZeroNet& net,
+      const torch::optim::Optimizer& optimizer,
+      std::filesystem::path checkpoint_dir,
+      std::string optimizer_file);
+
+  // Blocks until all the submitted snapshots are written or dropped.
+  void
+  wait();
+
+  // Returns the number of snapshots dropped because the writer fell behind.
+  std::size_t
+  dropped() const;
+
+  // Returns the number of checkpoints that could not be written.
+  std::size_t
+  failed() const;
+
+private:
+  struct Snapshot {
+    NetSnapshot net;
+    // The serialized optimizer state.
+    std::string optimizer;
+    std::filesystem::path checkpoint_dir;
+    std::string optimizer_file;
+  };
+
+  // Writes |snapshot| to its checkpoint directory. Returns false if it fails.
+  static bool
+  write(const Snapshot& snapshot);
+
+  // The loop of the writer thread.
+  void
+  run(std::stop_token stop_token);
+
+  mutable std::mutex mtx;
+  std::condition_variable_any cond;
+  std::optional<Snapshot> pending;
+  bool writing = false;
+  std::size_t num_dropped = 0;
+  std::size_t num_failed = 0;
+
+  // Declared last, so the thread starts after the other members are ready, and
+  // is joined before they are destroyed.
+  std::jthread writer;
+};
+
+} // namespace blunder
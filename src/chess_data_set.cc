@@ -1,12 +1,16 @@
 #include "chess_data_set.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
-#include "game_result.h"
+#include "replay_buffer.h"
 #include "tensor_encoder.h"
 
 #include <torch/torch.h>
@@ -16,82 +20,94 @@ namespace blunder {
 using torch::Tensor;
 
 ChessDataSet::ChessDataSet(
-    std::span<const GameResult> game_results,
-    std::shared_ptr<TensorEncoder> encoder)
-  : game_results(game_results),
-    encoder(std::move(encoder))
+    std::span<const TrainingPosition> positions,
+    std::shared_ptr<TensorEncoder> encoder,
+    torch::Device device)
+  : positions(positions),
+    encoder(std::move(encoder)),
+    device(device)
 {
   if (not this->encoder)
     throw std::invalid_argument("encoder cannot be null.");
 
   // Enable encoding tensors with grad enabled.
   this->encoder->with_grad(true);
-
-  for (const auto& gr : game_results)
-    num_examples += gr.moves.size();
 }
 
 ChessDataSet::ExampleType
 ChessDataSet::get(std::size_t index)
 {
-  if (index >= num_examples)
+  if (index >= positions.size())
     throw std::out_of_range("index is out of range");
 
-  const GameResult* game_result = nullptr;
-
-  for (const auto& gr : game_results) {
-    const auto num_moves = gr.moves.size();
-    if (num_moves > index) {
-      game_result = &gr;
-      break;
-    }
-    index -= num_moves;
-  }
-
-  if (not game_result)
-    throw std::runtime_error("Unable to find the game_result for index.");
+  const auto& position = positions[index];
+  assert(not position.policy.empty());
 
-  const auto& board = index == 0
-      ? game_result->game_start
-      : game_result->moves[index-1].best.board;
+  auto board = position.board.to_board();
+  auto input_tensor = encoder->encode_board(board).to(device);
 
-  auto input_tensor = encoder->encode_board(board).to(torch::kCUDA);
-  auto policy_tensor = encoder->encode_moves(game_result->moves[index].moves)
-                                .to(torch::kCUDA);
-
-  // Compute the actual value from the game result.
-  float value = 0;
-  if (game_result->winner == Color::White)
-    value = board.is_white_next() ? 1 : -1;
-  else if (game_result->winner == Color::Black)
-    value = board.is_white_next() ? -1 : 1;
-
-  Tensor value_tensor = torch::full({1}, value, torch::kCUDA);
+  // The visit counts of a cheap search are not a policy target, so they are
+  // zeroed out like the padding, and only the value is learned.
+  auto policy = encoder->encode_policy(position.policy);
+  if (not position.policy_target)
+    policy.probs.zero_();
+  Tensor value_tensor = torch::full({1}, position.value, device);
 
   return ExampleType(std::move(input_tensor),
-                     std::make_pair(policy_tensor, value_tensor));
+                     std::make_pair(std::move(policy), value_tensor));
 }
 
 ChessDataExample
 stack_examples(std::vector<ChessDataExample> examples)
 {
+  const std::int64_t batch_size = examples.size();
+
+  std::int64_t max_moves = 0;
+  for (const auto& example : examples) {
+    const auto& policy = example.target.first;
+    max_moves = std::max(max_moves, policy.indices.size(0));
+  }
+
+  // The padding uses index 0 with a probability of 0, which does not
+  // contribute to the loss.
+  auto indices = torch::zeros({batch_size, max_moves}, torch::kLong);
+  auto probs = torch::zeros({batch_size, max_moves});
+
   std::vector<Tensor> data;
-  std::vector<Tensor> policies;
   std::vector<Tensor> values;
   data.reserve(examples.size());
-  policies.reserve(examples.size());
   values.reserve(examples.size());
 
-  for (auto example : examples) {
+  for (std::int64_t i = 0; i < batch_size; ++i) {
+    auto& example = examples[i];
     data.push_back(std::move(example.data));
     auto& [policy, value] = example.target;
-    policies.push_back(std::move(policy));
+    auto num_moves = policy.indices.size(0);
+    indices[i].narrow(0, 0, num_moves).copy_(policy.indices);
+    probs[i].narrow(0, 0, num_moves).copy_(policy.probs);
     values.push_back(std::move(value));
   }
 
+  SparsePolicy policy{
+    .indices=indices.to(torch::kCUDA),
+    .probs=probs.to(torch::kCUDA)
+  };
+
   return ChessDataExample(
       torch::stack(data),
-      std::make_pair(torch::stack(policies), torch::stack(values)));
+      std::make_pair(std::move(policy), torch::stack(values)));
+}
+
+Tensor
+sparse_policy_loss(const Tensor& logits, const SparsePolicy& target)
+{
+  auto log_probs = torch::log_softmax(logits.flatten(/*start_dim=*/1), 1);
+  auto target_log_probs = log_probs.gather(1, target.indices);
+
+  // Every policy target sums to one, so this averages over the positions that
+  // are policy targets, and skips the positions without one.
+  auto num_targets = target.probs.sum().clamp_min(1);
+  return -(target.probs * target_log_probs).sum() / num_targets;
 }
 
 } // namespace blunder
@@ -7,55 +7,69 @@
 #include <utility>
 #include <vector>
 
-#include "game_result.h"
+#include "replay_buffer.h"
 #include "tensor_encoder.h"
 
 #include <torch/torch.h>
 
 namespace blunder {
 
-using TensorPair = std::pair<torch::Tensor, torch::Tensor>;
-using ChessDataExample = torch::data::Example<torch::Tensor, TensorPair>;
-
-// TODO: When we begin to generate training data through self play, we'll save
-// the game history, and this custom loader will need to read the data and
-// convert it to tensors.
-//
-// Placer holder code for a custom dataset to use with a dataloader.
-// Each example will consists of the input to the network, i.e. an 8x8x119 stack
-// of planes representing the current chess position, and the target will
-// consist of a pair of tensors in the form of (policy target, value target) to
-// represent the expected policy and value targets.
+// The training target, i.e. a pair of (sparse policy target, value target).
+using ChessTarget = std::pair<SparsePolicy, torch::Tensor>;
+using ChessDataExample = torch::data::Example<torch::Tensor, ChessTarget>;
+
+// A custom dataset to use with a dataloader, which converts training positions
+// sampled from self play into tensors. Each example will consists of the input
+// to the network, i.e. an 8x8x119 stack of planes representing the current
+// chess position, and the target will consist of a pair in the form of
+// (policy target, value target) to represent the expected policy and value
+// targets. The policy target is sparse, i.e. it only has entries for the moves
+// visited during search, which is a small fraction of the 73x8x8 policy planes.
 class ChessDataSet :
   public torch::data::datasets::Dataset<ChessDataSet, ChessDataExample>
 {
 public:
+  // The examples are created on |device|.
   ChessDataSet(
-      std::span<const GameResult> game_results,
-      std::shared_ptr<TensorEncoder> encoder);
+      std::span<const TrainingPosition> positions,
+      std::shared_ptr<TensorEncoder> encoder,
+      torch::Device device = torch::kCUDA);
 
   // Disable grad mode on the encoder.
   ~ChessDataSet()
   { this->encoder->with_grad(false); }
 
+  // Note that this is called concurrently from the data loader workers, and
+  // hence it should not modify the state of the dataset.
   ExampleType
   get(std::size_t index) override;
 
   torch::optional<std::size_t>
   size() const override
-  { return num_examples; };
+  { return positions.size(); };
 
 private:
-  // Note that this is not owned and hence the game results are expected to
-  // outlive ChessDataSet.
-  std::span<const GameResult> game_results;
+  // Note that this is not owned and hence the positions are expected to outlive
+  // ChessDataSet.
+  std::span<const TrainingPosition> positions;
   std::shared_ptr<TensorEncoder> encoder;
-  std::size_t num_examples = 0;
+  torch::Device device;
 };
 
 // Converts a collection of ChessDataExamples into a single Example by stacking
-// all the tensors as a single tensor.
+// all the tensors as a single tensor. The sparse policy targets are stacked
+// into tensors of dimension (batch size, max number of moves), where the
+// targets with fewer moves are padded with zero probabilities.
 ChessDataExample
 stack_examples(std::vector<ChessDataExample> examples);
 
+// Computes the cross entropy loss between the predicted policy logits, a tensor
+// of dimension (batch size, 73, 8, 8), and a batch of sparse policy targets,
+// without expanding the targets into the policy planes. The softmax is taken
+// over all the moves in the policy planes. The loss is averaged over the
+// positions with a policy target, i.e. the targets of positions that are not
+// policy targets are all zero and do not count.
+torch::Tensor
+sparse_policy_loss(const torch::Tensor& logits, const SparsePolicy& target);
+
 } // namespace blunder
@@ -1,7 +1,12 @@
 #include "coding_util.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <limits>
+#include <span>
 #include <stdexcept>
+#include <vector>
 
 #include "pieces.h"
 #include "square.h"
@@ -126,4 +131,22 @@ encode_move(Move mv)
   return mv_code;
 }
 
+std::vector<PolicyEntry>
+encode_policy(std::span<const MoveProb> moves)
+{
+  constexpr unsigned max_visits = std::numeric_limits<std::uint16_t>::max();
+
+  std::vector<PolicyEntry> policy;
+  policy.reserve(moves.size());
+
+  for (const auto& mv : moves) {
+    policy.push_back(PolicyEntry{
+      .index=static_cast<std::uint16_t>(encode_move(mv.mv).index()),
+      .visits=static_cast<std::uint16_t>(std::min(mv.visits, max_visits))
+    });
+  }
+
+  return policy;
+}
+
 } // namespace blunder
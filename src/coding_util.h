@@ -1,8 +1,12 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <span>
+#include <vector>
 
 #include "move.h"
+#include "search_result.h"
 
 namespace blunder {
 
@@ -19,6 +23,18 @@ struct EncodedMove {
     assert(row >= 0 and row <= 7);
     assert(col >= 0 and col <= 7);
   }
+
+  // Returns the flat index of the move in the 73x8x8 policy planes.
+  unsigned
+  index() const noexcept
+  { return code * 64 + row * 8 + col; }
+};
+
+// A sparse entry of a policy target, i.e. the flat index of a move in the
+// 73x8x8 policy planes and the number of visits for the move from search.
+struct PolicyEntry {
+  std::uint16_t index = 0;
+  std::uint16_t visits = 0;
 };
 
 // Encodes |mv| as a triple of
@@ -28,4 +44,9 @@ struct EncodedMove {
 EncodedMove
 encode_move(Move mv);
 
+// Encodes the visit counts of |moves| as sparse policy entries. Visit counts
+// that do not fit in a PolicyEntry are saturated.
+std::vector<PolicyEntry>
+encode_policy(std::span<const MoveProb> moves);
+
 } // namespace blunder
@@ -0,0 +1,186 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "folded_net.h"
+#include "inference_channel.h"
+#include "inference_net.h"
+#include "inference_server.h"
+#include "net.h"
+#include "script_net.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help     Print this help message.\n"
+     << "   -n|--net      The network exported with export_net. Without it,\n"
+     << "                 the network has random weights.\n"
+     << "   -f|--format   The format of the network, i.e. script or flat.\n"
+     << "                 Defaults to script.\n"
+     << "   -c|--channel  The name of the shared memory channel. Defaults to\n"
+     << "                 /blunder-eval.\n"
+     << "   -s|--slots    The number of requests in flight, a power of two.\n"
+     << "   -b|--batch    The maximum number of positions in a batch.\n"
+     << "   -w|--wait     The maximum microseconds to wait for a batch.\n"
+     << "\n"
+     << "Evaluates the positions of the clients of the channel, e.g.\n"
+     << "uci --server /blunder-eval, in batches until interrupted.\n"
+     << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"net", required_argument, nullptr, 'n'},
+    {"format", required_argument, nullptr, 'f'},
+    {"channel", required_argument, nullptr, 'c'},
+    {"slots", required_argument, nullptr, 's'},
+    {"batch", required_argument, nullptr, 'b'},
+    {"wait", required_argument, nullptr, 'w'},
+    {0, 0, 0, 0},
+  };
+
+  fs::path net_file;
+  std::string_view format = "script";
+  std::string channel_name = "/blunder-eval";
+  ChannelLayout layout;
+  ServerOptions options;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hn:f:c:s:b:w:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'n':
+        net_file = optarg;
+        break;
+      case 'f':
+        format = optarg;
+        if (format != "script" and format != "flat") {
+          std::cerr << "--format needs to be script or flat, but got "
+                    << format << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'c':
+        channel_name = optarg;
+        break;
+      case 's':
+        try {
+          layout.slots = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--slots needs to be a valid number, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'b':
+        try {
+          options.max_batch = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--batch needs to be a valid number, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'w':
+        try {
+          options.max_wait = std::chrono::microseconds(std::stol(optarg));
+        } catch (...) {
+          std::cerr << "--wait needs to be a valid number, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cerr);
+        return EXIT_FAILURE;
+    }
+  }
+
+  std::shared_ptr<InferenceNet> net;
+  try {
+    if (net_file.empty()) {
+      AlphaZeroNet random_net;
+      random_net.on_device(torch::kCPU);
+      random_net.set_eval_mode();
+      net = std::make_shared<FoldedNet>(random_net);
+    } else if (format == "flat") {
+      net = std::make_shared<FoldedNet>(FoldedNet::load(net_file));
+    } else {
+      net = std::make_shared<ScriptNet>(net_file);
+    }
+  } catch (const std::exception& err) {
+    std::cerr << "Unable to load " << net_file << ": " << err.what()
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The signals are blocked before the server thread starts, so that the
+  // thread inherits the mask, and only the main thread receives them.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    auto channel = std::make_shared<InferenceChannel>(
+        InferenceChannel::create(channel_name, layout));
+    InferenceServer server(std::move(net), channel, options);
+
+    std::cout << "Serving on " << channel_name << std::endl;
+    {
+      std::exception_ptr error;
+      std::jthread server_thread([&](std::stop_token stop_token) {
+        try {
+          server.serve(std::move(stop_token));
+        } catch (...) {
+          error = std::current_exception();
+          ::kill(::getpid(), SIGTERM);
+        }
+      });
+
+      int signal = 0;
+      sigwait(&signals, &signal);
+      server_thread.request_stop();
+      server_thread.join();
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+    std::cout << "Evaluated " << server.requests() << " positions in "
+              << server.batches() << " batches" << std::endl;
+  } catch (std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -14,7 +14,7 @@ struct Prediction {
   std::vector<std::pair<Board, float>> move_probs;
 
   // A value between [-1, 1] to represent likelihood of winning, drawing, or
-  // losing.
+  // losing for the player moving next.
   float value;
 };
 
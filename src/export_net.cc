@@ -0,0 +1,108 @@
+#include <cstdlib>
+#include <filesystem>
+#include <getopt.h>
+#include <iostream>
+#include <string_view>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "folded_net.h"
+#include "net.h"
+#include "script_net.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help        Print this help message.\n"
+     << "   -c|--checkpoint  The directory of the checkpoint to export.\n"
+     << "   -o|--output      The file where the exported network is saved.\n"
+     << "   -f|--format      The format of the exported network, i.e. script\n"
+     << "                    for a TorchScript module, or flat for a flat\n"
+     << "                    weight file that is mapped into memory to load.\n"
+     << "                    Defaults to script.\n"
+     << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"checkpoint", required_argument, nullptr, 'c'},
+    {"output", required_argument, nullptr, 'o'},
+    {"format", required_argument, nullptr, 'f'},
+    {0, 0, 0, 0},
+  };
+
+  fs::path checkpoint_dir;
+  fs::path output;
+  std::string_view format = "script";
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hc:o:f:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'c':
+        checkpoint_dir = optarg;
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'f':
+        format = optarg;
+        if (format != "script" and format != "flat") {
+          std::cerr << "--format needs to be script or flat, but got "
+                    << format << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cerr);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (checkpoint_dir.empty() or output.empty()) {
+    std::cerr << "Both --checkpoint and --output are required." << std::endl;
+    print_help(argv[0], std::cerr);
+    return EXIT_FAILURE;
+  }
+
+  auto config = AlphaZeroNet::checkpoint_config(checkpoint_dir);
+  if (not config) {
+    std::cerr << "Unable to read the architecture from " << checkpoint_dir
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  AlphaZeroNet net(*config);
+  if (not net.load_checkpoint(checkpoint_dir)) {
+    std::cerr << "Unable to load checkpoint from " << checkpoint_dir
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The exported module is optimized to run on the CPU.
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+
+  if (format == "flat")
+    FoldedNet(net).save(output);
+  else
+    ScriptNet::save(FoldedNet(net), output);
+
+  std::cout << "Exported " << checkpoint_dir << " to " << output << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,366 @@
+#include "folded_net.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace blunder {
+
+using ::torch::Tensor;
+using ::torch::nn::BatchNorm2d;
+using ::torch::nn::Conv2d;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The flat weight format consists of
+// - a FlatHeader.
+// - a FlatEntry for every weight, in the order of FoldedNet::weights.
+// - the fp32 data of the weights, each starting at an offset from the start of
+//   the file that is a multiple of kFlatAlignment, which is enough for aligned
+//   vector loads since the mapping starts at a page boundary.
+constexpr char kFlatMagic[8] = {'B', 'L', 'N', 'D', 'F', 'L', 'A', 'T'};
+constexpr std::uint32_t kFlatVersion = 1;
+constexpr std::uint64_t kFlatAlignment = 64;
+constexpr std::uint32_t kMaxDims = 4;
+
+// The number of weights outside the residual tower, i.e. a weight and a bias
+// for the input convolution, the two policy convolutions, the value
+// convolution, and the two value fully connected layers.
+constexpr std::uint32_t kNumHeadWeights = 12;
+
+// The number of weights in each residual block.
+constexpr std::uint32_t kNumBlockWeights = 4;
+
+struct FlatHeader {
+  char magic[8];
+  std::uint32_t version = kFlatVersion;
+  std::uint32_t blocks = 0;
+  std::uint32_t num_weights = 0;
+  std::uint32_t reserved = 0;
+};
+
+struct FlatEntry {
+  // The offset of the data, or zero for a weight that is not defined, i.e. a
+  // convolution without a bias.
+  std::uint64_t offset = 0;
+  std::uint32_t dims = 0;
+  std::uint32_t reserved = 0;
+  std::int64_t sizes[kMaxDims] = {};
+};
+
+// Rounds |offset| up to a multiple of kFlatAlignment.
+constexpr std::uint64_t
+align_offset(std::uint64_t offset) noexcept
+{ return (offset + kFlatAlignment - 1) / kFlatAlignment * kFlatAlignment; }
+
+// Returns the number of bytes of the data of |entry|, or throws an exception if
+// the entry does not fit in a file of |file_size| bytes.
+std::uint64_t
+entry_bytes(const FlatEntry& entry, std::uint64_t file_size)
+{
+  if (entry.dims == 0 or entry.dims > kMaxDims)
+    throw std::runtime_error("Invalid number of dims in flat weight file.");
+  if (entry.offset % kFlatAlignment)
+    throw std::runtime_error("Unaligned weight in flat weight file.");
+
+  std::uint64_t numel = 1;
+  for (std::uint32_t i = 0; i < entry.dims; ++i) {
+    if (entry.sizes[i] <= 0 or entry.sizes[i] > (1 << 24))
+      throw std::runtime_error("Invalid weight size in flat weight file.");
+    numel *= entry.sizes[i];
+  }
+
+  auto bytes = numel * sizeof(float);
+  if (entry.offset > file_size or bytes > file_size - entry.offset)
+    throw std::runtime_error("Truncated flat weight file.");
+
+  return bytes;
+}
+
+} // namespace
+
+FoldedConv
+FoldedConv::fold(const Conv2d& conv, const BatchNorm2d& bnorm)
+{
+  torch::NoGradGuard no_grad;
+
+  // BatchNorm in eval mode computes (x - mean) * scale + beta, where
+  // scale = gamma / sqrt(var + eps), which is linear in the output of the
+  // convolution.
+  auto scale = bnorm->weight / torch::sqrt(
+      bnorm->running_var + bnorm->options.eps());
+
+  auto bias = conv->bias.defined()
+    ? conv->bias
+    : torch::zeros_like(bnorm->running_mean);
+
+  return FoldedConv{
+    .weight=(conv->weight * scale.reshape({-1, 1, 1, 1})).contiguous(),
+    .bias=(bias - bnorm->running_mean) * scale + bnorm->bias,
+    .padding=conv->weight.size(-1) / 2
+  };
+}
+
+FoldedConv
+FoldedConv::from(const Conv2d& conv)
+{
+  torch::NoGradGuard no_grad;
+
+  // All the convolutions in AlphaZeroNet preserve the 8x8 board, i.e. the
+  // padding is half of the kernel size.
+  return FoldedConv{
+    .weight=conv->weight.detach().clone(),
+    .bias=conv->bias.defined() ? conv->bias.detach().clone() : Tensor(),
+    .padding=conv->weight.size(-1) / 2
+  };
+}
+
+FoldedNet::FoldedNet(
+    const AlphaZeroNet& net,
+    torch::MemoryFormat memory_format)
+  : mem_format(memory_format),
+    input_conv(FoldedConv::fold(net.conv, net.bnorm).to(memory_format)),
+    policy_conv1(FoldedConv::fold(
+          net.policy_net.conv1, net.policy_net.bnorm).to(memory_format)),
+    policy_conv2(FoldedConv::from(net.policy_net.conv2).to(memory_format)),
+    value_conv(FoldedConv::fold(
+          net.value_net.conv, net.value_net.bnorm).to(memory_format))
+{
+  torch::NoGradGuard no_grad;
+
+  res_blocks.reserve(net.res_nets.size());
+  for (const auto& res_net : net.res_nets) {
+    res_blocks.push_back(ResBlock{
+      .conv1=FoldedConv::fold(
+          res_net.conv1, res_net.bnorm1).to(memory_format),
+      .conv2=FoldedConv::fold(
+          res_net.conv2, res_net.bnorm2).to(memory_format)
+    });
+  }
+
+  value_fc1_weight = net.value_net.fc1->weight.detach().clone();
+  value_fc1_bias = net.value_net.fc1->bias.detach().clone();
+  value_fc2_weight = net.value_net.fc2->weight.detach().clone();
+  value_fc2_bias = net.value_net.fc2->bias.detach().clone();
+}
+
+FoldedNet
+FoldedNet::to(torch::Device device) const
+{
+  FoldedNet net(*this);
+  net.input_conv = input_conv.to(device);
+  for (auto& block : net.res_blocks) {
+    block.conv1 = block.conv1.to(device);
+    block.conv2 = block.conv2.to(device);
+  }
+  net.policy_conv1 = policy_conv1.to(device);
+  net.policy_conv2 = policy_conv2.to(device);
+  net.value_conv = value_conv.to(device);
+  net.value_fc1_weight = value_fc1_weight.to(device);
+  net.value_fc1_bias = value_fc1_bias.to(device);
+  net.value_fc2_weight = value_fc2_weight.to(device);
+  net.value_fc2_bias = value_fc2_bias.to(device);
+  return net;
+}
+
+std::vector<Tensor*>
+FoldedNet::weights()
+{
+  std::vector<Tensor*> all_weights = {&input_conv.weight, &input_conv.bias};
+  all_weights.reserve(kNumHeadWeights + kNumBlockWeights * res_blocks.size());
+
+  for (auto& block : res_blocks) {
+    all_weights.push_back(&block.conv1.weight);
+    all_weights.push_back(&block.conv1.bias);
+    all_weights.push_back(&block.conv2.weight);
+    all_weights.push_back(&block.conv2.bias);
+  }
+
+  for (auto* conv : {&policy_conv1, &policy_conv2, &value_conv}) {
+    all_weights.push_back(&conv->weight);
+    all_weights.push_back(&conv->bias);
+  }
+
+  all_weights.push_back(&value_fc1_weight);
+  all_weights.push_back(&value_fc1_bias);
+  all_weights.push_back(&value_fc2_weight);
+  all_weights.push_back(&value_fc2_bias);
+
+  return all_weights;
+}
+
+void
+FoldedNet::save(const fs::path& file_name) const
+{
+  // The tensors are handles, so the copy only gives us non-const access to the
+  // weights without copying them.
+  auto net = *this;
+  auto all_weights = net.weights();
+
+  FlatHeader header;
+  std::memcpy(header.magic, kFlatMagic, sizeof(kFlatMagic));
+  header.blocks = res_blocks.size();
+  header.num_weights = all_weights.size();
+
+  // Lay out the data after the table of entries, and save the weights in the
+  // standard layout, regardless of the memory format of the network.
+  std::vector<FlatEntry> entries(all_weights.size());
+  std::vector<Tensor> data(all_weights.size());
+  std::uint64_t offset = align_offset(
+      sizeof(FlatHeader) + entries.size() * sizeof(FlatEntry));
+
+  for (std::size_t i = 0; i < all_weights.size(); ++i) {
+    const auto& weight = *all_weights[i];
+    if (not weight.defined())
+      continue;
+
+    if (weight.dim() == 0 or weight.dim() > kMaxDims)
+      throw std::logic_error("Unexpected number of dims in a weight.");
+
+    auto& entry = entries[i];
+    entry.offset = offset;
+    entry.dims = weight.dim();
+    std::ranges::copy(weight.sizes(), entry.sizes);
+
+    data[i] = weight.to(torch::kCPU, torch::kFloat).contiguous();
+    offset = align_offset(offset + data[i].nbytes());
+  }
+
+  std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+  if (not out)
+    throw std::runtime_error("Unable to open " + file_name.string());
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(entries.data()),
+            entries.size() * sizeof(FlatEntry));
+
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    if (not data[i].defined())
+      continue;
+    // Pad up to the offset of the weight.
+    auto pos = static_cast<std::uint64_t>(out.tellp());
+    std::vector<char> padding(entries[i].offset - pos, 0);
+    out.write(padding.data(), padding.size());
+    out.write(static_cast<const char*>(data[i].data_ptr()), data[i].nbytes());
+  }
+
+  out.close();
+  if (not out)
+    throw std::runtime_error("Unable to write " + file_name.string());
+}
+
+FoldedNet
+FoldedNet::load(const fs::path& file_name)
+{
+  auto mapping = std::make_shared<const MappedFile>(file_name);
+  auto bytes = mapping->bytes();
+
+  FlatHeader header;
+  if (bytes.size() < sizeof(header))
+    throw std::runtime_error("Truncated flat weight file.");
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kFlatMagic, sizeof(kFlatMagic)))
+    throw std::runtime_error("Not a flat weight file.");
+  if (header.version != kFlatVersion)
+    throw std::runtime_error("Unsupported flat weight file version.");
+  if (header.num_weights != kNumHeadWeights + kNumBlockWeights * header.blocks)
+    throw std::runtime_error("Invalid number of weights in flat weight file.");
+
+  auto table_bytes =
+    static_cast<std::uint64_t>(header.num_weights) * sizeof(FlatEntry);
+  if (bytes.size() - sizeof(header) < table_bytes)
+    throw std::runtime_error("Truncated flat weight file.");
+
+  FoldedNet net;
+  net.res_blocks.resize(header.blocks);
+  auto all_weights = net.weights();
+
+  for (std::size_t i = 0; i < all_weights.size(); ++i) {
+    FlatEntry entry;
+    std::memcpy(&entry, bytes.data() + sizeof(header) + i * sizeof(FlatEntry),
+                sizeof(entry));
+    if (not entry.offset)
+      continue;
+
+    entry_bytes(entry, bytes.size());
+
+    // The tensors keep the mapping alive, and from_blob does not copy, but it
+    // needs a non-const pointer.
+    auto ptr = const_cast<std::byte*>(bytes.data() + entry.offset);
+    *all_weights[i] = torch::from_blob(
+        ptr,
+        torch::IntArrayRef(entry.sizes, entry.dims),
+        [mapping](void*) {},
+        torch::TensorOptions().dtype(torch::kFloat));
+  }
+
+  // The weights of the convolutions are required, the biases are optional.
+  auto check_conv = [](FoldedConv& conv) {
+    if (not conv.weight.defined() or conv.weight.dim() != 4)
+      throw std::runtime_error("Missing convolution in flat weight file.");
+    conv.padding = conv.weight.size(-1) / 2;
+  };
+
+  check_conv(net.input_conv);
+  for (auto& block : net.res_blocks) {
+    check_conv(block.conv1);
+    check_conv(block.conv2);
+  }
+  check_conv(net.policy_conv1);
+  check_conv(net.policy_conv2);
+  check_conv(net.value_conv);
+
+  if (not net.value_fc1_weight.defined() or not net.value_fc2_weight.defined())
+    throw std::runtime_error("Missing value head in flat weight file.");
+
+  return net;
+}
+
+std::pair<Tensor, Tensor>
+FoldedNet::predict(Tensor x) const
+{
+  c10::InferenceMode inference_mode;
+  return heads(tower(x.contiguous(mem_format)));
+}
+
+// The intermediate tensors are not shared, so the ReLUs and the skip
+// connections run in place. The convolutions, ReLUs and additions all keep the
+// layout of their inputs, so there are no reorders inside the tower.
+Tensor
+FoldedNet::tower(const Tensor& x) const
+{
+  auto out = input_conv.forward(x).relu_();
+
+  for (const auto& block : res_blocks) {
+    auto res = block.conv1.forward(out).relu_();
+    out = block.conv2.forward(res).add_(out).relu_();
+  }
+
+  return out;
+}
+
+std::pair<Tensor, Tensor>
+FoldedNet::heads(const Tensor& out) const
+{
+  auto pol = policy_conv2.forward(policy_conv1.forward(out).relu_());
+
+  auto val = value_conv.forward(out).relu_().flatten(/*start_dim=*/1);
+  val = torch::linear(val, value_fc1_weight, value_fc1_bias).relu_();
+  val = torch::linear(val, value_fc2_weight, value_fc2_bias).tanh_();
+
+  return {std::move(pol), std::move(val)};
+}
+
+} // namespace blunder
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "inference_net.h"
+#include "net.h"
+
+namespace blunder {
+
+// A convolution with stride 1 and same padding, which may have a BatchNorm
+// folded into its weights and bias.
+struct FoldedConv {
+  // Folds the running statistics and the affine parameters of |bnorm| into the
+  // weights and bias of |conv|.
+  static FoldedConv
+  fold(const torch::nn::Conv2d& conv, const torch::nn::BatchNorm2d& bnorm);
+
+  // Copies the weights and bias of |conv|, for convolutions without BatchNorm.
+  static FoldedConv
+  from(const torch::nn::Conv2d& conv);
+
+  torch::Tensor
+  forward(const torch::Tensor& x) const
+  { return torch::conv2d(x, weight, bias, /*stride=*/1, padding); }
+
+  // Returns a copy of the convolution on |device|.
+  FoldedConv
+  to(torch::Device device) const
+  {
+    return FoldedConv{
+      .weight=weight.to(device),
+      .bias=bias.defined() ? bias.to(device) : bias,
+      .padding=padding
+    };
+  }
+
+  // Returns a copy of the convolution with the weight in |memory_format|.
+  FoldedConv
+  to(torch::MemoryFormat memory_format) const
+  {
+    return FoldedConv{
+      .weight=weight.contiguous(memory_format),
+      .bias=bias,
+      .padding=padding
+    };
+  }
+
+  torch::Tensor weight;
+  torch::Tensor bias;
+  std::int64_t padding = 0;
+};
+
+// An inference-only export of AlphaZeroNet, where every BatchNorm is folded into
+// the convolution before it, so each convolution, BatchNorm and ReLU runs as a
+// convolution and an in-place ReLU. The folded BatchNorms use the running
+// statistics, hence the outputs match those of the AlphaZeroNet in eval mode.
+//
+// The weights are copied when the FoldedNet is created, so it does not see
+// later updates to the AlphaZeroNet. A FoldedNet can also be saved in a flat
+// weight file, which inference-only processes map into memory and use in
+// place, without building the AlphaZeroNet.
+class FoldedNet : public InferenceNet {
+public:
+  // The weights of the convolutions are stored in |memory_format|, and the
+  // inputs are converted to it, e.g. channels last to run the convolutions on
+  // oneDNN on CPU without reordering the activations at every layer.
+  explicit
+  FoldedNet(
+      const AlphaZeroNet& net,
+      torch::MemoryFormat memory_format = torch::MemoryFormat::Contiguous);
+
+  // Runs the network under inference mode.
+  std::pair<torch::Tensor, torch::Tensor>
+  predict(torch::Tensor x) const override;
+
+  torch::Device
+  device() const override
+  { return input_conv.weight.device(); }
+
+  // Returns the layout of the weights and the activations.
+  torch::MemoryFormat
+  memory_format() const noexcept
+  { return mem_format; }
+
+  // Returns a copy of the network on |device|.
+  FoldedNet
+  to(torch::Device device) const;
+
+  // Writes the weights to |file_name| in the flat weight format, i.e. a small
+  // header and a table of the weight shapes, followed by the raw fp32 weights,
+  // each aligned to 64 bytes. The file uses the byte order of the host. Throws
+  // an exception if the file cannot be written.
+  void
+  save(const std::filesystem::path& file_name) const;
+
+  // Maps the flat weight file |file_name| into memory, and returns a network
+  // on the CPU whose weights point into the mapping, i.e. the weights are
+  // neither read nor copied up front, and the pages are shared by all the
+  // processes that load the same file. The mapping is read only, so the
+  // weights must not be modified in place. Throws an exception if the file is
+  // not a valid flat weight file.
+  static FoldedNet
+  load(const std::filesystem::path& file_name);
+
+private:
+  friend class QuantizedNet;
+  friend class ScriptNet;
+
+  // Initializes an empty network for load.
+  FoldedNet() = default;
+
+  // Returns pointers to the weights, in the order of the flat weight file.
+  std::vector<torch::Tensor*>
+  weights();
+
+  // Runs the initial convolution and the residual tower.
+  torch::Tensor
+  tower(const torch::Tensor& x) const;
+
+  // Runs the policy and value heads on the output of the residual tower.
+  std::pair<torch::Tensor, torch::Tensor>
+  heads(const torch::Tensor& out) const;
+
+  struct ResBlock {
+    FoldedConv conv1;
+    FoldedConv conv2;
+  };
+
+  torch::MemoryFormat mem_format = torch::MemoryFormat::Contiguous;
+
+  FoldedConv input_conv;
+  std::vector<ResBlock> res_blocks;
+
+  // The policy head.
+  FoldedConv policy_conv1;
+  FoldedConv policy_conv2;
+
+  // The value head.
+  FoldedConv value_conv;
+  torch::Tensor value_fc1_weight;
+  torch::Tensor value_fc1_bias;
+  torch::Tensor value_fc2_weight;
+  torch::Tensor value_fc2_bias;
+};
+
+} // namespace blunder
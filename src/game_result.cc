@@ -3,7 +3,9 @@
 #include <format>
 #include <iterator>
 #include <stdexcept>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 namespace blunder {
 namespace {
@@ -20,6 +22,24 @@ get_game_winner(std::optional<Color> color) noexcept
 
 }
 
+std::string_view
+str(GameEnd game_end) noexcept
+{
+  switch (game_end) {
+    case GameEnd::Rules:
+      return "Rules";
+    case GameEnd::MoveLimit:
+      return "MoveLimit";
+    case GameEnd::Tablebase:
+      return "Tablebase";
+    case GameEnd::Resignation:
+      return "Resignation";
+    case GameEnd::DrawAdjudication:
+      return "DrawAdjudication";
+  }
+  return "None";
+}
+
 std::string
 GameStats::dbg() const {
   std::string buffer;
@@ -28,6 +48,7 @@ GameStats::dbg() const {
     R"(
     GameStats[
         winner={},
+        game_end={},
         max_nodes_expanded={},
         avg_nodes_expanded={:.3f}
         max_nodes_visited={}
@@ -36,8 +57,11 @@ GameStats::dbg() const {
         avg_depth={:.3f}
         millis_per_eval={:.3f}
         millis_per_search={:.3f}
+        simulations_saved_frac={:.3f}
+        policy_target_frac={:.3f}
     ])",
   str(game_winner),
+  str(game_end),
   max_nodes_expanded,
   avg_nodes_expanded,
   max_nodes_visited,
@@ -45,7 +69,9 @@ GameStats::dbg() const {
   max_depth,
   avg_depth,
   millis_per_eval,
-  millis_per_search);
+  millis_per_search,
+  simulations_saved_frac,
+  policy_target_frac);
 
   return buffer;
 }
@@ -59,8 +85,11 @@ GameResult::stats() const {
   unsigned total_nodes_visited = 0;
   float total_millis_per_eval = 0;
   float total_millis_per_search = 0;
+  unsigned total_simulations = 0;
+  unsigned total_simulations_saved = 0;
+  unsigned total_policy_targets = 0;
 
-  for (const auto& sr : moves) {
+  for (const auto& sr : plies) {
     total_depth += sr.depth;
     game_stats.max_depth = std::max(game_stats.max_depth, sr.depth);
 
@@ -75,23 +104,50 @@ GameResult::stats() const {
         game_stats.max_nodes_visited,
         sr.nodes_visited);
 
+    total_simulations += sr.simulations;
+    total_simulations_saved += sr.simulations_saved;
+    total_policy_targets += sr.policy_target;
+
     total_millis_per_eval += sr.millis_per_eval;
     total_millis_per_search += sr.millis_search_time;
   }
 
-  auto n = moves.size();
+  auto n = plies.size();
 
   if (not n)
     throw std::runtime_error("Cannot compute game stats without moves.");
 
   game_stats.game_winner = get_game_winner(winner);
+  game_stats.game_end = game_end;
   game_stats.avg_nodes_expanded = static_cast<float>(total_nodes_expanded) / n;
   game_stats.avg_nodes_visited = static_cast<float>(total_nodes_visited) / n;
   game_stats.avg_depth = static_cast<float>(total_depth) / n;
   game_stats.millis_per_eval = total_millis_per_eval / n;
   game_stats.millis_per_search = total_millis_per_search / n;
+  game_stats.policy_target_frac = static_cast<float>(total_policy_targets) / n;
+
+  if (auto total = total_simulations + total_simulations_saved)
+    game_stats.simulations_saved_frac =
+      static_cast<float>(total_simulations_saved) / total;
 
   return game_stats;
 }
 
+std::vector<Board>
+GameResult::replay() const
+{
+  std::vector<Board> boards;
+  boards.reserve(plies.size() + 1);
+  boards.push_back(game_start);
+
+  for (const auto& ply : plies) {
+    auto board = boards.back();
+    if (not board.update_with_move(ply.mv))
+      throw std::logic_error("Unable to replay move from game record.");
+    boards.push_back(std::move(board));
+  }
+
+  return boards;
+}
+
 } // namespace blunder
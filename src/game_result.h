@@ -1,16 +1,37 @@
 #pragma once
 
+#include <cassert>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "board.h"
+#include "coding_util.h"
 #include "color.h"
 #include "game_winner.h"
+#include "move.h"
 #include "search_result.h"
 
 namespace blunder {
 
+// How a game ended.
+enum class GameEnd {
+  // Mate, or a draw by the rules of chess.
+  Rules,
+  // The game reached the limit of moves.
+  MoveLimit,
+  // The position was found in the tablebases.
+  Tablebase,
+  // The loser resigned.
+  Resignation,
+  // The game was adjudicated as a draw.
+  DrawAdjudication
+};
+
+std::string_view
+str(GameEnd game_end) noexcept;
+
 struct GameStats {
   // Maximum nodes expanded in any one run.
   unsigned max_nodes_expanded = 0;
@@ -36,21 +57,114 @@ struct GameStats {
   // The average number of milliseconds per search for the entire game.
   float millis_per_search = 0;
 
+  // The fraction of the simulations in the simulation limits that were saved
+  // by stopping searches once the best move was decided.
+  float simulations_saved_frac = 0;
+
+  // The fraction of the plies whose visit counts are policy targets, i.e. the
+  // plies searched with the full search.
+  float policy_target_frac = 0;
+
   GameWinner game_winner = GameWinner::None;
 
+  GameEnd game_end = GameEnd::Rules;
+
   // Creats a debug string.
   std::string
   dbg() const;
 };
 
+// A compact record of a single ply in a game, i.e. the move that was played,
+// the visit counts from the search at the position, and a few statistics from
+// the search. Unlike SearchResult, it does not hold any boards, since the
+// positions can be replayed from the start of the game.
+struct PlyRecord {
+  // The move that was played.
+  Move mv;
+
+  // The visit counts for the moves searched at the position.
+  std::vector<PolicyEntry> policy;
+
+  // The expected value of winning from the position for the current player.
+  float value = 0;
+
+  // False if the value is unknown. See SearchResult.
+  bool has_value = true;
+
+  // False if the visit counts came from a cheap search, and hence they are not
+  // a policy training target.
+  bool policy_target = true;
+
+  // Search statistics. See SearchResult.
+  unsigned nodes_expanded = 0;
+  unsigned nodes_visited = 0;
+  unsigned depth = 0;
+  unsigned simulations = 0;
+  unsigned simulations_saved = 0;
+  float millis_per_eval = 0;
+  float millis_search_time = 0;
+
+  // Creates a PlyRecord from a SearchResult. It's an error to pass in a
+  // SearchResult with a best board without a valid last_move.
+  static PlyRecord
+  from(const SearchResult& search_result)
+  {
+    auto last_move = search_result.best.board.last_move();
+    assert(last_move);
+
+    return PlyRecord{
+      .mv=*last_move,
+      .policy=encode_policy(search_result.moves),
+      .value=search_result.value,
+      .has_value=search_result.has_value,
+      .policy_target=search_result.policy_target,
+      .nodes_expanded=search_result.nodes_expanded,
+      .nodes_visited=search_result.nodes_visited,
+      .depth=search_result.depth,
+      .simulations=search_result.simulations,
+      .simulations_saved=search_result.simulations_saved,
+      .millis_per_eval=search_result.millis_per_eval,
+      .millis_search_time=search_result.millis_search_time
+    };
+  }
+};
+
+// The record of a game, stored compactly as the starting position and the
+// moves that were played, such that the memory used by a game grows linearly
+// with the number of moves. The positions are replayed on demand.
 struct GameResult {
   Board game_start;
-  std::vector<SearchResult> moves;
+  std::vector<PlyRecord> plies;
   // TODO: replace this with GameWinner.
   std::optional<Color> winner;
 
+  GameEnd game_end = GameEnd::Rules;
+
+  // In a game played out without resignations, the player that would have
+  // resigned first. The resignation would have been wrong unless the player
+  // lost the game.
+  std::optional<Color> would_resign;
+
+  // Returns true if the game has a resignation that would have been wrong.
+  bool
+  is_false_resignation() const noexcept
+  {
+    if (not would_resign)
+      return false;
+    return winner != (*would_resign == Color::White
+        ? Color::Black
+        : Color::White);
+  }
+
   GameStats
   stats() const;
+
+  // Replays the game from the starting position. Returns a vector with one
+  // more board than the number of plies, where board i is the position before
+  // ply i, and the last board is the final position. Throws an exception if a
+  // move cannot be applied.
+  std::vector<Board>
+  replay() const;
 };
 
 } // namespace blunder
@@ -0,0 +1,115 @@
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+
+#include "board.h"
+#include "par.h"
+#include "tablebase.h"
+#include "tablebase_generator.h"
+#include "timer.h"
+
+using namespace blunder;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help     Print this help message.\n"
+     << "   -d|--dir      The directory to write the tables to.\n"
+     << "   -m|--men      The maximum number of pieces, 3 or 4.\n"
+     << "   -t|--threads  The number of threads to generate with.\n"
+     << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"dir", required_argument, nullptr, 'd'},
+    {"men", required_argument, nullptr, 'm'},
+    {"threads", required_argument, nullptr, 't'},
+    {0, 0, 0, 0},
+  };
+
+  std::string dir = "tablebases";
+  unsigned men = Tablebase::kMaxMen;
+  unsigned threads = std::thread::hardware_concurrency();
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hd:m:t:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'd':
+        dir = optarg;
+        break;
+      case 'm':
+        try {
+          men = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--men needs to be a valid number, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 't':
+        try {
+          threads = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--threads needs to be a valid number, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cerr);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (men < 3 or men > Tablebase::kMaxMen) {
+    std::cerr << "--men needs to be between 3 and " << Tablebase::kMaxMen
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Board::register_magics();
+
+  try {
+    TablebaseGenerator generator(
+        dir, std::make_shared<par::WorkQ>(threads ? threads : 1));
+
+    // The tables that are already in the directory are kept, so that an
+    // interrupted generation continues where it stopped.
+    for (const auto& material : TablebaseGenerator::all_materials(men)) {
+      const auto key = material.key();
+      if (generator.tablebase().has_table(key)) {
+        std::cout << key << " exists" << std::endl;
+        continue;
+      }
+
+      Timer timer;
+      timer.start();
+      generator.generate(material);
+      timer.end();
+      std::cout << key << " generated in " << timer.total_millis() << " ms"
+                << std::endl;
+    }
+  } catch (std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
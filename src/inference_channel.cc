@@ -0,0 +1,504 @@
+#include "inference_channel.h"
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace blunder {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The shared memory consists of a ChannelHeader, the ring of submitted
+// requests, the ring of free slots, and the slots, each of them on their own
+// cache lines. The fields that are shared between processes are only accessed
+// with std::atomic_ref, which is address free for lock-free types.
+constexpr std::size_t kCacheLine = 64;
+constexpr char kChannelMagic[8] = {'B', 'L', 'N', 'D', 'E', 'V', 'A', 'L'};
+constexpr std::uint32_t kChannelVersion = 1;
+
+static_assert(std::atomic_ref<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic_ref<std::uint32_t>::is_always_lock_free);
+
+struct alignas(kCacheLine) ChannelHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t slots;
+  std::uint32_t input_size;
+  std::uint32_t policy_size;
+  // Set once the creator initialized the channel.
+  std::uint32_t ready;
+  std::uint32_t closed;
+};
+
+struct RingHeader {
+  alignas(kCacheLine) std::uint64_t head;
+  alignas(kCacheLine) std::uint64_t tail;
+};
+
+struct RingCell {
+  std::uint64_t seq;
+  std::uint32_t slot;
+};
+
+struct alignas(kCacheLine) SlotHeader {
+  // Set once the server wrote the reply.
+  std::uint32_t done;
+  float value;
+};
+
+constexpr std::size_t
+round_up(std::size_t bytes) noexcept
+{ return (bytes + kCacheLine - 1) / kCacheLine * kCacheLine; }
+
+// Spins for a short while before yielding and then sleeping, such that a
+// quick reply is picked up right away, while a long wait does not burn a
+// core.
+class Backoff {
+public:
+  void
+  pause()
+  {
+    if (spins < kSpins) {
+      ++spins;
+    } else if (spins < kSpins + kYields) {
+      ++spins;
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+  }
+
+private:
+  static constexpr unsigned kSpins = 64;
+  static constexpr unsigned kYields = 64;
+  unsigned spins = 0;
+};
+
+// A bounded lock-free queue of slot indices for many producers and many
+// consumers, where each cell has a sequence number that tells whether it is
+// ready to be written or read for the current lap around the ring. Since
+// there are as many cells as slots, and a slot is in at most one ring, the
+// ring never holds more slots than cells. A push may still find its cell in
+// use for the last lap though, when a consumer advanced the head past the cell
+// but has not yet marked it free, and then waits for the consumer.
+class Ring {
+public:
+  Ring(std::byte* addr, unsigned size) noexcept
+    : header(reinterpret_cast<RingHeader*>(addr)),
+      cells(reinterpret_cast<RingCell*>(addr + sizeof(RingHeader))),
+      mask(size - 1)
+  {}
+
+  static std::size_t
+  bytes(unsigned size) noexcept
+  { return round_up(sizeof(RingHeader) + size * sizeof(RingCell)); }
+
+  void
+  init() noexcept
+  {
+    for (std::uint64_t i = 0; i <= mask; ++i)
+      cells[i].seq = i;
+  }
+
+  void
+  push(unsigned slot) noexcept
+  {
+    Backoff backoff;
+    std::atomic_ref tail(header->tail);
+    auto pos = tail.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = cells[pos & mask];
+      auto seq = std::atomic_ref(cell.seq).load(std::memory_order_acquire);
+      auto diff = static_cast<std::int64_t>(seq - pos);
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          cell.slot = slot;
+          std::atomic_ref(cell.seq).store(pos + 1, std::memory_order_release);
+          return;
+        }
+      } else if (diff < 0) {
+        // The consumer of the last lap marks the cell free right after it
+        // advanced the head.
+        backoff.pause();
+        pos = tail.load(std::memory_order_relaxed);
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::optional<unsigned>
+  pop() noexcept
+  {
+    std::atomic_ref head(header->head);
+    auto pos = head.load(std::memory_order_relaxed);
+    while (true) {
+      auto& cell = cells[pos & mask];
+      auto seq = std::atomic_ref(cell.seq).load(std::memory_order_acquire);
+      auto diff = static_cast<std::int64_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          unsigned slot = cell.slot;
+          std::atomic_ref(cell.seq).store(
+              pos + mask + 1, std::memory_order_release);
+          return slot;
+        }
+      } else if (diff < 0) {
+        return std::nullopt;
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  RingHeader* header;
+  RingCell* cells;
+  std::uint64_t mask;
+};
+
+std::size_t
+slot_bytes(const ChannelLayout& layout) noexcept
+{
+  return sizeof(SlotHeader)
+    + round_up((layout.input_size + layout.policy_size) * sizeof(float));
+}
+
+std::size_t
+total_bytes(const ChannelLayout& layout) noexcept
+{
+  return sizeof(ChannelHeader)
+    + 2 * Ring::bytes(layout.slots)
+    + layout.slots * slot_bytes(layout);
+}
+
+// Returns an error message for |what| with the description of errno.
+std::string
+errno_message(std::string what, const std::string& name)
+{
+  what += " ";
+  what += name;
+  what += ": ";
+  what += std::strerror(errno);
+  return what;
+}
+
+ChannelHeader&
+header_of(std::byte* addr) noexcept
+{ return *reinterpret_cast<ChannelHeader*>(addr); }
+
+Ring
+requests_of(std::byte* addr, const ChannelLayout& layout) noexcept
+{ return Ring(addr + sizeof(ChannelHeader), layout.slots); }
+
+Ring
+free_of(std::byte* addr, const ChannelLayout& layout) noexcept
+{
+  return Ring(
+      addr + sizeof(ChannelHeader) + Ring::bytes(layout.slots),
+      layout.slots);
+}
+
+} // namespace
+
+InferenceChannel
+InferenceChannel::create(const std::string& name, ChannelLayout layout)
+{
+  if (not name.starts_with('/'))
+    throw std::invalid_argument("Channel name must start with /.");
+  if (not std::has_single_bit(layout.slots))
+    throw std::invalid_argument("slots must be a power of two.");
+  if (not layout.input_size or not layout.policy_size)
+    throw std::invalid_argument("input_size and policy_size must be non-zero.");
+
+  int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1)
+    throw std::runtime_error(errno_message("Unable to create", name));
+
+  InferenceChannel channel;
+  channel.name = name;
+  channel.chan_layout = layout;
+  channel.is_owner = true;
+
+  const auto bytes = total_bytes(layout);
+  if (::ftruncate(fd, bytes) == -1) {
+    auto msg = errno_message("Unable to size", name);
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error(std::move(msg));
+  }
+
+  try {
+    channel.map(fd, bytes);
+  } catch (...) {
+    ::shm_unlink(name.c_str());
+    throw;
+  }
+
+  // The object is zero filled, so only the non-zero fields are set before the
+  // channel is marked ready.
+  auto& header = header_of(channel.addr);
+  std::memcpy(header.magic, kChannelMagic, sizeof(kChannelMagic));
+  header.version = kChannelVersion;
+  header.slots = layout.slots;
+  header.input_size = layout.input_size;
+  header.policy_size = layout.policy_size;
+
+  requests_of(channel.addr, layout).init();
+  auto free = free_of(channel.addr, layout);
+  free.init();
+  for (unsigned slot = 0; slot < layout.slots; ++slot)
+    free.push(slot);
+
+  std::atomic_ref(header.ready).store(1, std::memory_order_release);
+  return channel;
+}
+
+InferenceChannel
+InferenceChannel::open(const std::string& name)
+{
+  int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+  if (fd == -1)
+    throw std::runtime_error(errno_message("Unable to open", name));
+
+  struct stat st;
+  if (::fstat(fd, &st) == -1) {
+    auto msg = errno_message("Unable to stat", name);
+    ::close(fd);
+    throw std::runtime_error(std::move(msg));
+  }
+
+  if (static_cast<std::size_t>(st.st_size) < sizeof(ChannelHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Not an inference channel: " + name);
+  }
+
+  InferenceChannel channel;
+  channel.name = name;
+  channel.map(fd, st.st_size);
+
+  auto& header = header_of(channel.addr);
+  if (not std::atomic_ref(header.ready).load(std::memory_order_acquire))
+    throw std::runtime_error("Inference channel is not ready: " + name);
+  if (std::memcmp(header.magic, kChannelMagic, sizeof(kChannelMagic)))
+    throw std::runtime_error("Not an inference channel: " + name);
+  if (header.version != kChannelVersion)
+    throw std::runtime_error("Unsupported inference channel version.");
+
+  channel.chan_layout = ChannelLayout{
+    .slots=header.slots,
+    .input_size=header.input_size,
+    .policy_size=header.policy_size
+  };
+  if (channel.len != total_bytes(channel.chan_layout))
+    throw std::runtime_error("Truncated inference channel: " + name);
+
+  return channel;
+}
+
+InferenceChannel::InferenceChannel(InferenceChannel&& other) noexcept
+  : name(std::move(other.name)),
+    addr(std::exchange(other.addr, nullptr)),
+    len(std::exchange(other.len, 0)),
+    chan_layout(other.chan_layout),
+    is_owner(std::exchange(other.is_owner, false))
+{}
+
+InferenceChannel&
+InferenceChannel::operator=(InferenceChannel&& other) noexcept
+{
+  if (this != &other) {
+    unmap();
+    name = std::move(other.name);
+    addr = std::exchange(other.addr, nullptr);
+    len = std::exchange(other.len, 0);
+    chan_layout = other.chan_layout;
+    is_owner = std::exchange(other.is_owner, false);
+  }
+  return *this;
+}
+
+InferenceChannel::~InferenceChannel()
+{ unmap(); }
+
+void
+InferenceChannel::unmap() noexcept
+{
+  if (not addr)
+    return;
+
+  // The clients that still have the object mapped see it closed, rather than
+  // waiting for replies that never come.
+  if (is_owner) {
+    close();
+    ::shm_unlink(name.c_str());
+  }
+  ::munmap(addr, len);
+  addr = nullptr;
+  len = 0;
+}
+
+void
+InferenceChannel::map(int fd, std::size_t bytes)
+{
+  void* ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // The mapping keeps its own reference to the object.
+  ::close(fd);
+
+  if (ptr == MAP_FAILED)
+    throw std::runtime_error(errno_message("Unable to map", name));
+
+  addr = static_cast<std::byte*>(ptr);
+  len = bytes;
+}
+
+std::byte*
+InferenceChannel::slot_at(unsigned slot) const noexcept
+{
+  assert(slot < chan_layout.slots);
+  return addr + sizeof(ChannelHeader)
+    + 2 * Ring::bytes(chan_layout.slots)
+    + slot * slot_bytes(chan_layout);
+}
+
+unsigned
+InferenceChannel::acquire()
+{
+  auto free = free_of(addr, chan_layout);
+  Backoff backoff;
+  while (true) {
+    if (is_closed())
+      throw std::runtime_error("Inference channel is closed.");
+    if (auto slot = free.pop())
+      return *slot;
+    backoff.pause();
+  }
+}
+
+std::span<float>
+InferenceChannel::input(unsigned slot) noexcept
+{
+  auto* floats = reinterpret_cast<float*>(slot_at(slot) + sizeof(SlotHeader));
+  return {floats, chan_layout.input_size};
+}
+
+void
+InferenceChannel::submit(unsigned slot) noexcept
+{
+  // The push publishes the cleared flag and the input with release order.
+  auto& slot_header = *reinterpret_cast<SlotHeader*>(slot_at(slot));
+  std::atomic_ref(slot_header.done).store(0, std::memory_order_relaxed);
+  requests_of(addr, chan_layout).push(slot);
+}
+
+void
+InferenceChannel::wait(unsigned slot) const
+{
+  auto& slot_header = *reinterpret_cast<SlotHeader*>(slot_at(slot));
+  Backoff backoff;
+  while (not std::atomic_ref(slot_header.done).load(
+        std::memory_order_acquire)) {
+    if (is_closed())
+      throw std::runtime_error("Inference channel is closed.");
+    backoff.pause();
+  }
+}
+
+std::span<const float>
+InferenceChannel::policy(unsigned slot) const noexcept
+{
+  const auto* floats =
+    reinterpret_cast<const float*>(slot_at(slot) + sizeof(SlotHeader));
+  return {floats + chan_layout.input_size, chan_layout.policy_size};
+}
+
+float
+InferenceChannel::value(unsigned slot) const noexcept
+{ return reinterpret_cast<const SlotHeader*>(slot_at(slot))->value; }
+
+void
+InferenceChannel::release(unsigned slot) noexcept
+{ free_of(addr, chan_layout).push(slot); }
+
+std::size_t
+InferenceChannel::take(
+    std::span<unsigned> slots,
+    std::chrono::microseconds max_wait)
+{
+  auto requests = requests_of(addr, chan_layout);
+  auto deadline = Clock::now() + max_wait;
+  std::size_t taken = 0;
+  Backoff backoff;
+
+  while (taken < slots.size()) {
+    if (auto slot = requests.pop()) {
+      // The wait for a full batch starts with the first request, so that a
+      // request is never delayed by more than |max_wait|.
+      if (not taken)
+        deadline = Clock::now() + max_wait;
+      slots[taken++] = *slot;
+      continue;
+    }
+    if (is_closed() or Clock::now() >= deadline)
+      break;
+    backoff.pause();
+  }
+
+  return taken;
+}
+
+std::span<const float>
+InferenceChannel::request(unsigned slot) const noexcept
+{
+  const auto* floats =
+    reinterpret_cast<const float*>(slot_at(slot) + sizeof(SlotHeader));
+  return {floats, chan_layout.input_size};
+}
+
+std::span<float>
+InferenceChannel::reply_policy(unsigned slot) noexcept
+{
+  auto* floats = reinterpret_cast<float*>(slot_at(slot) + sizeof(SlotHeader));
+  return {floats + chan_layout.input_size, chan_layout.policy_size};
+}
+
+void
+InferenceChannel::reply(unsigned slot, float value) noexcept
+{
+  auto& slot_header = *reinterpret_cast<SlotHeader*>(slot_at(slot));
+  slot_header.value = value;
+  std::atomic_ref(slot_header.done).store(1, std::memory_order_release);
+}
+
+void
+InferenceChannel::close() noexcept
+{
+  std::atomic_ref(header_of(addr).closed).store(1, std::memory_order_release);
+}
+
+bool
+InferenceChannel::is_closed() const noexcept
+{
+  return std::atomic_ref(header_of(addr).closed).load(
+      std::memory_order_acquire);
+}
+
+} // namespace blunder
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace blunder {
+
+// The sizes of the requests and the replies of an InferenceChannel.
+struct ChannelLayout {
+  // The number of requests that can be in flight at once across all the
+  // clients, which must be a power of two.
+  unsigned slots = 256;
+
+  // The number of floats in an encoded position, i.e. 119 planes of 8x8.
+  unsigned input_size = 119 * 64;
+
+  // The number of floats in a policy, i.e. 73 planes of 8x8.
+  unsigned policy_size = 73 * 64;
+};
+
+// A channel in POSIX shared memory through which client processes send
+// encoded positions to a server process that evaluates them with a network,
+// and that writes the policy and the value back.
+//
+// Every request has a slot with room for its input and its reply. The free
+// slots and the submitted requests are kept in two lock-free ring buffers, so
+// neither the clients nor the server ever take a lock, and a client only
+// waits for the reply to its own slot. A slot is lost if its client dies with
+// a request in flight.
+class InferenceChannel {
+public:
+  // Creates the shared memory object |name|, e.g. "/blunder-eval", which is
+  // removed when the channel is destroyed. Throws an exception if the layout
+  // is invalid, or if the object exists or cannot be created.
+  static InferenceChannel
+  create(const std::string& name, ChannelLayout layout = {});
+
+  // Opens the channel |name| created by another process. Throws an exception
+  // if it does not exist, or is not an inference channel.
+  static InferenceChannel
+  open(const std::string& name);
+
+  InferenceChannel(const InferenceChannel&) = delete;
+  InferenceChannel& operator=(const InferenceChannel&) = delete;
+
+  InferenceChannel(InferenceChannel&& other) noexcept;
+  InferenceChannel& operator=(InferenceChannel&& other) noexcept;
+
+  ~InferenceChannel();
+
+  const ChannelLayout&
+  layout() const noexcept
+  { return chan_layout; }
+
+  // Client side. A request claims a slot, writes its input, submits it,
+  // waits for the reply, reads the reply, and releases the slot.
+
+  // Claims a free slot, waiting while all the slots are in flight. Throws an
+  // exception if the channel is closed.
+  unsigned
+  acquire();
+
+  std::span<float>
+  input(unsigned slot) noexcept;
+
+  void
+  submit(unsigned slot) noexcept;
+
+  // Waits for the reply to the request in |slot|. Throws an exception if the
+  // channel is closed before the reply.
+  void
+  wait(unsigned slot) const;
+
+  std::span<const float>
+  policy(unsigned slot) const noexcept;
+
+  float
+  value(unsigned slot) const noexcept;
+
+  void
+  release(unsigned slot) noexcept;
+
+  // Server side.
+
+  // Takes up to |slots.size()| requests into |slots|. Waits up to |max_wait|
+  // for the first request, and then until the batch is full or |max_wait|
+  // passed since the first request. Returns the number of requests taken,
+  // which is zero if none arrived.
+  std::size_t
+  take(std::span<unsigned> slots, std::chrono::microseconds max_wait);
+
+  std::span<const float>
+  request(unsigned slot) const noexcept;
+
+  std::span<float>
+  reply_policy(unsigned slot) noexcept;
+
+  // Sets the value of the reply to |slot|, which hands the reply, including
+  // the policy, to the client.
+  void
+  reply(unsigned slot, float value) noexcept;
+
+  // Closes the channel, such that the clients waiting on it throw an
+  // exception.
+  void
+  close() noexcept;
+
+  bool
+  is_closed() const noexcept;
+
+private:
+  InferenceChannel() = default;
+
+  // Maps |bytes| of the shared memory object opened as |fd|.
+  void
+  map(int fd, std::size_t bytes);
+
+  // Unmaps the channel, and removes it if this is the creator.
+  void
+  unmap() noexcept;
+
+  std::byte*
+  slot_at(unsigned slot) const noexcept;
+
+  std::string name;
+  std::byte* addr = nullptr;
+  std::size_t len = 0;
+  ChannelLayout chan_layout;
+  bool is_owner = false;
+};
+
+} // namespace blunder
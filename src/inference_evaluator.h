@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <utility>
+
+#include "board_path.h"
+#include "evaluator.h"
+#include "inference_net.h"
+#include "tensor_decoder.h"
+#include "tensor_encoder.h"
+
+namespace blunder {
+
+// Evaluates positions with an InferenceNet, e.g. a FoldedNet, rather than with
+// the AlphaZeroNet used for training.
+class InferenceEvaluator : public Evaluator {
+public:
+  InferenceEvaluator(
+      std::shared_ptr<const InferenceNet> net,
+      std::shared_ptr<TensorDecoder> tensor_decoder,
+      std::shared_ptr<TensorEncoder> tensor_encoder)
+    : net(std::move(net)),
+      tensor_decoder(std::move(tensor_decoder)),
+      tensor_encoder(std::move(tensor_encoder))
+  {
+    assert(this->net);
+    assert(this->tensor_decoder);
+    assert(this->tensor_encoder);
+  }
+
+  Prediction
+  predict(const EvalBoardPath& board_path) const override;
+
+private:
+  std::shared_ptr<const InferenceNet> net;
+  std::shared_ptr<TensorDecoder> tensor_decoder;
+  std::shared_ptr<TensorEncoder> tensor_encoder;
+};
+
+} // namespace blunder
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <utility>
+
+#include <torch/torch.h>
+
+namespace blunder {
+
+// The kind of network used to evaluate positions outside of training.
+enum class EvalNet {
+  // Runs the AlphaZeroNet as is, i.e. the same modules used for training.
+  Eager,
+  // Runs a FoldedNet exported from the AlphaZeroNet.
+  Folded,
+  // Runs a QuantizedNet exported from the AlphaZeroNet, on the CPU.
+  Int8
+};
+
+// An abstract interface for networks that only run inference, e.g. a network
+// exported from AlphaZeroNet with optimizations that are not valid during
+// training.
+class InferenceNet {
+public:
+  virtual
+  ~InferenceNet() = default;
+
+  // Runs the network on a batch of encoded positions, and returns the policy
+  // and value tensors.
+  virtual std::pair<torch::Tensor, torch::Tensor>
+  predict(torch::Tensor x) const = 0;
+
+  // Returns the device where the network runs.
+  virtual torch::Device
+  device() const = 0;
+};
+
+} // namespace blunder
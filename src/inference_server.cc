@@ -0,0 +1,90 @@
+#include "inference_server.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include <torch/torch.h>
+
+namespace blunder {
+
+InferenceServer::InferenceServer(
+    std::shared_ptr<const InferenceNet> net,
+    std::shared_ptr<InferenceChannel> channel,
+    ServerOptions options)
+  : net(std::move(net)),
+    channel(std::move(channel)),
+    options(options)
+{
+  if (not this->net)
+    throw std::invalid_argument("net is null.");
+  if (not this->channel)
+    throw std::invalid_argument("channel is null.");
+  const auto& layout = this->channel->layout();
+  if (not options.max_batch or options.max_batch > layout.slots)
+    throw std::invalid_argument("max_batch must be in range [1,slots].");
+  if (layout.input_size % 64)
+    throw std::invalid_argument("input_size must be a multiple of 64.");
+
+  slots.resize(options.max_batch);
+}
+
+void
+InferenceServer::serve(std::stop_token stop_token)
+{
+  try {
+    while (not stop_token.stop_requested() and not channel->is_closed())
+      serve_batch();
+  } catch (...) {
+    // The clients would otherwise wait forever for their replies.
+    channel->close();
+    throw;
+  }
+}
+
+std::size_t
+InferenceServer::serve_batch()
+{
+  const auto n = channel->take(slots, options.max_wait);
+  if (not n)
+    return 0;
+
+  c10::InferenceMode inference_mode;
+
+  const auto& layout = channel->layout();
+  const auto batch = static_cast<std::int64_t>(n);
+
+  auto input = torch::empty({batch, layout.input_size / 64, 8, 8});
+  auto* input_data = input.data_ptr<float>();
+  for (std::size_t i = 0; i < n; ++i) {
+    std::ranges::copy(
+        channel->request(slots[i]),
+        input_data + i * layout.input_size);
+  }
+
+  auto [policy, value] = net->predict(input.to(net->device()));
+  policy = policy.to(torch::kCPU, torch::kFloat)
+                 .contiguous()
+                 .reshape({batch, -1});
+  value = value.to(torch::kCPU, torch::kFloat).contiguous().reshape({batch});
+
+  if (policy.size(1) != layout.policy_size)
+    throw std::logic_error("The policy does not match the channel layout.");
+
+  const auto* policy_data = policy.data_ptr<float>();
+  const auto* value_data = value.data_ptr<float>();
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto* row = policy_data + i * layout.policy_size;
+    std::copy(row, row + layout.policy_size,
+              channel->reply_policy(slots[i]).begin());
+    channel->reply(slots[i], value_data[i]);
+  }
+
+  ++num_batches;
+  num_requests += n;
+  return n;
+}
+
+} // namespace blunder
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <vector>
+
+#include "inference_channel.h"
+#include "inference_net.h"
+
+namespace blunder {
+
+// How an InferenceServer groups the requests into batches.
+struct ServerOptions {
+  // The most requests evaluated in one batch.
+  unsigned max_batch = 64;
+
+  // The longest that the first request of a batch waits for the batch to
+  // fill up, which trades the latency of a request for larger batches.
+  std::chrono::microseconds max_wait{500};
+};
+
+// Evaluates the requests of the clients of an InferenceChannel with a single
+// network, such that several self-play processes share one network, e.g. on
+// one GPU, and their requests are evaluated in batches instead of one at a
+// time. The clients use a RemoteEvaluator.
+class InferenceServer {
+public:
+  // Throws an exception if the network or the channel are null, or if
+  // |options.max_batch| is zero or larger than the slots of the channel.
+  InferenceServer(
+      std::shared_ptr<const InferenceNet> net,
+      std::shared_ptr<InferenceChannel> channel,
+      ServerOptions options = {});
+
+  // Evaluates batches until |stop_token| is stopped or the channel is closed.
+  void
+  serve(std::stop_token stop_token);
+
+  // Evaluates one batch of the requests that arrive within the max wait.
+  // Returns the number of requests evaluated.
+  std::size_t
+  serve_batch();
+
+  // Returns the number of batches evaluated.
+  std::uint64_t
+  batches() const noexcept
+  { return num_batches; }
+
+  // Returns the number of requests evaluated.
+  std::uint64_t
+  requests() const noexcept
+  { return num_requests; }
+
+private:
+  std::shared_ptr<const InferenceNet> net;
+  std::shared_ptr<InferenceChannel> channel;
+  ServerOptions options;
+  std::vector<unsigned> slots;
+  std::uint64_t num_batches = 0;
+  std::uint64_t num_requests = 0;
+};
+
+} // namespace blunder
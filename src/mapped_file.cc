@@ -0,0 +1,87 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace blunder {
+
+namespace {
+
+// Returns an error message for |what| with the description of errno.
+std::string
+errno_message(std::string what, const std::filesystem::path& path)
+{
+  what += " ";
+  what += path.string();
+  what += ": ";
+  what += std::strerror(errno);
+  return what;
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    throw std::runtime_error(errno_message("Unable to open", path));
+
+  struct stat st;
+  if (::fstat(fd, &st) == -1) {
+    auto msg = errno_message("Unable to stat", path);
+    ::close(fd);
+    throw std::runtime_error(std::move(msg));
+  }
+
+  len = st.st_size;
+
+  // An empty file cannot be mapped, but it is a valid empty mapping.
+  if (not len) {
+    ::close(fd);
+    return;
+  }
+
+  void* ptr = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+
+  if (ptr == MAP_FAILED)
+    throw std::runtime_error(errno_message("Unable to map", path));
+
+  addr = static_cast<const std::byte*>(ptr);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : addr(std::exchange(other.addr, nullptr)),
+    len(std::exchange(other.len, 0))
+{}
+
+MappedFile&
+MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other) {
+    if (addr)
+      ::munmap(const_cast<std::byte*>(addr), len);
+    addr = std::exchange(other.addr, nullptr);
+    len = std::exchange(other.len, 0);
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile()
+{
+  if (addr)
+    ::munmap(const_cast<std::byte*>(addr), len);
+}
+
+} // namespace blunder
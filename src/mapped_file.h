@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace blunder {
+
+// A read-only memory mapping of a whole file, which lets large files, e.g.
+// network weights, be used in place without reading them into memory first.
+// The pages are loaded lazily by the OS and are shared with other processes
+// that map the same file.
+class MappedFile {
+public:
+  // Maps the file at |path|. Throws an exception if the file cannot be opened
+  // or mapped.
+  explicit
+  MappedFile(const std::filesystem::path& path);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  ~MappedFile();
+
+  // Returns the contents of the file.
+  std::span<const std::byte>
+  bytes() const noexcept
+  { return {addr, len}; }
+
+  // Returns the size of the file in bytes.
+  std::size_t
+  size() const noexcept
+  { return len; }
+
+private:
+  const std::byte* addr = nullptr;
+  std::size_t len = 0;
+};
+
+} // namespace blunder
@@ -4,9 +4,12 @@
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <random>
 #include <utility>
 
+#include "tablebase.h"
 #include "timer.h"
 
 namespace blunder {
@@ -52,10 +55,15 @@ struct Node {
   Node* parent = nullptr;
   float prior;
   unsigned visits = 1;
+  // The values are for the player making the move to the node.
   float value = 0.0;
   // The initial value from the network or from a terminal state.
   float init_value = 0.0;
   bool is_leaf = true;
+  // The value is exact from the tablebases.
+  bool is_exact = false;
+  // The terminal or exact value was counted in the first visit.
+  bool is_scored = false;
 
   Node*
   choose_next() noexcept
@@ -66,23 +74,38 @@ struct Node {
   choose_action() noexcept;
 
   // Expands the node with the move probabilities and the value from the
-  // prediction.
+  // prediction. |from_root| is the path leading up to the root of the search,
+  // which is used to find children that repeat earlier positions.
   Node&
-  expand(Prediction pred);
+  expand(Prediction pred, const EvalBoardPath& from_root);
 
   // Returns a board path from the current node, with current node the root
   // node of the board path.
-  EvalBoardPath
+  template<typename Path = EvalBoardPath>
+  Path
   get_path(const EvalBoardPath& from_root) const noexcept;
 
-  // Returns true if the board reached a terminal state.
+  // Returns true if the board reached a terminal state. A position below the
+  // root that repeats within the game is treated as a draw, since neither
+  // player can gain by repeating it again, which cuts repeated lines right
+  // away. The root is still searched, since the game goes on from it. A
+  // position in the tablebases is treated like a terminal state too.
   bool
   is_terminal() const noexcept
-  { return board.is_terminal(); }
+  {
+    return board.is_terminal()
+      or (parent and board.repetitions())
+      or is_exact;
+  }
+
+  // Sets the exact value of the node from the WDL of the tablebases, which is
+  // for the player moving next, like terminate.
+  Node&
+  set_exact(Wdl wdl) noexcept;
 
   // Terminates the node by setting a value based on whether player making the
   // move is winning or not, like expand, but without computing subsequent
-  // actions.
+  // actions. Every later call counts another visit of the node.
   Node&
   terminate();
 
@@ -106,7 +129,7 @@ struct Node {
   operator<(const Node& right) const noexcept
   { return mean_uct() < right.mean_uct(); }
 
-  // Propagates search statistics back up the search tree.
+  // Propagates the initial value of the node back up the search tree.
   void
   update_stats() noexcept;
 
@@ -115,11 +138,12 @@ struct Node {
   add_noise() noexcept;
 };
 
-EvalBoardPath
+template<typename Path>
+Path
 Node::get_path(const EvalBoardPath& from_root) const noexcept
 {
   auto node = this;
-  EvalBoardPath board_path;
+  Path board_path;
 
   // Check for parent to avoid adding the root node here, since push(from_root)
   // takes care of adding the root.
@@ -134,21 +158,27 @@ Node::get_path(const EvalBoardPath& from_root) const noexcept
 }
 
 Node&
-Node::expand(Prediction pred)
+Node::expand(Prediction pred, const EvalBoardPath& from_root)
 {
   assert(is_leaf and not is_terminal());
 
   if (pred.move_probs.empty())
     throw std::logic_error("No moves found, but expecting some.");
 
+  // The prediction is for the player moving next, i.e. the opponent of the
+  // player making the move to the node.
   is_leaf = false;
-  value = pred.value;
+  value = -pred.value;
   init_value = value;
   children.reserve(pred.move_probs.size());
 
   for (auto& [child_board, child_prior] : pred.move_probs)
     children.emplace_back(std::move(child_board), *this, child_prior);
 
+  auto history = get_path<RepetitionBoardPath>(from_root);
+  for (auto& child : children)
+    child.board.find_repetition(history);
+
   return *this;
 }
 
@@ -156,7 +186,7 @@ void
 Node::update_stats() noexcept
 {
   auto node = parent;
-  auto val = value;
+  auto val = init_value;
 
   while (node) {
     val *= -1;
@@ -166,15 +196,35 @@ Node::update_stats() noexcept
   }
 }
 
+Node&
+Node::set_exact(Wdl wdl) noexcept
+{
+  assert(is_leaf);
+  is_exact = true;
+  // The value is for the player making the move to the node.
+  init_value = wdl == Wdl::Win ? -1.0 : wdl == Wdl::Loss ? 1.0 : 0.0;
+  value = init_value;
+  is_scored = true;
+  return *this;
+}
+
 Node&
 Node::terminate()
 {
-  if (not board.is_terminal())
+  if (not is_terminal())
     throw std::logic_error("Node is not in a terminal state.");
-
   // The value of 1 here is for the move leading up to the check.
-  init_value = board.is_mate() ? 1.0 : 0.0;
-  value = value;
+  if (not is_exact)
+    init_value = board.is_mate() ? 1.0 : 0.0;
+
+  // The first visit is counted when the node is created.
+  if (is_scored) {
+    ++visits;
+    value += init_value;
+  } else {
+    value = init_value;
+    is_scored = true;
+  }
   return *this;
 }
 
@@ -205,6 +255,56 @@ Node::uct() const noexcept
 
 } // namespace
 
+struct Mcts::Tree {
+  // Returns the root for a search of |board|, which is the node of |board| if
+  // it's the root, a child, or a grandchild of the current root, or a new root
+  // otherwise.
+  Node&
+  reroot(const Board& board);
+
+  std::optional<Node> root;
+};
+
+Node&
+Mcts::Tree::reroot(const Board& board)
+{
+  if (root and root->board != board) {
+    Node* found = nullptr;
+    for (auto& child : root->children) {
+      if (child.board == board) {
+        found = &child;
+        break;
+      }
+      for (auto& grand_child : child.children) {
+        if (grand_child.board == board) {
+          found = &grand_child;
+          break;
+        }
+      }
+      if (found) break;
+    }
+
+    // A node scored by the tablebases has no subtree, and is searched again as
+    // a new root.
+    if (found and not found->is_exact) {
+      // The subtree is moved out before the old tree is released. The children
+      // keep their addresses, so only their parent pointers need an update.
+      Node subtree = std::move(*found);
+      root = std::move(subtree);
+      root->parent = nullptr;
+      for (auto& child : root->children)
+        child.parent = &*root;
+    } else {
+      root.reset();
+    }
+  }
+
+  if (not root)
+    root.emplace(board);
+
+  return *root;
+}
+
 Mcts::Mcts(
     std::shared_ptr<Evaluator> evaluator,
     unsigned simulations,
@@ -217,39 +317,139 @@ Mcts::Mcts(
   dir_fn = std::bind_front(std::move(dir), std::move(gen));
 }
 
-// TODO: Determine if adding some sort of caching improves performance.
+Mcts::~Mcts() = default;
+
+void
+Mcts::set_tree_reuse(bool tree_reuse)
+{
+  std::lock_guard lock(tree_mtx);
+  tree = tree_reuse ? std::make_unique<Tree>() : nullptr;
+}
+
+void
+Mcts::set_tablebase(std::shared_ptr<const Tablebase> tablebase)
+{ this->tablebase = std::move(tablebase); }
+
 SearchResult
 Mcts::run(const EvalBoardPath& board_path) const
+{ return run(board_path, SearchLimits{.simulations=simuls}); }
+
+// TODO: Determine if adding some sort of caching improves performance.
+SearchResult
+Mcts::run(const EvalBoardPath& board_path, const SearchLimits& limits) const
 {
   auto board = board_path.root();
   if (not board)
     throw std::invalid_argument("EvalBoardPath should have a root.");
+  if (limits.is_unbounded())
+    throw std::invalid_argument("The search needs a limit or a stop token.");
 
   Timer eval_timer;
   Timer search_timer;
   search_timer.start();
 
-  eval_timer.start();
-  auto pred = evaluator->predict(board_path);
-  eval_timer.end();
-
-  // Copy the priors before adding noise to them.
-  SearchResult result;
-  result.moves.reserve(pred.move_probs.size());
-  for (const auto& [board, prior] : pred.move_probs) {
-    auto last_move = board.last_move();
+  // The search cannot change the move when there is only one, so skip the
+  // evaluation too. The value of the position is unknown in that case, and the
+  // single visit is not a policy target.
+  if (auto children = board->get().next(); children.size() == 1) {
+    auto last_move = children.front().last_move();
     assert(last_move);
-    result.moves.push_back(MoveProb{.mv=*last_move, .prior=prior});
+    search_timer.end();
+
+    SearchResult result;
+    result.moves.push_back(MoveProb{.mv=*last_move, .prior=1, .visits=1});
+    result.best = BoardProb{
+      .board=std::move(children.front()),
+      .prior=1,
+      .visits=1
+    };
+    result.has_value = false;
+    result.policy_target = false;
+    result.millis_search_time = search_timer.total_millis();
+    return result;
   }
 
-  add_noise(pred.move_probs);
+  // The root lives in the tree if it is reused, and otherwise only for this
+  // run.
+  std::unique_lock tree_lock(tree_mtx, std::defer_lock);
+  std::optional<Node> own_root;
+  Node* root_node = nullptr;
+  if (tree) {
+    tree_lock.lock();
+    root_node = &tree->reroot(board->get());
+  } else {
+    root_node = &own_root.emplace(board->get());
+  }
+  auto& root = *root_node;
 
-  Node root(board->get());
-  root.expand(pred);
+  SearchResult result;
+  if (root.is_leaf) {
+    eval_timer.start();
+    auto pred = evaluator->predict(board_path);
+    eval_timer.end();
+
+    // Copy the priors before adding noise to them.
+    result.moves.reserve(pred.move_probs.size());
+    for (const auto& [board, prior] : pred.move_probs) {
+      auto last_move = board.last_move();
+      assert(last_move);
+      result.moves.push_back(MoveProb{.mv=*last_move, .prior=prior});
+    }
+
+    if (limits.root_noise)
+      add_noise(pred.move_probs);
+
+    root.expand(pred, board_path);
+  } else {
+    result.reused_visits = root.visits;
+    result.moves.reserve(root.children.size());
+    for (const auto& child : root.children) {
+      auto last_move = child.board.last_move();
+      assert(last_move);
+      result.moves.push_back(MoveProb{.mv=*last_move, .prior=child.prior});
+    }
+  }
 
   unsigned max_depth = 0;
 
-  for (unsigned i = 0; i < simuls; ++i) {
+  // The limits are checked before every simulation, which is cheap compared to
+  // the evaluation in a simulation.
+  auto should_stop = [&] {
+    return (limits.simulations and result.simulations >= limits.simulations)
+           or (limits.nodes and result.nodes_visited >= limits.nodes)
+           or (limits.time != Milliseconds(0)
+               and search_timer.elapsed() >= limits.time)
+           or limits.stop_token.stop_requested();
+  };
+
+  // Every simulation adds at most one visit to one child of the root, so the
+  // most visited child cannot be caught if its lead over the runner up is
+  // larger than the simulations left. Ties would be broken by the prior, hence
+  // the lead needs to be strictly larger.
+  auto is_decided = [&] {
+    if (not limits.stop_when_decided or not limits.simulations)
+      return false;
+
+    unsigned first = 0;
+    unsigned second = 0;
+    for (const auto& child : root.children) {
+      if (child.visits > first) {
+        second = first;
+        first = child.visits;
+      } else if (child.visits > second) {
+        second = child.visits;
+      }
+    }
+
+    return first > second + (limits.simulations - result.simulations);
+  };
+
+  for (; not should_stop(); ++result.simulations) {
+    if (is_decided()) {
+      result.simulations_saved = limits.simulations - result.simulations;
+      break;
+    }
+
     auto* node = &root;
 
     unsigned current_depth = 0;
@@ -268,6 +468,15 @@ Mcts::run(const EvalBoardPath& board_path) const
       continue;
     }
 
+    // The tablebases score the leaf exactly, so there is no need to call
+    // the evaluator either.
+    if (tablebase) {
+      if (auto wdl = tablebase->probe_wdl(node->board)) {
+        node->set_exact(*wdl).update_stats();
+        continue;
+      }
+    }
+
     // Reached a leaf node.
     auto bp = node->get_path(board_path);
 
@@ -277,22 +486,21 @@ Mcts::run(const EvalBoardPath& board_path) const
     eval_timer.end();
 
     // Expand leaf node.
-    node->expand(std::move(pred)).update_stats();
+    node->expand(std::move(pred), board_path).update_stats();
     ++result.nodes_expanded;
   }
 
   search_timer.end();
 
+  // Break ties with the prior, e.g. when the search is stopped before the
+  // children are visited.
   const Node* max_node = nullptr;
-  unsigned max_visits = 0;
   unsigned i = 0;
   for (const auto& child : root.children) {
-    auto visits = child.visits;
-    result.moves[i++].visits = visits;
-    if (visits > max_visits) {
-      max_visits = visits;
+    result.moves[i++].visits = child.visits;
+    if (not max_node or child.visits > max_node->visits
+        or (child.visits == max_node->visits and child.prior > max_node->prior))
       max_node = &child;
-    }
   }
 
   if (not max_node)
@@ -305,7 +513,9 @@ Mcts::run(const EvalBoardPath& board_path) const
 
   result.value = max_node->init_value;
   result.depth = max_depth;
-  result.millis_per_eval = eval_timer.avg_millis();
+  // A search from a reused root may not evaluate any position.
+  if (eval_timer.num_intervals())
+    result.millis_per_eval = eval_timer.avg_millis();
   result.millis_eval = eval_timer.total_millis();
   result.millis_search_time = search_timer.total_millis();
 
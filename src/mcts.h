@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <span>
 #include <utility>
 
@@ -9,6 +10,8 @@
 #include "board_path.h"
 #include "evaluator.h"
 #include "search.h"
+#include "search_limits.h"
+#include "tablebase.h"
 
 namespace blunder {
 
@@ -22,17 +25,49 @@ public:
       unsigned simulations,
       unsigned seed);
 
+  ~Mcts();
+
+  // Keeps the search tree between runs, such that a run from a position in the
+  // first two plies of the last tree, e.g. after a move and a reply, continues
+  // from the subtree of the position rather than from scratch, and the rest of
+  // the tree is discarded. The priors of a reused root do not get new noise.
+  // Disabled by default.
+  void
+  set_tree_reuse(bool tree_reuse);
+
+  // Scores the leaves that are in |tablebase| with the exact value of the
+  // table rather than with the evaluator, and does not expand them further.
+  // Disabled by default.
+  void
+  set_tablebase(std::shared_ptr<const Tablebase> tablebase);
+
+  // Runs the number of simulations set in the constructor.
   SearchResult
   run(const EvalBoardPath& board_path) const override;
 
+  // Runs simulations until one of |limits| is reached. Throws an exception if
+  // the limits are unbounded. A position with a single legal move returns at
+  // once, without evaluating the position.
+  SearchResult
+  run(const EvalBoardPath& board_path,
+      const SearchLimits& limits) const override;
+
 private:
   // Adds noise to the priors of the root node before running the simulations.
   void
   add_noise(std::span<std::pair<Board, float>> priors) const;
 
+  // The tree kept between runs. See set_tree_reuse.
+  struct Tree;
+
   std::shared_ptr<Evaluator> evaluator;
   unsigned simuls;
   std::function<float()> dir_fn;
+  std::unique_ptr<Tree> tree;
+  std::shared_ptr<const Tablebase> tablebase;
+  // Only one run at a time can use the tree, e.g. a search waits for a
+  // ponder search to stop.
+  mutable std::mutex tree_mtx;
 };
 
 } // namespace blunder
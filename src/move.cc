@@ -52,6 +52,16 @@ Move::str() const
   return buff;
 }
 
+std::string
+Move::uci() const
+{
+  std::string buff = to_sq_str(from_square);
+  buff += to_sq_str(to_square);
+  if (is_promo())
+    buff += promo_piece->letter(Color::Black);
+  return buff;
+}
+
 std::optional<std::pair<unsigned, unsigned>>
 Move::get_rook_from_to() const noexcept
 {
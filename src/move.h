@@ -164,6 +164,12 @@ public:
   std::string
   str() const;
 
+  // Returns the move in the long algebraic notation of the UCI protocol, e.g.
+  // e2e4, or e7e8q for a promotion. Castling is the move of the king, e.g.
+  // e1g1.
+  std::string
+  uci() const;
+
   //-----------
   // Accessors.
   //-----------
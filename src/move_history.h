@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "move.h"
+
+namespace blunder {
+
+// A fixed size ring buffer with the most recent moves leading up to a position.
+// The moves are stored inline, so that copying a Board, which happens for every
+// child during move generation and search, is a plain copy of a few bytes
+// rather than a copy of the full game history.
+class MoveHistory {
+public:
+  // The maximum number of moves kept in the history, which is enough to
+  // recognize the shortest cycle of moves leading back to a position.
+  static constexpr unsigned kMaxMoves = 4;
+
+  // Adds |mv| as the most recent move, dropping the oldest move if the history
+  // is full.
+  void
+  push(Move mv) noexcept
+  {
+    moves[next] = mv;
+    next = (next + 1) % kMaxMoves;
+    if (num < kMaxMoves)
+      ++num;
+  }
+
+  // Returns the move |i| plies before the most recent move, if it is still in
+  // the history, i.e. get(0) returns the most recent move.
+  std::optional<Move>
+  get(unsigned i) const noexcept
+  {
+    if (i >= num)
+      return std::nullopt;
+    return moves[(next + kMaxMoves - 1 - i) % kMaxMoves];
+  }
+
+  // Returns the most recent move, if there is one.
+  std::optional<Move>
+  last() const noexcept
+  { return get(0); }
+
+  // Returns the number of moves in the history.
+  unsigned
+  size() const noexcept
+  { return num; }
+
+  bool
+  empty() const noexcept
+  { return num == 0; }
+
+private:
+  std::array<std::optional<Move>, kMaxMoves> moves{};
+
+  // The index where the next move is written.
+  std::uint8_t next = 0;
+
+  // The number of moves in the history.
+  std::uint8_t num = 0;
+};
+
+} // namespace blunder
@@ -1,11 +1,16 @@
 #include "net.h"
 
+#include <cstdint>
 #include <filesystem>
 #include <format>
 #include <iostream>
 #include <iterator>
+#include <optional>
 #include <ranges>
+#include <stdexcept>
+#include <string_view>
 #include <system_error>
+#include <vector>
 
 namespace blunder {
 
@@ -24,29 +29,78 @@ using ::torch::tanh;
 namespace fs = std::filesystem;
 namespace views = std::ranges::views;
 
+// Returns the device where the networks are created, i.e. the GPU if one is
+// available.
+inline torch::Device
+default_device()
+{ return torch::cuda::is_available() ? torch::kCUDA : torch::kCPU; }
+
 inline Conv2d
-make_conv_nn()
+make_conv_nn(unsigned filters)
 {
-  auto opts = Conv2dOptions(256, 256, 3).stride(1).padding(1);
+  auto opts = Conv2dOptions(filters, filters, 3).stride(1).padding(1);
   return Conv2d(opts);
 }
 
 inline BatchNorm2d
-make_bnorm()
-{ return BatchNorm2d(BatchNorm2dOptions(256)); }
+make_bnorm(unsigned filters)
+{ return BatchNorm2d(BatchNorm2dOptions(filters)); }
 
+// Copies the values of |from_params| into |to_params|. Returns false if the
+// parameters do not have the same shapes, e.g. when they are from networks
+// with different architectures.
 bool
 clone_params(std::vector<Tensor> from_params, std::vector<Tensor> to_params)
 {
   if (from_params.size() != to_params.size())
     return false;
 
+  for (auto [from_tensor, to_tensor] : views::zip(from_params, to_params)) {
+    if (from_tensor.sizes() != to_tensor.sizes())
+      return false;
+  }
+
+  // Copy in place, since the output tensors share their buffers with the
+  // network parameters.
+  torch::NoGradGuard no_grad;
   for (auto [from_tensor, to_tensor] : views::zip(from_params, to_params))
-    to_tensor = from_tensor.clone();
+    to_tensor.copy_(from_tensor);
 
   return true;
 }
 
+// Throws an exception if |config| has a size that is zero.
+const NetConfig&
+check_config(const NetConfig& config)
+{
+  if (not config.blocks)
+    throw std::invalid_argument("blocks must be non-zero.");
+  if (not config.filters)
+    throw std::invalid_argument("filters must be non-zero.");
+  if (not config.value_hidden)
+    throw std::invalid_argument("value_hidden must be non-zero.");
+  return config;
+}
+
+// Returns copies of |params| in CPU memory, which do not share their buffers
+// with the network. The copies are contiguous, so the saved files do not
+// depend on the memory format of the network.
+std::vector<Tensor>
+copy_to_cpu(const std::vector<Tensor>& params)
+{
+  std::vector<Tensor> copies;
+  copies.reserve(params.size());
+  for (const auto& param : params) {
+    copies.push_back(param.detach().to(
+          torch::kCPU, param.scalar_type(), /*non_blocking=*/false,
+          /*copy=*/true, torch::MemoryFormat::Contiguous));
+  }
+  return copies;
+}
+
+// The name of the file with the architecture in a checkpoint.
+constexpr std::string_view kConfigFile = "net-config.pt";
+
 // Loads checkpoint parameters from a file onto a collection of output tensors.
 // @file_name The name of the file where the parameters are saved.
 // @out_params The output parameters where the checkpoint parameters are loaded
@@ -63,23 +117,90 @@ load_params(const fs::path& file_name, std::vector<Tensor> out_params)
   return clone_params(std::move(saved_params), std::move(out_params));
 }
 
+// Loads checkpoint buffers from a file onto a collection of output tensors like
+// load_params. Checkpoints created before the buffers were saved do not have
+// the file, in which case the output tensors keep their values.
+bool
+load_buffers(const fs::path& file_name, std::vector<Tensor> out_buffers)
+{
+  if (not fs::exists(file_name))
+    return true;
+  return load_params(file_name, std::move(out_buffers));
+}
+
 } // namespace
 
+//---------------
+// Net snapshot
+//---------------
+
+void
+NetSnapshot::save(const fs::path& checkpoint_dir) const
+{
+  auto fpath = checkpoint_dir;
+
+  // Save the architecture.
+  fpath.append(kConfigFile);
+  std::vector<std::int64_t> sizes = {
+    config.blocks, config.filters, config.value_hidden};
+  torch::save(torch::tensor(sizes), fpath.string());
+
+  // Save the input params.
+  fpath.replace_filename("input-params.pt");
+  torch::save(input_params, fpath.string());
+
+  // Save the policy head params.
+  fpath.replace_filename("policy-params.pt");
+  torch::save(policy_params, fpath.string());
+
+  // Save the value head params.
+  fpath.replace_filename("value-params.pt");
+  torch::save(value_params, fpath.string());
+
+  // Save the residual block parameters.
+  std::string buff;
+  buff.reserve(32);
+  for (const auto [i, params] : views::enumerate(res_block_params)) {
+    std::format_to(std::back_inserter(buff), "res-block-params-{:0>2}.pt", i);
+    fpath.replace_filename(buff);
+    torch::save(params, fpath.string());
+    buff.clear();
+  }
+
+  // Save the buffers, i.e. the BatchNorm statistics, which are needed to fold
+  // the BatchNorm layers of an exported network.
+  fpath.replace_filename("input-buffers.pt");
+  torch::save(input_buffers, fpath.string());
+
+  fpath.replace_filename("policy-buffers.pt");
+  torch::save(policy_buffers, fpath.string());
+
+  fpath.replace_filename("value-buffers.pt");
+  torch::save(value_buffers, fpath.string());
+
+  for (const auto [i, buffers] : views::enumerate(res_block_buffers)) {
+    std::format_to(std::back_inserter(buff), "res-block-buffers-{:0>2}.pt", i);
+    fpath.replace_filename(buff);
+    torch::save(buffers, fpath.string());
+    buff.clear();
+  }
+}
+
 //---------------
 // Residual Block
 //---------------
 
-ResBlockNet::ResBlockNet(std::string_view name)
-    : conv1(make_conv_nn()),
-      conv2(make_conv_nn()),
-      bnorm1(make_bnorm()),
-      bnorm2(make_bnorm())
+ResBlockNet::ResBlockNet(std::string_view name, unsigned filters)
+    : conv1(make_conv_nn(filters)),
+      conv2(make_conv_nn(filters)),
+      bnorm1(make_bnorm(filters)),
+      bnorm2(make_bnorm(filters))
 {
   register_module(std::format("{}-conv1", name), conv1);
   register_module(std::format("{}-conv2", name), conv2);
   register_module(std::format("{}-bnorm1", name), bnorm1);
   register_module(std::format("{}-bnorm2", name), bnorm2);
-  this->to(torch::kCUDA);
+  this->to(default_device());
 }
 
 Tensor
@@ -95,15 +216,15 @@ ResBlockNet::forward(Tensor x)
 // Policy head net
 //----------------
 
-PolicyNet::PolicyNet()
-    : conv1(make_conv_nn()),
-      bnorm(make_bnorm()),
-      conv2(Conv2d(Conv2dOptions(256, 73, 3).stride(1).padding(1)))
+PolicyNet::PolicyNet(unsigned filters)
+    : conv1(make_conv_nn(filters)),
+      bnorm(make_bnorm(filters)),
+      conv2(Conv2d(Conv2dOptions(filters, 73, 3).stride(1).padding(1)))
 {
   register_module("PolicyNet-conv1", conv1);
   register_module("PolicyNet-bnorm", bnorm);
   register_module("PolicyNet-conv2", conv2);
-  this->to(torch::kCUDA);
+  this->to(default_device());
 }
 
 Tensor
@@ -114,17 +235,17 @@ PolicyNet::forward(Tensor x)
 // Value head net
 //----------------
 
-ValueNet::ValueNet()
-    : conv(Conv2d(Conv2dOptions(256, 1, 1).stride(1))),
+ValueNet::ValueNet(unsigned filters, unsigned hidden)
+    : conv(Conv2d(Conv2dOptions(filters, 1, 1).stride(1))),
       bnorm(BatchNorm2d(BatchNorm2dOptions(1))),
-      fc1(Linear(64, 256)),
-      fc2(Linear(256, 1))
+      fc1(Linear(64, hidden)),
+      fc2(Linear(hidden, 1))
 {
   register_module("ValueNet-conv", conv);
   register_module("ValueNet-bnorm", bnorm);
   register_module("ValueNet-fc1", fc1);
   register_module("ValueNet-fc2", fc2);
-  this->to(torch::kCUDA);
+  this->to(default_device());
 }
 
 Tensor
@@ -145,27 +266,29 @@ ValueNet::forward(Tensor x)
 // AlphaZero net
 //--------------
 
-AlphaZeroNet::AlphaZeroNet()
-  : conv(Conv2d(Conv2dOptions(119, 256, 3).stride(1).padding(1))),
-    bnorm(make_bnorm()),
-    policy_net(),
-    value_net()
+AlphaZeroNet::AlphaZeroNet(NetConfig config)
+  : net_config(check_config(config)),
+    conv(Conv2d(Conv2dOptions(119, config.filters, 3).stride(1).padding(1))),
+    bnorm(make_bnorm(config.filters)),
+    policy_net(config.filters),
+    value_net(config.filters, config.value_hidden)
 {
   register_module("input-conv", conv);
   register_module("input-bnorm", bnorm);
 
   // Initialize the residual blocks.
-  res_nets.reserve(19);
-  for (int i = 0; i < 19; ++i)
-    res_nets.emplace_back(std::format("ResNetBlock-{}", i));
+  res_nets.reserve(config.blocks);
+  for (unsigned i = 0; i < config.blocks; ++i)
+    res_nets.emplace_back(std::format("ResNetBlock-{}", i), config.filters);
 
-  this->to(torch::kCUDA);
+  this->to(default_device());
 }
 
 std::pair<Tensor, Tensor>
 AlphaZeroNet::forward(Tensor x)
 {
-  auto out = conv(x);
+  // This is a no-op when the input is already in the layout of the weights.
+  auto out = conv(x.contiguous(mem_format));
   out = bnorm(out);
   out = relu(out);
 
@@ -178,6 +301,56 @@ AlphaZeroNet::forward(Tensor x)
   return {pol, val};
 }
 
+void
+AlphaZeroNet::set_memory_format(torch::MemoryFormat memory_format)
+{
+  torch::NoGradGuard no_grad;
+
+  // The convolution weights are the only 4-D parameters. set_data swaps the
+  // storage in place, so the modules and any optimizer see the new layout.
+  for (auto& param : all_parameters()) {
+    if (param.dim() == 4)
+      param.set_data(param.contiguous(memory_format));
+  }
+  mem_format = memory_format;
+}
+
+std::vector<Tensor>
+AlphaZeroNet::all_parameters() const
+{
+  auto params = parameters();
+
+  auto append = [&params](const torch::nn::Module& module) {
+    auto module_params = module.parameters();
+    params.insert(params.end(), module_params.begin(), module_params.end());
+  };
+
+  for (const auto& res_net : res_nets)
+    append(res_net);
+  append(policy_net);
+  append(value_net);
+
+  return params;
+}
+
+std::vector<Tensor>
+AlphaZeroNet::all_buffers() const
+{
+  auto all = buffers();
+
+  auto append = [&all](const torch::nn::Module& module) {
+    auto module_buffers = module.buffers();
+    all.insert(all.end(), module_buffers.begin(), module_buffers.end());
+  };
+
+  for (const auto& res_net : res_nets)
+    append(res_net);
+  append(policy_net);
+  append(value_net);
+
+  return all;
+}
+
 void
 AlphaZeroNet::on_device(torch::Device device)
 {
@@ -190,6 +363,31 @@ AlphaZeroNet::on_device(torch::Device device)
   to(device);
 }
 
+NetSnapshot
+AlphaZeroNet::snapshot() const
+{
+  torch::NoGradGuard no_grad;
+
+  NetSnapshot snapshot{
+    .config=net_config,
+    .input_params=copy_to_cpu(parameters()),
+    .policy_params=copy_to_cpu(policy_net.parameters()),
+    .value_params=copy_to_cpu(value_net.parameters()),
+    .input_buffers=copy_to_cpu(buffers()),
+    .policy_buffers=copy_to_cpu(policy_net.buffers()),
+    .value_buffers=copy_to_cpu(value_net.buffers())
+  };
+
+  snapshot.res_block_params.reserve(res_nets.size());
+  snapshot.res_block_buffers.reserve(res_nets.size());
+  for (const auto& res_net : res_nets) {
+    snapshot.res_block_params.push_back(copy_to_cpu(res_net.parameters()));
+    snapshot.res_block_buffers.push_back(copy_to_cpu(res_net.buffers()));
+  }
+
+  return snapshot;
+}
+
 bool
 AlphaZeroNet::create_checkpoint(const fs::path& checkpoint_dir)
 {
@@ -202,31 +400,10 @@ AlphaZeroNet::create_checkpoint(const fs::path& checkpoint_dir)
   fs::create_directories(checkpoint_dir, err);
   if (err) return false;
 
-  // Turn on inference mode to create the checkpoint.
-  c10::InferenceMode inference_mode(true);
-
-  auto fpath = checkpoint_dir;
-
-  // Save the input params.
-  fpath.append("input-params.pt");
-  torch::save(parameters(), fpath.string());
-
-  // Save the policy head params.
-  fpath.replace_filename("policy-params.pt");
-  torch::save(policy_net.parameters(), fpath.string());
-
-  // Save the policy head params.
-  fpath.replace_filename("value-params.pt");
-  torch::save(value_net.parameters(), fpath.string());
-
-  // Save the residual block parameters.
-  std::string buff;
-  buff.reserve(32);
-  for (const auto [i, net] : views::enumerate(res_nets)) {
-    std::format_to(std::back_inserter(buff), "res-block-params-{:0>2}.pt", i);
-    fpath.replace_filename(buff);
-    torch::save(net.parameters(), fpath.string());
-    buff.clear();
+  try {
+    snapshot().save(checkpoint_dir);
+  } catch (const c10::Error&) {
+    return false;
   }
 
   return true;
@@ -239,6 +416,11 @@ AlphaZeroNet::load_checkpoint(const fs::path& checkpoint_dir)
   if (not fs::exists(checkpoint_dir) || not fs::is_directory(checkpoint_dir))
     return false;
 
+  // Validate the architecture before loading any parameters.
+  auto config = checkpoint_config(checkpoint_dir);
+  if (not config or *config != net_config)
+    return false;
+
   // Turn on inference mode to load the checkpoint.
   c10::InferenceMode inference_mode(true);
 
@@ -266,13 +448,62 @@ AlphaZeroNet::load_checkpoint(const fs::path& checkpoint_dir)
     buff.clear();
   }
 
+  file_name.replace_filename("input-buffers.pt");
+  if (not load_buffers(file_name, buffers()))
+    return false;
+
+  file_name.replace_filename("policy-buffers.pt");
+  if (not load_buffers(file_name, policy_net.buffers()))
+    return false;
+
+  file_name.replace_filename("value-buffers.pt");
+  if (not load_buffers(file_name, value_net.buffers()))
+    return false;
+
+  for (const auto [i, net] : views::enumerate(res_nets)) {
+    std::format_to(std::back_inserter(buff), "res-block-buffers-{:0>2}.pt", i);
+    file_name.replace_filename(buff);
+    if (not load_buffers(file_name, net.buffers()))
+      return false;
+    buff.clear();
+  }
+
   return true;
 }
 
+std::optional<NetConfig>
+AlphaZeroNet::checkpoint_config(const fs::path& checkpoint_dir)
+{
+  if (not fs::is_directory(checkpoint_dir))
+    return std::nullopt;
+
+  auto file_name = checkpoint_dir / kConfigFile;
+  if (not fs::exists(file_name))
+    return NetConfig();
+
+  Tensor sizes;
+  try {
+    torch::load(sizes, file_name.string());
+  } catch (const c10::Error&) {
+    return std::nullopt;
+  }
+
+  if (sizes.numel() != 3)
+    return std::nullopt;
+
+  auto data = sizes.to(torch::kLong).contiguous();
+  auto ptr = data.data_ptr<std::int64_t>();
+  return NetConfig{
+    .blocks=static_cast<unsigned>(ptr[0]),
+    .filters=static_cast<unsigned>(ptr[1]),
+    .value_hidden=static_cast<unsigned>(ptr[2])
+  };
+}
+
 AlphaZeroNet
 AlphaZeroNet::clone() const
 {
-  AlphaZeroNet other_net;
+  AlphaZeroNet other_net(net_config);
 
   if (not clone_params(parameters(), other_net.parameters()))
     throw std::runtime_error("Unable clone input params");
@@ -289,6 +520,23 @@ AlphaZeroNet::clone() const
     if (not clone_params(from.parameters(), to.parameters()))
       throw std::runtime_error("Unable clone residual network params.");
   }
+
+  // The BatchNorm statistics are buffers rather than parameters.
+  if (not clone_params(buffers(), other_net.buffers()))
+    throw std::runtime_error("Unable clone input buffers.");
+
+  if (not clone_params(policy_net.buffers(), other_net.policy_net.buffers()))
+    throw std::runtime_error("Unable clone policy network buffers.");
+
+  if (not clone_params(value_net.buffers(), other_net.value_net.buffers()))
+    throw std::runtime_error("Unable clone value network buffers.");
+
+  for (auto [from, to] : views::zip(res_nets, other_net.res_nets)) {
+    if (not clone_params(from.buffers(), to.buffers()))
+      throw std::runtime_error("Unable clone residual network buffers.");
+  }
+
+  other_net.set_memory_format(mem_format);
   return other_net;
 }
 
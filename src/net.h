@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
 #include <string_view>
 #include <utility>
 #include <vector>
@@ -57,15 +58,57 @@ namespace blunder {
 //      - a fully connected layer to a scalar
 //      - a tanh nonlinearity outputting a scalar in the range [-1, 1].
 
+//--------------------
+// Network architecture
+//--------------------
+
+// The size of an AlphaZeroNet. The defaults are the sizes of the network in the
+// AlphaZero paper, which are too expensive to reach useful node rates on CPU.
+struct NetConfig {
+  // The number of residual blocks.
+  unsigned blocks = 19;
+  // The number of filters in the convolutions of the residual tower and the
+  // policy head.
+  unsigned filters = 256;
+  // The size of the hidden layer in the value head.
+  unsigned value_hidden = 256;
+
+  // Default equality comparison.
+  friend bool operator==(const NetConfig&, const NetConfig&) = default;
+};
+
+//---------------
+// Net snapshot
+//---------------
+
+// A copy of the parameters and the buffers, i.e. the BatchNorm statistics, of
+// an AlphaZeroNet in CPU memory, grouped by the files of a checkpoint, so the
+// checkpoint can be written while the network keeps training.
+struct NetSnapshot {
+  // Writes the checkpoint files to |checkpoint_dir|, which must exist. Throws
+  // an exception if a file cannot be written.
+  void
+  save(const std::filesystem::path& checkpoint_dir) const;
+
+  NetConfig config;
+  std::vector<torch::Tensor> input_params;
+  std::vector<torch::Tensor> policy_params;
+  std::vector<torch::Tensor> value_params;
+  std::vector<std::vector<torch::Tensor>> res_block_params;
+  std::vector<torch::Tensor> input_buffers;
+  std::vector<torch::Tensor> policy_buffers;
+  std::vector<torch::Tensor> value_buffers;
+  std::vector<std::vector<torch::Tensor>> res_block_buffers;
+};
+
 //---------------
 // Residual Block
 //---------------
 
 // ResBlockNet implements the residual block in the AlphaZero network, which has
-// 19 of these blocks connected together.
+// NetConfig::blocks of these blocks connected together.
 struct ResBlockNet : public torch::nn::Module {
-  explicit
-  ResBlockNet(std::string_view name);
+  ResBlockNet(std::string_view name, unsigned filters);
 
   torch::Tensor
   forward(torch::Tensor x);
@@ -81,7 +124,8 @@ struct ResBlockNet : public torch::nn::Module {
 //----------------
 
 struct PolicyNet : public torch::nn::Module {
-  PolicyNet();
+  explicit
+  PolicyNet(unsigned filters);
 
   torch::Tensor
   forward(torch::Tensor x);
@@ -96,7 +140,7 @@ struct PolicyNet : public torch::nn::Module {
 //----------------
 
 struct ValueNet : public torch::nn::Module {
-  ValueNet();
+  ValueNet(unsigned filters, unsigned hidden);
 
   torch::Tensor
   forward(torch::Tensor x);
@@ -111,12 +155,14 @@ struct ValueNet : public torch::nn::Module {
 // AlphaZero net
 //--------------
 
-// TODO: figure out how to enable the network to operate in inference mode to
-// make computations more efficient:
-// https://pytorch.org/cppdocs/notes/inference_mode.html.
+// The network used for training. Networks that only run inference, such as a
+// FoldedNet, are exported from it.
 class AlphaZeroNet : public torch::nn::Module {
 public:
-  AlphaZeroNet();
+  // Initializes the network with the architecture in |config|. Throws an
+  // exception if any of the sizes is zero.
+  explicit
+  AlphaZeroNet(NetConfig config = NetConfig());
 
   // Copy ctor.
   AlphaZeroNet(const AlphaZeroNet& net) = delete;
@@ -134,6 +180,50 @@ public:
   void
   on_device(torch::Device device);
 
+  // Returns the device where the network runs.
+  torch::Device
+  device() const
+  { return conv->weight.device(); }
+
+  // Converts the weights of the convolutions to |memory_format|, and makes
+  // forward convert its input to it, so the activations keep the same layout
+  // through the whole network. With channels last, the convolutions on CPU run
+  // on oneDNN without reordering the activations at every layer. The weights
+  // are converted once here rather than on every call.
+  void
+  set_memory_format(torch::MemoryFormat memory_format);
+
+  // Returns the layout of the weights and the activations.
+  torch::MemoryFormat
+  memory_format() const noexcept
+  { return mem_format; }
+
+  // Returns the parameters of all the layers. Note that parameters() only has
+  // the parameters of the input layers, since the residual blocks and the heads
+  // are not registered as submodules.
+  std::vector<torch::Tensor>
+  all_parameters() const;
+
+  // Returns the buffers of all the layers, i.e. the BatchNorm statistics, like
+  // all_parameters.
+  std::vector<torch::Tensor>
+  all_buffers() const;
+
+  // Returns the architecture of the network.
+  const NetConfig&
+  config() const noexcept
+  { return net_config; }
+
+  // Returns the architecture recorded in the checkpoint in |checkpoint_dir|, or
+  // nullopt if the checkpoint cannot be read. Checkpoints created before the
+  // architecture was recorded have the default architecture.
+  static std::optional<NetConfig>
+  checkpoint_config(const std::filesystem::path& checkpoint_dir);
+
+  // Returns a copy of the parameters and the buffers in CPU memory.
+  NetSnapshot
+  snapshot() const;
+
   // @param checkpoint_dir is the name of a directory where the checkpoint is
   // created. If the directory already exists, then it is expected to be empty.
   // Returns true if the checkpoint is created, or false otherwise.
@@ -142,7 +232,9 @@ public:
 
   // @param checkpoint_dir is the name of a directory where the checkpoint is
   // contained. Returns true if the checkpoint is loaded successfully, or false
-  // otherwise.
+  // otherwise, including when the checkpoint has a different architecture.
+  // Checkpoints created before the buffers were saved keep the default
+  // BatchNorm statistics.
   bool
   load_checkpoint(const std::filesystem::path& checkpoint_dir);
 
@@ -155,6 +247,10 @@ public:
   set_training_mode();
 
 private:
+  friend class FoldedNet;
+
+  NetConfig net_config;
+  torch::MemoryFormat mem_format = torch::MemoryFormat::Contiguous;
   torch::nn::Conv2d conv = nullptr;
   torch::nn::BatchNorm2d bnorm = nullptr;
   PolicyNet policy_net;
@@ -0,0 +1,363 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+#include "mapped_file.h"
+#include "move.h"
+#include "piece_set.h"
+
+namespace blunder {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The network file consists of an NnueHeader followed by the feature weights,
+// the feature biases, the output weights, and the output bias, all in native
+// byte order.
+constexpr char kNnueMagic[8] = {'B', 'L', 'N', 'D', 'N', 'N', 'U', 'E'};
+constexpr std::uint32_t kNnueVersion = 1;
+
+struct NnueHeader {
+  char magic[8];
+  std::uint32_t version = kNnueVersion;
+  std::uint32_t features = Nnue::kFeatures;
+  std::uint32_t hidden = Nnue::kHidden;
+  std::uint32_t reserved = 0;
+};
+
+// The quantized value of 1.0 in the feature layer, which is also the maximum of
+// the clipped ReLU.
+constexpr int kFeatureScale = 255;
+// The quantized value of 1.0 in the output weights, which are small since
+// they add up hundreds of hidden units.
+constexpr int kOutputScale = 1024;
+
+constexpr Type kPieceTypes[] = {
+  Type::King,
+  Type::Queen,
+  Type::Rook,
+  Type::Bishop,
+  Type::Knight,
+  Type::Pawn
+};
+
+using Column = std::span<const std::int16_t, Nnue::kHidden>;
+using Hidden = std::array<std::int16_t, Nnue::kHidden>;
+
+// Adds |column| to |acc|.
+void
+add_column(Hidden& acc, Column column) noexcept
+{
+#if defined(__AVX512BW__)
+  for (unsigned i = 0; i < Nnue::kHidden; i += 32) {
+    auto a = _mm512_loadu_si512(acc.data() + i);
+    auto c = _mm512_loadu_si512(column.data() + i);
+    _mm512_storeu_si512(acc.data() + i, _mm512_add_epi16(a, c));
+  }
+#elif defined(__AVX2__)
+  for (unsigned i = 0; i < Nnue::kHidden; i += 16) {
+    auto* a = reinterpret_cast<__m256i*>(acc.data() + i);
+    auto c = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(column.data() + i));
+    _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), c));
+  }
+#else
+  for (unsigned i = 0; i < Nnue::kHidden; ++i)
+    acc[i] += column[i];
+#endif
+}
+
+// Subtracts |column| from |acc|.
+void
+sub_column(Hidden& acc, Column column) noexcept
+{
+#if defined(__AVX512BW__)
+  for (unsigned i = 0; i < Nnue::kHidden; i += 32) {
+    auto a = _mm512_loadu_si512(acc.data() + i);
+    auto c = _mm512_loadu_si512(column.data() + i);
+    _mm512_storeu_si512(acc.data() + i, _mm512_sub_epi16(a, c));
+  }
+#elif defined(__AVX2__)
+  for (unsigned i = 0; i < Nnue::kHidden; i += 16) {
+    auto* a = reinterpret_cast<__m256i*>(acc.data() + i);
+    auto c = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(column.data() + i));
+    _mm256_storeu_si256(a, _mm256_sub_epi16(_mm256_loadu_si256(a), c));
+  }
+#else
+  for (unsigned i = 0; i < Nnue::kHidden; ++i)
+    acc[i] -= column[i];
+#endif
+}
+
+// Returns the dot product of the clipped ReLU of |acc| and |weights|.
+std::int32_t
+crelu_dot(const Hidden& acc, Column weights) noexcept
+{
+#if defined(__AVX512BW__)
+  const auto zero = _mm512_setzero_si512();
+  const auto max = _mm512_set1_epi16(kFeatureScale);
+  auto sum = _mm512_setzero_si512();
+  for (unsigned i = 0; i < Nnue::kHidden; i += 32) {
+    auto a = _mm512_loadu_si512(acc.data() + i);
+    auto w = _mm512_loadu_si512(weights.data() + i);
+    a = _mm512_min_epi16(_mm512_max_epi16(a, zero), max);
+    sum = _mm512_add_epi32(sum, _mm512_madd_epi16(a, w));
+  }
+  return _mm512_reduce_add_epi32(sum);
+#elif defined(__AVX2__)
+  const auto zero = _mm256_setzero_si256();
+  const auto max = _mm256_set1_epi16(kFeatureScale);
+  auto sum = _mm256_setzero_si256();
+  for (unsigned i = 0; i < Nnue::kHidden; i += 16) {
+    auto a = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(acc.data() + i));
+    auto w = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(weights.data() + i));
+    a = _mm256_min_epi16(_mm256_max_epi16(a, zero), max);
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, w));
+  }
+  auto sum128 = _mm_add_epi32(
+      _mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0b01001110));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0b10110001));
+  return _mm_cvtsi128_si32(sum128);
+#else
+  std::int32_t sum = 0;
+  for (unsigned i = 0; i < Nnue::kHidden; ++i) {
+    std::int32_t a = std::clamp<std::int16_t>(acc[i], 0, kFeatureScale);
+    sum += a * weights[i];
+  }
+  return sum;
+#endif
+}
+
+// Quantizes |value| with |scale|, saturating at the range of int16.
+std::int16_t
+quantize(float value, int scale) noexcept
+{
+  return static_cast<std::int16_t>(
+      std::clamp(std::lround(value * scale), -32768l, 32767l));
+}
+
+Color
+other_color(Color color) noexcept
+{ return color == Color::White ? Color::Black : Color::White; }
+
+} // namespace
+
+Nnue::Nnue()
+  : feature_weights(kFeatures * kHidden, 0) {}
+
+Nnue::Nnue(const NnueWeights& weights)
+  : Nnue()
+{
+  if (weights.feature_weights.size() != kFeatures * kHidden
+      or weights.feature_biases.size() != kHidden
+      or weights.output_weights.size() != 2 * kHidden)
+    throw std::invalid_argument("The weights do not match the network size.");
+
+  for (unsigned i = 0; i < feature_weights.size(); ++i)
+    feature_weights[i] = quantize(weights.feature_weights[i], kFeatureScale);
+  for (unsigned i = 0; i < kHidden; ++i)
+    feature_biases[i] = quantize(weights.feature_biases[i], kFeatureScale);
+  for (unsigned i = 0; i < 2 * kHidden; ++i)
+    output_weights[i] = quantize(weights.output_weights[i], kOutputScale);
+  output_bias = std::lround(
+      weights.output_bias * kFeatureScale * kOutputScale);
+}
+
+Nnue
+Nnue::load(const fs::path& path)
+{
+  MappedFile mapping(path);
+  auto bytes = mapping.bytes();
+
+  NnueHeader header;
+  if (bytes.size() < sizeof(header))
+    throw std::runtime_error("Truncated NNUE file.");
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kNnueMagic, sizeof(kNnueMagic)))
+    throw std::runtime_error("Not an NNUE file.");
+  if (header.version != kNnueVersion)
+    throw std::runtime_error("Unsupported NNUE file version.");
+  if (header.features != kFeatures or header.hidden != kHidden)
+    throw std::runtime_error("The NNUE file has a different network size.");
+
+  Nnue nnue;
+  const std::size_t weight_bytes =
+    nnue.feature_weights.size() * sizeof(std::int16_t);
+  if (bytes.size() != sizeof(header) + weight_bytes
+      + sizeof(nnue.feature_biases) + sizeof(nnue.output_weights)
+      + sizeof(nnue.output_bias))
+    throw std::runtime_error("Truncated NNUE file.");
+
+  auto* data = bytes.data() + sizeof(header);
+  std::memcpy(nnue.feature_weights.data(), data, weight_bytes);
+  data += weight_bytes;
+  std::memcpy(nnue.feature_biases.data(), data, sizeof(nnue.feature_biases));
+  data += sizeof(nnue.feature_biases);
+  std::memcpy(nnue.output_weights.data(), data, sizeof(nnue.output_weights));
+  data += sizeof(nnue.output_weights);
+  std::memcpy(&nnue.output_bias, data, sizeof(nnue.output_bias));
+
+  return nnue;
+}
+
+void
+Nnue::save(const fs::path& path) const
+{
+  NnueHeader header;
+  std::memcpy(header.magic, kNnueMagic, sizeof(kNnueMagic));
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (not out)
+    throw std::runtime_error("Unable to open " + path.string());
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(feature_weights.data()),
+            feature_weights.size() * sizeof(std::int16_t));
+  out.write(reinterpret_cast<const char*>(feature_biases.data()),
+            sizeof(feature_biases));
+  out.write(reinterpret_cast<const char*>(output_weights.data()),
+            sizeof(output_weights));
+  out.write(reinterpret_cast<const char*>(&output_bias), sizeof(output_bias));
+
+  out.close();
+  if (not out)
+    throw std::runtime_error("Unable to write " + path.string());
+}
+
+unsigned
+Nnue::feature(Color perspective, Color piece_color, Type type, unsigned square)
+  noexcept
+{
+  assert(square < 64);
+
+  // Black sees the board flipped, with its own pieces first.
+  if (perspective == Color::Black)
+    square ^= 56;
+  const unsigned color_index = piece_color == perspective ? 0 : 1;
+  return (color_index * 6 + to_int(type)) * 64 + square;
+}
+
+std::vector<unsigned>
+Nnue::features(const Board& board, Color perspective)
+{
+  std::vector<unsigned> indices;
+  indices.reserve(board.all_bits().count());
+
+  for (auto color : {Color::White, Color::Black}) {
+    const auto& pieces = color == Color::White ? board.white() : board.black();
+    for (auto type : kPieceTypes) {
+      auto bb = pieces.get(type);
+      while (bb)
+        indices.push_back(
+            feature(perspective, color, type, bb.first_bit_and_clear()));
+    }
+  }
+
+  return indices;
+}
+
+void
+Nnue::refresh(const Board& board, Accumulator& acc) const noexcept
+{
+  acc.white = feature_biases;
+  acc.black = feature_biases;
+
+  auto column = [this](unsigned index) {
+    return Column(feature_weights.data() + index * kHidden, kHidden);
+  };
+
+  for (auto color : {Color::White, Color::Black}) {
+    const auto& pieces = color == Color::White ? board.white() : board.black();
+    for (auto type : kPieceTypes) {
+      auto bb = pieces.get(type);
+      while (bb) {
+        auto square = bb.first_bit_and_clear();
+        add_column(acc.white, column(feature(Color::White, color, type, square)));
+        add_column(acc.black, column(feature(Color::Black, color, type, square)));
+      }
+    }
+  }
+}
+
+void
+Nnue::update(const Accumulator& parent, const Board& board, Accumulator& acc)
+  const noexcept
+{
+  auto last_move = board.last_move();
+  assert(last_move);
+  const auto& mv = *last_move;
+
+  // The player who made the move is not the player moving next.
+  const auto mover = board.is_white_next() ? Color::Black : Color::White;
+  const auto other = other_color(mover);
+
+  acc = parent;
+
+  auto column = [this](unsigned index) {
+    return Column(feature_weights.data() + index * kHidden, kHidden);
+  };
+  auto add = [&](Color color, Type type, unsigned square) {
+    add_column(acc.white, column(feature(Color::White, color, type, square)));
+    add_column(acc.black, column(feature(Color::Black, color, type, square)));
+  };
+  auto sub = [&](Color color, Type type, unsigned square) {
+    sub_column(acc.white, column(feature(Color::White, color, type, square)));
+    sub_column(acc.black, column(feature(Color::Black, color, type, square)));
+  };
+
+  const auto type = mv.piece().type();
+  sub(mover, type, mv.from());
+  add(mover, mv.promoted() ? mv.promoted()->type() : type, mv.to());
+
+  if (auto capture = mv.capture())
+    sub(other, capture->type(), mv.is_enpassant() ? mv.passant() : mv.to());
+
+  if (auto rook_move = mv.get_rook_from_to()) {
+    sub(mover, Type::Rook, rook_move->first);
+    add(mover, Type::Rook, rook_move->second);
+  }
+}
+
+int
+Nnue::evaluate(const Accumulator& acc, bool is_white_next) const noexcept
+{
+  const auto& mine = is_white_next ? acc.white : acc.black;
+  const auto& other = is_white_next ? acc.black : acc.white;
+
+  const auto* weights = output_weights.data();
+  const std::int64_t sum = static_cast<std::int64_t>(output_bias)
+    + crelu_dot(mine, Column(weights, kHidden))
+    + crelu_dot(other, Column(weights + kHidden, kHidden));
+
+  return sum * kCentipawns / (kFeatureScale * kOutputScale);
+}
+
+int
+Nnue::evaluate(const Board& board) const noexcept
+{
+  Accumulator acc;
+  refresh(board, acc);
+  return evaluate(acc, board.is_white_next());
+}
+
+} // namespace blunder
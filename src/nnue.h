@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "board.h"
+#include "color.h"
+#include "pieces.h"
+
+namespace blunder {
+
+// The float parameters of an Nnue, as fitted by the NnueTrainer. The feature
+// weights are stored by feature, i.e. the kHidden weights of a feature are
+// contiguous.
+struct NnueWeights {
+  std::vector<float> feature_weights;
+  std::vector<float> feature_biases;
+  // The weights for the hidden units of the player moving next, followed by
+  // the weights for the hidden units of the other player.
+  std::vector<float> output_weights;
+  float output_bias = 0;
+};
+
+// An efficiently updatable neural network to evaluate positions on the CPU.
+// The network has a single hidden layer, which is computed separately from the
+// perspective of each player over 768 binary features, one for every piece type
+// and color on every square, where the board is flipped for black such that
+// both perspectives see their own pieces move up the board. The output is
+// computed from the hidden units of both perspectives, with the player moving
+// next first.
+//
+// Since a move only changes a few features, the hidden layer before the
+// activation, i.e. the accumulator, is updated from the accumulator of the
+// position before the move by adding and subtracting a few weight columns,
+// rather than computing it from scratch. The network runs on 16-bit integers,
+// with AVX2 or AVX-512 if the build targets them.
+class Nnue {
+public:
+  static constexpr unsigned kFeatures = 768;
+  static constexpr unsigned kHidden = 256;
+
+  // The centipawns of an output of 1.0 of the float network, whose value is
+  // tanh of the output.
+  static constexpr int kCentipawns = 400;
+
+  // The hidden layer before the activation from the perspective of each
+  // player.
+  struct Accumulator {
+    alignas(64) std::array<std::int16_t, kHidden> white;
+    alignas(64) std::array<std::int16_t, kHidden> black;
+  };
+
+  // Initializes a network with all the weights set to zero, which evaluates
+  // every position as even.
+  Nnue();
+
+  // Quantizes the float |weights|. Throws an exception if the weights do not
+  // have the sizes of the network.
+  explicit
+  Nnue(const NnueWeights& weights);
+
+  // Reads the network from a file written by save. Throws an exception if the
+  // file cannot be read or has the wrong format.
+  static Nnue
+  load(const std::filesystem::path& path);
+
+  // Writes the network to |path|. Throws an exception on error.
+  void
+  save(const std::filesystem::path& path) const;
+
+  // Returns the index of the feature for a |piece_color| piece of |type| on
+  // |square| from the perspective of |perspective|.
+  static unsigned
+  feature(Color perspective, Color piece_color, Type type, unsigned square)
+    noexcept;
+
+  // Returns the features of |board| from the perspective of |perspective|.
+  static std::vector<unsigned>
+  features(const Board& board, Color perspective);
+
+  // Computes the accumulator of |board| from scratch.
+  void
+  refresh(const Board& board, Accumulator& acc) const noexcept;
+
+  // Computes the accumulator of |board| from |parent|, the accumulator of the
+  // position before the last move of |board|. Note that |board| needs a last
+  // move.
+  void
+  update(const Accumulator& parent, const Board& board, Accumulator& acc) const
+    noexcept;
+
+  // Returns the evaluation in centipawns from |acc| from the perspective of the
+  // player moving next.
+  int
+  evaluate(const Accumulator& acc, bool is_white_next) const noexcept;
+
+  // Returns the evaluation of |board| in centipawns from the perspective of the
+  // player moving next.
+  int
+  evaluate(const Board& board) const noexcept;
+
+private:
+  std::vector<std::int16_t> feature_weights;
+  std::array<std::int16_t, kHidden> feature_biases{};
+  std::array<std::int16_t, 2 * kHidden> output_weights{};
+  std::int32_t output_bias = 0;
+};
+
+} // namespace blunder
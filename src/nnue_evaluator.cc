@@ -0,0 +1,71 @@
+#include "nnue_evaluator.h"
+
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "board.h"
+
+namespace blunder {
+
+NnueEvaluator::NnueEvaluator(
+    std::shared_ptr<const Nnue> nnue,
+    std::size_t capacity)
+  : nnue(std::move(nnue)),
+    table(capacity)
+{
+  if (not this->nnue)
+    throw std::invalid_argument("nnue cannot be null.");
+  if (not capacity)
+    throw std::invalid_argument("capacity must be non-zero.");
+}
+
+Prediction
+NnueEvaluator::predict(const EvalBoardPath& board_path) const
+{
+  auto root = board_path.root();
+  if (not root)
+    throw std::invalid_argument("board_path should have at least one board.");
+
+  ++num_predictions;
+  const auto& board = root->get();
+
+  Nnue::Accumulator acc;
+  {
+    std::lock_guard lock(mtx);
+
+    bool is_updated = false;
+    if (board_path.size() > 1 and board.last_move()) {
+      auto iter = board_path.begin();
+      const auto key = (*++iter).hash();
+      const auto& entry = table[key % table.size()];
+      if (entry.is_set and entry.key == key) {
+        nnue->update(entry.acc, board, acc);
+        is_updated = true;
+        ++num_updates;
+      }
+    }
+    if (not is_updated)
+      nnue->refresh(board, acc);
+
+    auto& entry = table[board.hash() % table.size()];
+    entry.key = board.hash();
+    entry.is_set = true;
+    entry.acc = acc;
+  }
+
+  Prediction pred;
+  pred.value = std::tanh(static_cast<float>(
+        nnue->evaluate(acc, board.is_white_next())) / Nnue::kCentipawns);
+
+  auto children = board.next();
+  pred.move_probs.reserve(children.size());
+  for (auto& child : children)
+    pred.move_probs.emplace_back(std::move(child), 1.0f / children.size());
+
+  return pred;
+}
+
+} // namespace blunder
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "board_path.h"
+#include "evaluator.h"
+#include "nnue.h"
+
+namespace blunder {
+
+// An evaluator that runs an Nnue on the CPU. The network only has a value,
+// which is for the player moving next like any Prediction, so the priors are
+// uniform over the legal moves. The accumulators of the last
+// positions evaluated are kept in a fixed size table, such that a position
+// whose parent in the board path was evaluated, e.g. a leaf of an Mcts whose
+// parent was expanded earlier, updates the accumulator of its parent with the
+// last move rather than computing it from scratch. The evaluator is safe to use
+// from multiple threads.
+class NnueEvaluator : public Evaluator {
+public:
+  // Initializes the evaluator with the network, and the number of accumulators
+  // to keep. Throws an exception if the network is null or the capacity is
+  // zero.
+  explicit
+  NnueEvaluator(
+      std::shared_ptr<const Nnue> nnue,
+      std::size_t capacity = 4096);
+
+  Prediction
+  predict(const EvalBoardPath& board_path) const override;
+
+  // Returns the number of predictions that updated the accumulator of the
+  // parent rather than computing it from scratch.
+  std::uint64_t
+  updates() const noexcept
+  { return num_updates; }
+
+  // Returns the number of predictions.
+  std::uint64_t
+  predictions() const noexcept
+  { return num_predictions; }
+
+private:
+  struct Entry {
+    std::uint64_t key = 0;
+    bool is_set = false;
+    Nnue::Accumulator acc;
+  };
+
+  std::shared_ptr<const Nnue> nnue;
+  mutable std::vector<Entry> table;
+  mutable std::mutex mtx;
+  mutable std::atomic<std::uint64_t> num_updates = 0;
+  mutable std::atomic<std::uint64_t> num_predictions = 0;
+};
+
+} // namespace blunder
@@ -0,0 +1,270 @@
+#include "nnue_trainer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "color.h"
+
+namespace blunder {
+namespace {
+
+constexpr unsigned kFeatures = Nnue::kFeatures;
+constexpr unsigned kHidden = Nnue::kHidden;
+
+// The decay rates of the moments, and the epsilon of Adam.
+constexpr float kBeta1 = 0.9;
+constexpr float kBeta2 = 0.999;
+constexpr float kEpsilon = 1e-8;
+
+// Returns weights of the size of the network, all set to zero.
+NnueWeights
+zero_weights()
+{
+  return NnueWeights{
+    .feature_weights=std::vector<float>(kFeatures * kHidden, 0),
+    .feature_biases=std::vector<float>(kHidden, 0),
+    .output_weights=std::vector<float>(2 * kHidden, 0),
+    .output_bias=0
+  };
+}
+
+// Returns the hidden layer before the activation, i.e. the biases plus the
+// columns of the feature weights for |features|.
+std::vector<float>
+hidden_layer(
+    const NnueWeights& weights,
+    const std::vector<std::uint16_t>& features)
+{
+  std::vector<float> acc(weights.feature_biases);
+  for (auto feature : features) {
+    const auto* column = weights.feature_weights.data() + feature * kHidden;
+    for (unsigned i = 0; i < kHidden; ++i)
+      acc[i] += column[i];
+  }
+  return acc;
+}
+
+// The clipped ReLU.
+float
+crelu(float x) noexcept
+{ return std::clamp(x, 0.0f, 1.0f); }
+
+} // namespace
+
+NnueTrainer::NnueTrainer(
+    float learning_rate,
+    float result_weight,
+    std::uint64_t seed)
+  : params(zero_weights()),
+    grads(zero_weights()),
+    first_moments(zero_weights()),
+    second_moments(zero_weights()),
+    is_touched(kFeatures, false),
+    learning_rate(learning_rate),
+    result_weight(result_weight),
+    rand_gen(seed)
+{
+  if (result_weight < 0 or result_weight > 1)
+    throw std::invalid_argument("result_weight must be in [0, 1].");
+
+  // Start with the hidden units in the linear range of the clipped ReLU, such
+  // that they all have a gradient.
+  std::uniform_real_distribution<float> feature_dist(-0.1, 0.1);
+  for (auto& weight : params.feature_weights)
+    weight = feature_dist(rand_gen);
+  std::ranges::fill(params.feature_biases, 0.5f);
+
+  std::uniform_real_distribution<float> output_dist(
+      -1 / std::sqrt(2.0f * kHidden), 1 / std::sqrt(2.0f * kHidden));
+  for (auto& weight : params.output_weights)
+    weight = output_dist(rand_gen);
+}
+
+void
+NnueTrainer::add(const GameResult& game_result)
+{
+  auto boards = game_result.replay();
+
+  for (std::size_t i = 0; i < game_result.plies.size(); ++i) {
+    const auto& board = boards[i];
+
+    // The outcome from the perspective of the player moving next.
+    float outcome = 0;
+    if (game_result.winner == Color::White)
+      outcome = board.is_white_next() ? 1 : -1;
+    else if (game_result.winner == Color::Black)
+      outcome = board.is_white_next() ? -1 : 1;
+
+    // A ply without a search value, e.g. a forced move, learns the outcome.
+    const auto& ply = game_result.plies[i];
+    const float target = ply.has_value
+      ? result_weight * outcome + (1 - result_weight) * ply.value
+      : outcome;
+    positions.push_back(make_position(board, target));
+  }
+}
+
+float
+NnueTrainer::train(unsigned epochs, unsigned batch_size)
+{
+  if (positions.empty())
+    throw std::logic_error("There are no positions to train on.");
+  if (not batch_size)
+    throw std::invalid_argument("batch_size must be non-zero.");
+
+  std::vector<std::size_t> order(positions.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  float epoch_loss = 0;
+  for (unsigned epoch = 0; epoch < epochs; ++epoch) {
+    std::ranges::shuffle(order, rand_gen);
+
+    epoch_loss = 0;
+    for (std::size_t start = 0; start < order.size(); start += batch_size) {
+      const auto end = std::min(order.size(), start + batch_size);
+      const float scale = 1.0f / (end - start);
+      for (auto i = start; i < end; ++i)
+        epoch_loss += backward(positions[order[i]], scale);
+      step();
+    }
+    epoch_loss /= positions.size();
+  }
+
+  return epoch_loss;
+}
+
+float
+NnueTrainer::loss() const
+{
+  if (positions.empty())
+    return 0;
+
+  float total = 0;
+  for (const auto& position : positions) {
+    auto error = forward(position).value - position.target;
+    total += error * error;
+  }
+  return total / positions.size();
+}
+
+float
+NnueTrainer::predict(const Board& board) const
+{ return forward(make_position(board, 0)).value; }
+
+NnueTrainer::Activations
+NnueTrainer::forward(const Position& position) const
+{
+  Activations act{
+    .mine=hidden_layer(params, position.mine),
+    .other=hidden_layer(params, position.other)
+  };
+
+  float output = params.output_bias;
+  for (unsigned i = 0; i < kHidden; ++i) {
+    output += params.output_weights[i] * crelu(act.mine[i]);
+    output += params.output_weights[kHidden + i] * crelu(act.other[i]);
+  }
+  act.value = std::tanh(output);
+  return act;
+}
+
+float
+NnueTrainer::backward(const Position& position, float scale)
+{
+  auto act = forward(position);
+  const float error = act.value - position.target;
+
+  // The derivative of the squared error with respect to the output.
+  const float d_output = 2 * error * (1 - act.value * act.value) * scale;
+  grads.output_bias += d_output;
+
+  auto backward_side = [&](const std::vector<float>& acc,
+                           const std::vector<std::uint16_t>& features,
+                           unsigned offset) {
+    std::vector<float> d_acc(kHidden, 0);
+    for (unsigned i = 0; i < kHidden; ++i) {
+      grads.output_weights[offset + i] += d_output * crelu(acc[i]);
+      // The clipped ReLU has no gradient outside of (0, 1).
+      if (acc[i] > 0 and acc[i] < 1)
+        d_acc[i] = d_output * params.output_weights[offset + i];
+      grads.feature_biases[i] += d_acc[i];
+    }
+
+    for (auto feature : features) {
+      if (not is_touched[feature]) {
+        is_touched[feature] = true;
+        touched.push_back(feature);
+      }
+      auto* column = grads.feature_weights.data() + feature * kHidden;
+      for (unsigned i = 0; i < kHidden; ++i)
+        column[i] += d_acc[i];
+    }
+  };
+
+  backward_side(act.mine, position.mine, 0);
+  backward_side(act.other, position.other, kHidden);
+
+  return error * error;
+}
+
+void
+NnueTrainer::step()
+{
+  ++steps;
+  const float correction1 = 1 - std::pow(kBeta1, steps);
+  const float correction2 = 1 - std::pow(kBeta2, steps);
+
+  auto update = [&](float& param, float& grad, float& m, float& v) {
+    m = kBeta1 * m + (1 - kBeta1) * grad;
+    v = kBeta2 * v + (1 - kBeta2) * grad * grad;
+    param -= learning_rate * (m / correction1)
+             / (std::sqrt(v / correction2) + kEpsilon);
+    grad = 0;
+  };
+
+  // Only the features in the batch have a gradient.
+  for (auto feature : touched) {
+    const auto offset = feature * kHidden;
+    for (unsigned i = offset; i < offset + kHidden; ++i) {
+      update(params.feature_weights[i], grads.feature_weights[i],
+             first_moments.feature_weights[i],
+             second_moments.feature_weights[i]);
+    }
+    is_touched[feature] = false;
+  }
+  touched.clear();
+
+  for (unsigned i = 0; i < kHidden; ++i) {
+    update(params.feature_biases[i], grads.feature_biases[i],
+           first_moments.feature_biases[i], second_moments.feature_biases[i]);
+  }
+  for (unsigned i = 0; i < 2 * kHidden; ++i) {
+    update(params.output_weights[i], grads.output_weights[i],
+           first_moments.output_weights[i], second_moments.output_weights[i]);
+  }
+  update(params.output_bias, grads.output_bias,
+         first_moments.output_bias, second_moments.output_bias);
+}
+
+NnueTrainer::Position
+NnueTrainer::make_position(const Board& board, float target)
+{
+  const auto mine = board.is_white_next() ? Color::White : Color::Black;
+  const auto other = board.is_white_next() ? Color::Black : Color::White;
+
+  Position position;
+  position.target = target;
+  for (auto feature : Nnue::features(board, mine))
+    position.mine.push_back(feature);
+  for (auto feature : Nnue::features(board, other))
+    position.other.push_back(feature);
+  return position;
+}
+
+} // namespace blunder
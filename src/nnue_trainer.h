@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "board.h"
+#include "game_result.h"
+#include "nnue.h"
+
+namespace blunder {
+
+// Fits the float weights of an Nnue to the positions of self-play games with
+// Adam, where the value of the network, i.e. tanh of its output, is fitted to
+// the outcome of the game from the perspective of the player moving next,
+// optionally mixed with the value of the search at the position. The feature
+// weights are updated only for the features in a batch, which are a few dozen
+// out of 768 per position.
+class NnueTrainer {
+public:
+  // Initializes the trainer with the learning rate, the weight of the game
+  // outcome in the value target, where the rest of the weight goes to the value
+  // of the search, and a seed for the initial weights and the order of the
+  // positions. Throws an exception if the result weight is not in [0, 1].
+  explicit
+  NnueTrainer(
+      float learning_rate = 1e-3,
+      float result_weight = 1.0,
+      std::uint64_t seed = 0);
+
+  // Adds the positions before every ply of |game_result|.
+  void
+  add(const GameResult& game_result);
+
+  // Returns the number of positions to train on.
+  std::size_t
+  size() const noexcept
+  { return positions.size(); }
+
+  // Runs |epochs| passes over the positions in random order, in batches of
+  // |batch_size| positions. Returns the mean squared error of the value in the
+  // last epoch. Throws an exception if there are no positions.
+  float
+  train(unsigned epochs, unsigned batch_size = 256);
+
+  // Returns the mean squared error of the value over all the positions.
+  float
+  loss() const;
+
+  // Returns the value of |board| with the float weights.
+  float
+  predict(const Board& board) const;
+
+  const NnueWeights&
+  weights() const noexcept
+  { return params; }
+
+  // Returns the quantized network.
+  Nnue
+  network() const
+  { return Nnue(params); }
+
+private:
+  struct Position {
+    // The features from the perspective of the player moving next, and of the
+    // other player.
+    std::vector<std::uint16_t> mine;
+    std::vector<std::uint16_t> other;
+    float target = 0;
+  };
+
+  // The activations of a position.
+  struct Activations {
+    std::vector<float> mine;
+    std::vector<float> other;
+    float value = 0;
+  };
+
+  // Runs the float network on |position|.
+  Activations
+  forward(const Position& position) const;
+
+  // Adds the gradient of the squared error of |position| scaled by |scale| to
+  // the gradients, and returns the squared error.
+  float
+  backward(const Position& position, float scale);
+
+  // Updates the weights with the gradients, and clears the gradients.
+  void
+  step();
+
+  // Returns the position for |board| with |target| as its value.
+  static Position
+  make_position(const Board& board, float target);
+
+  NnueWeights params;
+  NnueWeights grads;
+  // The first and second moments of Adam.
+  NnueWeights first_moments;
+  NnueWeights second_moments;
+  // The features with a gradient in the current batch.
+  std::vector<std::uint16_t> touched;
+  std::vector<bool> is_touched;
+  unsigned steps = 0;
+
+  float learning_rate;
+  float result_weight;
+  std::vector<Position> positions;
+  std::mt19937_64 rand_gen;
+};
+
+} // namespace blunder
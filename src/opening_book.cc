@@ -0,0 +1,213 @@
+#include "opening_book.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "coding_util.h"
+#include "mapped_file.h"
+
+namespace blunder {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The book file consists of a BookHeader followed by the entries, all in
+// native byte order. The header is a multiple of the alignment of the
+// entries, such that the entries are used in place.
+constexpr char kBookMagic[8] = {'B', 'L', 'N', 'D', 'B', 'O', 'O', 'K'};
+constexpr std::uint32_t kBookVersion = 1;
+
+struct BookHeader {
+  char magic[8];
+  std::uint32_t version = kBookVersion;
+  std::uint32_t max_plies = 0;
+  std::uint64_t entries = 0;
+  std::uint64_t reserved = 0;
+};
+
+static_assert(sizeof(BookHeader) % alignof(OpeningBook::Entry) == 0);
+
+// Compares the entries by key, to find the entries of a position.
+struct KeyLess {
+  bool
+  operator()(const OpeningBook::Entry& entry, std::uint64_t key) const noexcept
+  { return entry.key < key; }
+
+  bool
+  operator()(std::uint64_t key, const OpeningBook::Entry& entry) const noexcept
+  { return key < entry.key; }
+};
+
+} // namespace
+
+OpeningBook::OpeningBook(const fs::path& path)
+  : file(path)
+{
+  auto bytes = file.bytes();
+
+  BookHeader header;
+  if (bytes.size() < sizeof(header))
+    throw std::runtime_error("Truncated opening book.");
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kBookMagic, sizeof(kBookMagic)))
+    throw std::runtime_error("Not an opening book.");
+  if (header.version != kBookVersion)
+    throw std::runtime_error("Unsupported opening book version.");
+  if (bytes.size() != sizeof(header) + header.entries * sizeof(Entry))
+    throw std::runtime_error("Truncated opening book.");
+
+  book_entries = std::span(
+      reinterpret_cast<const Entry*>(bytes.data() + sizeof(header)),
+      header.entries);
+  book_max_plies = header.max_plies;
+}
+
+std::vector<BoardProb>
+OpeningBook::lookup(const Board& board) const
+{
+  auto [first, last] = std::equal_range(
+      book_entries.begin(), book_entries.end(), board.hash(), KeyLess());
+  if (first == last)
+    return {};
+
+  std::vector<BoardProb> moves;
+  std::uint64_t total = 0;
+  for (auto& child : board.next()) {
+    const auto move = encode_move(*child.last_move()).index();
+    auto entry = std::find_if(first, last, [move](const Entry& entry) {
+      return entry.move == move;
+    });
+    if (entry == last)
+      continue;
+    moves.push_back(BoardProb{
+      .board=std::move(child),
+      .prior=0,
+      .visits=entry->visits
+    });
+    total += entry->visits;
+  }
+
+  for (auto& move : moves)
+    move.prior = static_cast<float>(move.visits) / total;
+  return moves;
+}
+
+std::optional<SearchResult>
+OpeningBook::sample(
+    const Board& board,
+    const BookOptions& options,
+    std::mt19937_64& rand_gen) const
+{
+  auto moves = lookup(board);
+
+  std::uint64_t total = 0;
+  for (const auto& move : moves)
+    total += move.visits;
+  if (moves.empty() or total < options.min_visits)
+    return std::nullopt;
+
+  SearchResult result;
+  if (options.temperature <= 0) {
+    result.best = *std::max_element(moves.begin(), moves.end());
+  } else {
+    std::vector<double> weights;
+    weights.reserve(moves.size());
+    for (const auto& move : moves)
+      weights.push_back(std::pow(move.visits, 1.0 / options.temperature));
+    std::discrete_distribution<std::size_t> dist(
+        weights.begin(), weights.end());
+    result.best = moves[dist(rand_gen)];
+  }
+
+  for (const auto& move : moves)
+    result.moves.push_back(MoveProb::from(move));
+  result.has_value = false;
+  result.policy_target = false;
+  return result;
+}
+
+OpeningBookBuilder::OpeningBookBuilder(unsigned max_plies)
+  : max_plies(max_plies)
+{
+  if (not max_plies)
+    throw std::invalid_argument("max_plies must be non-zero.");
+}
+
+void
+OpeningBookBuilder::add(const GameResult& game_result)
+{
+  auto board = game_result.game_start;
+  const auto plies = std::min<std::size_t>(
+      max_plies, game_result.plies.size());
+
+  for (std::size_t i = 0; i < plies; ++i) {
+    const auto& ply = game_result.plies[i];
+    // The visits of cheap searches and of book moves are not added, since they
+    // are not from a full search.
+    if (ply.policy_target) {
+      for (const auto& entry : ply.policy)
+        visits[{board.hash(), entry.index}] += entry.visits;
+    }
+
+    if (not board.update_with_move(ply.mv))
+      throw std::logic_error("Unable to replay move from game record.");
+  }
+}
+
+void
+OpeningBookBuilder::add(const OpeningBook& book)
+{
+  max_plies = std::max(max_plies, book.max_plies());
+  for (const auto& entry : book.entries())
+    visits[{entry.key, entry.move}] += entry.visits;
+}
+
+void
+OpeningBookBuilder::write(const fs::path& path) const
+{
+  BookHeader header;
+  std::memcpy(header.magic, kBookMagic, sizeof(kBookMagic));
+  header.max_plies = max_plies;
+  header.entries = visits.size();
+
+  auto tmp_path = path;
+  tmp_path += ".tmp";
+
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (not out)
+      throw std::runtime_error("Unable to open " + tmp_path.string());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // The map is ordered by key and move, which is the order of the book.
+    for (const auto& [key_move, count] : visits) {
+      OpeningBook::Entry entry{
+        .key=key_move.first,
+        .move=key_move.second,
+        .reserved=0,
+        .visits=static_cast<std::uint32_t>(std::min<std::uint64_t>(
+            count, std::numeric_limits<std::uint32_t>::max()))
+      };
+      out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    }
+
+    out.close();
+    if (not out)
+      throw std::runtime_error("Unable to write " + tmp_path.string());
+  }
+
+  fs::rename(tmp_path, path);
+}
+
+} // namespace blunder
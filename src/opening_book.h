@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "game_result.h"
+#include "mapped_file.h"
+#include "search_result.h"
+
+namespace blunder {
+
+// How players use an opening book.
+struct BookOptions {
+  // The number of plies from the start of the game in which the book is used.
+  // Zero disables the book.
+  unsigned max_plies = 0;
+
+  // The temperature of the visit counts when sampling a move, where a higher
+  // temperature plays more diverse openings, and zero always plays the most
+  // visited move.
+  float temperature = 1;
+
+  // The minimum visits of a position in the book, such that positions that
+  // were rarely searched are searched again.
+  unsigned min_visits = 1;
+};
+
+// An opening book of the visit counts at the root of the searches in the first
+// plies of self-play games. The book is a file of entries sorted by the hash of
+// the position, which is mapped read-only and shared with the other processes
+// that use the same book, and positions are found by binary search.
+class OpeningBook {
+public:
+  // One move of a position in the book. The move is the flat index of the move
+  // in the policy planes, see encode_move.
+  struct Entry {
+    std::uint64_t key = 0;
+    std::uint16_t move = 0;
+    std::uint16_t reserved = 0;
+    std::uint32_t visits = 0;
+  };
+
+  // Maps the book at |path|. Throws an exception if the file cannot be mapped
+  // or is not a book.
+  explicit
+  OpeningBook(const std::filesystem::path& path);
+
+  // Returns the moves of |board| in the book, with the visits summed over the
+  // games and the prior set to the fraction of the visits. Moves that are not
+  // legal in |board|, e.g. due to a hash collision, are skipped.
+  std::vector<BoardProb>
+  lookup(const Board& board) const;
+
+  // Samples a move for |board| from the book with |options|. Returns nothing
+  // if the board is not in the book, or has fewer than the minimum visits. The
+  // result has no value and is not a policy target, since it does not come
+  // from a search.
+  std::optional<SearchResult>
+  sample(
+      const Board& board,
+      const BookOptions& options,
+      std::mt19937_64& rand_gen) const;
+
+  // Returns all the entries, sorted by key and move.
+  std::span<const Entry>
+  entries() const noexcept
+  { return book_entries; }
+
+  // Returns the number of plies from the start of the games in the book.
+  unsigned
+  max_plies() const noexcept
+  { return book_max_plies; }
+
+private:
+  MappedFile file;
+  std::span<const Entry> book_entries;
+  unsigned book_max_plies = 0;
+};
+
+// Aggregates the root visit counts of the first plies of games into an
+// OpeningBook file.
+class OpeningBookBuilder {
+public:
+  // Initializes the builder to add the positions in the first |max_plies| of
+  // the games. Throws an exception if |max_plies| is zero.
+  explicit
+  OpeningBookBuilder(unsigned max_plies);
+
+  // Adds the visit counts of the plies of |game_result| from a full search
+  // in the first plies of the game.
+  void
+  add(const GameResult& game_result);
+
+  // Adds the entries of |book|, e.g. to extend a book with new games.
+  void
+  add(const OpeningBook& book);
+
+  // Returns the number of moves in the book.
+  std::size_t
+  size() const noexcept
+  { return visits.size(); }
+
+  // Writes the book to |path|. The book is written to a temporary file first
+  // and then renamed, such that processes that have the old book mapped keep
+  // reading the old book. Throws an exception on error.
+  void
+  write(const std::filesystem::path& path) const;
+
+private:
+  unsigned max_plies;
+  // The visits by position hash and move.
+  std::map<std::pair<std::uint64_t, std::uint16_t>, std::uint64_t> visits;
+};
+
+} // namespace blunder
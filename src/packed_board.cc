@@ -0,0 +1,117 @@
+#include "packed_board.h"
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+
+#include "bitboard.h"
+#include "color.h"
+#include "pieces.h"
+#include "piece_set.h"
+
+namespace blunder {
+namespace {
+
+constexpr Type kPieceTypes[] = {
+  Type::King,
+  Type::Queen,
+  Type::Rook,
+  Type::Bishop,
+  Type::Knight,
+  Type::Pawn
+};
+
+// Returns the 4-bit piece code of the piece on the square in |bb|.
+std::uint8_t
+piece_code(const Board& board, BitBoard bb) noexcept
+{
+  if (auto piece = board.white().find_type(bb))
+    return piece->uint();
+
+  auto piece = board.black().find_type(bb);
+  assert(piece);
+  return piece->uint() + 6;
+}
+
+} // namespace
+
+PackedBoard
+PackedBoard::from(const Board& board) noexcept
+{
+  PackedBoard packed;
+
+  auto all_bits = board.all_bits();
+  packed.occupied = all_bits.raw();
+
+  unsigned i = 0;
+  while (all_bits) {
+    auto [ignored, bb] = all_bits.index_bb_and_clear();
+    auto code = piece_code(board, bb);
+    packed.pieces[i / 2] |= i % 2 ? code << 4 : code;
+    ++i;
+  }
+
+  packed.half_move = board.hm_count();
+  packed.full_move = board.fm_count();
+
+  if (board.is_white_next())
+    packed.flags |= kWhiteNext;
+  if (board.has_white_king_castle())
+    packed.flags |= kWhiteKingCastle;
+  if (board.has_white_queen_castle())
+    packed.flags |= kWhiteQueenCastle;
+  if (board.has_black_king_castle())
+    packed.flags |= kBlackKingCastle;
+  if (board.has_black_queen_castle())
+    packed.flags |= kBlackQueenCastle;
+
+  if (board.has_enpassant()) {
+    packed.flags |= kEnPassant;
+    packed.en_passant_file = board.enpassant_file();
+  }
+
+  return packed;
+}
+
+Board
+PackedBoard::to_board() const
+{
+  PieceSet white;
+  PieceSet black;
+
+  BitBoard all_bits(occupied);
+  unsigned i = 0;
+  while (all_bits) {
+    auto square = all_bits.first_bit_and_clear();
+    unsigned code = i % 2 ? pieces[i / 2] >> 4 : pieces[i / 2] & 0xf;
+    if (code >= 12)
+      throw std::logic_error("Invalid piece code in packed board.");
+    if (code < 6)
+      white.set_bit(kPieceTypes[code], square);
+    else
+      black.set_bit(kPieceTypes[code - 6], square);
+    ++i;
+  }
+
+  BoardBuilder builder;
+  if (flags & kEnPassant)
+    builder.set_enpassant_file(en_passant_file);
+
+  auto color = is_white_next() ? Color::White : Color::Black;
+  auto board = builder
+         .set_pieces(color, white, black)
+         .set_wk_castling(flags & kWhiteKingCastle)
+         .set_wq_castling(flags & kWhiteQueenCastle)
+         .set_bk_castling(flags & kBlackKingCastle)
+         .set_bq_castling(flags & kBlackQueenCastle)
+         .set_half_move(half_move)
+         .set_full_move(full_move)
+         .build();
+
+  if (not board)
+    throw std::logic_error("Unable to rebuild board from packed board.");
+
+  return *board;
+}
+
+} // namespace blunder
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "board.h"
+
+namespace blunder {
+
+// A compact, fixed size representation of a chess position, meant for storing
+// large numbers of positions, e.g. training positions in a replay buffer. A
+// Board carries attack sets and the move history, whereas a PackedBoard only
+// holds the minimum state needed to rebuild the Board:
+// - a bitboard with the occupied squares.
+// - a 4-bit piece code for every occupied square, ordered by square index.
+// - the move counters, the color moving next, castling and en passant rights.
+//
+// Note that the move history is not preserved, and hence a Board rebuilt from a
+// PackedBoard does not have a last move.
+class PackedBoard {
+public:
+  // Packs |board| into a PackedBoard.
+  static PackedBoard
+  from(const Board& board) noexcept;
+
+  // Rebuilds the Board. Throws an exception if the packed board does not
+  // represent a valid position.
+  Board
+  to_board() const;
+
+  // Returns true if white is next to move.
+  bool
+  is_white_next() const noexcept
+  { return flags & kWhiteNext; }
+
+  // Default equality comparison.
+  friend bool operator==(const PackedBoard&, const PackedBoard&) = default;
+
+private:
+  // Bit flags for the |flags| member.
+  static constexpr std::uint8_t kWhiteNext = 1;
+  static constexpr std::uint8_t kWhiteKingCastle = 1 << 1;
+  static constexpr std::uint8_t kWhiteQueenCastle = 1 << 2;
+  static constexpr std::uint8_t kBlackKingCastle = 1 << 3;
+  static constexpr std::uint8_t kBlackQueenCastle = 1 << 4;
+  static constexpr std::uint8_t kEnPassant = 1 << 5;
+
+  // The squares with a piece.
+  std::uint64_t occupied = 0;
+
+  // Two piece codes per byte, one for each occupied square in order of square
+  // index. The piece code is the piece type, plus 6 for black pieces.
+  std::array<std::uint8_t, 16> pieces{};
+
+  std::uint16_t half_move = 0;
+  std::uint16_t full_move = 0;
+
+  // The color to move next, castling rights, and en passant right.
+  std::uint8_t flags = 0;
+
+  // The file where en passant is possible, if the en passant flag is set.
+  std::uint8_t en_passant_file = 0;
+};
+
+static_assert(sizeof(PackedBoard) == 32);
+
+} // namespace blunder
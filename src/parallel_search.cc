@@ -0,0 +1,166 @@
+#include "parallel_search.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+
+namespace blunder {
+namespace {
+
+// Returns |limit| split between |n| searches, rounding up, such that a set
+// limit stays set.
+unsigned
+split(unsigned limit, unsigned n) noexcept
+{ return (limit + n - 1) / n; }
+
+// Merges the results of searches of the position |board|.
+SearchResult
+merge(const Board& board, std::vector<SearchResult> results)
+{
+  assert(not results.empty());
+
+  auto merged = std::move(results.front());
+  for (std::size_t i = 1; i < results.size(); ++i) {
+    const auto& result = results[i];
+    for (const auto& move : result.moves) {
+      auto iter = std::find_if(
+          merged.moves.begin(), merged.moves.end(),
+          [&](const auto& mp) { return mp.mv == move.mv; });
+      if (iter != merged.moves.end())
+        iter->visits += move.visits;
+      else
+        merged.moves.push_back(move);
+    }
+
+    merged.nodes_expanded += result.nodes_expanded;
+    merged.nodes_visited += result.nodes_visited;
+    merged.simulations += result.simulations;
+    merged.simulations_saved += result.simulations_saved;
+    merged.reused_visits += result.reused_visits;
+    merged.depth = std::max(merged.depth, result.depth);
+    merged.millis_eval += result.millis_eval;
+    merged.millis_search_time = std::max(
+        merged.millis_search_time, result.millis_search_time);
+    merged.policy_target = merged.policy_target and result.policy_target;
+  }
+
+  if (merged.nodes_expanded)
+    merged.millis_per_eval = merged.millis_eval / merged.nodes_expanded;
+
+  // Break ties with the prior, like Mcts.
+  auto best = std::max_element(
+      merged.moves.begin(), merged.moves.end(),
+      [](const auto& left, const auto& right) {
+        return left.visits < right.visits
+               or (left.visits == right.visits and left.prior < right.prior);
+      });
+  assert(best != merged.moves.end());
+
+  // The value is from a search that picked the same move, if any.
+  for (const auto& result : results) {
+    if (result.best.board.last_move() == best->mv) {
+      merged.value = result.value;
+      merged.has_value = result.has_value;
+      break;
+    }
+  }
+
+  for (auto& child : board.next()) {
+    if (child.last_move() == best->mv) {
+      merged.best = BoardProb{
+        .board=std::move(child),
+        .prior=best->prior,
+        .visits=best->visits
+      };
+      break;
+    }
+  }
+
+  return merged;
+}
+
+} // namespace
+
+ParallelSearch::ParallelSearch(std::vector<std::shared_ptr<Search>> searches)
+  : searches(std::move(searches))
+{
+  if (this->searches.empty())
+    throw std::invalid_argument("searches cannot be empty.");
+  for (const auto& search : this->searches) {
+    if (not search)
+      throw std::invalid_argument("searches cannot have a null search.");
+  }
+}
+
+SearchResult
+ParallelSearch::run(const EvalBoardPath& board_path) const
+{
+  return run_all(board_path, [&](const Search& search, std::size_t) {
+    return search.run(board_path);
+  });
+}
+
+SearchResult
+ParallelSearch::run(
+    const EvalBoardPath& board_path,
+    const SearchLimits& limits) const
+{
+  auto search_limits = limits;
+  search_limits.simulations = split(limits.simulations, searches.size());
+  search_limits.nodes = split(limits.nodes, searches.size());
+
+  // The searches after the first add noise to the priors of the root, since
+  // they would search the same tree as the first otherwise.
+  auto noise_limits = search_limits;
+  noise_limits.root_noise = true;
+
+  return run_all(board_path, [&](const Search& search, std::size_t i) {
+    return search.run(board_path, i ? noise_limits : search_limits);
+  });
+}
+
+template<typename SearchFn>
+SearchResult
+ParallelSearch::run_all(
+    const EvalBoardPath& board_path,
+    SearchFn search_fn) const
+{
+  auto root = board_path.root();
+  if (not root)
+    throw std::invalid_argument("EvalBoardPath should have a root.");
+
+  const auto n = searches.size();
+  std::vector<SearchResult> results(n);
+  std::vector<std::exception_ptr> errors(n);
+
+  auto run_one = [&](std::size_t i) {
+    try {
+      results[i] = search_fn(*searches[i], i);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(n - 1);
+    for (std::size_t i = 1; i < n; ++i)
+      threads.emplace_back(run_one, i);
+    run_one(0);
+  }
+
+  for (const auto& error : errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  return merge(root->get(), std::move(results));
+}
+
+} // namespace blunder
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "board_path.h"
+#include "search.h"
+#include "search_limits.h"
+#include "search_result.h"
+
+namespace blunder {
+
+// Runs several searches of the same position in parallel, e.g. Mcts with
+// different seeds, and merges the visit counts of the moves at the root, i.e.
+// root parallelization. The searches do not share their trees, but they can
+// share an evaluator, e.g. a CachedEvaluator, such that positions evaluated by
+// one search are cheap for the others. The first search runs on the calling
+// thread.
+class ParallelSearch : public Search {
+public:
+  // Throws an exception if |searches| is empty or has a null search.
+  explicit
+  ParallelSearch(std::vector<std::shared_ptr<Search>> searches);
+
+  // Runs every search with its own number of simulations.
+  SearchResult
+  run(const EvalBoardPath& board_path) const override;
+
+  // Runs every search until one of |limits| is reached, where the simulation
+  // and node limits are split evenly between the searches. The searches after
+  // the first always add noise to the root priors to search different trees.
+  SearchResult
+  run(const EvalBoardPath& board_path,
+      const SearchLimits& limits) const override;
+
+  // Returns the number of searches that run in parallel.
+  unsigned
+  size() const noexcept
+  { return searches.size(); }
+
+private:
+  // Runs |search_fn| with every search and its index in parallel, and merges
+  // the results.
+  template<typename SearchFn>
+  SearchResult
+  run_all(const EvalBoardPath& board_path, SearchFn search_fn) const;
+
+  std::vector<std::shared_ptr<Search>> searches;
+};
+
+} // namespace blunder
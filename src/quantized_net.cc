@@ -0,0 +1,225 @@
+#include "quantized_net.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <ATen/core/dispatch/Dispatcher.h>
+
+namespace blunder {
+namespace {
+
+using ::torch::Tensor;
+
+// Activations are quantized to 7 bits rather than 8, like the default qconfig
+// for fbgemm, since the int16 accumulation of the x86 kernels can saturate with
+// the full range.
+constexpr std::int64_t kActivationMax = 127;
+
+// The number of calibration positions to run through the float network at once.
+constexpr std::int64_t kCalibrationBatch = 64;
+
+// Tracks the range of the values observed in an activation.
+struct MinMax {
+  float min = std::numeric_limits<float>::max();
+  float max = std::numeric_limits<float>::lowest();
+
+  void
+  observe(const Tensor& t)
+  {
+    min = std::min(min, t.min().item<float>());
+    max = std::max(max, t.max().item<float>());
+  }
+
+  // Returns the affine quantization parameters that cover the observed range,
+  // extended to include 0 so that it is exactly representable.
+  QuantParams
+  params() const noexcept
+  {
+    auto lo = std::min(min, 0.0f);
+    auto hi = std::max(max, 0.0f);
+    double scale = (hi - lo) / kActivationMax;
+    if (scale <= 0)
+      return QuantParams{};
+
+    auto zero_point = static_cast<std::int64_t>(std::round(-lo / scale));
+    return QuantParams{
+      .scale=scale,
+      .zero_point=std::clamp<std::int64_t>(zero_point, 0, kActivationMax)
+    };
+  }
+};
+
+// The observed ranges for the activations in a residual block.
+struct ResBlockRanges {
+  MinMax conv1;
+  MinMax conv2;
+  MinMax out;
+};
+
+// The quantized kernels are registered with the dispatcher, but they are not
+// exposed in the C++ frontend, so they are called as boxed operators.
+c10::OperatorHandle
+find_op(const char* name, const char* overload)
+{ return c10::Dispatcher::singleton().findSchemaOrThrow(name, overload); }
+
+c10::IValue
+call_op(const c10::OperatorHandle& op, std::vector<c10::IValue> args)
+{
+  op.callBoxed(&args);
+  return std::move(args.front());
+}
+
+const c10::OperatorHandle&
+prepack_op()
+{
+  static const auto op = find_op("quantized::conv2d_prepack", "");
+  return op;
+}
+
+const c10::OperatorHandle&
+conv_op()
+{
+  static const auto op = find_op("quantized::conv2d", "new");
+  return op;
+}
+
+const c10::OperatorHandle&
+conv_relu_op()
+{
+  static const auto op = find_op("quantized::conv2d_relu", "new");
+  return op;
+}
+
+const c10::OperatorHandle&
+add_relu_op()
+{
+  static const auto op = find_op("quantized::add_relu", "");
+  return op;
+}
+
+// Runs the quantized convolution |op| on |qx|, and quantizes the output with
+// |out|.
+Tensor
+run_conv(
+    const c10::OperatorHandle& op,
+    const Tensor& qx,
+    const c10::IValue& packed,
+    QuantParams out)
+{ return call_op(op, {qx, packed, out.scale, out.zero_point}).toTensor(); }
+
+} // namespace
+
+QuantizedNet::QuantizedNet(
+    const FoldedNet& net,
+    const Tensor& calibration_inputs)
+  : float_net(net.to(torch::kCPU))
+{
+  if (not calibration_inputs.defined() or calibration_inputs.size(0) == 0)
+    throw std::invalid_argument("calibration_inputs cannot be empty.");
+
+  c10::InferenceMode inference_mode;
+
+  MinMax tower_range;
+  std::vector<ResBlockRanges> block_ranges(float_net.res_blocks.size());
+
+  // Run the float network on the calibration inputs to observe the range of
+  // every activation that is quantized.
+  auto inputs = calibration_inputs.to(torch::kCPU);
+  for (const auto& batch : inputs.split(kCalibrationBatch)) {
+    auto out = float_net.input_conv.forward(batch).relu_();
+    tower_range.observe(out);
+
+    for (std::size_t i = 0; i < float_net.res_blocks.size(); ++i) {
+      const auto& block = float_net.res_blocks[i];
+      auto& ranges = block_ranges[i];
+
+      auto res = block.conv1.forward(out).relu_();
+      ranges.conv1.observe(res);
+
+      res = block.conv2.forward(res);
+      ranges.conv2.observe(res);
+
+      out = res.add_(out).relu_();
+      ranges.out.observe(out);
+    }
+  }
+
+  tower_params = tower_range.params();
+
+  res_blocks.reserve(float_net.res_blocks.size());
+  for (std::size_t i = 0; i < float_net.res_blocks.size(); ++i) {
+    const auto& block = float_net.res_blocks[i];
+    const auto& ranges = block_ranges[i];
+    res_blocks.push_back(ResBlock{
+      .conv1=pack(block.conv1, ranges.conv1.params()),
+      .conv2=pack(block.conv2, ranges.conv2.params()),
+      .out=ranges.out.params()
+    });
+  }
+}
+
+QuantizedNet::QuantizedConv
+QuantizedNet::pack(const FoldedConv& conv, QuantParams out)
+{
+  // Symmetric int8 weights with a scale for every output channel.
+  const auto& weight = conv.weight;
+  auto scales = weight.abs().amax({1, 2, 3}).clamp_min(1e-8) / 127;
+  auto zero_points = torch::zeros({weight.size(0)}, torch::kLong);
+  auto qweight = torch::quantize_per_channel(
+      weight, scales.to(torch::kDouble), zero_points, /*axis=*/0,
+      torch::kQInt8);
+
+  const std::vector<std::int64_t> ones = {1, 1};
+  const std::vector<std::int64_t> padding = {conv.padding, conv.padding};
+
+  // Note that the bias stays in float, and is quantized by the kernel.
+  auto packed = call_op(prepack_op(), {
+      qweight, conv.bias, ones, padding, /*dilation=*/ones,
+      /*groups=*/std::int64_t{1}});
+
+  return QuantizedConv{.packed=std::move(packed), .out=out};
+}
+
+std::pair<Tensor, Tensor>
+QuantizedNet::predict(Tensor x) const
+{
+  c10::InferenceMode inference_mode;
+
+  auto out = float_net.input_conv.forward(x).relu_();
+  out = torch::quantize_per_tensor(
+      out, tower_params.scale, tower_params.zero_point, torch::kQUInt8);
+
+  for (const auto& block : res_blocks) {
+    auto res = run_conv(conv_relu_op(), out, block.conv1.packed,
+                        block.conv1.out);
+    res = run_conv(conv_op(), res, block.conv2.packed, block.conv2.out);
+    out = call_op(add_relu_op(),
+                  {res, out, block.out.scale, block.out.zero_point}).toTensor();
+  }
+
+  return float_net.heads(out.dequantize());
+}
+
+Tensor
+calibration_inputs(ChessDataSet& data_set, std::size_t num_positions)
+{
+  auto n = std::min<std::size_t>(num_positions, *data_set.size());
+
+  std::vector<Tensor> inputs;
+  inputs.reserve(n);
+  for (std::size_t i = 0; i < n; ++i)
+    inputs.push_back(data_set.get(i).data.detach().to(torch::kCPU));
+
+  if (inputs.empty())
+    throw std::invalid_argument("data_set has no positions.");
+
+  return torch::stack(inputs);
+}
+
+} // namespace blunder
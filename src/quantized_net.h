@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "chess_data_set.h"
+#include "folded_net.h"
+#include "inference_net.h"
+
+namespace blunder {
+
+// The scale and zero point to quantize a tensor as quint8.
+struct QuantParams {
+  double scale = 1.0;
+  std::int64_t zero_point = 0;
+};
+
+// A post-training INT8 quantization of the residual tower of a FoldedNet for
+// CPU inference, which is where almost all of the compute goes. The weights are
+// quantized per output channel, and the activations per tensor with ranges
+// calibrated by running the float network on a set of positions.
+//
+// The input convolution and the heads run in float. The input planes include
+// the move counters, whose range would leave too few levels for the binary
+// piece planes, and the heads only take two of the convolutions.
+class QuantizedNet : public InferenceNet {
+public:
+  // Quantizes |net| with activation ranges calibrated on |calibration_inputs|,
+  // a tensor of encoded positions of dimension (N, 119, 8, 8). Throws an
+  // exception if there are no calibration inputs.
+  QuantizedNet(const FoldedNet& net, const torch::Tensor& calibration_inputs);
+
+  // Runs the network under inference mode. Note that |x| is expected to be on
+  // the CPU.
+  std::pair<torch::Tensor, torch::Tensor>
+  predict(torch::Tensor x) const override;
+
+  torch::Device
+  device() const override
+  { return torch::kCPU; }
+
+private:
+  // A convolution packed for the quantized kernels, and the quantization
+  // parameters of its output.
+  struct QuantizedConv {
+    c10::IValue packed;
+    QuantParams out;
+  };
+
+  struct ResBlock {
+    QuantizedConv conv1;
+    QuantizedConv conv2;
+    // The quantization parameters of the output of the skip connection.
+    QuantParams out;
+  };
+
+  // Packs |conv| with int8 weights for the quantized kernels.
+  static QuantizedConv
+  pack(const FoldedConv& conv, QuantParams out);
+
+  // The float network on the CPU, used for calibration, the input convolution
+  // and the heads.
+  FoldedNet float_net;
+
+  // The quantization parameters of the input to the residual tower.
+  QuantParams tower_params;
+  std::vector<ResBlock> res_blocks;
+};
+
+// Encodes up to |num_positions| positions from |data_set| on the CPU, to use as
+// calibration inputs for a QuantizedNet.
+torch::Tensor
+calibration_inputs(ChessDataSet& data_set, std::size_t num_positions);
+
+} // namespace blunder
@@ -21,6 +21,8 @@ public:
     : rand_fn(seed),
       rand_value_fn(-1.0, 1.0) {}
 
+  using Search::run;
+
   SearchResult
   run(const EvalBoardPath& board_path) const override;
 
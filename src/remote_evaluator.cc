@@ -0,0 +1,56 @@
+#include "remote_evaluator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include <torch/torch.h>
+
+namespace blunder {
+
+Prediction
+RemoteEvaluator::predict(const EvalBoardPath& board_path) const
+{
+  auto root = board_path.root();
+  if (not root)
+    throw std::invalid_argument("board_path should have at least one board.");
+
+  c10::InferenceMode inference_mode;
+
+  const auto& layout = channel->layout();
+  auto input = tensor_encoder->encode_state(board_path)
+                 .to(torch::kCPU, torch::kFloat)
+                 .contiguous();
+  if (input.numel() != layout.input_size)
+    throw std::invalid_argument("The position does not fit the channel.");
+
+  const auto slot = channel->acquire();
+  const auto* input_data = input.data_ptr<float>();
+  std::copy(input_data, input_data + layout.input_size,
+            channel->input(slot).begin());
+  channel->submit(slot);
+
+  // The slot is only released once the server replied, since the server
+  // writes to it until then.
+  channel->wait(slot);
+
+  // The policy is copied out of the slot, so that the slot is released before
+  // the slower decoding.
+  auto policy = channel->policy(slot);
+  auto policy_tensor = torch::from_blob(
+      const_cast<float*>(policy.data()),
+      {1, static_cast<std::int64_t>(layout.policy_size / 64), 8, 8}).clone();
+  auto value_tensor = torch::full({1, 1}, channel->value(slot));
+  channel->release(slot);
+
+  auto decoded_moves = tensor_decoder->decode(
+      *root, std::move(policy_tensor), std::move(value_tensor));
+
+  return Prediction{
+    .move_probs=std::move(decoded_moves.move_probs),
+    .value=decoded_moves.value
+  };
+}
+
+} // namespace blunder
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <utility>
+
+#include "board_path.h"
+#include "evaluator.h"
+#include "inference_channel.h"
+#include "tensor_decoder.h"
+#include "tensor_encoder.h"
+
+namespace blunder {
+
+// Evaluates positions by sending them to an InferenceServer in another process
+// through |channel|. The positions are encoded and the replies decoded in the
+// client, so the server only runs the network. It is safe to use from
+// multiple threads, e.g. with ParallelSearch.
+class RemoteEvaluator : public Evaluator {
+public:
+  RemoteEvaluator(
+      std::shared_ptr<InferenceChannel> channel,
+      std::shared_ptr<TensorDecoder> tensor_decoder,
+      std::shared_ptr<TensorEncoder> tensor_encoder)
+    : channel(std::move(channel)),
+      tensor_decoder(std::move(tensor_decoder)),
+      tensor_encoder(std::move(tensor_encoder))
+  {
+    assert(this->channel);
+    assert(this->tensor_decoder);
+    assert(this->tensor_encoder);
+  }
+
+  // Throws an exception if the encoded position does not fit the channel, or
+  // if the server closes the channel.
+  Prediction
+  predict(const EvalBoardPath& board_path) const override;
+
+private:
+  std::shared_ptr<InferenceChannel> channel;
+  std::shared_ptr<TensorDecoder> tensor_decoder;
+  std::shared_ptr<TensorEncoder> tensor_encoder;
+};
+
+} // namespace blunder
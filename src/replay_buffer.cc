@@ -0,0 +1,107 @@
+#include "replay_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "coding_util.h"
+#include "color.h"
+#include "game_result.h"
+#include "packed_board.h"
+
+namespace blunder {
+
+ReplayBuffer::ReplayBuffer(
+    std::size_t capacity,
+    ReplaySampling sampling,
+    std::uint64_t seed)
+  : max_size(capacity),
+    sampling(sampling),
+    rand_gen(seed)
+{
+  if (not capacity)
+    throw std::invalid_argument("capacity must be non-zero.");
+}
+
+void
+ReplayBuffer::add(TrainingPosition position)
+{
+  if (positions.size() < max_size) {
+    positions.push_back(std::move(position));
+    return;
+  }
+
+  // The buffer is full, so we overwrite the oldest position.
+  positions[head] = std::move(position);
+  head = (head + 1) % max_size;
+}
+
+void
+ReplayBuffer::add(const GameResult& game_result)
+{
+  auto boards = game_result.replay();
+
+  for (std::size_t i = 0; i < game_result.plies.size(); ++i) {
+    const auto& ply = game_result.plies[i];
+
+    // Moves without visit counts, e.g. from a human player, do not have a
+    // policy target.
+    if (ply.policy.empty())
+      continue;
+
+    const auto& board = boards[i];
+
+    // Compute the value from the perspective of the player moving next.
+    float value = 0;
+    if (game_result.winner == Color::White)
+      value = board.is_white_next() ? 1 : -1;
+    else if (game_result.winner == Color::Black)
+      value = board.is_white_next() ? -1 : 1;
+
+    add(TrainingPosition{
+      .board=PackedBoard::from(board),
+      .policy=ply.policy,
+      .value=value,
+      .policy_target=ply.policy_target
+    });
+  }
+}
+
+std::vector<TrainingPosition>
+ReplayBuffer::sample(std::size_t n) const
+{
+  std::vector<TrainingPosition> samples;
+  if (positions.empty())
+    return samples;
+
+  samples.reserve(n);
+  for (std::size_t i = 0; i < n; ++i)
+    samples.push_back((*this)[sample_index()]);
+
+  return samples;
+}
+
+std::size_t
+ReplayBuffer::sample_index() const
+{
+  const auto n = positions.size();
+
+  if (sampling == ReplaySampling::Uniform) {
+    std::uniform_int_distribution<std::size_t> dist(0, n-1);
+    return dist(rand_gen);
+  }
+
+  // Sample from a linearly increasing density by inverting its CDF, which
+  // keeps sampling constant time regardless of the size of the window.
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  auto index = static_cast<std::size_t>(n * std::sqrt(dist(rand_gen)));
+  return std::min(index, n-1);
+}
+
+} // namespace blunder
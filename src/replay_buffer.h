@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "coding_util.h"
+#include "game_result.h"
+#include "packed_board.h"
+
+namespace blunder {
+
+// Determines how positions are sampled from the ReplayBuffer.
+enum class ReplaySampling {
+  // Every position in the window is equally likely to be sampled.
+  Uniform,
+  // The probability of sampling a position increases linearly with how recent
+  // it is, i.e. the newest position is sampled about twice as often as the
+  // position in the middle of the window, and the oldest is almost never
+  // sampled.
+  Recency
+};
+
+// A position used as a training example, i.e. the position, the visit counts
+// from the search at the position, and the outcome of the game from the
+// perspective of the player moving next.
+struct TrainingPosition {
+  PackedBoard board;
+  std::vector<PolicyEntry> policy;
+  float value = 0;
+  // False if the visit counts are from a cheap search, in which case the
+  // position is only a value target.
+  bool policy_target = true;
+};
+
+// A bounded buffer with the most recent training positions, which allows us to
+// train models on positions from multiple training sessions rather than only on
+// the games from the current session. The buffer is implemented as a ring
+// buffer, such that adding a position when the buffer is full evicts the oldest
+// position in constant time.
+class ReplayBuffer {
+public:
+  ReplayBuffer() = default;
+
+  // Initializes the buffer with the maximum number of positions to hold, the
+  // sampling strategy, and a seed for the random number generator used for
+  // sampling.
+  ReplayBuffer(
+      std::size_t capacity,
+      ReplaySampling sampling = ReplaySampling::Uniform,
+      std::uint64_t seed = 0);
+
+  // Adds |position| to the buffer, evicting the oldest position if the buffer
+  // is full.
+  void
+  add(TrainingPosition position);
+
+  // Adds all the positions from |game_result| to the buffer.
+  void
+  add(const GameResult& game_result);
+
+  // Samples |n| positions with replacement. Returns an empty vector if the
+  // buffer is empty.
+  std::vector<TrainingPosition>
+  sample(std::size_t n) const;
+
+  // Returns the position at |index|, where 0 is the oldest position in the
+  // buffer.
+  const TrainingPosition&
+  operator[](std::size_t index) const noexcept
+  { return positions[(head + index) % positions.size()]; }
+
+  // Returns the number of positions in the buffer.
+  std::size_t
+  size() const noexcept
+  { return positions.size(); }
+
+  bool
+  empty() const noexcept
+  { return positions.empty(); }
+
+  // Returns the maximum number of positions that the buffer can hold.
+  std::size_t
+  capacity() const noexcept
+  { return max_size; }
+
+private:
+  // Returns the index, relative to the oldest position, of a random position
+  // chosen with the sampling strategy.
+  std::size_t
+  sample_index() const;
+
+  std::vector<TrainingPosition> positions;
+
+  // The index of the oldest position once the buffer is full.
+  std::size_t head = 0;
+  std::size_t max_size = 0;
+  ReplaySampling sampling = ReplaySampling::Uniform;
+  mutable std::mt19937_64 rand_gen;
+};
+
+} // namespace blunder
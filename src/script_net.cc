@@ -0,0 +1,113 @@
+#include "script_net.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace blunder {
+namespace {
+
+namespace fs = std::filesystem;
+
+using ::torch::Tensor;
+
+// Registers the weights and bias of |conv| as parameters named |name|_w and
+// |name|_b, and returns the TorchScript expression for the convolution of
+// |input|.
+std::string
+script_conv(
+    torch::jit::Module& module,
+    const FoldedConv& conv,
+    std::string_view name,
+    std::string_view input)
+{
+  auto weight = std::format("{}_w", name);
+  auto bias = std::format("{}_b", name);
+  module.register_parameter(weight, conv.weight, /*is_buffer=*/false);
+  module.register_parameter(bias, conv.bias, /*is_buffer=*/false);
+  return std::format("torch.conv2d({}, self.{}, self.{}, [1, 1], [{}, {}])",
+                     input, weight, bias, conv.padding, conv.padding);
+}
+
+} // namespace
+
+ScriptNet::ScriptNet(const fs::path& file_name, torch::Device device)
+  : ScriptNet(torch::jit::load(file_name.string(), device), device)
+{}
+
+ScriptNet::ScriptNet(torch::jit::Module module, torch::Device device)
+  : module(std::move(module)),
+    module_device(device)
+{
+  this->module.eval();
+}
+
+torch::jit::Module
+ScriptNet::export_module(const FoldedNet& net)
+{
+  torch::NoGradGuard no_grad;
+  torch::jit::Module module("AlphaZeroNet");
+
+  // The residual tower is unrolled in the source of the forward method, since
+  // freezing inlines every weight as a constant anyway.
+  std::string src;
+  src.reserve(8192);
+  auto out = std::back_inserter(src);
+
+  std::format_to(out, "def forward(self, x):\n");
+  std::format_to(out, "    out = torch.relu({})\n",
+                 script_conv(module, net.input_conv, "input", "x"));
+
+  for (std::size_t i = 0; i < net.res_blocks.size(); ++i) {
+    const auto& block = net.res_blocks[i];
+    std::format_to(out, "    res = torch.relu({})\n",
+        script_conv(module, block.conv1, std::format("res{}_1", i), "out"));
+    std::format_to(out, "    out = torch.relu({} + out)\n",
+        script_conv(module, block.conv2, std::format("res{}_2", i), "res"));
+  }
+
+  std::format_to(out, "    pol = torch.relu({})\n",
+                 script_conv(module, net.policy_conv1, "policy1", "out"));
+  std::format_to(out, "    pol = {}\n",
+                 script_conv(module, net.policy_conv2, "policy2", "pol"));
+
+  module.register_parameter("fc1_w", net.value_fc1_weight, false);
+  module.register_parameter("fc1_b", net.value_fc1_bias, false);
+  module.register_parameter("fc2_w", net.value_fc2_weight, false);
+  module.register_parameter("fc2_b", net.value_fc2_bias, false);
+
+  std::format_to(out, "    val = torch.relu({})\n",
+                 script_conv(module, net.value_conv, "value", "out"));
+  std::format_to(out, "    val = torch.flatten(val, 1)\n");
+  std::format_to(out,
+      "    val = torch.relu(torch.linear(val, self.fc1_w, self.fc1_b))\n");
+  std::format_to(out,
+      "    val = torch.tanh(torch.linear(val, self.fc2_w, self.fc2_b))\n");
+  std::format_to(out, "    return pol, val\n");
+
+  module.define(src);
+  module.eval();
+
+  auto frozen = torch::jit::freeze(module);
+  return torch::jit::optimize_for_inference(frozen);
+}
+
+void
+ScriptNet::save(const FoldedNet& net, const fs::path& file_name)
+{ export_module(net).save(file_name.string()); }
+
+std::pair<Tensor, Tensor>
+ScriptNet::predict(Tensor x) const
+{
+  c10::InferenceMode inference_mode;
+
+  auto outputs = module.forward({std::move(x)}).toTuple();
+  const auto& elements = outputs->elements();
+  return {elements[0].toTensor(), elements[1].toTensor()};
+}
+
+} // namespace blunder
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <filesystem>
+#include <utility>
+
+#include <torch/script.h>
+#include <torch/torch.h>
+
+#include "folded_net.h"
+#include "inference_net.h"
+
+namespace blunder {
+
+// An InferenceNet that runs a frozen TorchScript module exported from a
+// FoldedNet, which lets inference-only processes load the network from a single
+// file without building the AlphaZeroNet modules, and removes the eager-mode
+// dispatch overhead. Freezing inlines the weights as constants, which allows
+// the graph optimizations for inference to fuse and pre-pack operators.
+class ScriptNet : public InferenceNet {
+public:
+  // Loads a module saved with ScriptNet::save onto |device|.
+  explicit
+  ScriptNet(
+      const std::filesystem::path& file_name,
+      torch::Device device = torch::kCPU);
+
+  // Initializes the ScriptNet from a module that is already loaded, e.g. from
+  // export_module.
+  ScriptNet(torch::jit::Module module, torch::Device device);
+
+  // Scripts the forward pass of |net|, then freezes and optimizes the module
+  // for inference. Note that the optimizations target the CPU, so the module
+  // is meant to run on the CPU.
+  static torch::jit::Module
+  export_module(const FoldedNet& net);
+
+  // Exports |net| with export_module and saves it to |file_name|.
+  static void
+  save(const FoldedNet& net, const std::filesystem::path& file_name);
+
+  // Runs the module under inference mode.
+  std::pair<torch::Tensor, torch::Tensor>
+  predict(torch::Tensor x) const override;
+
+  torch::Device
+  device() const override
+  { return module_device; }
+
+private:
+  // Running a method is not const in the module API, but it does not modify
+  // the frozen module.
+  mutable torch::jit::Module module;
+  torch::Device module_device;
+};
+
+} // namespace blunder
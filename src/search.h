@@ -5,6 +5,7 @@
 #include "board.h"
 #include "board_path.h"
 #include "move.h"
+#include "search_limits.h"
 #include "search_result.h"
 
 namespace blunder {
@@ -17,6 +18,15 @@ public:
   // Runs a game search.
   virtual SearchResult
   run(const EvalBoardPath& board) const = 0;
+
+  // Runs a game search that stops at |limits|. By default the limits are
+  // ignored, for searches that take a fixed amount of work.
+  virtual SearchResult
+  run(const EvalBoardPath& board, const SearchLimits& limits) const
+  {
+    (void)limits;
+    return run(board);
+  }
 };
 
 } // namespace blunder
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stop_token>
+
+#include "time_types.h"
+
+namespace blunder {
+
+// The limits of a single search. The search stops as soon as it reaches any of
+// the limits that are set, or when a stop is requested through |stop_token|,
+// e.g. from the thread that reads commands from a GUI. A limit of zero is not
+// set.
+struct SearchLimits {
+  // The maximum number of simulations.
+  unsigned simulations = 0;
+
+  // The maximum number of nodes visited, as counted in
+  // SearchResult::nodes_visited.
+  unsigned nodes = 0;
+
+  // The maximum time of the search.
+  Milliseconds time{0};
+
+  // The maximum depth in plies of a search that deepens iteratively, e.g.
+  // AlphaBeta. Mcts ignores it, so it does not count as a limit in
+  // is_unbounded.
+  unsigned depth = 0;
+
+  // Stops the search when a stop is requested from another thread.
+  std::stop_token stop_token{};
+
+  // Stops the search before the simulation limit once the remaining
+  // simulations cannot change the most visited move, i.e. the best move is the
+  // same, but the moves other than the best get fewer visits.
+  bool stop_when_decided = true;
+
+  // Adds Dirichlet noise to the priors of the root to encourage exploration.
+  // Cheap searches turn it off, since they need all their simulations to pick a
+  // good move.
+  bool root_noise = true;
+
+  // Returns true if the search would never stop, i.e. none of the limits is
+  // set and a stop cannot be requested.
+  bool
+  is_unbounded() const noexcept
+  {
+    return not simulations and not nodes and time == Milliseconds(0)
+           and not stop_token.stop_possible();
+  }
+};
+
+} // namespace blunder
@@ -55,15 +55,34 @@ struct SearchResult {
   // The expected value of winning from this position for the current player.
   float value = 0;
 
+  // False if the search did not evaluate the position, e.g. when there is only
+  // one legal move, in which case the value is unknown and should be skipped.
+  bool has_value = true;
+
   // Total nodes searched, i.e. nodes that are expanded.
   unsigned nodes_expanded = 0;
 
   // Total nodes visited, including repeat visits.
   unsigned nodes_visited = 0;
 
+  // Total simulations run from the root.
+  unsigned simulations = 0;
+
+  // The simulations left in the simulation limit when the search stopped
+  // because they could not change the best move.
+  unsigned simulations_saved = 0;
+
+  // The visits of the root that were kept from an earlier search, e.g. from
+  // pondering on the opponent's turn.
+  unsigned reused_visits = 0;
+
   // The maximum depth of a branch explored during search.
   unsigned depth = 0;
 
+  // False if the search was a cheap search, whose visit counts are too noisy to
+  // be used as a policy training target. See PlayoutCap.
+  bool policy_target = true;
+
   // Average number of milliseconds per evaluation of node.
   float millis_per_eval = 0;
 
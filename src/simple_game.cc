@@ -1,13 +1,19 @@
 #include "simple_game.h"
 
+#include <cmath>
 #include <iostream>
 #include <optional>
+#include <random>
+#include <ranges>
 #include <utility>
+#include <vector>
 
 #include "board.h"
 #include "board_path.h"
+#include "game_result.h"
 #include "move.h"
 #include "search_result.h"
+#include "tablebase.h"
 
 namespace blunder {
 
@@ -15,38 +21,117 @@ GameResult
 SimpleGame::play()
 {
   GameResult game_result;
-  game_result.moves.reserve(max_moves);
+  game_result.plies.reserve(max_moves);
   game_result.game_start = Board::new_board();
+
+  // The boards are only kept while the game is played, since the game path
+  // points to them. Reserve upfront so the pointers are not invalidated.
+  std::vector<Board> boards;
+  boards.reserve(max_moves + 1);
   GameBoardPath game_path;
-  game_path.push(game_result.game_start);
+  game_path.push(boards.emplace_back(game_result.game_start));
 
   int move_num = 1;
+  std::optional<Wdl> tablebase_wdl;
+
+  // A fraction of the games are played out without resignations, to check
+  // whether the resignations would have been right.
+  const bool may_resign = adjudication.is_resign_enabled()
+    and not std::bernoulli_distribution(adjudication.no_resign_prob)(rand_gen);
+  std::optional<Color> resigned;
+  bool drawn = false;
+
+  // The number of plies in a row that are below the resign threshold for each
+  // color, and that are within the draw threshold for both colors.
+  unsigned losing_plies[2] = {0, 0};
+  unsigned drawn_plies = 0;
 
   while (not game_path.fast_back().is_terminal()) {
-    if (game_path.is_full())
+    if (game_path.is_full() or game_result.plies.size() >= max_moves)
       break;
 
     const auto& board = game_path.fast_back();
 
-    auto play_result = board.is_white_next()
+    // The outcome of a position in the tablebases is known, so there is no
+    // need to play it out.
+    if (tablebase and (tablebase_wdl = tablebase->probe_wdl(board)))
+      break;
+
+    const auto mover = board.is_white_next() ? Color::White : Color::Black;
+    auto play_result = mover == Color::White
        ? wplayer->make_move(game_path)
        : bplayer->make_move(game_path);
 
-    const auto& pr = game_result.moves.emplace_back(std::move(play_result));
-    const auto& next_board = pr.best.board;
+    const auto& pr = game_result.plies.emplace_back(
+        PlyRecord::from(play_result));
 
     if (verbose) {
       std::cout << "move " << move_num++ << " -> "
-                << *next_board.last_move()
+                << pr.mv
                 << "  value=" << pr.value << std::endl;
     }
 
+    auto& next_board = boards.emplace_back(std::move(play_result.best.board));
+
+    // Check the new position against the earlier ones so that a game drawn by
+    // repetition ends right away.
+    auto earlier = boards | std::views::reverse | std::views::drop(1);
+    next_board.find_repetition(earlier);
     game_path.push(next_board);
+
+    // A game that ended by the rules is not adjudicated, and a ply without a
+    // value, e.g. a forced move, leaves the counts as they are.
+    if (next_board.is_terminal() or not pr.has_value)
+      continue;
+
+    // The player resigns after its move, which is kept in the game, since its
+    // search is a training target like any other.
+    if (adjudication.is_resign_enabled()) {
+      auto& losing = losing_plies[static_cast<int>(mover)];
+      losing = pr.value < adjudication.resign_threshold ? losing + 1 : 0;
+      if (losing >= adjudication.resign_plies) {
+        if (may_resign) {
+          resigned = mover;
+          break;
+        }
+        if (not game_result.would_resign)
+          game_result.would_resign = mover;
+      }
+    }
+
+    if (adjudication.is_draw_enabled()) {
+      drawn_plies = std::abs(pr.value) <= adjudication.draw_threshold
+        ? drawn_plies + 1
+        : 0;
+      if (drawn_plies >= adjudication.draw_plies
+          and game_result.plies.size() >= adjudication.draw_min_plies) {
+        drawn = true;
+        break;
+      }
+    }
   }
 
   const auto& board = game_path.fast_back();
-  if (board.is_mate())
-    game_result.winner = board.is_white_next() ? Color::Black : Color::White;
+  const auto next = board.is_white_next() ? Color::White : Color::Black;
+  const auto other = next == Color::White ? Color::Black : Color::White;
+  if (resigned) {
+    game_result.game_end = GameEnd::Resignation;
+    game_result.winner = *resigned == Color::White
+      ? Color::Black
+      : Color::White;
+  } else if (drawn) {
+    game_result.game_end = GameEnd::DrawAdjudication;
+  } else if (tablebase_wdl) {
+    game_result.game_end = GameEnd::Tablebase;
+    if (*tablebase_wdl == Wdl::Win)
+      game_result.winner = next;
+    else if (*tablebase_wdl == Wdl::Loss)
+      game_result.winner = other;
+  } else if (board.is_mate()) {
+    game_result.winner = other;
+  } else if (not board.is_terminal()) {
+    game_result.game_end = GameEnd::MoveLimit;
+  }
 
   return game_result;
 }
@@ -1,13 +1,45 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <random>
 #include <utility>
 
 #include "game.h"
 #include "player.h"
+#include "tablebase.h"
 
 namespace blunder {
 
+// Ends games whose outcome is clear from the values of the searches, rather
+// than playing them out to mate, a draw or the move limit.
+struct Adjudication {
+  // A player resigns once the value of its searches is below
+  // |resign_threshold| for |resign_plies| of its moves in a row. The values
+  // are in [-1,1], so the default threshold never resigns.
+  float resign_threshold = -1;
+  unsigned resign_plies = 2;
+
+  // The fraction of the games played out without resignations, which
+  // measures how many of the resignations would have been wrong.
+  float no_resign_prob = 0.1;
+
+  // The game is a draw once the values of both players are within
+  // |draw_threshold| of zero for |draw_plies| plies in a row, but not before
+  // |draw_min_plies| plies. Disabled if |draw_plies| is zero.
+  float draw_threshold = 0.05;
+  unsigned draw_plies = 0;
+  unsigned draw_min_plies = 60;
+
+  bool
+  is_resign_enabled() const noexcept
+  { return resign_threshold > -1 and resign_plies; }
+
+  bool
+  is_draw_enabled() const noexcept
+  { return draw_plies; }
+};
+
 // TODO: modify or extend interface to play games from random positions.
 // Implements a simple chess game between two players.
 class SimpleGame : public Game {
@@ -31,6 +63,22 @@ public:
   flip_colors()
   { wplayer.swap(bplayer); }
 
+  // Ends the game as soon as the position is in |tablebase|, with the winner
+  // of perfect play. Disabled by default.
+  void
+  set_tablebase(std::shared_ptr<const Tablebase> tablebase)
+  { this->tablebase = std::move(tablebase); }
+
+  // Ends the games by resignation or by a draw with |adjudication|, where
+  // |seed| seeds the choice of the games played without resignations.
+  // Disabled by default.
+  void
+  set_adjudication(Adjudication adjudication, std::uint64_t seed)
+  {
+    this->adjudication = adjudication;
+    rand_gen.seed(seed);
+  }
+
 private:
   // Player for white pieces.
   std::unique_ptr<Player> wplayer;
@@ -38,6 +86,9 @@ private:
   // Player for black pieces.
   std::unique_ptr<Player> bplayer;
 
+  std::shared_ptr<const Tablebase> tablebase;
+  Adjudication adjudication;
+  std::mt19937_64 rand_gen;
   unsigned max_moves;
   bool verbose = false;
 
@@ -9,9 +9,19 @@
 #include "alpha_zero_encoder.h"
 #include "alpha_zero_evaluator.h"
 #include "blunder_player.h"
+#include "evaluator.h"
+#include "folded_net.h"
+#include "inference_channel.h"
+#include "inference_evaluator.h"
+#include "inference_net.h"
 #include "mcts.h"
 #include "net.h"
+#include "opening_book.h"
 #include "player.h"
+#include "quantized_net.h"
+#include "remote_evaluator.h"
+#include "simple_game.h"
+#include "tablebase.h"
 #include "tensor_decoder.h"
 #include "tensor_encoder.h"
 
@@ -39,6 +49,13 @@ SimpleGameBuilder::set_net(std::shared_ptr<AlphaZeroNet> net)
   return *this;
 }
 
+SimpleGameBuilder&
+SimpleGameBuilder::set_channel(std::shared_ptr<InferenceChannel> channel)
+{
+  this->channel = std::move(channel);
+  return *this;
+}
+
 SimpleGameBuilder&
 SimpleGameBuilder::set_max_moves(unsigned max_moves)
 {
@@ -53,6 +70,37 @@ SimpleGameBuilder::set_simulations(unsigned simulations)
   return *this;
 }
 
+SimpleGameBuilder&
+SimpleGameBuilder::set_playout_cap(PlayoutCap playout_cap)
+{
+  this->playout_cap = playout_cap;
+  return *this;
+}
+
+SimpleGameBuilder&
+SimpleGameBuilder::set_opening_book(
+    std::shared_ptr<const OpeningBook> book,
+    BookOptions book_options)
+{
+  this->book = std::move(book);
+  this->book_options = book_options;
+  return *this;
+}
+
+SimpleGameBuilder&
+SimpleGameBuilder::set_tablebase(std::shared_ptr<const Tablebase> tablebase)
+{
+  this->tablebase = std::move(tablebase);
+  return *this;
+}
+
+SimpleGameBuilder&
+SimpleGameBuilder::set_adjudication(Adjudication adjudication)
+{
+  this->adjudication = adjudication;
+  return *this;
+}
+
 SimpleGameBuilder&
 SimpleGameBuilder::set_white_seed(std::uint64_t white_seed)
 {
@@ -88,41 +136,113 @@ SimpleGameBuilder::set_verbose(bool verbose)
   return *this;
 }
 
+SimpleGameBuilder&
+SimpleGameBuilder::set_eval_net(EvalNet eval_net)
+{
+  this->eval_net = eval_net;
+  return *this;
+}
+
+SimpleGameBuilder&
+SimpleGameBuilder::set_calibration_inputs(torch::Tensor calibration_inputs)
+{
+  this->calibration_inputs = std::move(calibration_inputs);
+  return *this;
+}
+
+SimpleGameBuilder&
+SimpleGameBuilder::set_memory_format(torch::MemoryFormat memory_format)
+{
+  this->memory_format = memory_format;
+  return *this;
+}
+
 SimpleGame
 SimpleGameBuilder::build()
 {
-  if (not white_net)
+  if (not channel and not white_net)
     throw std::invalid_argument("white_net is null.");
-  if (not black_net)
+  if (not channel and not black_net)
     throw std::invalid_argument("black_net is null.");
   if (not max_moves)
     throw std::invalid_argument("max_moves is zero.");
   if (not simulations)
     throw std::invalid_argument("simulations is zero.");
+  if (playout_cap.full_search_prob <= 0 or playout_cap.full_search_prob > 1)
+    throw std::invalid_argument("full_search_prob must be in range (0,1].");
+  if (playout_cap.full_search_prob < 1 and not playout_cap.fast_simulations)
+    throw std::invalid_argument("fast_simulations is zero.");
+  if (playout_cap.fast_simulations >= simulations)
+    throw std::invalid_argument("fast_simulations must be below simulations.");
+  if (book and book_options.temperature < 0)
+    throw std::invalid_argument("book temperature must be non-negative.");
+  if (adjudication.resign_threshold < -1 or adjudication.resign_threshold >= 1)
+    throw std::invalid_argument("resign_threshold must be in range [-1,1).");
+  if (adjudication.no_resign_prob < 0 or adjudication.no_resign_prob > 1)
+    throw std::invalid_argument("no_resign_prob must be in range [0,1].");
+  if (adjudication.draw_threshold < 0 or adjudication.draw_threshold >= 1)
+    throw std::invalid_argument("draw_threshold must be in range [0,1).");
+  if (not channel and eval_net == EvalNet::Int8
+      and not calibration_inputs.defined())
+    throw std::invalid_argument("calibration_inputs are needed for Int8.");
 
   if (not decoder)
     decoder = std::make_shared<AlphaZeroDecoder>();
   if (not encoder)
     encoder = std::make_shared<AlphaZeroEncoder>();
 
-  auto wp = create_player(white_net, white_seed);
-  auto bp = create_player(black_net, black_seed);
+  // Share the evaluator when both players use the same network, so that the
+  // network is only exported once.
+  auto white_eval = create_evaluator(white_net);
+  auto black_eval = white_net == black_net
+    ? white_eval
+    : create_evaluator(black_net);
+
+  auto wp = create_player(std::move(white_eval), white_seed);
+  auto bp = create_player(std::move(black_eval), black_seed);
   SimpleGame simple_game(std::move(wp), std::move(bp), max_moves);
+  simple_game.set_tablebase(tablebase);
+  simple_game.set_adjudication(adjudication, white_seed ^ black_seed);
   simple_game.verbose = verbose;
 
   return simple_game;
 }
 
+std::shared_ptr<Evaluator>
+SimpleGameBuilder::create_evaluator(std::shared_ptr<AlphaZeroNet> net)
+{
+  if (channel)
+    return std::make_shared<RemoteEvaluator>(channel, decoder, encoder);
+
+  switch (eval_net) {
+    case EvalNet::Eager:
+      return std::make_shared<AlphaZeroEvaluator>(
+          std::move(net), decoder, encoder, memory_format);
+    case EvalNet::Folded:
+      return std::make_shared<InferenceEvaluator>(
+          std::make_shared<FoldedNet>(*net, memory_format), decoder, encoder);
+    case EvalNet::Int8:
+      return std::make_shared<InferenceEvaluator>(
+          std::make_shared<QuantizedNet>(FoldedNet(*net), calibration_inputs),
+          decoder, encoder);
+  }
+  throw std::invalid_argument("Unknown eval_net.");
+}
+
 std::unique_ptr<Player>
 SimpleGameBuilder::create_player(
-    std::shared_ptr<AlphaZeroNet> net,
+    std::shared_ptr<Evaluator> evaluator,
     std::uint64_t seed)
 {
-  auto evaluator = std::make_shared<AlphaZeroEvaluator>(
-          std::move(net), decoder, encoder);
   auto mcts = std::make_shared<Mcts>(
           std::move(evaluator), simulations, seed);
-  return std::make_unique<BlunderPlayer>(std::move(mcts));
+  if (tablebase)
+    mcts->set_tablebase(tablebase);
+  auto player = std::make_unique<BlunderPlayer>(
+      std::move(mcts), playout_cap, seed);
+  if (book)
+    player->set_opening_book(book, book_options);
+  return player;
 }
 
 } // namespace blunder
@@ -3,9 +3,17 @@
 #include <cstdint>
 #include <memory>
 
+#include <torch/torch.h>
+
+#include "blunder_player.h"
+#include "evaluator.h"
+#include "inference_channel.h"
+#include "inference_net.h"
 #include "net.h"
+#include "opening_book.h"
 #include "player.h"
 #include "simple_game.h"
+#include "tablebase.h"
 #include "tensor_decoder.h"
 #include "tensor_encoder.h"
 
@@ -22,12 +30,42 @@ public:
   SimpleGameBuilder&
   set_net(std::shared_ptr<AlphaZeroNet> net);
 
+  // Sets the channel of an InferenceServer that evaluates the positions of both
+  // players, instead of the networks, which are then not needed.
+  SimpleGameBuilder&
+  set_channel(std::shared_ptr<InferenceChannel> channel);
+
   SimpleGameBuilder&
   set_max_moves(unsigned max_moves);
 
   SimpleGameBuilder&
   set_simulations(unsigned simulations);
 
+  // Sets playout cap randomization, i.e. most moves are searched with
+  // |playout_cap.fast_simulations| simulations, and only a random fraction of
+  // the moves with the full number of simulations, which are the only moves
+  // marked as policy targets. Disabled by default.
+  SimpleGameBuilder&
+  set_playout_cap(PlayoutCap playout_cap);
+
+  // Sets the opening book that both players play from in the first plies of
+  // the game, see BlunderPlayer::set_opening_book. Disabled by default.
+  SimpleGameBuilder&
+  set_opening_book(
+      std::shared_ptr<const OpeningBook> book,
+      BookOptions book_options);
+
+  // Sets the tablebases that end the game when it reaches a position in the
+  // tables, and that score such positions in the searches of the players.
+  // Disabled by default.
+  SimpleGameBuilder&
+  set_tablebase(std::shared_ptr<const Tablebase> tablebase);
+
+  // Sets the resignations and the draws that end games early, see
+  // Adjudication. Disabled by default.
+  SimpleGameBuilder&
+  set_adjudication(Adjudication adjudication);
+
   SimpleGameBuilder&
   set_white_seed(std::uint64_t white_seed);
 
@@ -43,22 +81,50 @@ public:
   SimpleGameBuilder&
   set_verbose(bool verbose);
 
+  // Sets the kind of network used to evaluate positions. Defaults to a
+  // FoldedNet exported from the AlphaZeroNet when the game is built.
+  SimpleGameBuilder&
+  set_eval_net(EvalNet eval_net);
+
+  // Sets the positions used to calibrate the activation ranges of a
+  // QuantizedNet, which are required with EvalNet::Int8.
+  SimpleGameBuilder&
+  set_calibration_inputs(torch::Tensor calibration_inputs);
+
+  // Sets the layout of the weights and the activations of the Eager and Folded
+  // networks, e.g. channels last to run the convolutions on oneDNN on CPU. The
+  // weights are converted once when the game is built. Defaults to contiguous.
+  SimpleGameBuilder&
+  set_memory_format(torch::MemoryFormat memory_format);
+
   SimpleGame
   build();
 
 private:
 
+  std::shared_ptr<Evaluator>
+  create_evaluator(std::shared_ptr<AlphaZeroNet> net);
+
   std::unique_ptr<Player>
-  create_player(std::shared_ptr<AlphaZeroNet> net, std::uint64_t seed);
+  create_player(std::shared_ptr<Evaluator> evaluator, std::uint64_t seed);
 
   std::shared_ptr<AlphaZeroNet> white_net = nullptr;
   std::shared_ptr<AlphaZeroNet> black_net = nullptr;
   std::shared_ptr<TensorDecoder> decoder = nullptr;
   std::shared_ptr<TensorEncoder> encoder = nullptr;
+  std::shared_ptr<const OpeningBook> book = nullptr;
+  std::shared_ptr<const Tablebase> tablebase = nullptr;
+  std::shared_ptr<InferenceChannel> channel = nullptr;
+  torch::Tensor calibration_inputs;
   std::uint64_t white_seed = 0;
   std::uint64_t black_seed = 0;
   unsigned max_moves = 300;
   unsigned simulations = 800;
+  PlayoutCap playout_cap;
+  BookOptions book_options;
+  Adjudication adjudication;
+  EvalNet eval_net = EvalNet::Folded;
+  torch::MemoryFormat memory_format = torch::MemoryFormat::Contiguous;
   bool verbose = false;
 };
 
@@ -0,0 +1,598 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "color.h"
+#include "mapped_file.h"
+#include "piece_set.h"
+#include "pieces.h"
+
+namespace blunder {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A table file consists of a TableHeader followed by the values of the
+// positions, i.e. one byte per position in a DTM file, and two bits per
+// position in a WDL file.
+constexpr char kTableMagic[8] = {'B', 'L', 'N', 'D', 'T', 'B', 'L', 'E'};
+constexpr std::uint32_t kTableVersion = 1;
+
+enum class TableKind : std::uint32_t {
+  Dtm,
+  Wdl
+};
+
+struct TableHeader {
+  char magic[8];
+  std::uint32_t version = kTableVersion;
+  TableKind kind = TableKind::Dtm;
+  std::uint64_t positions = 0;
+  char key[16] = {};
+};
+
+// The codes of the WDL files.
+constexpr std::uint8_t kWdlDraw = 0;
+constexpr std::uint8_t kWdlWin = 1;
+constexpr std::uint8_t kWdlLoss = 2;
+constexpr std::uint8_t kWdlInvalid = 3;
+
+// The types of the pieces other than the king, in the order of the keys.
+constexpr Type kPieceTypes[] = {
+  Type::Queen,
+  Type::Rook,
+  Type::Bishop,
+  Type::Knight,
+  Type::Pawn
+};
+
+// The squares of the white king in the a1-d1-d4 triangle, which is where the
+// white king is in a table without pawns.
+constexpr unsigned kTriangle[] = {0, 1, 2, 3, 9, 10, 11, 18, 19, 27};
+
+unsigned
+file_of(unsigned square) noexcept
+{ return square & 7; }
+
+unsigned
+rank_of(unsigned square) noexcept
+{ return square >> 3; }
+
+// Returns the types of the pieces in |pieces| other than the king, in the
+// order of the keys.
+std::vector<Type>
+types_of(const PieceSet& pieces)
+{
+  std::vector<Type> types;
+  for (auto type : kPieceTypes) {
+    for (auto count = pieces.get(type).count(); count; --count)
+      types.push_back(type);
+  }
+  return types;
+}
+
+// Appends the squares of the pieces in |pieces| other than the king, in the
+// order of the keys.
+void
+append_squares(const PieceSet& pieces, std::vector<unsigned>& squares)
+{
+  for (auto type : kPieceTypes) {
+    for (auto bb = pieces.get(type); bb;)
+      squares.push_back(bb.first_bit_and_clear());
+  }
+}
+
+// Returns the number of squares of the white king in a table.
+unsigned
+king_squares(bool has_pawns) noexcept
+{ return has_pawns ? 32 : std::size(kTriangle); }
+
+// Returns the index of the position with the pieces on |squares|, i.e. the
+// white king, the black king, and the other pieces of |material| in its order.
+// The squares are mirrored such that the white king is on the left half of the
+// board, and without pawns, also on the lower half of the board and below the
+// a1-h8 diagonal. The pieces of the same type are sorted by square, and with
+// the white king on the diagonal, the index is the lower of the position and
+// the position mirrored across the diagonal, such that every position has a
+// single index.
+std::uint64_t
+index_of(
+    std::vector<unsigned> squares,
+    bool is_black_next,
+    const Material& material)
+{
+  auto transform = [&squares](auto fn) {
+    for (auto& square : squares)
+      square = fn(square);
+  };
+
+  auto transpose = [](unsigned square) {
+    return (file_of(square) << 3) | rank_of(square);
+  };
+
+  const unsigned kings = king_squares(material.pawns() > 0);
+  auto encode = [&](std::vector<unsigned> squares, std::uint64_t king) {
+    // The pieces of one player are ordered by type in the material.
+    auto first = squares.begin() + 2;
+    for (const auto* types : {&material.white, &material.black}) {
+      for (std::size_t i = 0; i < types->size();) {
+        auto j = i;
+        while (j < types->size() and (*types)[j] == (*types)[i])
+          ++j;
+        std::sort(first + i, first + j);
+        i = j;
+      }
+      first += types->size();
+    }
+
+    std::uint64_t index = is_black_next ? 1 : 0;
+    index = index * kings + king;
+    for (unsigned i = 1; i < squares.size(); ++i)
+      index = index * 64 + squares[i];
+    return index;
+  };
+
+  if (file_of(squares[0]) > 3)
+    transform([](unsigned square) { return square ^ 7; });
+
+  if (material.pawns()) {
+    const auto king = rank_of(squares[0]) * 4 + file_of(squares[0]);
+    return encode(std::move(squares), king);
+  }
+
+  if (rank_of(squares[0]) > 3)
+    transform([](unsigned square) { return square ^ 56; });
+  if (rank_of(squares[0]) > file_of(squares[0]))
+    transform(transpose);
+
+  const std::uint64_t king =
+    std::ranges::find(kTriangle, squares[0]) - std::begin(kTriangle);
+  const auto index = encode(squares, king);
+  if (rank_of(squares[0]) != file_of(squares[0]))
+    return index;
+
+  transform(transpose);
+  return std::min(index, encode(std::move(squares), king));
+}
+
+// Returns the code of a WDL file for a value of a DTM file.
+std::uint8_t
+wdl_code(std::uint8_t value) noexcept
+{
+  if (value == kInvalidDtm)
+    return kWdlInvalid;
+  if (not value)
+    return kWdlDraw;
+  return (value - 1) % 2 ? kWdlWin : kWdlLoss;
+}
+
+// Returns true if |left| is a better result than |right| for the player
+// moving next, i.e. a faster win or a slower loss.
+bool
+is_better(const TablebaseResult& left, const TablebaseResult& right) noexcept
+{
+  if (left.wdl != right.wdl)
+    return left.wdl > right.wdl;
+  if (left.wdl == Wdl::Win)
+    return left.dtm < right.dtm;
+  return left.dtm > right.dtm;
+}
+
+// Returns the result of |board| from the results of its children with
+// |probe_fn|, or nothing if a child is not found.
+template<typename ProbeFn>
+std::optional<TablebaseResult>
+best_child(const Board& board, ProbeFn probe_fn)
+{
+  std::optional<TablebaseResult> best;
+  for (const auto& child : board.next()) {
+    auto result = probe_fn(child);
+    if (not result)
+      return std::nullopt;
+
+    TablebaseResult mine;
+    if (result->wdl == Wdl::Win) {
+      mine = {.wdl=Wdl::Loss, .dtm=result->dtm + 1};
+    } else if (result->wdl == Wdl::Loss) {
+      mine = {.wdl=Wdl::Win, .dtm=result->dtm + 1};
+    }
+
+    if (not best or is_better(mine, *best))
+      best = mine;
+  }
+  return best;
+}
+
+// Writes |values| to a table file at |path|. The file is written to a
+// temporary file first and then renamed, such that processes that have the
+// old table mapped keep reading the old table.
+void
+write_table(
+    const fs::path& path,
+    TableKind kind,
+    const Material& material,
+    std::span<const std::uint8_t> values)
+{
+  TableHeader header;
+  std::memcpy(header.magic, kTableMagic, sizeof(kTableMagic));
+  header.kind = kind;
+  header.positions = material.positions();
+  const auto key = material.key();
+  assert(key.size() < sizeof(header.key));
+  std::ranges::copy(key, header.key);
+
+  auto tmp_path = path;
+  tmp_path += ".tmp";
+
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (not out)
+      throw std::runtime_error("Unable to open " + tmp_path.string());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(values.data()), values.size());
+
+    out.close();
+    if (not out)
+      throw std::runtime_error("Unable to write " + tmp_path.string());
+  }
+
+  fs::rename(tmp_path, path);
+}
+
+} // namespace
+
+std::uint8_t
+to_dtm_value(const TablebaseResult& result) noexcept
+{ return result.wdl == Wdl::Draw ? 0 : result.dtm + 1; }
+
+std::optional<TablebaseResult>
+from_dtm_value(std::uint8_t value) noexcept
+{
+  if (value == kInvalidDtm)
+    return std::nullopt;
+  if (not value)
+    return TablebaseResult{.wdl=Wdl::Draw, .dtm=0};
+
+  // The player moving next wins if the mate is on its own move.
+  const unsigned dtm = value - 1;
+  return TablebaseResult{.wdl=dtm % 2 ? Wdl::Win : Wdl::Loss, .dtm=dtm};
+}
+
+Material
+Material::from_key(std::string_view key)
+{
+  auto invalid = [key] {
+    return std::invalid_argument(
+        "Invalid material key: " + std::string(key));
+  };
+
+  auto separator = key.find('v');
+  if (separator == std::string_view::npos)
+    throw invalid();
+
+  auto parse_side = [&](std::string_view side) {
+    if (side.empty() or side.front() != 'K')
+      throw invalid();
+
+    std::vector<Type> types;
+    for (auto letter : side.substr(1)) {
+      auto type = std::ranges::find_if(kPieceTypes, [letter](Type type) {
+        return Piece(type).letter() == letter;
+      });
+      if (type == std::end(kPieceTypes))
+        throw invalid();
+      types.push_back(*type);
+    }
+
+    if (not std::ranges::is_sorted(types))
+      throw invalid();
+    return types;
+  };
+
+  return Material{
+    .white=parse_side(key.substr(0, separator)),
+    .black=parse_side(key.substr(separator + 1))
+  };
+}
+
+std::string
+Material::key() const
+{
+  std::string key = "K";
+  for (auto type : white)
+    key += Piece(type).letter();
+  key += "vK";
+  for (auto type : black)
+    key += Piece(type).letter();
+  return key;
+}
+
+unsigned
+Material::pawns() const noexcept
+{
+  return std::ranges::count(white, Type::Pawn)
+       + std::ranges::count(black, Type::Pawn);
+}
+
+bool
+Material::is_canonical() const noexcept
+{
+  if (white.size() != black.size())
+    return white.size() > black.size();
+  return not std::ranges::lexicographical_compare(black, white);
+}
+
+std::uint64_t
+Material::positions() const noexcept
+{
+  std::uint64_t positions = 2 * king_squares(pawns() > 0);
+  for (unsigned i = 1; i < men(); ++i)
+    positions *= 64;
+  return positions;
+}
+
+Tablebase::Tablebase(const fs::path& dir)
+{
+  for (const auto& entry : fs::directory_iterator(dir)) {
+    const auto extension = entry.path().extension();
+    if (extension == ".dtm" or extension == ".wdl")
+      load(entry.path());
+  }
+}
+
+void
+Tablebase::load(const fs::path& path)
+{
+  MappedFile file(path);
+  auto bytes = file.bytes();
+
+  TableHeader header;
+  if (bytes.size() < sizeof(header))
+    throw std::runtime_error("Truncated table file " + path.string());
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  if (std::memcmp(header.magic, kTableMagic, sizeof(kTableMagic)))
+    throw std::runtime_error("Not a table file " + path.string());
+  if (header.version != kTableVersion)
+    throw std::runtime_error("Unsupported table version " + path.string());
+  if (header.key[sizeof(header.key) - 1])
+    throw std::runtime_error("Invalid table key " + path.string());
+
+  const std::string key(header.key);
+  const auto material = Material::from_key(key);
+  if (header.positions != material.positions())
+    throw std::runtime_error("Wrong number of positions " + path.string());
+
+  const bool is_dtm = header.kind == TableKind::Dtm;
+  if (not is_dtm and header.kind != TableKind::Wdl)
+    throw std::runtime_error("Unknown table kind " + path.string());
+
+  const auto size = is_dtm ? header.positions : (header.positions + 3) / 4;
+  if (bytes.size() != sizeof(header) + size)
+    throw std::runtime_error("Truncated table file " + path.string());
+
+  auto& table = tables[key];
+  auto& table_file = is_dtm ? table.dtm_file : table.wdl_file;
+  table_file.emplace(std::move(file));
+  std::span<const std::uint8_t> values(
+      reinterpret_cast<const std::uint8_t*>(
+        table_file->bytes().data() + sizeof(header)),
+      size);
+  if (is_dtm)
+    table.dtm = values;
+  else
+    table.wdl = values;
+}
+
+bool
+Tablebase::has_table(std::string_view key) const
+{ return tables.contains(key); }
+
+std::optional<Wdl>
+Tablebase::probe_wdl(const Board& board) const
+{
+  if (board.all_bits().count() > kMaxMen)
+    return std::nullopt;
+  if (board.is_terminal())
+    return board.is_mate() ? Wdl::Loss : Wdl::Draw;
+
+  if (board.has_enpassant()) {
+    auto result = best_child(board, [this](const Board& child) {
+      auto wdl = probe_wdl(child);
+      return wdl
+        ? std::optional(TablebaseResult{.wdl=*wdl, .dtm=0})
+        : std::nullopt;
+    });
+    return result ? std::optional(result->wdl) : std::nullopt;
+  }
+
+  auto position = locate(board);
+  if (not position)
+    return std::nullopt;
+  auto iter = tables.find(position->key);
+  if (iter == tables.end())
+    return std::nullopt;
+
+  const auto& table = iter->second;
+  if (table.wdl.empty()) {
+    if (table.dtm.empty())
+      return std::nullopt;
+    auto result = from_dtm_value(table.dtm[position->index]);
+    return result ? std::optional(result->wdl) : std::nullopt;
+  }
+
+  const auto index = position->index;
+  switch ((table.wdl[index / 4] >> (2 * (index % 4))) & 3) {
+    case kWdlDraw:
+      return Wdl::Draw;
+    case kWdlWin:
+      return Wdl::Win;
+    case kWdlLoss:
+      return Wdl::Loss;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<TablebaseResult>
+Tablebase::probe(const Board& board) const
+{
+  if (board.all_bits().count() > kMaxMen)
+    return std::nullopt;
+  if (board.is_terminal()) {
+    return TablebaseResult{
+      .wdl=board.is_mate() ? Wdl::Loss : Wdl::Draw,
+      .dtm=0
+    };
+  }
+
+  if (board.has_enpassant()) {
+    return best_child(board, [this](const Board& child) {
+      return probe(child);
+    });
+  }
+
+  auto position = locate(board);
+  if (not position)
+    return std::nullopt;
+  auto iter = tables.find(position->key);
+  if (iter == tables.end() or iter->second.dtm.empty())
+    return std::nullopt;
+  return from_dtm_value(iter->second.dtm[position->index]);
+}
+
+std::optional<TablePosition>
+Tablebase::locate(const Board& board)
+{
+  if (board.all_bits().count() > kMaxMen)
+    return std::nullopt;
+  if (board.has_white_king_castle() or board.has_white_queen_castle()
+      or board.has_black_king_castle() or board.has_black_queen_castle())
+    return std::nullopt;
+
+  Material material{
+    .white=types_of(board.white()),
+    .black=types_of(board.black())
+  };
+  bool is_black_next = not board.is_white_next();
+
+  // Without a table for the material, the position is found in the table with
+  // the colors flipped, i.e. with the board mirrored vertically.
+  const bool flip = not material.is_canonical();
+  const auto& strong = flip ? board.black() : board.white();
+  const auto& weak = flip ? board.white() : board.black();
+
+  std::vector<unsigned> squares;
+  squares.reserve(kMaxMen);
+  squares.push_back(strong.king().first_bit());
+  squares.push_back(weak.king().first_bit());
+  append_squares(strong, squares);
+  append_squares(weak, squares);
+
+  if (flip) {
+    std::swap(material.white, material.black);
+    for (auto& square : squares)
+      square ^= 56;
+    is_black_next = not is_black_next;
+  }
+
+  return TablePosition{
+    .key=material.key(),
+    .index=index_of(std::move(squares), is_black_next, material)
+  };
+}
+
+std::optional<Board>
+Tablebase::board_at(const Material& material, std::uint64_t index)
+{
+  const bool has_pawns = material.pawns() > 0;
+  const unsigned men = material.men();
+
+  auto rest = index;
+  std::vector<unsigned> squares(men);
+  for (unsigned i = men - 1; i > 0; --i) {
+    squares[i] = rest % 64;
+    rest /= 64;
+  }
+  const unsigned king = rest % king_squares(has_pawns);
+  rest /= king_squares(has_pawns);
+  if (rest > 1)
+    return std::nullopt;
+  const auto color = rest ? Color::Black : Color::White;
+  squares[0] = has_pawns ? (king / 4) * 8 + king % 4 : kTriangle[king];
+
+  std::uint64_t occupied = 0;
+  for (auto square : squares) {
+    if (occupied & (1ull << square))
+      return std::nullopt;
+    occupied |= 1ull << square;
+  }
+
+  PieceSet white;
+  PieceSet black;
+  white.set_bit(Type::King, squares[0]);
+  black.set_bit(Type::King, squares[1]);
+
+  unsigned i = 2;
+  for (auto pieces : {std::make_pair(&white, &material.white),
+                      std::make_pair(&black, &material.black)}) {
+    for (auto type : *pieces.second) {
+      const auto square = squares[i++];
+      // Pawns are never on the first or the last rank.
+      if (type == Type::Pawn and (rank_of(square) == 0 or rank_of(square) == 7))
+        return std::nullopt;
+      pieces.first->set_bit(type, square);
+    }
+  }
+
+  auto board = BoardBuilder()
+    .set_pieces(color, white, black)
+    .set_half_move(0)
+    .set_full_move(1)
+    .build();
+  if (not board or board->is_check_other())
+    return std::nullopt;
+
+  // The position has another index if it is symmetric to a position with a
+  // lower index, or the pieces of the same type are not sorted.
+  if (locate(*board)->index != index)
+    return std::nullopt;
+  return *board;
+}
+
+void
+Tablebase::write(
+    const fs::path& dir,
+    const Material& material,
+    std::span<const std::uint8_t> dtm)
+{
+  if (dtm.size() != material.positions())
+    throw std::invalid_argument("The table does not match the material.");
+
+  fs::create_directories(dir);
+  const auto key = material.key();
+  write_table(dir / (key + ".dtm"), TableKind::Dtm, material, dtm);
+
+  std::vector<std::uint8_t> wdl((dtm.size() + 3) / 4, 0);
+  for (std::size_t i = 0; i < dtm.size(); ++i)
+    wdl[i / 4] |= wdl_code(dtm[i]) << (2 * (i % 4));
+  write_table(dir / (key + ".wdl"), TableKind::Wdl, material, wdl);
+}
+
+} // namespace blunder
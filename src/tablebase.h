@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "board.h"
+#include "mapped_file.h"
+#include "pieces.h"
+
+namespace blunder {
+
+// The outcome of a position with perfect play, from the perspective of the
+// player moving next.
+enum class Wdl {
+  Loss,
+  Draw,
+  Win
+};
+
+// The result of a position in the tablebases.
+struct TablebaseResult {
+  Wdl wdl = Wdl::Draw;
+
+  // The number of plies to mate with perfect play, i.e. the plies for the
+  // winner to mate, or for the loser to get mated. Zero for a draw, or if the
+  // player moving next is mated.
+  unsigned dtm = 0;
+};
+
+// The byte of a position in a DTM table that is not a legal position.
+constexpr std::uint8_t kInvalidDtm = 255;
+
+// Returns the byte of |result| in a DTM table, which is zero for a draw, and
+// otherwise one plus the distance to mate, such that the player moving next
+// wins if the byte is even.
+std::uint8_t
+to_dtm_value(const TablebaseResult& result) noexcept;
+
+// Returns the result for the byte of a DTM table, or nothing if the position is
+// not legal.
+std::optional<TablebaseResult>
+from_dtm_value(std::uint8_t value) noexcept;
+
+// A table and the index of a position in the table.
+struct TablePosition {
+  std::string key;
+  std::uint64_t index = 0;
+};
+
+// The material of a table, e.g. KQvKR for a king and queen against a king and
+// rook, where the pieces of each side are ordered queen, rook, bishop, knight,
+// pawn.
+struct Material {
+  std::vector<Type> white;
+  std::vector<Type> black;
+
+  // Parses a key like KQvKR. Throws an exception if the key is not valid.
+  static Material
+  from_key(std::string_view key);
+
+  // Returns the key of the material, e.g. KQvKR.
+  std::string
+  key() const;
+
+  // Returns the number of pieces, including the kings.
+  unsigned
+  men() const noexcept
+  { return 2 + white.size() + black.size(); }
+
+  // Returns the number of pawns of both players.
+  unsigned
+  pawns() const noexcept;
+
+  // Returns true if white has at least the material of black, i.e. more
+  // pieces, or stronger pieces with the same number of pieces. Only such
+  // materials have a table, and the others are found with the colors flipped.
+  bool
+  is_canonical() const noexcept;
+
+  // Returns the number of positions in the table, including the ones that are
+  // not legal or are symmetric to other positions. The positions are reduced by
+  // symmetry, i.e. the white king is on the left half of the board, and in the
+  // a1-d1-d4 triangle without pawns.
+  std::uint64_t
+  positions() const noexcept;
+};
+
+// Endgame tablebases with the distance to mate of every position with up to
+// kMaxMen pieces, as generated by TablebaseGenerator. Every table is a pair of
+// files in a directory, e.g. KQvK.dtm with one byte per position, and
+// KQvK.wdl with two bits per position. The files are mapped read-only, so the
+// tables are shared with other processes, and a table can have only one of the
+// files, e.g. to save memory with only the WDL files.
+//
+// The tables assume that there are no castling rights, which is always the
+// case in the tables, and positions with castling rights are not found.
+class Tablebase {
+public:
+  static constexpr unsigned kMaxMen = 4;
+
+  // Initializes empty tablebases.
+  Tablebase() = default;
+
+  // Maps the tables in |dir|. Throws an exception if a table file is not
+  // valid.
+  explicit
+  Tablebase(const std::filesystem::path& dir);
+
+  // Maps the table file at |path|, replacing the file of the same table if it
+  // was already mapped. Throws an exception if the file cannot be mapped or is
+  // not a table file.
+  void
+  load(const std::filesystem::path& path);
+
+  // Returns true if there is a file for the table with |key|.
+  bool
+  has_table(std::string_view key) const;
+
+  // Returns the number of tables.
+  std::size_t
+  size() const noexcept
+  { return tables.size(); }
+
+  // Returns the WDL of |board|, or nothing if the table of |board| is missing.
+  std::optional<Wdl>
+  probe_wdl(const Board& board) const;
+
+  // Returns the WDL and the DTM of |board|, or nothing if the DTM file of the
+  // table of |board| is missing.
+  std::optional<TablebaseResult>
+  probe(const Board& board) const;
+
+  // Returns the table and the index of |board|, or nothing if the board has
+  // more than kMaxMen pieces or castling rights. The en passant right is
+  // ignored, i.e. positions with an en passant capture are resolved from
+  // their children.
+  static std::optional<TablePosition>
+  locate(const Board& board);
+
+  // Returns the board at |index| of the table of |material|, or nothing if the
+  // index is not a legal position, or if the position has another index.
+  static std::optional<Board>
+  board_at(const Material& material, std::uint64_t index);
+
+  // Writes the table for |material| with one byte per position, see
+  // to_dtm_value, into DTM and WDL files in |dir|. Throws an exception on
+  // error.
+  static void
+  write(
+      const std::filesystem::path& dir,
+      const Material& material,
+      std::span<const std::uint8_t> dtm);
+
+private:
+  struct Table {
+    std::optional<MappedFile> dtm_file;
+    std::optional<MappedFile> wdl_file;
+    std::span<const std::uint8_t> dtm;
+    std::span<const std::uint8_t> wdl;
+  };
+
+  std::map<std::string, Table, std::less<>> tables;
+};
+
+} // namespace blunder
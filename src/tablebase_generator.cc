@@ -0,0 +1,426 @@
+#include "tablebase_generator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "color.h"
+#include "par.h"
+#include "piece_set.h"
+#include "pieces.h"
+#include "tablebase.h"
+
+namespace blunder {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The number of positions searched by a task of the work queue.
+constexpr std::size_t kChunkSize = 1 << 12;
+
+// The table that is generated, and the values of its positions so far.
+struct Generation {
+  const Tablebase& tb;
+  std::string key;
+  // The values of the positions of the table, see to_dtm_value. Empty in the
+  // first pass, where all the positions of the table are undecided.
+  std::span<const std::uint8_t> values;
+};
+
+// The result of searching a position one ply forward.
+struct Outcome {
+  // The result, or nothing if it depends on undecided positions.
+  std::optional<TablebaseResult> result;
+  // True if a child has the en passant right, i.e. the child is not in the
+  // table, and the position has to be searched again in every ply.
+  bool has_enpassant = false;
+};
+
+Outcome
+evaluate(const Generation& gen, const Board& board);
+
+// Returns the result of |child|, or nothing if it is undecided.
+std::optional<TablebaseResult>
+child_result(const Generation& gen, const Board& child)
+{
+  if (child.is_terminal()) {
+    return TablebaseResult{
+      .wdl=child.is_mate() ? Wdl::Loss : Wdl::Draw,
+      .dtm=0
+    };
+  }
+  if (child.has_enpassant())
+    return evaluate(gen, child).result;
+
+  auto position = Tablebase::locate(child);
+  assert(position);
+  if (position->key == gen.key) {
+    // Undecided positions are zero until the table is complete.
+    auto value = gen.values.empty() ? 0 : gen.values[position->index];
+    return value ? from_dtm_value(value) : std::nullopt;
+  }
+
+  auto result = gen.tb.probe(child);
+  if (not result)
+    throw std::logic_error("Missing table " + position->key);
+  return result;
+}
+
+Outcome
+evaluate(const Generation& gen, const Board& board)
+{
+  Outcome outcome;
+  std::optional<unsigned> min_loss;
+  unsigned max_win = 0;
+  bool all_wins = true;
+
+  for (const auto& child : board.next()) {
+    outcome.has_enpassant |= child.has_enpassant();
+    auto result = child_result(gen, child);
+    if (not result) {
+      all_wins = false;
+    } else if (result->wdl == Wdl::Loss) {
+      min_loss = std::min(min_loss.value_or(result->dtm), result->dtm);
+    } else if (result->wdl == Wdl::Win) {
+      max_win = std::max(max_win, result->dtm);
+    } else {
+      all_wins = false;
+    }
+  }
+
+  // The fastest win, or the slowest loss when every move loses.
+  if (min_loss)
+    outcome.result = TablebaseResult{.wdl=Wdl::Win, .dtm=*min_loss + 1};
+  else if (all_wins)
+    outcome.result = TablebaseResult{.wdl=Wdl::Loss, .dtm=max_win + 1};
+
+  if (outcome.result and outcome.result->dtm + 1 >= kInvalidDtm)
+    throw std::logic_error("The distance to mate does not fit the table.");
+  return outcome;
+}
+
+// Returns the squares from which a piece of |type| and |color| can have moved
+// to |square| without a capture or a promotion, where |occupied| are the
+// squares of all the pieces.
+std::vector<unsigned>
+unmove_squares(Type type, Color color, unsigned square, BitBoard occupied)
+{
+  const int file = square % 8;
+  const int rank = square / 8;
+  std::vector<unsigned> squares;
+
+  auto is_empty = [occupied](int file, int rank) {
+    return file >= 0 and file < 8 and rank >= 0 and rank < 8
+       and not (occupied & BitBoard::from_index(rank * 8 + file));
+  };
+
+  auto add_steps = [&](std::initializer_list<std::pair<int, int>> steps) {
+    for (auto [df, dr] : steps) {
+      if (is_empty(file + df, rank + dr))
+        squares.push_back((rank + dr) * 8 + file + df);
+    }
+  };
+
+  auto add_rays = [&](std::initializer_list<std::pair<int, int>> steps) {
+    for (auto [df, dr] : steps) {
+      for (int f = file + df, r = rank + dr; is_empty(f, r); f += df, r += dr)
+        squares.push_back(r * 8 + f);
+    }
+  };
+
+  switch (type) {
+    case Type::King:
+      add_steps({{-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
+                 {0, 1}, {1, -1}, {1, 0}, {1, 1}});
+      break;
+    case Type::Knight:
+      add_steps({{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2},
+                 {1, -2}, {1, 2}, {2, -1}, {2, 1}});
+      break;
+    case Type::Bishop:
+      add_rays({{-1, -1}, {-1, 1}, {1, -1}, {1, 1}});
+      break;
+    case Type::Rook:
+      add_rays({{-1, 0}, {1, 0}, {0, -1}, {0, 1}});
+      break;
+    case Type::Queen:
+      add_rays({{-1, -1}, {-1, 1}, {1, -1}, {1, 1},
+                {-1, 0}, {1, 0}, {0, -1}, {0, 1}});
+      break;
+    case Type::Pawn: {
+      // Pawns move back towards their starting rank, and two squares back to
+      // it.
+      const int dr = color == Color::White ? -1 : 1;
+      const int start = color == Color::White ? 1 : 6;
+      if (rank != start and is_empty(file, rank + dr)) {
+        squares.push_back((rank + dr) * 8 + file);
+        if (rank + 2 * dr == start and is_empty(file, rank + 2 * dr))
+          squares.push_back((rank + 2 * dr) * 8 + file);
+      }
+      break;
+    }
+  }
+  return squares;
+}
+
+// Returns the indices of the positions of the table that have a move to
+// |board|, and possibly of some that do not.
+std::vector<std::uint32_t>
+unmove(const Board& board)
+{
+  const auto color = board.is_white_next() ? Color::Black : Color::White;
+  const auto& mover = color == Color::White ? board.white() : board.black();
+  const auto& other = color == Color::White ? board.black() : board.white();
+  const auto occupied = board.all_bits();
+
+  std::vector<std::uint32_t> indices;
+  for (auto type : {Type::King, Type::Queen, Type::Rook, Type::Bishop,
+                    Type::Knight, Type::Pawn}) {
+    for (auto bb = mover.get(type); bb;) {
+      const auto square = bb.first_bit_and_clear();
+      for (auto from : unmove_squares(type, color, square, occupied)) {
+        auto pieces = mover;
+        pieces.clear_bit(type, square).set_bit(type, from);
+        const auto& white = color == Color::White ? pieces : other;
+        const auto& black = color == Color::White ? other : pieces;
+
+        auto prev = BoardBuilder()
+          .set_pieces(color, white, black)
+          .set_half_move(0)
+          .set_full_move(1)
+          .build();
+        if (not prev or prev->is_check_other())
+          continue;
+        auto position = Tablebase::locate(*prev);
+        assert(position);
+        indices.push_back(position->index);
+      }
+    }
+  }
+  return indices;
+}
+
+// Returns all the sorted lists of |count| piece types other than the king.
+std::vector<std::vector<Type>>
+all_sides(unsigned count, Type first = Type::Queen)
+{
+  if (not count)
+    return {std::vector<Type>()};
+
+  std::vector<std::vector<Type>> sides;
+  for (auto type : {Type::Queen, Type::Rook, Type::Bishop, Type::Knight,
+                    Type::Pawn}) {
+    if (type < first)
+      continue;
+    for (auto& rest : all_sides(count - 1, type)) {
+      rest.insert(rest.begin(), type);
+      sides.push_back(std::move(rest));
+    }
+  }
+  return sides;
+}
+
+void
+sort_unique(std::vector<std::uint32_t>& indices)
+{
+  std::ranges::sort(indices);
+  auto [first, last] = std::ranges::unique(indices);
+  indices.erase(first, last);
+}
+
+} // namespace
+
+TablebaseGenerator::TablebaseGenerator(
+    fs::path dir,
+    std::shared_ptr<par::WorkQ> workq)
+  : dir(std::move(dir)),
+    workq(std::move(workq))
+{
+  if (not this->workq)
+    throw std::invalid_argument("workq is null.");
+  if (fs::exists(this->dir))
+    tb = Tablebase(this->dir);
+}
+
+void
+TablebaseGenerator::generate(const Material& material)
+{
+  if (material.men() > Tablebase::kMaxMen)
+    throw std::invalid_argument("Too many pieces for a table.");
+  if (not material.is_canonical())
+    throw std::invalid_argument("The material is not canonical.");
+
+  const auto positions = material.positions();
+  std::vector<std::uint8_t> values(positions, 0);
+  Generation gen{.tb=tb, .key=material.key(), .values={}};
+
+  // The positions that are decided in a ply, indexed by the ply.
+  std::vector<std::vector<std::uint32_t>> decided_in;
+  auto schedule = [&decided_in](unsigned ply, std::uint32_t index) {
+    if (decided_in.size() <= ply)
+      decided_in.resize(ply + 1);
+    decided_in[ply].push_back(index);
+  };
+
+  struct ChunkResult {
+    std::vector<std::pair<unsigned, std::uint32_t>> scheduled;
+    std::vector<std::pair<std::uint32_t, std::uint8_t>> updates;
+    std::vector<std::uint32_t> enpassant;
+  };
+
+  // The first pass marks the positions that are not legal or are terminal, and
+  // searches the others with all the positions of the table undecided.
+  const auto chunks = (positions + kChunkSize - 1) / kChunkSize;
+  auto first_futs = workq->for_range(chunks, [&](std::size_t chunk) {
+    ChunkResult chunk_result;
+    const auto end = std::min<std::uint64_t>(
+        (chunk + 1) * kChunkSize, positions);
+    for (std::uint64_t index = chunk * kChunkSize; index < end; ++index) {
+      auto board = Tablebase::board_at(material, index);
+      if (not board) {
+        values[index] = kInvalidDtm;
+        continue;
+      }
+      if (board->is_terminal()) {
+        if (board->is_mate())
+          values[index] = to_dtm_value({.wdl=Wdl::Loss, .dtm=0});
+        continue;
+      }
+
+      auto outcome = evaluate(gen, *board);
+      if (outcome.has_enpassant)
+        chunk_result.enpassant.push_back(index);
+      if (outcome.result)
+        chunk_result.scheduled.emplace_back(outcome.result->dtm, index);
+    }
+    return chunk_result;
+  });
+
+  std::vector<std::uint32_t> enpassant;
+  for (auto& fut : first_futs) {
+    auto chunk_result = fut.get();
+    for (auto [ply, index] : chunk_result.scheduled)
+      schedule(ply, index);
+    enpassant.insert(
+        enpassant.end(),
+        chunk_result.enpassant.begin(),
+        chunk_result.enpassant.end());
+  }
+
+  // Every ply decides the positions with that distance to mate, from the
+  // positions decided in the previous plies. The values are only updated
+  // between the plies, such that the tasks read the same values.
+  gen.values = values;
+  std::vector<std::uint32_t> unmoved;
+  for (unsigned ply = 1; ply < decided_in.size() or not unmoved.empty(); ++ply) {
+    auto candidates = std::move(unmoved);
+    if (ply < decided_in.size()) {
+      candidates.insert(
+          candidates.end(), decided_in[ply].begin(), decided_in[ply].end());
+      decided_in[ply] = {};
+    }
+    candidates.insert(candidates.end(), enpassant.begin(), enpassant.end());
+    sort_unique(candidates);
+
+    const auto ply_chunks = (candidates.size() + kChunkSize - 1) / kChunkSize;
+    auto futs = workq->for_range(ply_chunks, [&](std::size_t chunk) {
+      ChunkResult chunk_result;
+      const auto end = std::min((chunk + 1) * kChunkSize, candidates.size());
+      for (auto i = chunk * kChunkSize; i < end; ++i) {
+        const auto index = candidates[i];
+        if (values[index])
+          continue;
+        auto board = Tablebase::board_at(material, index);
+        if (not board or board->is_terminal())
+          continue;
+
+        auto result = evaluate(gen, *board).result;
+        if (not result)
+          continue;
+        // A position that is decided with a longer distance through another
+        // table waits for its ply, in case a shorter win comes up.
+        if (result->dtm <= ply)
+          chunk_result.updates.emplace_back(index, to_dtm_value(*result));
+        else
+          chunk_result.scheduled.emplace_back(result->dtm, index);
+      }
+      return chunk_result;
+    });
+
+    std::vector<std::uint32_t> updated;
+    for (auto& fut : futs) {
+      auto chunk_result = fut.get();
+      for (auto [index, value] : chunk_result.updates) {
+        values[index] = value;
+        updated.push_back(index);
+      }
+      for (auto [next_ply, index] : chunk_result.scheduled)
+        schedule(next_ply, index);
+    }
+
+    // The positions that can move to the decided ones are the candidates of
+    // the next ply.
+    const auto unmove_chunks = (updated.size() + kChunkSize - 1) / kChunkSize;
+    auto unmove_futs = workq->for_range(unmove_chunks, [&](std::size_t chunk) {
+      std::vector<std::uint32_t> indices;
+      const auto end = std::min((chunk + 1) * kChunkSize, updated.size());
+      for (auto i = chunk * kChunkSize; i < end; ++i) {
+        auto board = Tablebase::board_at(material, updated[i]);
+        assert(board);
+        auto prev = unmove(*board);
+        indices.insert(indices.end(), prev.begin(), prev.end());
+      }
+      return indices;
+    });
+
+    for (auto& fut : unmove_futs) {
+      auto indices = fut.get();
+      unmoved.insert(unmoved.end(), indices.begin(), indices.end());
+    }
+    sort_unique(unmoved);
+  }
+
+  Tablebase::write(dir, material, values);
+  tb.load(dir / (gen.key + ".dtm"));
+  tb.load(dir / (gen.key + ".wdl"));
+}
+
+std::vector<Material>
+TablebaseGenerator::all_materials(unsigned max_men)
+{
+  if (max_men > Tablebase::kMaxMen)
+    throw std::invalid_argument("Too many pieces for a table.");
+
+  std::vector<Material> materials;
+  for (unsigned men = 3; men <= max_men; ++men) {
+    for (unsigned white = 0; white <= men - 2; ++white) {
+      for (auto& white_types : all_sides(white)) {
+        for (auto& black_types : all_sides(men - 2 - white)) {
+          Material material{.white=white_types, .black=black_types};
+          if (material.is_canonical())
+            materials.push_back(std::move(material));
+        }
+      }
+    }
+  }
+
+  // Captures lead to fewer pieces, and promotions to fewer pawns.
+  std::ranges::stable_sort(materials, {}, [](const Material& material) {
+    return std::pair(material.men(), material.pawns());
+  });
+  return materials;
+}
+
+} // namespace blunder
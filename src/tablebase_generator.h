@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "par.h"
+#include "tablebase.h"
+
+namespace blunder {
+
+// Generates the tables of Tablebase by retrograde analysis. The positions of a
+// table are first searched one ply forward, to resolve the positions that are
+// decided by captures, promotions, and mates. Then the positions are decided
+// ply by ply in the order of the distance to mate, where the positions decided
+// in a ply are unmoved to find the positions that may be decided in the next
+// ply, which are then searched one ply forward with Board::next.
+class TablebaseGenerator {
+public:
+  // Initializes the generator to write the tables to |dir|, and to map the
+  // tables that are already in |dir|. Throws an exception if |workq| is null.
+  TablebaseGenerator(
+      std::filesystem::path dir,
+      std::shared_ptr<par::WorkQ> workq);
+
+  // Generates the table of |material|, writes it to the directory, and maps
+  // it. The tables of the materials after a capture or a promotion must be
+  // generated first. Throws an exception if such a table is missing, or if
+  // |material| is not canonical or has too many pieces.
+  void
+  generate(const Material& material);
+
+  // Returns the tables that are mapped, including the generated ones.
+  const Tablebase&
+  tablebase() const noexcept
+  { return tb; }
+
+  // Returns the canonical materials with three to |max_men| pieces, in an
+  // order in which the tables can be generated.
+  static std::vector<Material>
+  all_materials(unsigned max_men);
+
+private:
+  std::filesystem::path dir;
+  std::shared_ptr<par::WorkQ> workq;
+  Tablebase tb;
+};
+
+} // namespace blunder
@@ -6,10 +6,20 @@
 
 #include "board.h"
 #include "board_path.h"
+#include "coding_util.h"
 #include "search_result.h"
 
 namespace blunder {
 
+// A sparse representation of a policy target, i.e. the flat indices of the
+// moves in the policy planes, and the probability for each move.
+struct SparsePolicy {
+  // A 1-D tensor of int64 indices.
+  torch::Tensor indices;
+  // A 1-D tensor of float probabilities.
+  torch::Tensor probs;
+};
+
 // An interface for encoding the input boards into the tensor input for neural
 // network evaluation.
 class TensorEncoder {
@@ -32,6 +42,12 @@ public:
   virtual torch::Tensor
   encode_moves(std::span<const MoveProb> moves) const = 0;
 
+  // Converts |policy| into a sparse policy target, where the probability of a
+  // move is its share of the total visits. The target is a constant in the
+  // loss, so it is never encoded with grad enabled.
+  virtual SparsePolicy
+  encode_policy(std::span<const PolicyEntry> policy) const = 0;
+
   // If set, tensors are encoded with requires_grad=true, otherwise they are
   // encoded with requires_grad=false.
   void with_grad(bool enabled)
@@ -1,11 +1,17 @@
 #include <cstdlib>
 #include <getopt.h>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <string>
 #include <string_view>
 #include <unistd.h>
 
+#include "alpha_beta.h"
+#include "blunder_player.h"
 #include "board.h"
+#include "nnue.h"
+#include "player.h"
 #include "random_player.h"
 #include "simple_game.h"
 #include "terminal_player.h"
@@ -20,6 +26,10 @@ print_help(std::string_view prog, std::ostream& os)
      << "   -p|--pname  The name of the player, or TerminalGame by default.\n"
      << "   -w|--white  Play the game as white. Exclusive of --black.\n"
      << "   -b|--black  Play the game as black. Exclusive of --white.\n"
+     << "   -d|--depth  Play against an alpha-beta search to this depth,\n"
+     << "               rather than against random moves.\n"
+     << "   -u|--nnue   The network file for the alpha-beta search to\n"
+     << "               evaluate positions with, e.g. from train_nnue.\n"
      << std::endl;
 }
 
@@ -29,18 +39,22 @@ main(int argc, char** argv)
 
   struct option longopts[] = {
     {"help", no_argument, nullptr, 'h'},
-    {"pname", required_argument, nullptr, 'n'},
+    {"pname", required_argument, nullptr, 'p'},
     {"white", no_argument, nullptr, 'w'},
     {"black", no_argument, nullptr, 'b'},
+    {"depth", required_argument, nullptr, 'd'},
+    {"nnue", required_argument, nullptr, 'u'},
     {0, 0, 0, 0},
   };
 
   std::string_view player_name = "TerminalPlayer";
   bool as_white = false;
   bool as_black = false;
+  unsigned depth = 0;
+  std::string nnue_file;
 
   while (true) {
-    auto ret = getopt_long(argc, argv, "hp", longopts, nullptr);
+    auto ret = getopt_long(argc, argv, "hp:wbd:u:", longopts, nullptr);
     if (ret == -1) break;
     switch (ret) {
       case 'h':
@@ -55,6 +69,19 @@ main(int argc, char** argv)
       case 'b':
         as_black = true;
         break;
+      case 'd':
+        try {
+          depth = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--depth needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'u':
+        nnue_file = optarg;
+        break;
       default:
         std::cerr << "Received unknown command line option.\n";
         print_help(argv[0], std::cerr);
@@ -71,7 +98,20 @@ main(int argc, char** argv)
   std::random_device rand_dev;
 
   auto terminal_player = std::make_unique<TerminalPlayer>(player_name);
-  auto rand_player = std::make_unique<RandomPlayer>(rand_dev());
+  if (not nnue_file.empty() and not depth) {
+    std::cerr << "--nnue needs --depth to be set." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<Player> engine_player;
+  if (depth) {
+    auto search = std::make_shared<AlphaBeta>(depth);
+    if (not nnue_file.empty())
+      search->set_network(std::make_shared<Nnue>(Nnue::load(nnue_file)));
+    engine_player = std::make_unique<BlunderPlayer>(search);
+  } else {
+    engine_player = std::make_unique<RandomPlayer>(rand_dev());
+  }
 
   bool is_white = false;
   if (as_white or as_black)
@@ -86,8 +126,8 @@ main(int argc, char** argv)
   Board::register_magics();
 
   auto game = is_white
-     ? SimpleGame(std::move(terminal_player), std::move(rand_player))
-     : SimpleGame(std::move(rand_player), std::move(terminal_player));
+     ? SimpleGame(std::move(terminal_player), std::move(engine_player))
+     : SimpleGame(std::move(engine_player), std::move(terminal_player));
 
   auto results = game.play();
 
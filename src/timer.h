@@ -45,6 +45,14 @@ public:
   total() const
   { return total_time; }
 
+  // Returns the time since start was called, without ending the interval.
+  SteadyDuration
+  elapsed() const noexcept
+  {
+    assert(time_point and "Timer::start() needs to be called before elapsed()");
+    return SteadyClock::now() - *time_point;
+  }
+
   // Getters for the total time.
 
   std::int64_t
@@ -0,0 +1,177 @@
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+
+#include "alpha_beta.h"
+#include "blunder_player.h"
+#include "board.h"
+#include "board_path.h"
+#include "nnue.h"
+#include "nnue_trainer.h"
+#include "player.h"
+#include "random_search.h"
+#include "simple_game.h"
+
+using namespace blunder;
+
+// Plays random moves for the first plies of the game, and then the moves of
+// another player, such that the games of a deterministic search differ.
+class OpeningPlayer : public Player {
+public:
+  OpeningPlayer(std::unique_ptr<Player> player, unsigned random_plies,
+                unsigned seed)
+    : player(std::move(player)),
+      random_plies(random_plies),
+      rand_search(seed) {}
+
+  SearchResult
+  make_move(const GameBoardPath& boards) override
+  {
+    if (boards.size() > random_plies)
+      return player->make_move(boards);
+    return rand_search.run(EvalBoardPath::rev(boards));
+  }
+
+  std::string_view
+  name() const noexcept
+  { return player->name(); }
+
+private:
+  std::unique_ptr<Player> player;
+  unsigned random_plies;
+  RandomSearch rand_search;
+};
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ...\n"
+     << "   -h|--help          Print this help message.\n"
+     << "   -g|--games         The number of self-play games to train on.\n"
+     << "   -d|--depth         The depth of the alpha-beta search in self play.\n"
+     << "   -r|--random_plies  The number of random plies to start a game.\n"
+     << "   -e|--epochs        The number of passes over the positions.\n"
+     << "   -o|--out           The file to write the network to.\n"
+     << std::endl;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"games", required_argument, nullptr, 'g'},
+    {"depth", required_argument, nullptr, 'd'},
+    {"random_plies", required_argument, nullptr, 'r'},
+    {"epochs", required_argument, nullptr, 'e'},
+    {"out", required_argument, nullptr, 'o'},
+    {0, 0, 0, 0},
+  };
+
+  unsigned games = 100;
+  unsigned depth = 3;
+  unsigned random_plies = 8;
+  unsigned epochs = 10;
+  std::string out = "nnue.bin";
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hg:d:r:e:o:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'g':
+        try {
+          games = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--games needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'd':
+        try {
+          depth = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--depth needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'r':
+        try {
+          random_plies = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--random_plies needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'e':
+        try {
+          epochs = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--epochs needs to be a valid, but got "
+                    << optarg << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cerr);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (not depth) {
+    std::cerr << "--depth needs to be non-zero." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Board::register_magics();
+
+  std::random_device rand_dev;
+  auto search = std::make_shared<AlphaBeta>(depth);
+  NnueTrainer trainer;
+
+  for (unsigned i = 0; i < games; ++i) {
+    auto make_player = [&] {
+      return std::make_unique<OpeningPlayer>(
+          std::make_unique<BlunderPlayer>(search), random_plies, rand_dev());
+    };
+    SimpleGame game(make_player(), make_player());
+    trainer.add(game.play());
+    std::cout << "Played game " << i + 1 << " of " << games << ", "
+              << trainer.size() << " positions" << std::endl;
+  }
+
+  if (not trainer.size()) {
+    std::cerr << "The games have no positions to train on." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Initial loss: " << trainer.loss() << std::endl;
+  for (unsigned epoch = 0; epoch < epochs; ++epoch) {
+    auto loss = trainer.train(/*epochs=*/1);
+    std::cout << "Epoch " << epoch + 1 << " loss: " << loss << std::endl;
+  }
+
+  trainer.network().save(out);
+  std::cout << "Wrote the network to " << out << std::endl;
+
+  return EXIT_SUCCESS;
+}
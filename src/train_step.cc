@@ -0,0 +1,120 @@
+#include "train_step.h"
+
+#include <utility>
+
+#include <ATen/autocast_mode.h>
+
+namespace blunder {
+
+namespace {
+
+using ::torch::Tensor;
+
+// Enables autocast to |dtype| on |device_type| for the lifetime of the guard,
+// and restores the previous state on exit.
+class AutocastGuard {
+public:
+  AutocastGuard(c10::DeviceType device_type, c10::ScalarType dtype)
+    : device_type(device_type),
+      prev_enabled(at::autocast::is_autocast_enabled(device_type)),
+      prev_dtype(at::autocast::get_autocast_dtype(device_type))
+  {
+    at::autocast::set_autocast_enabled(device_type, true);
+    at::autocast::set_autocast_dtype(device_type, dtype);
+    at::autocast::increment_nesting();
+  }
+
+  AutocastGuard(const AutocastGuard&) = delete;
+  AutocastGuard& operator=(const AutocastGuard&) = delete;
+
+  // The bf16 copies of the weights are cached while autocast is enabled, and
+  // are released when the outermost guard exits, since the weights change on
+  // every step.
+  ~AutocastGuard()
+  {
+    if (at::autocast::decrement_nesting() == 0)
+      at::autocast::clear_cache();
+    at::autocast::set_autocast_enabled(device_type, prev_enabled);
+    at::autocast::set_autocast_dtype(device_type, prev_dtype);
+  }
+
+private:
+  c10::DeviceType device_type;
+  bool prev_enabled;
+  c10::ScalarType prev_dtype;
+};
+
+// Runs the forward pass, in bf16 with autocast if |precision| is BFloat16. The
+// outputs are always returned in fp32.
+std::pair<Tensor, Tensor>
+forward(AlphaZeroNet& net, const Tensor& input, TrainingPrecision precision)
+{
+  if (precision == TrainingPrecision::Float32)
+    return net.forward(input);
+
+  AutocastGuard autocast(net.device().type(), torch::kBFloat16);
+  auto [policy, value] = net.forward(input);
+  return {policy.to(torch::kFloat), value.to(torch::kFloat)};
+}
+
+// Divides the gradients of |optimizer| by |loss_scale|. Returns false if any
+// of the gradients is not finite.
+bool
+unscale_grads(torch::optim::Optimizer& optimizer, float loss_scale)
+{
+  torch::NoGradGuard no_grad;
+
+  // Accumulate the check on the device, to wait only once for the result.
+  Tensor finite;
+  for (auto& group : optimizer.param_groups()) {
+    for (auto& param : group.params()) {
+      auto& grad = param.mutable_grad();
+      if (not grad.defined())
+        continue;
+      grad.div_(loss_scale);
+      auto grad_finite = torch::isfinite(grad).all();
+      finite = finite.defined() ? finite.logical_and(grad_finite) : grad_finite;
+    }
+  }
+
+  return not finite.defined() or finite.item<bool>();
+}
+
+} // namespace
+
+Tensor
+train_step(
+    AlphaZeroNet& net,
+    torch::optim::Optimizer& optimizer,
+    const ChessDataExample& batch,
+    TrainingPrecision precision,
+    float loss_scale)
+{
+  optimizer.zero_grad();
+
+  auto [policy_pred, value_pred] = forward(net, batch.data, precision);
+  const auto& [policy_target, value_target] = batch.target;
+
+  auto value_loss = torch::mse_loss(value_pred, value_target);
+
+  // The policy targets are sparse, so they are fed straight to the loss without
+  // expanding them into the policy planes.
+  auto policy_loss = sparse_policy_loss(policy_pred, policy_target);
+
+  // TODO: add L2 regularization.
+  auto loss = value_loss + policy_loss;
+
+  if (loss_scale == 1) {
+    loss.backward();
+    optimizer.step();
+    return loss.detach();
+  }
+
+  (loss * loss_scale).backward();
+  if (unscale_grads(optimizer, loss_scale))
+    optimizer.step();
+
+  return loss.detach();
+}
+
+} // namespace blunder
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <torch/torch.h>
+
+#include "chess_data_set.h"
+#include "net.h"
+
+namespace blunder {
+
+// The precision of the forward and backward passes during training.
+enum class TrainingPrecision {
+  // Runs everything in fp32.
+  Float32,
+  // Runs the forward pass under autocast to bf16, such that the convolutions
+  // and the fully connected layers run in bf16, e.g. on AVX-512-BF16 or AMX on
+  // CPU. The weights, the gradients and the optimizer state stay in fp32, i.e.
+  // the network parameters are the master weights, and the losses are
+  // computed in fp32.
+  BFloat16
+};
+
+// Runs one optimization step of |net| on |batch|, i.e. the forward pass, the
+// loss, the backward pass, and the update with |optimizer|.
+//
+// The loss is multiplied by |loss_scale| before the backward pass, and the
+// gradients are divided by it before the update, to keep small gradients from
+// flushing to zero in low precision. With a loss scale other than 1, the
+// update is skipped if any of the gradients is not finite.
+//
+// Returns the unscaled loss, without waiting for it to be computed on the
+// device.
+torch::Tensor
+train_step(
+    AlphaZeroNet& net,
+    torch::optim::Optimizer& optimizer,
+    const ChessDataExample& batch,
+    TrainingPrecision precision = TrainingPrecision::Float32,
+    float loss_scale = 1);
+
+} // namespace blunder
@@ -1,5 +1,6 @@
 #include "trainer.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <format>
 #include <iostream>
@@ -12,10 +13,15 @@
 #include <vector>
 
 #include "alpha_zero_encoder.h"
+#include "checkpoint_writer.h"
 #include "chess_data_set.h"
 #include "game_result.h"
 #include "net.h"
+#include "opening_book.h"
+#include "replay_buffer.h"
 #include "simple_game_builder.h"
+#include "timer.h"
+#include "train_step.h"
 
 #include <torch/torch.h>
 
@@ -34,6 +40,10 @@ Trainer::play_training_games(std::shared_ptr<AlphaZeroNet> net) const
   auto game = SimpleGameBuilder()
                 .set_net(std::move(net))
                 .set_max_moves(max_moves_per_game)
+                .set_playout_cap(playout_cap)
+                .set_opening_book(book, book_options)
+                .set_tablebase(tablebase)
+                .set_adjudication(adjudication)
                 .set_decoder(decoder)
                 .set_encoder(encoder)
                 .build();
@@ -41,12 +51,23 @@ Trainer::play_training_games(std::shared_ptr<AlphaZeroNet> net) const
   std::vector<GameResult> game_results;
   game_results.reserve(training_games);
 
+  unsigned resignations = 0;
+  unsigned false_resignations = 0;
+
   for (unsigned i = 0; i < training_games; ++i) {
     auto game_result = game.play();
     std::cout << game_result.stats().dbg() << std::endl;
+    resignations += game_result.would_resign.has_value();
+    false_resignations += game_result.is_false_resignation();
     game_results.push_back(std::move(game_result));
   }
 
+  // The games played out without resignations tell how often a resignation is
+  // wrong, which should stay low, e.g. below 5%, when tuning the threshold.
+  if (resignations)
+    std::cout << "False resignations: " << false_resignations << " of "
+              << resignations << std::endl;
+
   return game_results;
 }
 
@@ -56,10 +77,16 @@ Trainer::play_tournament(std::shared_ptr<AlphaZeroNet> contender) const
 {
   c10::InferenceMode inference_mode(true);
 
+  auto tournament_adjudication = adjudication;
+  tournament_adjudication.no_resign_prob = 0;
+
   auto game = SimpleGameBuilder()
                 .set_white_net(champion)
                 .set_black_net(std::move(contender))
                 .set_max_moves(max_moves_per_game)
+                .set_opening_book(book, book_options)
+                .set_tablebase(tablebase)
+                .set_adjudication(tournament_adjudication)
                 .set_decoder(decoder)
                 .set_encoder(encoder)
                 .build();
@@ -87,52 +114,61 @@ Trainer::play_tournament(std::shared_ptr<AlphaZeroNet> contender) const
 // Trains the model.
 std::shared_ptr<AlphaZeroNet>
 Trainer::train_model(
-    std::span<const GameResult> game_results,
+    std::span<const TrainingPosition> positions,
     const AlphaZeroNet& net) const
 {
   auto trained_net = std::make_shared<AlphaZeroNet>(net.clone());
   trained_net->set_training_mode();
-  ChessDataSet data_set(game_results, encoder);
+  ChessDataSet data_set(positions, encoder, trained_net->device());
+
+  // Examples are encoded and stacked into batches by the loader workers, and up
+  // to prefetch_batches batches are kept in flight so the training loop does
+  // not have to wait for the encoding. Batches are yielded in the order they
+  // are ready since the sampler is random anyway.
+  auto loader_opts = torch::data::DataLoaderOptions(batch_size)
+                       .workers(loader_workers)
+                       .max_jobs(std::max(prefetch_batches, loader_workers))
+                       .enforce_ordering(false);
 
   auto data_loader = torch::data::make_data_loader(
       std::move(data_set).map(Collate<ChessDataExample>(stack_examples)),
-      batch_size);
+      std::move(loader_opts));
 
   // Instantiate an SGD optimization algorithm to update our Net's parameters.
   // TODO: experiment with updating the learning rate.
-  torch::optim::SGD optimizer(trained_net->parameters(), /*lr=*/0.01);
+  torch::optim::SGD optimizer(trained_net->all_parameters(), /*lr=*/0.01);
 
-  unsigned num_checkpoint = 0;
+  // The checkpoints are written in the background, so the training loop only
+  // waits for the parameters to be copied to memory.
+  CheckpointWriter checkpoint_writer;
   fs::path dir_path(checkpoint_dir);
   std::string dir_name;
   dir_name.reserve(32);
 
   for (size_t epoch = 1; epoch <= training_epochs; ++epoch) {
     size_t batch_index = 0;
-    // Iterate the data loader to yield batches from the dataset.
-    for (auto& batch : *data_loader) {
-      // Reset gradients.
-      optimizer.zero_grad();
 
-      // Execute the model on the input data.
-      auto [policy_pred, value_pred] = trained_net->forward(batch.data);
+    // Measures the time that the training loop is blocked waiting for the data
+    // loader to produce the next batch.
+    Timer stall_timer;
+    stall_timer.start();
 
-      // Get the target values from self play.
-      auto& [policy_target, value_target] = batch.target;
+    // Measures the time of the whole epoch, to compute the training throughput.
+    Timer epoch_timer;
+    epoch_timer.start();
+    std::size_t num_samples = 0;
 
-      // TODO: compute loss for value
-      torch::nn::MSELoss mse_loss;
-      auto value_loss = mse_loss(value_pred, value_target);
+    // Iterate the data loader to yield batches from the dataset. Note that the
+    // iterator fetches batches lazily, i.e. when it is compared or dereferenced.
+    auto iter = data_loader->begin();
+    for (; iter != data_loader->end(); ++iter) {
+      auto& batch = *iter;
+      stall_timer.end();
 
-      torch::nn::CrossEntropyLoss ce_loss;
-      auto policy_loss = ce_loss(policy_pred, policy_target);
-
-      // TODO: add L2 regularization.
-      auto loss = value_loss + policy_loss;
-      loss.backward();
-
-      // Update the parameters based on the calculated gradients.
-      optimizer.step();
+      // Run the model on the batch and update the parameters.
+      auto loss = train_step(
+          *trained_net, optimizer, batch, precision, loss_scale);
+      num_samples += batch.data.size(0);
 
       // Output the loss and checkpoint every batches.
       if (++batch_index % checkpoint_steps == 0) {
@@ -143,23 +179,42 @@ Trainer::train_model(
 
         std::format_to(
             std::back_inserter(dir_name), "model-{:0>4}", num_checkpoint);
-        trained_net->create_checkpoint(dir_path / dir_name);
-
         auto file_name = std::format("optim-{:0>4}.pt", num_checkpoint);
-        torch::save(optimizer, dir_path / dir_name / file_name);
+        checkpoint_writer.submit(
+            *trained_net, optimizer, dir_path / dir_name, std::move(file_name));
+        ++num_checkpoint;
 
         // Clear the dir_name so we can reuse the buffer.
         dir_name.clear();
       }
+
+      stall_timer.start();
     }
+
+    // Account for the wait on the end of the epoch.
+    stall_timer.end();
+    epoch_timer.end();
+
+    std::cout << "Epoch: " << epoch
+              << " | Batches: " << batch_index
+              << " | Samples/sec: "
+              << 1000.0 * num_samples / epoch_timer.total_millis()
+              << " | Loader stall millis: " << stall_timer.total_millis()
+              << std::endl;
   }
 
+  checkpoint_writer.wait();
+  if (auto dropped = checkpoint_writer.dropped())
+    std::cout << "Dropped " << dropped << " checkpoints while the writer was "
+              << "behind" << std::endl;
+
   return trained_net;
 }
 
 // Runs the full training pipeline:
-// 1. Generates training data by playing games of self-play.
-// 2. Use the data from the games to train a new model.
+// 1. Generates training data by playing games of self-play, and adds the
+//    positions to the replay buffer.
+// 2. Use positions sampled from the replay buffer to train a new model.
 // 3. Play a tournament between the new agent and the old agent.
 // 4. If the the new agent has a sufficient winning percentage, then repeat 1-3
 // with the new agent, otherwise repeat with the same agent.
@@ -170,7 +225,25 @@ Trainer::train() const
 
   for (unsigned i = 0; i < training_sessions; ++i) {
     auto game_results = play_training_games(champion);
-    auto contender = train_model(game_results, *champion);
+    for (const auto& game_result : game_results)
+      replay_buffer.add(game_result);
+
+    if (book_builder) {
+      for (const auto& game_result : game_results)
+        book_builder->add(game_result);
+      book_builder->write(opening_book_path);
+      book = std::make_shared<const OpeningBook>(opening_book_path);
+      std::cout << "Opening book has " << book->entries().size() << " moves"
+                << std::endl;
+    }
+
+    auto num_samples = replay_samples ? replay_samples : replay_buffer.size();
+    auto positions = replay_buffer.sample(num_samples);
+    std::cout << "Training on " << positions.size() << " positions from a "
+              << "replay buffer with " << replay_buffer.size() << " positions"
+              << std::endl;
+
+    auto contender = train_model(positions, *champion);
     auto match_stats = play_tournament(contender);
 
     std::cout << "Match stats:"
@@ -1,19 +1,27 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "blunder_player.h"
 #include "net.h"
 #include "game_result.h"
 #include "net.h"
+#include "opening_book.h"
+#include "replay_buffer.h"
 #include "search.h"
 #include "search_result.h"
+#include "simple_game.h"
+#include "tablebase.h"
 #include "tensor_decoder.h"
 #include "tensor_encoder.h"
+#include "train_step.h"
 
 namespace blunder {
 
@@ -43,12 +51,12 @@ private:
   play_tournament(std::shared_ptr<AlphaZeroNet> contender) const;
 
   // Creates a new version of the model by training the current model.
-  // @param game_results A collection of games for use as training data.
+  // @param positions A collection of positions for use as training data.
   // @param net The current version of the model.
-  // @return A new version of the model that is trained on game_results.
+  // @return A new version of the model that is trained on positions.
   std::shared_ptr<AlphaZeroNet>
   train_model(
-      std::span<const GameResult> game_results,
+      std::span<const TrainingPosition> positions,
       const AlphaZeroNet& net) const;
 
   // The total number of training sessions. Each session consists of a round of
@@ -79,9 +87,69 @@ private:
   // The directory where checkpoints are created.
   std::string checkpoint_dir;
 
+  // The number of worker threads used by the data loader to encode examples.
+  // If zero, examples are encoded on the training thread.
+  unsigned loader_workers = 2;
+
+  // The maximum number of batches the data loader prepares ahead of the
+  // training loop.
+  unsigned prefetch_batches = 4;
+
+  // The maximum number of positions kept in the replay buffer across training
+  // sessions.
+  std::size_t replay_window = 500000;
+
+  // The number of positions sampled from the replay buffer to train a model. If
+  // zero, then the number of samples is the number of positions in the buffer.
+  std::size_t replay_samples = 0;
+
+  // How positions are sampled from the replay buffer.
+  ReplaySampling replay_sampling = ReplaySampling::Uniform;
+
+  // Playout cap randomization for the training games. Disabled by default, i.e.
+  // every move uses the full search.
+  PlayoutCap playout_cap;
+
+  // The file of the opening book, which is extended with the training games of
+  // every session. If empty, then the games do not use an opening book.
+  std::string opening_book_path;
+
+  // How the players use the opening book in the training and tournament games.
+  BookOptions book_options;
+
+  // The directory of the tablebases. If empty, then the games do not use
+  // tablebases.
+  std::string tablebase_dir;
+
+  // The resignations and draws that end the training and tournament games
+  // early. Disabled by default.
+  Adjudication adjudication;
+
+  // The precision of the forward and backward passes during model training.
+  TrainingPrecision precision = TrainingPrecision::Float32;
+
+  // The factor to scale the loss by before the backward pass. bf16 has the same
+  // exponent range as fp32, so the default of 1 is usually fine with bf16.
+  float loss_scale = 1;
+
+  // The positions from the most recent training games.
+  mutable ReplayBuffer replay_buffer;
+
   std::shared_ptr<TensorDecoder> decoder = nullptr;
   std::shared_ptr<TensorEncoder> encoder = nullptr;
 
+  // The number of checkpoints created during model training, which numbers the
+  // checkpoints across training sessions.
+  mutable unsigned num_checkpoint = 0;
+
+  // The opening book, which is null until it has positions, and the builder
+  // that aggregates the training games into it.
+  mutable std::shared_ptr<const OpeningBook> book = nullptr;
+  mutable std::optional<OpeningBookBuilder> book_builder;
+
+  // The tablebases, which are null without a directory.
+  std::shared_ptr<const Tablebase> tablebase = nullptr;
+
   // The current champion network.
   mutable std::shared_ptr<AlphaZeroNet> champion = nullptr;
 
@@ -1,13 +1,23 @@
 #include "trainer_builder.h"
 
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <random>
 #include <stdexcept>
 
 #include "alpha_zero_decoder.h"
 #include "alpha_zero_encoder.h"
 #include "net.h"
+#include "opening_book.h"
+#include "replay_buffer.h"
+#include "simple_game.h"
+#include "tablebase.h"
 
 namespace blunder {
 
+namespace fs = std::filesystem;
+
 Trainer
 TrainerBuilder::build()
 {
@@ -35,11 +45,53 @@ TrainerBuilder::build()
     if (not trainer.max_moves_per_game)
       throw std::invalid_argument("max_moves_per_game must be non-zero.");
 
+    if (trainer.loader_workers and not trainer.prefetch_batches)
+      throw std::invalid_argument(
+          "prefetch_batches must be non-zero with loader workers.");
+
+    if (not trainer.replay_window)
+      throw std::invalid_argument("replay_window must be non-zero.");
+
+    if (not std::isfinite(trainer.loss_scale) or trainer.loss_scale <= 0)
+      throw std::invalid_argument("loss_scale must be positive and finite.");
+
+    const auto& adjudication = trainer.adjudication;
+    if (adjudication.resign_threshold < -1
+        or adjudication.resign_threshold >= 1)
+      throw std::invalid_argument("resign_threshold must be in range [-1,1).");
+
+    if (adjudication.no_resign_prob < 0 or adjudication.no_resign_prob > 1)
+      throw std::invalid_argument("no_resign_prob must be in range [0,1].");
+
+    if (adjudication.draw_threshold < 0 or adjudication.draw_threshold >= 1)
+      throw std::invalid_argument("draw_threshold must be in range [0,1).");
+
+    if (not trainer.opening_book_path.empty()) {
+      if (not trainer.book_options.max_plies)
+        throw std::invalid_argument("book max_plies must be non-zero.");
+      if (trainer.book_options.temperature < 0)
+        throw std::invalid_argument("book temperature must be non-negative.");
+
+      trainer.book_builder.emplace(trainer.book_options.max_plies);
+      if (fs::exists(trainer.opening_book_path)) {
+        trainer.book = std::make_shared<const OpeningBook>(
+            trainer.opening_book_path);
+        trainer.book_builder->add(*trainer.book);
+      }
+    }
+
+    if (not trainer.tablebase_dir.empty()) {
+      if (not fs::is_directory(trainer.tablebase_dir))
+        throw std::invalid_argument("tablebase_dir is not a directory.");
+      trainer.tablebase = std::make_shared<const Tablebase>(
+          trainer.tablebase_dir);
+    }
+
     if (trainer.checkpoint_dir.empty())
       trainer.checkpoint_dir = "checkpoints";
 
     if (not trainer.champion)
-      trainer.champion = std::make_shared<AlphaZeroNet>();
+      trainer.champion = std::make_shared<AlphaZeroNet>(net_config);
 
     if (not trainer.decoder)
       trainer.decoder = std::make_shared<AlphaZeroDecoder>();
@@ -47,6 +99,11 @@ TrainerBuilder::build()
     if (not trainer.encoder)
       trainer.encoder = std::make_shared<AlphaZeroEncoder>();
 
+    trainer.replay_buffer = ReplayBuffer(
+        trainer.replay_window,
+        trainer.replay_sampling,
+        std::random_device()());
+
     return trainer;
 }
 
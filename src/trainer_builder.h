@@ -1,5 +1,14 @@
 #pragma once
 
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "net.h"
+#include "opening_book.h"
+#include "replay_buffer.h"
+#include "simple_game.h"
+#include "train_step.h"
 #include "trainer.h"
 
 namespace blunder {
@@ -69,6 +78,99 @@ public:
     return *this;
   }
 
+  TrainerBuilder&
+  set_loader_workers(unsigned loader_workers)
+  {
+    trainer.loader_workers = loader_workers;
+    return *this;
+  }
+
+  TrainerBuilder&
+  set_prefetch_batches(unsigned prefetch_batches)
+  {
+    trainer.prefetch_batches = prefetch_batches;
+    return *this;
+  }
+
+  TrainerBuilder&
+  set_replay_window(std::size_t replay_window)
+  {
+    trainer.replay_window = replay_window;
+    return *this;
+  }
+
+  TrainerBuilder&
+  set_replay_samples(std::size_t replay_samples)
+  {
+    trainer.replay_samples = replay_samples;
+    return *this;
+  }
+
+  TrainerBuilder&
+  set_replay_sampling(ReplaySampling replay_sampling)
+  {
+    trainer.replay_sampling = replay_sampling;
+    return *this;
+  }
+
+  // Sets playout cap randomization for the training games, i.e. a random
+  // fraction of the moves use the full search and are policy targets, and the
+  // rest use a cheap search.
+  TrainerBuilder&
+  set_playout_cap(PlayoutCap playout_cap)
+  {
+    trainer.playout_cap = playout_cap;
+    return *this;
+  }
+
+  // Sets the file of the opening book that the training and tournament games
+  // play from with |book_options|. The book is read if the file exists, and is
+  // extended with the training games of every session.
+  TrainerBuilder&
+  set_opening_book(std::string opening_book_path, BookOptions book_options)
+  {
+    trainer.opening_book_path = std::move(opening_book_path);
+    trainer.book_options = book_options;
+    return *this;
+  }
+
+  // Sets the directory of the tablebases that end the training and tournament
+  // games, and that score their leaves. Throws an exception in build if the
+  // directory does not exist.
+  TrainerBuilder&
+  set_tablebase_dir(std::string tablebase_dir)
+  {
+    trainer.tablebase_dir = std::move(tablebase_dir);
+    return *this;
+  }
+
+  // Sets the resignations and draws that end the training and tournament games
+  // early. The tournament games never play out the games without resignations,
+  // since they are not used to check the resignations.
+  TrainerBuilder&
+  set_adjudication(Adjudication adjudication)
+  {
+    trainer.adjudication = adjudication;
+    return *this;
+  }
+
+  // Sets the precision of the forward and backward passes during model
+  // training, e.g. bf16 mixed precision on CPUs with bf16 instructions.
+  TrainerBuilder&
+  set_precision(TrainingPrecision precision)
+  {
+    trainer.precision = precision;
+    return *this;
+  }
+
+  // Sets the factor to scale the loss by before the backward pass.
+  TrainerBuilder&
+  set_loss_scale(float loss_scale)
+  {
+    trainer.loss_scale = loss_scale;
+    return *this;
+  }
+
   TrainerBuilder&
   set_champion_net(std::shared_ptr<AlphaZeroNet> champion)
   {
@@ -76,6 +178,15 @@ public:
     return *this;
   }
 
+  // Sets the architecture of the initial champion network, which is only used
+  // if the champion network is not set.
+  TrainerBuilder&
+  set_net_config(NetConfig net_config)
+  {
+    this->net_config = net_config;
+    return *this;
+  }
+
   TrainerBuilder&
   set_decoder(std::shared_ptr<TensorDecoder> decoder)
   {
@@ -95,6 +206,7 @@ public:
 
 private:
   Trainer trainer;
+  NetConfig net_config;
 };
 
 } // namespace blunder
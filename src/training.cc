@@ -1,10 +1,17 @@
 #include <cstdlib>
 #include <getopt.h>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 #include <unistd.h>
 
+#include "blunder_player.h"
 #include "board.h"
+#include "net.h"
+#include "opening_book.h"
+#include "simple_game.h"
+#include "train_step.h"
 #include "trainer_builder.h"
 
 using namespace blunder;
@@ -20,6 +27,20 @@ print_help(std::string_view prog, std::ostream& os)
      << "   -g|--tournament_games   The total number of tournament_games.\n"
      << "   -b|--batch_size         The number of examples to use per batch.\n"
      << "   -c|--checkpoint_steps   Number of steps before creating a checkpoint.\n"
+     << "   -w|--replay_window      Max number of positions in the replay buffer.\n"
+     << "   -n|--blocks             The number of residual blocks in the network.\n"
+     << "   -f|--filters            The number of filters in the network.\n"
+     << "   -m|--bf16               Train with bf16 mixed precision.\n"
+     << "   -l|--loss_scale         The factor to scale the loss by.\n"
+     << "   -q|--fast_simulations   Simulations of the cheap searches in self play.\n"
+     << "   -p|--full_search_prob   The probability of a full search in self play.\n"
+     << "   -o|--opening_book       The opening book file to play and extend.\n"
+     << "   -d|--book_depth         The number of plies to play from the book.\n"
+     << "   -r|--book_temperature   The temperature of the book moves.\n"
+     << "   -x|--tablebases         The directory of the endgame tablebases.\n"
+     << "   -v|--resign_threshold   The value below which self play resigns.\n"
+     << "   -u|--no_resign_prob     The fraction of games without resignations.\n"
+     << "   -a|--draw_plies         Plies near a zero value to adjudicate a draw.\n"
      << std::endl;
 }
 
@@ -34,6 +55,20 @@ main(int argc, char** argv)
     {"tournament_games", required_argument, nullptr, 'g'},
     {"batch_size", required_argument, nullptr, 'b'},
     {"checkpoint_steps", required_argument, nullptr, 'c'},
+    {"replay_window", required_argument, nullptr, 'w'},
+    {"blocks", required_argument, nullptr, 'n'},
+    {"filters", required_argument, nullptr, 'f'},
+    {"bf16", no_argument, nullptr, 'm'},
+    {"loss_scale", required_argument, nullptr, 'l'},
+    {"fast_simulations", required_argument, nullptr, 'q'},
+    {"full_search_prob", required_argument, nullptr, 'p'},
+    {"opening_book", required_argument, nullptr, 'o'},
+    {"book_depth", required_argument, nullptr, 'd'},
+    {"book_temperature", required_argument, nullptr, 'r'},
+    {"tablebases", required_argument, nullptr, 'x'},
+    {"resign_threshold", required_argument, nullptr, 'v'},
+    {"no_resign_prob", required_argument, nullptr, 'u'},
+    {"draw_plies", required_argument, nullptr, 'a'},
     {0, 0, 0, 0},
   };
 
@@ -43,11 +78,20 @@ main(int argc, char** argv)
   unsigned training_epochs = 10;
   unsigned tournament_games = 20;
   unsigned checkpoint_steps = 10;
+  unsigned replay_window = 500000;
+  NetConfig net_config;
+  auto precision = TrainingPrecision::Float32;
+  float loss_scale = 1;
+  PlayoutCap playout_cap;
+  std::string opening_book;
+  BookOptions book_options{.max_plies=8};
+  std::string tablebase_dir;
+  Adjudication adjudication;
 
   // TODO: factor out some of the logic to parse the arguments.
 
   while (true) {
-    auto ret = getopt_long(argc, argv, "ht:s:e:g:b:c:", longopts, nullptr);
+    auto ret = getopt_long(argc, argv, "ht:s:e:g:b:c:w:n:f:ml:q:p:o:d:r:x:v:u:a:", longopts, nullptr);
     if (ret == -1) break;
     switch (ret) {
       case 'h':
@@ -113,6 +157,129 @@ main(int argc, char** argv)
           return EXIT_FAILURE;
         }
         break;
+      case 'w':
+        try {
+          // A negative window would wrap around in the unsigned window.
+          auto window = std::stol(optarg);
+          if (window <= 0)
+            throw std::out_of_range("The replay window must be positive.");
+          replay_window = window;
+        } catch (...) {
+          std::cerr << "--replay_window needs to be a valid number greather than 0"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'n':
+        try {
+          net_config.blocks = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--blocks needs to be a valid number greather than 0"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'f':
+        try {
+          net_config.filters = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--filters needs to be a valid number greather than 0"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'm':
+        precision = TrainingPrecision::BFloat16;
+        break;
+      case 'l':
+        try {
+          loss_scale = std::stof(optarg);
+        } catch (...) {
+          std::cerr << "--loss_scale needs to be a valid number greather than 0"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'q':
+        try {
+          playout_cap.fast_simulations = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--fast_simulations needs to be a valid number greather than 0"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'p':
+        try {
+          playout_cap.full_search_prob = std::stof(optarg);
+        } catch (...) {
+          std::cerr << "--full_search_prob needs to be a valid number in (0,1]"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'o':
+        opening_book = optarg;
+        break;
+      case 'd':
+        try {
+          book_options.max_plies = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--book_depth needs to be a valid number greather than 0"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'r':
+        try {
+          book_options.temperature = std::stof(optarg);
+        } catch (...) {
+          std::cerr << "--book_temperature needs to be a valid number"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'x':
+        tablebase_dir = optarg;
+        break;
+      case 'v':
+        try {
+          adjudication.resign_threshold = std::stof(optarg);
+        } catch (...) {
+          std::cerr << "--resign_threshold needs to be a valid number in [-1,1)"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'u':
+        try {
+          adjudication.no_resign_prob = std::stof(optarg);
+        } catch (...) {
+          std::cerr << "--no_resign_prob needs to be a valid number in [0,1]"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'a':
+        try {
+          adjudication.draw_plies = std::stol(optarg);
+        } catch (...) {
+          std::cerr << "--draw_plies needs to be a valid number"
+              << " but got " << optarg << std::endl;
+          print_help(argv[0], std::cout);
+          return EXIT_FAILURE;
+        }
+        break;
       default:
         std::cerr << "Received unknown command line option.\n";
         print_help(argv[0], std::cerr);
@@ -130,6 +297,14 @@ main(int argc, char** argv)
       .set_tournament_games(tournament_games)
       .set_checkpoint_steps(checkpoint_steps)
       .set_batch_size(batch_size)
+      .set_replay_window(replay_window)
+      .set_net_config(net_config)
+      .set_precision(precision)
+      .set_loss_scale(loss_scale)
+      .set_playout_cap(playout_cap)
+      .set_opening_book(opening_book, book_options)
+      .set_tablebase_dir(tablebase_dir)
+      .set_adjudication(adjudication)
       .build()
       .train();
   } catch (std::exception& err) {
@@ -0,0 +1,157 @@
+#include <cstdlib>
+#include <filesystem>
+#include <getopt.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "alpha_zero_decoder.h"
+#include "alpha_zero_encoder.h"
+#include "board.h"
+#include "evaluator.h"
+#include "folded_net.h"
+#include "inference_channel.h"
+#include "inference_evaluator.h"
+#include "inference_net.h"
+#include "net.h"
+#include "remote_evaluator.h"
+#include "script_net.h"
+#include "uci_engine.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+void
+print_help(std::string_view prog, std::ostream& os)
+{
+  os << "Usage: " << prog << " [options] ... [bench [nodes]]\n"
+     << "   -h|--help    Print this help message.\n"
+     << "   -n|--net     The network exported with export_net. Without it,\n"
+     << "                the network has random weights, which is only\n"
+     << "                useful to measure the speed of the search.\n"
+     << "   -f|--format  The format of the network, i.e. script or flat.\n"
+     << "                Defaults to script.\n"
+     << "   -s|--server  The channel of an eval_server that evaluates the\n"
+     << "                positions instead of a network in this process.\n"
+     << "\n"
+     << "Speaks UCI on stdin and stdout, or with bench, searches a fixed list\n"
+     << "of positions, prints the nodes per second, and exits.\n"
+     << std::endl;
+}
+
+// Loads the network in |net_file|, or creates a network with random weights if
+// |net_file| is empty.
+std::shared_ptr<InferenceNet>
+load_net(const fs::path& net_file, std::string_view format)
+{
+  if (net_file.empty()) {
+    AlphaZeroNet random_net;
+    random_net.on_device(torch::kCPU);
+    random_net.set_eval_mode();
+    return std::make_shared<FoldedNet>(random_net);
+  }
+  if (format == "flat")
+    return std::make_shared<FoldedNet>(FoldedNet::load(net_file));
+  return std::make_shared<ScriptNet>(net_file);
+}
+
+int
+main(int argc, char** argv)
+{
+  struct option longopts[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"net", required_argument, nullptr, 'n'},
+    {"format", required_argument, nullptr, 'f'},
+    {"server", required_argument, nullptr, 's'},
+    {0, 0, 0, 0},
+  };
+
+  fs::path net_file;
+  std::string_view format = "script";
+  std::string server;
+
+  while (true) {
+    auto ret = getopt_long(argc, argv, "hn:f:s:", longopts, nullptr);
+    if (ret == -1) break;
+    switch (ret) {
+      case 'h':
+        print_help(argv[0], std::cout);
+        return EXIT_SUCCESS;
+      case 'n':
+        net_file = optarg;
+        break;
+      case 'f':
+        format = optarg;
+        if (format != "script" and format != "flat") {
+          std::cerr << "--format needs to be script or flat, but got "
+                    << format << std::endl;
+          print_help(argv[0], std::cerr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 's':
+        server = optarg;
+        break;
+      default:
+        std::cerr << "Received unknown command line option.\n";
+        print_help(argv[0], std::cerr);
+        return EXIT_FAILURE;
+    }
+  }
+
+  // The remaining arguments, if any, are a bench command.
+  std::string bench_command;
+  for (int i = optind; i < argc; ++i) {
+    if (not bench_command.empty())
+      bench_command += ' ';
+    bench_command += argv[i];
+  }
+  if (not bench_command.empty() and not bench_command.starts_with("bench")) {
+    std::cerr << "Unknown command " << bench_command << std::endl;
+    print_help(argv[0], std::cerr);
+    return EXIT_FAILURE;
+  }
+
+  Board::register_magics();
+
+  std::shared_ptr<Evaluator> evaluator;
+  try {
+    if (not server.empty()) {
+      // The server owns the network, so only the encoding of the positions
+      // and the decoding of the replies run here.
+      evaluator = std::make_shared<RemoteEvaluator>(
+          std::make_shared<InferenceChannel>(InferenceChannel::open(server)),
+          std::make_shared<AlphaZeroDecoder>(),
+          std::make_shared<AlphaZeroEncoder>());
+    } else {
+      evaluator = std::make_shared<InferenceEvaluator>(
+          load_net(net_file, format),
+          std::make_shared<AlphaZeroDecoder>(),
+          std::make_shared<AlphaZeroEncoder>());
+    }
+  } catch (const std::exception& err) {
+    std::cerr << "Unable to load "
+              << (server.empty() ? net_file.string() : server) << ": "
+              << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  UciEngine engine(std::move(evaluator), std::cout);
+
+  if (not bench_command.empty()) {
+    engine.handle(bench_command);
+    return EXIT_SUCCESS;
+  }
+
+  if (net_file.empty() and server.empty())
+    std::cout << "info string Using a network with random weights" << std::endl;
+
+  engine.loop(std::cin);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,449 @@
+#include "uci_engine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <format>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "board_path.h"
+#include "cached_evaluator.h"
+#include "fen.h"
+#include "mcts.h"
+#include "parallel_search.h"
+#include "search_result.h"
+#include "time_types.h"
+#include "timer.h"
+
+namespace blunder {
+namespace {
+
+constexpr unsigned kMaxThreads = 256;
+constexpr unsigned kMaxHashMb = 1 << 16;
+
+// The simulations of Mcts::run without limits, which the engine never uses.
+constexpr unsigned kSimulations = 800;
+
+// The moves left until the next time control when the GUI does not tell.
+constexpr unsigned kMovesToGo = 30;
+
+// The time kept on the clock for the GUI to receive the move.
+constexpr Milliseconds kMoveOverhead{30};
+
+// The positions searched by bench, from the opening to the endgame.
+constexpr std::string_view kBenchFens[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+  "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+  "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+  "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+  "3br1k1/p1pn3p/1p3n2/5pNq/2P1p3/1PN3PP/P2Q1PB1/4R1K1 w - - 0 23",
+  "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+};
+
+// Splits |command| into tokens separated by whitespace.
+std::vector<std::string_view>
+split(std::string_view command)
+{
+  std::vector<std::string_view> tokens;
+  auto is_space = [](char c) { return std::isspace(c); };
+
+  auto iter = command.begin();
+  while (true) {
+    iter = std::find_if_not(iter, command.end(), is_space);
+    if (iter == command.end())
+      break;
+    auto token_end = std::find_if(iter, command.end(), is_space);
+    tokens.emplace_back(iter, token_end);
+    iter = token_end;
+  }
+
+  return tokens;
+}
+
+// Joins |tokens| with a space between them.
+std::string
+join(std::span<const std::string_view> tokens)
+{
+  std::string joined;
+  for (auto token : tokens) {
+    if (not joined.empty())
+      joined += ' ';
+    joined += token;
+  }
+  return joined;
+}
+
+std::string
+to_lower(std::string_view str)
+{
+  std::string lower(str);
+  for (auto& c : lower)
+    c = std::tolower(c);
+  return lower;
+}
+
+// Parses |token| as a non-negative number. Throws an exception if it is not a
+// valid number.
+std::int64_t
+to_number(std::string_view token)
+{
+  std::size_t pos = 0;
+  auto number = std::stoll(std::string(token), &pos);
+  if (pos != token.size() or number < 0)
+    throw std::invalid_argument(std::format("Invalid number {}", token));
+  return number;
+}
+
+// Returns the time to search a move with |remaining| time on the clock, an
+// increment of |inc| per move, and |moves_to_go| moves until the next time
+// control, if known.
+Milliseconds
+move_time(Milliseconds remaining, Milliseconds inc, unsigned moves_to_go)
+{
+  auto moves = moves_to_go ? moves_to_go : kMovesToGo;
+  auto time = remaining / moves + inc * 3 / 4;
+  auto max_time = std::max(remaining - kMoveOverhead, Milliseconds(1));
+  return std::clamp(time, Milliseconds(1), max_time);
+}
+
+} // namespace
+
+UciEngine::UciEngine(std::shared_ptr<Evaluator> evaluator, std::ostream& out)
+  : evaluator(std::move(evaluator)),
+    out(out)
+{
+  if (not this->evaluator)
+    throw std::invalid_argument("evaluator cannot be null.");
+
+  boards.push_back(Board::new_board());
+  new_search();
+}
+
+bool
+UciEngine::handle(std::string_view command)
+{
+  auto tokens = split(command);
+  if (tokens.empty())
+    return true;
+
+  auto name = tokens.front();
+  auto args = Tokens(tokens).subspan(1);
+
+  try {
+    if (name == "uci") {
+      uci();
+    } else if (name == "isready") {
+      print("readyok");
+    } else if (name == "ucinewgame") {
+      stop();
+      boards = {Board::new_board()};
+      new_search();
+    } else if (name == "setoption") {
+      stop();
+      set_option(args);
+    } else if (name == "position") {
+      stop();
+      set_position(args);
+    } else if (name == "go") {
+      stop();
+      go(args);
+    } else if (name == "stop") {
+      stop();
+    } else if (name == "bench") {
+      stop();
+      bench(args.empty() ? kSimulations : to_number(args.front()));
+    } else if (name == "quit") {
+      stop();
+      return false;
+    } else {
+      print(std::format("info string Unknown command {}", name));
+    }
+  } catch (const std::exception& err) {
+    print(std::format("info string Error in {}: {}", name, err.what()));
+  }
+
+  return true;
+}
+
+void
+UciEngine::loop(std::istream& in)
+{
+  std::string command;
+  while (std::getline(in, command)) {
+    if (not handle(command))
+      return;
+  }
+  stop();
+}
+
+void
+UciEngine::wait()
+{
+  if (search_thread.joinable())
+    search_thread.join();
+}
+
+BenchResult
+UciEngine::bench(unsigned nodes)
+{
+  if (not nodes)
+    throw std::invalid_argument("bench needs a non-zero number of nodes.");
+
+  stop();
+  new_search();
+
+  BenchResult bench_result;
+  unsigned i = 0;
+  for (auto fen : kBenchFens) {
+    auto board = read_fen(fen);
+    if (not board)
+      throw std::logic_error(std::format("Invalid bench position {}", fen));
+
+    EvalBoardPath board_path;
+    board_path.push(*board);
+
+    Timer timer;
+    timer.start();
+    auto result = search->run(
+        board_path, SearchLimits{.nodes=nodes, .root_noise=false});
+    timer.end();
+
+    bench_result.nodes += result.nodes_visited;
+    bench_result.millis += timer.total_millis();
+    print(std::format(
+        "info string bench position {}/{} nodes {} time {}",
+        ++i, std::size(kBenchFens), result.nodes_visited,
+        timer.total_millis()));
+  }
+
+  // The same summary as other engines, which match harnesses know how to read.
+  print("===========================");
+  print(std::format("Total time (ms) : {}", bench_result.millis));
+  print(std::format("Nodes searched  : {}", bench_result.nodes));
+  print(std::format("Nodes/second    : {}", bench_result.nps()));
+
+  // The trees and the cache of the bench positions are not useful for a game.
+  new_search();
+
+  return bench_result;
+}
+
+void
+UciEngine::uci()
+{
+  print("id name blunder");
+  print("id author the blunder authors");
+  print(std::format(
+      "option name Threads type spin default 1 min 1 max {}", kMaxThreads));
+  print(std::format(
+      "option name Hash type spin default 16 min 0 max {}", kMaxHashMb));
+  print("uciok");
+}
+
+void
+UciEngine::set_option(Tokens tokens)
+{
+  // The name and the value can have spaces, i.e.
+  // name <name> [value <value>].
+  auto value_iter = std::ranges::find(tokens, "value");
+  if (tokens.empty() or tokens.front() != "name" or value_iter == tokens.end())
+    throw std::invalid_argument("Expected name <name> value <value>.");
+
+  auto option = to_lower(join({tokens.begin() + 1, value_iter}));
+  auto value = join({value_iter + 1, tokens.end()});
+
+  if (option == "threads") {
+    auto n = to_number(value);
+    if (n < 1 or n > kMaxThreads)
+      throw std::invalid_argument(std::format("Invalid Threads {}", value));
+    threads = n;
+  } else if (option == "hash") {
+    auto n = to_number(value);
+    if (n > kMaxHashMb)
+      throw std::invalid_argument(std::format("Invalid Hash {}", value));
+    hash_mb = n;
+  } else {
+    throw std::invalid_argument(std::format("Unknown option {}", option));
+  }
+
+  new_search();
+}
+
+void
+UciEngine::set_position(Tokens tokens)
+{
+  auto moves_iter = std::ranges::find(tokens, "moves");
+
+  std::vector<Board> new_boards;
+  if (not tokens.empty() and tokens.front() == "startpos") {
+    new_boards.push_back(Board::new_board());
+  } else if (not tokens.empty() and tokens.front() == "fen") {
+    auto fen = join({tokens.begin() + 1, moves_iter});
+    auto board = read_fen(fen);
+    if (not board)
+      throw std::invalid_argument(std::format("Invalid FEN {}", fen));
+    new_boards.push_back(std::move(*board));
+  } else {
+    throw std::invalid_argument("Expected startpos or fen.");
+  }
+
+  if (moves_iter != tokens.end()) {
+    for (auto move : Tokens(moves_iter + 1, tokens.end())) {
+      auto children = new_boards.back().next();
+      auto child = std::ranges::find_if(children, [&](const auto& board) {
+        return board.last_move()->uci() == move;
+      });
+      if (child == children.end())
+        throw std::invalid_argument(std::format("Illegal move {}", move));
+
+      // Record repetitions, which the search treats as draws.
+      child->find_repetition(new_boards | std::views::reverse);
+      new_boards.push_back(std::move(*child));
+    }
+  }
+
+  boards = std::move(new_boards);
+}
+
+void
+UciEngine::go(Tokens tokens)
+{
+  SearchLimits limits{.root_noise=false};
+  Milliseconds wtime{0};
+  Milliseconds btime{0};
+  Milliseconds winc{0};
+  Milliseconds binc{0};
+  unsigned moves_to_go = 0;
+  bool infinite = false;
+
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    auto token = tokens[i];
+    if (token == "infinite") {
+      infinite = true;
+      continue;
+    }
+    if (token == "ponder")
+      continue;
+
+    if (i + 1 == tokens.size())
+      throw std::invalid_argument(std::format("{} needs a value", token));
+    auto value = tokens[++i];
+
+    if (token == "wtime")
+      wtime = Milliseconds(to_number(value));
+    else if (token == "btime")
+      btime = Milliseconds(to_number(value));
+    else if (token == "winc")
+      winc = Milliseconds(to_number(value));
+    else if (token == "binc")
+      binc = Milliseconds(to_number(value));
+    else if (token == "movestogo")
+      moves_to_go = to_number(value);
+    else if (token == "movetime")
+      limits.time = Milliseconds(to_number(value));
+    else if (token == "nodes")
+      limits.nodes = to_number(value);
+    // Other limits, e.g. depth, do not apply to the search and are ignored.
+  }
+
+  const auto& board = boards.back();
+  if (not infinite and limits.time == Milliseconds(0)) {
+    auto remaining = board.is_white_next() ? wtime : btime;
+    auto inc = board.is_white_next() ? winc : binc;
+    if (remaining != Milliseconds(0))
+      limits.time = move_time(remaining, inc, moves_to_go);
+  }
+
+  // Without any limit the search runs until stop, like infinite.
+  if (limits.time == Milliseconds(0) and not limits.nodes)
+    infinite = true;
+
+  if (infinite) {
+    limits.time = Milliseconds(0);
+    limits.nodes = 0;
+  }
+
+  search_thread = std::jthread(
+      [this, limits, infinite](std::stop_token stop_token) mutable {
+    std::string best_move = "0000";
+    if (not boards.back().next().empty()) {
+      limits.stop_token = stop_token;
+      auto board_path = EvalBoardPath::rev(boards);
+      try {
+        auto result = search->run(board_path, limits);
+        auto nodes = result.nodes_visited;
+        auto millis = static_cast<std::int64_t>(result.millis_search_time);
+        best_move = result.best.board.last_move()->uci();
+        print(std::format(
+            "info depth {} nodes {} nps {} time {} pv {}",
+            result.depth, nodes,
+            nodes * 1000 / std::max<std::int64_t>(millis, 1), millis,
+            best_move));
+      } catch (const std::exception& err) {
+        print(std::format("info string Error in search: {}", err.what()));
+      }
+    }
+
+    // The best move of an infinite search is only sent after stop.
+    if (infinite) {
+      std::mutex mtx;
+      std::condition_variable_any cv;
+      std::unique_lock lock(mtx);
+      cv.wait(lock, stop_token, [] { return false; });
+    }
+
+    print(std::format("bestmove {}", best_move));
+  });
+}
+
+void
+UciEngine::stop()
+{
+  if (search_thread.joinable()) {
+    search_thread.request_stop();
+    search_thread.join();
+  }
+}
+
+void
+UciEngine::new_search()
+{
+  std::shared_ptr<Evaluator> search_evaluator = evaluator;
+  if (hash_mb) {
+    search_evaluator = std::make_shared<CachedEvaluator>(
+        evaluator, static_cast<std::size_t>(hash_mb) << 20);
+  }
+
+  // The searches need different seeds for the noise of the root priors.
+  std::vector<std::shared_ptr<Search>> searches;
+  for (unsigned i = 0; i < threads; ++i) {
+    auto mcts = std::make_shared<Mcts>(search_evaluator, kSimulations, i);
+    mcts->set_tree_reuse(true);
+    searches.push_back(std::move(mcts));
+  }
+
+  search = std::make_shared<ParallelSearch>(std::move(searches));
+}
+
+void
+UciEngine::print(std::string_view line)
+{
+  std::lock_guard lock(out_mtx);
+  out << line << std::endl;
+}
+
+} // namespace blunder
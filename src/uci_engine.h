@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "evaluator.h"
+#include "search.h"
+#include "search_limits.h"
+
+namespace blunder {
+
+// The totals of a bench run.
+struct BenchResult {
+  // The nodes visited over all the positions.
+  std::uint64_t nodes = 0;
+
+  // The total time of the searches.
+  std::int64_t millis = 0;
+
+  // Returns the nodes visited per second.
+  std::uint64_t
+  nps() const noexcept
+  { return nodes * 1000 / std::max<std::int64_t>(millis, 1); }
+};
+
+// An engine that speaks the UCI protocol, i.e. it handles the commands from a
+// GUI or a match harness, and writes the responses to an output stream. The
+// search is a ParallelSearch of Mcts, one per thread, which keep their trees
+// between moves and share a CachedEvaluator when the hash is set. A search runs
+// on a background thread, so that stop can interrupt it.
+//
+// Supported commands:
+// - uci, isready, ucinewgame, quit.
+// - setoption name Threads|Hash value <n>.
+// - position startpos|fen <fen> [moves <move> ...].
+// - go [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>]
+//      [movetime <ms>] [nodes <n>] [infinite].
+// - stop.
+// - bench [nodes], which is not part of UCI, to search a fixed list of
+//   positions and print the total nodes and nodes per second.
+class UciEngine {
+public:
+  // Initializes the engine with the evaluator for the searches and the stream
+  // for the responses.
+  UciEngine(std::shared_ptr<Evaluator> evaluator, std::ostream& out);
+
+  // Handles a single command. Returns false if the command is quit. Errors in
+  // a command are reported as an info string, and the command is ignored.
+  bool
+  handle(std::string_view command);
+
+  // Handles the commands from |in| until quit, or until the end of the input.
+  void
+  loop(std::istream& in);
+
+  // Waits for the current search, if any, to finish on its own.
+  void
+  wait();
+
+  // Searches each of the bench positions from scratch until |nodes| nodes are
+  // visited, and prints the total nodes and nodes per second.
+  BenchResult
+  bench(unsigned nodes);
+
+private:
+  using Tokens = std::span<const std::string_view>;
+
+  void
+  uci();
+
+  void
+  set_option(Tokens tokens);
+
+  void
+  set_position(Tokens tokens);
+
+  void
+  go(Tokens tokens);
+
+  // Stops the current search, if any, and waits for it to print its move.
+  void
+  stop();
+
+  // Builds the searches with the current options, which also discards their
+  // trees and the cache.
+  void
+  new_search();
+
+  // Writes |line| to the output.
+  void
+  print(std::string_view line);
+
+  std::shared_ptr<Evaluator> evaluator;
+  std::shared_ptr<Search> search;
+  unsigned threads = 1;
+  unsigned hash_mb = 16;
+
+  // The position to search and the boards leading up to it.
+  std::vector<Board> boards;
+
+  std::ostream& out;
+  std::mutex out_mtx;
+  // Declared last, since the thread is stopped and joined on destruction before
+  // the members it uses are destroyed.
+  std::jthread search_thread;
+};
+
+} // namespace blunder
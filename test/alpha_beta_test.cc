@@ -0,0 +1,195 @@
+#include "alpha_beta.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+
+#include "blunder_player.h"
+#include "board.h"
+#include "board_path.h"
+#include "fen.h"
+#include "gtest/gtest.h"
+#include "nnue.h"
+#include "search_limits.h"
+#include "timer.h"
+
+using namespace blunder;
+
+class AlphaBetaTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  // Returns the board for |fen|.
+  static Board
+  board_from(std::string_view fen)
+  {
+    auto board = read_fen(fen);
+    if (not board)
+      throw std::invalid_argument("Invalid FEN in test.");
+    return *board;
+  }
+
+  SearchResult
+  run(const Board& board)
+  {
+    EvalBoardPath board_path;
+    board_path.push(board);
+    return search.run(board_path);
+  }
+
+  SearchResult
+  run(const Board& board, const SearchLimits& limits)
+  {
+    EvalBoardPath board_path;
+    board_path.push(board);
+    return search.run(board_path, limits);
+  }
+
+  AlphaBeta search{/*depth=*/4, /*table_bytes=*/1 << 20};
+};
+
+TEST_F(AlphaBetaTest, EvaluatesStartingPositionAsEven)
+{ EXPECT_EQ(AlphaBeta::evaluate(Board::new_board()), 0); }
+
+TEST_F(AlphaBetaTest, EvaluationIsSymmetric)
+{
+  auto white = board_from("4k3/8/8/8/8/8/3PN3/4K3 w - - 0 1");
+  auto black = board_from("4k3/3pn3/8/8/8/8/8/4K3 b - - 0 1");
+  EXPECT_GT(AlphaBeta::evaluate(white), 0);
+  EXPECT_EQ(AlphaBeta::evaluate(white), AlphaBeta::evaluate(black));
+
+  // The same position is bad for the player without the pieces.
+  auto other = board_from("4k3/8/8/8/8/8/3PN3/4K3 b - - 0 1");
+  EXPECT_EQ(AlphaBeta::evaluate(other), -AlphaBeta::evaluate(white));
+}
+
+TEST_F(AlphaBetaTest, FindsMateInOne)
+{
+  auto result = run(board_from("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1"));
+  EXPECT_TRUE(result.best.board.is_mate());
+  EXPECT_GT(result.value, 0.99);
+}
+
+TEST_F(AlphaBetaTest, PrefersMateToStalemate)
+{
+  // Qc7 stalemates, whereas Qc8 mates.
+  auto result = run(board_from("k7/8/1K6/8/8/8/8/2Q5 w - - 0 1"));
+  EXPECT_TRUE(result.best.board.is_mate());
+}
+
+TEST_F(AlphaBetaTest, FindsMateInTwo)
+{
+  // Ra7 or Rb7 leave the king only g8, after which the other rook mates.
+  auto result = run(board_from("7k/8/8/8/8/8/R7/1R4K1 w - - 0 1"));
+  EXPECT_GT(result.value, 0.99);
+
+  for (const auto& reply : result.best.board.next()) {
+    bool has_mate = false;
+    for (const auto& next : reply.next())
+      has_mate = has_mate or next.is_mate();
+    EXPECT_TRUE(has_mate) << reply.last_move()->uci();
+  }
+}
+
+TEST_F(AlphaBetaTest, CapturesHangingQueen)
+{
+  auto result = run(board_from("4k3/8/8/3q4/8/8/8/3RK3 w - - 0 1"));
+  EXPECT_EQ(result.best.board.last_move()->uci(), "d1d5");
+}
+
+TEST_F(AlphaBetaTest, AvoidsLosingQueenToRecapture)
+{
+  // Qxd5 wins a pawn, but loses the queen to the pawn on e6.
+  auto result = run(board_from("4k3/8/4p3/3p4/8/8/3Q4/4K3 w - - 0 1"));
+  EXPECT_NE(result.best.board.last_move()->uci(), "d2d5");
+}
+
+TEST_F(AlphaBetaTest, PolicyIsOneHotOnBestMove)
+{
+  auto board = Board::new_board();
+  auto result = run(board);
+
+  EXPECT_EQ(result.moves.size(), board.next().size());
+  unsigned visits = 0;
+  for (const auto& move_prob : result.moves) {
+    visits += move_prob.visits;
+    if (move_prob.visits) {
+      EXPECT_EQ(move_prob.mv, *result.best.board.last_move());
+    }
+  }
+  EXPECT_EQ(visits, 1u);
+  EXPECT_EQ(result.depth, 4u);
+}
+
+TEST_F(AlphaBetaTest, DepthLimitOverridesConstructorDepth)
+{
+  auto result = run(Board::new_board(), SearchLimits{.depth=2});
+  EXPECT_EQ(result.depth, 2u);
+}
+
+TEST_F(AlphaBetaTest, StopsAtNodeLimit)
+{
+  auto result = run(Board::new_board(), SearchLimits{.nodes=500});
+  EXPECT_EQ(result.nodes_visited, 500u);
+  EXPECT_TRUE(result.best.board.last_move());
+}
+
+TEST_F(AlphaBetaTest, StopsAtTime)
+{
+  Timer timer;
+  timer.start();
+  auto result = run(
+      Board::new_board(), SearchLimits{.time=Milliseconds(50)});
+  timer.end();
+
+  EXPECT_GE(result.depth, 1u);
+  EXPECT_LT(timer.total_millis(), 1000);
+}
+
+TEST_F(AlphaBetaTest, StopsOnRequest)
+{
+  std::stop_source stop_source;
+  std::jthread stopper([&] {
+    std::this_thread::sleep_for(Milliseconds(50));
+    stop_source.request_stop();
+  });
+
+  auto result = run(
+      Board::new_board(), SearchLimits{.stop_token=stop_source.get_token()});
+  EXPECT_GE(result.depth, 1u);
+}
+
+TEST_F(AlphaBetaTest, ThrowsOnTerminalBoard)
+{
+  auto board = board_from("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1");
+  EXPECT_THROW(run(board), std::invalid_argument);
+}
+
+TEST_F(AlphaBetaTest, PlaysThroughBlunderPlayer)
+{
+  BlunderPlayer player(std::make_shared<AlphaBeta>(/*depth=*/3));
+
+  auto board = board_from("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+  GameBoardPath game_path;
+  game_path.push(board);
+
+  auto result = player.make_move(game_path);
+  EXPECT_TRUE(result.best.board.is_mate());
+}
+
+TEST_F(AlphaBetaTest, EvaluatesWithNetwork)
+{
+  // The network without weights evaluates every position as even, but the
+  // search still sees mates.
+  search.set_network(std::make_shared<Nnue>());
+  EXPECT_EQ(run(Board::new_board()).value, 0);
+  EXPECT_TRUE(
+      run(board_from("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1")).best.board.is_mate());
+
+  search.set_network(nullptr);
+  EXPECT_NE(run(Board::new_board()).value, 0);
+}
@@ -0,0 +1,161 @@
+#include "blunder_player.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "board.h"
+#include "board_path.h"
+#include "game_result.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "opening_book.h"
+#include "search.h"
+#include "search_limits.h"
+#include "search_result.h"
+
+using namespace blunder;
+
+namespace {
+
+constexpr unsigned kFullSimulations = 800;
+
+// A search that plays the first move, and records the simulations of every
+// search, where a search without limits is a full search.
+class FakeSearch : public Search {
+public:
+  SearchResult
+  run(const EvalBoardPath& board_path) const override
+  { return run(board_path, SearchLimits{.simulations=kFullSimulations}); }
+
+  SearchResult
+  run(const EvalBoardPath& board_path,
+      const SearchLimits& limits) const override
+  {
+    simulations.push_back(limits.simulations);
+    root_noise.push_back(limits.root_noise);
+    roots.push_back(board_path.root()->get());
+    stoppable.push_back(limits.stop_token.stop_possible());
+
+    SearchResult result;
+    result.best.board = board_path.root()->get().next().front();
+    result.simulations = limits.simulations;
+    return result;
+  }
+
+  mutable std::vector<unsigned> simulations;
+  mutable std::vector<bool> root_noise;
+  mutable std::vector<Board> roots;
+  mutable std::vector<bool> stoppable;
+};
+
+} // namespace
+
+class BlunderPlayerTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  {
+    Board::register_magics();
+    board = Board::new_board();
+    game_path.push(board);
+  }
+
+  Board board;
+  GameBoardPath game_path;
+  std::shared_ptr<FakeSearch> search = std::make_shared<FakeSearch>();
+};
+
+TEST_F(BlunderPlayerTest, WithoutPlayoutCapEveryMoveIsFullSearch)
+{
+  BlunderPlayer player(search);
+
+  for (int i = 0; i < 10; ++i)
+    EXPECT_TRUE(player.make_move(game_path).policy_target);
+
+  EXPECT_THAT(search->simulations, testing::Each(kFullSimulations));
+}
+
+TEST_F(BlunderPlayerTest, PlayoutCapMarksFastSearches)
+{
+  BlunderPlayer player(
+      search,
+      PlayoutCap{.fast_simulations=50, .full_search_prob=0.25},
+      /*seed=*/1);
+
+  unsigned full = 0;
+  constexpr unsigned kMoves = 400;
+  for (unsigned i = 0; i < kMoves; ++i) {
+    auto result = player.make_move(game_path);
+    if (result.policy_target) {
+      ++full;
+      EXPECT_EQ(result.simulations, kFullSimulations);
+    } else {
+      EXPECT_EQ(result.simulations, 50u);
+      EXPECT_FALSE(search->root_noise.back());
+    }
+  }
+
+  // About a quarter of the moves use the full search.
+  EXPECT_GT(full, kMoves / 8);
+  EXPECT_LT(full, kMoves / 2);
+}
+
+TEST_F(BlunderPlayerTest, PondersOnPositionAfterMove)
+{
+  BlunderPlayer player(search);
+  player.set_pondering(/*max_simulations=*/1000);
+
+  auto result = player.make_move(game_path);
+  // Wait for the ponder search to finish before looking at the searches.
+  player.set_pondering(0);
+
+  ASSERT_EQ(search->roots.size(), 2u);
+  EXPECT_EQ(search->roots[0], board);
+  EXPECT_FALSE(search->stoppable[0]);
+  EXPECT_EQ(search->roots[1], result.best.board);
+  EXPECT_EQ(search->simulations[1], 1000u);
+  EXPECT_TRUE(search->stoppable[1]);
+  EXPECT_FALSE(search->root_noise[1]);
+}
+
+TEST_F(BlunderPlayerTest, PlaysFromOpeningBook)
+{
+  // A book with the visits of the second move of the first two plies.
+  GameResult game_result;
+  game_result.game_start = board;
+  auto book_board = board;
+  for (int i = 0; i < 2; ++i) {
+    SearchResult result;
+    result.best.board = book_board.next()[1];
+    result.moves = {MoveProb::from(result.best)};
+    result.moves.front().visits = 10;
+    game_result.plies.push_back(PlyRecord::from(result));
+    book_board = result.best.board;
+  }
+
+  auto path = std::filesystem::temp_directory_path()
+    / "blunder-player-opening-book-test";
+  OpeningBookBuilder builder(/*max_plies=*/2);
+  builder.add(game_result);
+  builder.write(path);
+  auto book = std::make_shared<const OpeningBook>(path);
+  std::filesystem::remove(path);
+
+  BlunderPlayer player(search);
+  player.set_opening_book(book, BookOptions{.max_plies=2});
+
+  // The first two plies are from the book, and the third one is searched.
+  std::vector<Board> boards;
+  boards.reserve(3);
+  for (int i = 0; i < 3; ++i) {
+    auto result = player.make_move(game_path);
+    EXPECT_EQ(result.policy_target, i == 2);
+    if (i < 2) {
+      EXPECT_EQ(result.best.board, game_path.fast_back().next()[1]);
+    }
+    game_path.push(boards.emplace_back(result.best.board));
+  }
+  EXPECT_EQ(search->roots.size(), 1u);
+}
@@ -1,6 +1,9 @@
 #include "board.h"
 
+#include <algorithm>
 #include <iostream>
+#include <ranges>
+#include <string_view>
 #include <unordered_set>
 #include <vector>
 
@@ -696,3 +699,175 @@ TEST_F(BoardTest, UpdateWithMoves2)
 
   EXPECT_FALSE(children.empty());
 }
+
+TEST_F(BoardTest, MoveHistoryKeepsMostRecentMoves)
+{
+  MoveVec moves;
+  moves.emplace_back(Piece::knight(), Sq::g1, Sq::f3);
+  moves.emplace_back(Piece::knight(), Sq::g8, Sq::f6);
+  moves.emplace_back(Piece::knight(), Sq::f3, Sq::g1);
+  moves.emplace_back(Piece::knight(), Sq::f6, Sq::g8);
+  moves.emplace_back(Piece::pawn(), Sq::e2, Sq::e4);
+  moves.emplace_back(Piece::pawn(), Sq::e7, Sq::e5);
+
+  auto board = Board::new_board();
+  EXPECT_FALSE(board.last_move());
+  EXPECT_TRUE(board.move_history().empty());
+
+  board.update_with_moves(moves);
+
+  const auto& history = board.move_history();
+  ASSERT_EQ(history.size(), MoveHistory::kMaxMoves);
+  EXPECT_EQ(board.last_move(), moves.back());
+
+  for (unsigned i = 0; i < history.size(); ++i)
+    EXPECT_EQ(history.get(i), moves[moves.size() - 1 - i]);
+
+  EXPECT_FALSE(history.get(history.size()));
+}
+
+TEST_F(BoardTest, TranspositionsHaveSameHash)
+{
+  MoveVec moves1;
+  moves1.emplace_back(Piece::knight(), Sq::g1, Sq::f3);
+  moves1.emplace_back(Piece::knight(), Sq::g8, Sq::f6);
+  moves1.emplace_back(Piece::knight(), Sq::b1, Sq::c3);
+
+  MoveVec moves2;
+  moves2.emplace_back(Piece::knight(), Sq::b1, Sq::c3);
+  moves2.emplace_back(Piece::knight(), Sq::g8, Sq::f6);
+  moves2.emplace_back(Piece::knight(), Sq::g1, Sq::f3);
+
+  auto board1 = Board::new_board().update_with_moves(moves1);
+  auto board2 = Board::new_board().update_with_moves(moves2);
+
+  EXPECT_EQ(board1.hash(), board2.hash());
+  EXPECT_TRUE(board1.is_same_position(board2));
+  EXPECT_NE(board1.hash(), Board::new_board().hash());
+
+  auto fen_board = read_fen(
+      "rnbqkb1r/pppppppp/5n2/8/8/2N2N2/PPPPPPPP/R1BQKB1R b KQkq - 3 2");
+  ASSERT_TRUE(fen_board);
+  EXPECT_EQ(fen_board->hash(), board1.hash());
+}
+
+TEST_F(BoardTest, HashIsUpdatedForSpecialMoves)
+{
+  // Each move changes castling or en passant rights, or moves more than one
+  // piece, which the hash of the next position needs to account for.
+  struct {
+    std::string_view fen;
+    std::string_view move;
+    std::string_view next_fen;
+  } cases[] = {
+    {"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "e1g1",
+     "r3k2r/8/8/8/8/8/8/R4RK1 b kq - 1 1"},
+    {"r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1", "e8c8",
+     "2kr3r/8/8/8/8/8/8/R3K2R w KQ - 1 2"},
+    {"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "a1a8",
+     "R3k2r/8/8/8/8/8/8/4K2R b Kk - 0 1"},
+    {"4k3/8/8/8/3p4/8/4P3/4K3 w - - 0 1", "e2e4",
+     "4k3/8/8/8/3pP3/8/8/4K3 b - e3 0 1"},
+    {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6",
+     "4k3/8/3P4/8/8/8/8/4K3 b - - 0 1"},
+    {"r3k3/1P6/8/8/8/8/8/4K3 w q - 0 1", "b7a8q",
+     "Q3k3/8/8/8/8/8/8/4K3 b - - 0 1"},
+  };
+
+  for (const auto& [fen, move, next_fen] : cases) {
+    auto board = read_fen(fen);
+    auto next_board = read_fen(next_fen);
+    ASSERT_TRUE(board) << fen;
+    ASSERT_TRUE(next_board) << next_fen;
+
+    auto children = board->next();
+    auto child = std::ranges::find_if(children, [&](const auto& child) {
+      return child.last_move()->uci() == move;
+    });
+    ASSERT_NE(child, children.end()) << fen << " " << move;
+    EXPECT_TRUE(child->is_same_position(*next_board)) << fen << " " << move;
+    EXPECT_EQ(child->hash(), next_board->hash()) << fen << " " << move;
+  }
+}
+
+TEST_F(BoardTest, ThreefoldRepetitionIsDraw)
+{
+  MoveVec moves;
+  moves.emplace_back(Piece::knight(), Sq::g1, Sq::f3);
+  moves.emplace_back(Piece::knight(), Sq::g8, Sq::f6);
+  moves.emplace_back(Piece::knight(), Sq::f3, Sq::g1);
+  moves.emplace_back(Piece::knight(), Sq::f6, Sq::g8);
+
+  // Play the knight shuffle twice, so the initial position occurs three times.
+  std::vector<Board> boards;
+  boards.push_back(Board::new_board());
+  for (unsigned i = 0; i < 8; ++i) {
+    auto board = boards.back();
+    ASSERT_TRUE(board.update_with_move(moves[i % moves.size()]));
+    auto earlier = boards | std::views::reverse;
+    board.find_repetition(earlier);
+    boards.push_back(board);
+  }
+
+  EXPECT_EQ(boards[3].repetitions(), 0);
+  EXPECT_EQ(boards[4].repetitions(), 1);
+  EXPECT_FALSE(boards[4].is_terminal());
+  EXPECT_EQ(boards[5].repetitions(), 1);
+  EXPECT_EQ(boards[8].repetitions(), 2);
+  EXPECT_TRUE(boards[8].is_terminal());
+  EXPECT_FALSE(boards[8].is_mate());
+  EXPECT_TRUE(boards[8].next().empty());
+}
+
+TEST_F(BoardTest, InsufficientMaterialIsDraw)
+{
+  // A lone minor piece cannot mate, regardless of the side to move.
+  for (auto fen : {"8/8/8/4k3/8/8/8/K5N1 w - - 0 1",
+                   "8/8/8/4k3/8/8/8/K5N1 b - - 0 1",
+                   "8/8/8/4k3/8/8/8/K5B1 w - - 0 1",
+                   "8/8/8/4k3/8/8/8/K7 w - - 0 1"}) {
+    auto board = read_fen(fen);
+    ASSERT_TRUE(board) << fen;
+    EXPECT_TRUE(board->is_terminal()) << fen;
+    EXPECT_FALSE(board->is_mate()) << fen;
+  }
+
+  // A pawn, a rook, or a queen is enough, regardless of the side to move.
+  for (auto fen : {"8/P6k/8/8/8/8/8/K7 w - - 0 1",
+                   "8/P6k/8/8/8/8/8/K7 b - - 0 1",
+                   "8/7k/8/8/8/8/8/K5R1 w - - 0 1",
+                   "8/7k/8/8/8/8/8/K5Q1 b - - 0 1"}) {
+    auto board = read_fen(fen);
+    ASSERT_TRUE(board) << fen;
+    EXPECT_FALSE(board->is_terminal()) << fen;
+  }
+}
+
+TEST_F(BoardTest, LoneKingWithoutMovesIsMateOnlyInCheck)
+{
+  auto mate = read_fen("k1Q5/8/1K6/8/8/8/8/8 b - - 0 1");
+  ASSERT_TRUE(mate);
+  EXPECT_TRUE(mate->is_terminal());
+  EXPECT_TRUE(mate->is_mate());
+
+  auto stalemate = read_fen("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1");
+  ASSERT_TRUE(stalemate);
+  EXPECT_TRUE(stalemate->is_terminal());
+  EXPECT_FALSE(stalemate->is_mate());
+}
+
+TEST_F(BoardTest, RookCapturedByRookLosesCastlingRight)
+{
+  auto board = read_fen("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1");
+  ASSERT_TRUE(board);
+
+  auto children = board->next();
+  auto capture = std::ranges::find_if(children, [](const Board& child) {
+    return child.last_move()->uci() == "h8h1";
+  });
+  ASSERT_NE(capture, children.end());
+  EXPECT_FALSE(capture->has_white_king_castle());
+  EXPECT_TRUE(capture->has_white_queen_castle());
+  EXPECT_FALSE(capture->has_black_king_castle());
+  EXPECT_TRUE(capture->has_black_queen_castle());
+}
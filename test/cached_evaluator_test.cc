@@ -0,0 +1,94 @@
+#include "cached_evaluator.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "board.h"
+#include "board_path.h"
+#include "evaluator.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace blunder;
+
+namespace {
+
+// An evaluator that puts increasing priors on the moves, and counts the
+// evaluations.
+class CountingEvaluator : public Evaluator {
+public:
+  Prediction
+  predict(const EvalBoardPath& board_path) const override
+  {
+    ++evals;
+    Prediction pred;
+    pred.value = 0.5;
+    auto children = board_path.root()->get().next();
+    for (std::size_t i = 0; i < children.size(); ++i)
+      pred.move_probs.emplace_back(std::move(children[i]), i);
+    return pred;
+  }
+
+  mutable std::atomic<unsigned> evals = 0;
+};
+
+} // namespace
+
+class CachedEvaluatorTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  std::shared_ptr<CountingEvaluator> evaluator =
+    std::make_shared<CountingEvaluator>();
+};
+
+TEST_F(CachedEvaluatorTest, ThrowsWithoutEvaluatorOrRoom)
+{
+  EXPECT_THROW(CachedEvaluator(nullptr, 1 << 20), std::invalid_argument);
+  EXPECT_THROW(CachedEvaluator(evaluator, 1), std::invalid_argument);
+}
+
+TEST_F(CachedEvaluatorTest, ReturnsCachedPrediction)
+{
+  CachedEvaluator cache(evaluator, 1 << 20);
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+
+  auto pred = cache.predict(board_path);
+  auto cached_pred = cache.predict(board_path);
+
+  EXPECT_EQ(evaluator->evals, 1u);
+  EXPECT_EQ(cache.hits(), 1u);
+  EXPECT_EQ(cache.lookups(), 2u);
+  EXPECT_EQ(cached_pred.value, pred.value);
+  ASSERT_EQ(cached_pred.move_probs.size(), pred.move_probs.size());
+  for (std::size_t i = 0; i < pred.move_probs.size(); ++i) {
+    EXPECT_EQ(cached_pred.move_probs[i].first, pred.move_probs[i].first);
+    EXPECT_EQ(cached_pred.move_probs[i].second, pred.move_probs[i].second);
+  }
+}
+
+TEST_F(CachedEvaluatorTest, HistoryIsPartOfTheKey)
+{
+  CachedEvaluator cache(evaluator, 1 << 20);
+  auto board = Board::new_board();
+  auto child = board.next().front();
+
+  EvalBoardPath board_path;
+  board_path.push(child);
+  cache.predict(board_path);
+
+  // The same position, but with the board before it in the path.
+  EvalBoardPath path_with_history;
+  path_with_history.push(child);
+  path_with_history.push(board);
+  cache.predict(path_with_history);
+
+  EXPECT_EQ(evaluator->evals, 2u);
+  EXPECT_EQ(cache.hits(), 0u);
+}
@@ -0,0 +1,121 @@
+#include "checkpoint_writer.h"
+
+#include <filesystem>
+
+#include <torch/torch.h>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "net.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+class CheckpointWriterTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  {
+    root_dir = fs::temp_directory_path() / "blunder-checkpoint-writer-test";
+    fs::remove_all(root_dir);
+    fs::create_directories(root_dir);
+    net.on_device(torch::kCPU);
+  }
+
+  void
+  TearDown() override
+  { fs::remove_all(root_dir); }
+
+  AlphaZeroNet net{NetConfig{.blocks=1, .filters=8, .value_hidden=8}};
+  fs::path root_dir;
+};
+
+TEST_F(CheckpointWriterTest, WritesLoadableCheckpoint)
+{
+  torch::optim::SGD optimizer(net.all_parameters(), /*lr=*/0.01);
+  auto checkpoint_dir = root_dir / "model-0000";
+
+  CheckpointWriter writer;
+  writer.submit(net, optimizer, checkpoint_dir, "optim-0000.pt");
+  writer.wait();
+
+  EXPECT_EQ(writer.failed(), 0u);
+  EXPECT_TRUE(fs::exists(checkpoint_dir / "optim-0000.pt"));
+  EXPECT_FALSE(fs::exists(root_dir / "model-0000.tmp"));
+
+  AlphaZeroNet loaded_net(net.config());
+  loaded_net.on_device(torch::kCPU);
+  ASSERT_TRUE(loaded_net.load_checkpoint(checkpoint_dir));
+
+  auto params = net.all_parameters();
+  auto loaded_params = loaded_net.all_parameters();
+  ASSERT_EQ(params.size(), loaded_params.size());
+  for (std::size_t i = 0; i < params.size(); ++i)
+    EXPECT_TRUE(torch::equal(params[i], loaded_params[i]));
+
+  torch::optim::SGD loaded_optimizer(
+      loaded_net.all_parameters(), /*lr=*/0.01);
+  EXPECT_NO_THROW(torch::load(
+        loaded_optimizer, (checkpoint_dir / "optim-0000.pt").string()));
+}
+
+TEST_F(CheckpointWriterTest, KeepsBatchNormStatistics)
+{
+  // Move the running statistics away from their defaults.
+  {
+    torch::NoGradGuard no_grad;
+    net.set_training_mode();
+    for (int i = 0; i < 3; ++i)
+      net.forward(torch::randn({4, 119, 8, 8}));
+  }
+
+  torch::optim::SGD optimizer(net.all_parameters(), /*lr=*/0.01);
+  CheckpointWriter writer;
+  writer.submit(net, optimizer, root_dir / "model-0000", "optim-0000.pt");
+  writer.wait();
+
+  AlphaZeroNet loaded_net(net.config());
+  loaded_net.on_device(torch::kCPU);
+  ASSERT_TRUE(loaded_net.load_checkpoint(root_dir / "model-0000"));
+
+  auto buffers = net.all_buffers();
+  auto loaded_buffers = loaded_net.all_buffers();
+  ASSERT_EQ(buffers.size(), loaded_buffers.size());
+  for (std::size_t i = 0; i < buffers.size(); ++i)
+    EXPECT_TRUE(torch::equal(buffers[i], loaded_buffers[i]));
+}
+
+TEST_F(CheckpointWriterTest, SnapshotIsNotAffectedByLaterUpdates)
+{
+  torch::optim::SGD optimizer(net.all_parameters(), /*lr=*/0.01);
+  auto expected = net.all_parameters().front().detach().clone();
+
+  CheckpointWriter writer;
+  writer.submit(net, optimizer, root_dir / "model-0000", "optim-0000.pt");
+  {
+    torch::NoGradGuard no_grad;
+    net.all_parameters().front().add_(1);
+  }
+  writer.wait();
+
+  AlphaZeroNet loaded_net(net.config());
+  loaded_net.on_device(torch::kCPU);
+  ASSERT_TRUE(loaded_net.load_checkpoint(root_dir / "model-0000"));
+  EXPECT_TRUE(torch::equal(loaded_net.all_parameters().front(), expected));
+}
+
+TEST_F(CheckpointWriterTest, DoesNotOverwriteCheckpoint)
+{
+  torch::optim::SGD optimizer(net.all_parameters(), /*lr=*/0.01);
+  auto checkpoint_dir = root_dir / "model-0000";
+
+  CheckpointWriter writer;
+  writer.submit(net, optimizer, checkpoint_dir, "optim-0000.pt");
+  writer.wait();
+  writer.submit(net, optimizer, checkpoint_dir, "optim-0000.pt");
+  writer.wait();
+
+  EXPECT_EQ(writer.failed(), 1u);
+}
@@ -0,0 +1,154 @@
+#include "folded_net.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <torch/torch.h>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "net.h"
+
+using namespace blunder;
+
+TEST(FoldedNetTest, MatchesNetInEvalMode)
+{
+  torch::manual_seed(42);
+
+  AlphaZeroNet net;
+  net.on_device(torch::kCPU);
+
+  // Update the BatchNorm running statistics, so that the folded weights differ
+  // from the original ones.
+  {
+    torch::NoGradGuard no_grad;
+    net.set_training_mode();
+    for (int i = 0; i < 3; ++i)
+      net.forward(torch::randn({4, 119, 8, 8}));
+  }
+  net.set_eval_mode();
+
+  FoldedNet folded_net(net);
+  EXPECT_EQ(folded_net.device(), torch::Device(torch::kCPU));
+
+  auto input = torch::randn({2, 119, 8, 8});
+
+  torch::NoGradGuard no_grad;
+  auto [pol, val] = net.forward(input);
+  auto [folded_pol, folded_val] = folded_net.predict(input);
+
+  ASSERT_EQ(folded_pol.sizes(), pol.sizes());
+  ASSERT_EQ(folded_val.sizes(), val.sizes());
+  EXPECT_TRUE(torch::allclose(folded_pol, pol, /*rtol=*/1e-3, /*atol=*/1e-3));
+  EXPECT_TRUE(torch::allclose(folded_val, val, /*rtol=*/1e-3, /*atol=*/1e-4));
+}
+
+TEST(FoldedNetTest, ChannelsLastMatchesContiguous)
+{
+  torch::manual_seed(42);
+
+  AlphaZeroNet net(NetConfig{.blocks=2, .filters=32, .value_hidden=32});
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+
+  FoldedNet folded_net(net);
+  FoldedNet channels_last_net(net, torch::MemoryFormat::ChannelsLast);
+  EXPECT_EQ(channels_last_net.memory_format(),
+            torch::MemoryFormat::ChannelsLast);
+
+  auto input = torch::randn({3, 119, 8, 8});
+  auto [pol, val] = folded_net.predict(input);
+  auto [channels_last_pol, channels_last_val] =
+    channels_last_net.predict(input);
+
+  ASSERT_EQ(channels_last_pol.sizes(), pol.sizes());
+  EXPECT_TRUE(torch::allclose(
+        channels_last_pol, pol, /*rtol=*/1e-4, /*atol=*/1e-4));
+  EXPECT_TRUE(torch::allclose(
+        channels_last_val, val, /*rtol=*/1e-4, /*atol=*/1e-5));
+}
+
+TEST(FoldedNetTest, LoadsFlatWeightsInPlace)
+{
+  torch::manual_seed(42);
+
+  AlphaZeroNet net(NetConfig{.blocks=2, .filters=16, .value_hidden=16});
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+
+  FoldedNet folded_net(net);
+  auto file_name =
+    std::filesystem::temp_directory_path() / "blunder-folded-net-test.bin";
+  folded_net.save(file_name);
+
+  auto loaded_net = FoldedNet::load(file_name);
+  EXPECT_EQ(loaded_net.device(), torch::Device(torch::kCPU));
+
+  auto input = torch::randn({2, 119, 8, 8});
+  auto [pol, val] = folded_net.predict(input);
+  auto [loaded_pol, loaded_val] = loaded_net.predict(input);
+  EXPECT_TRUE(torch::equal(loaded_pol, pol));
+  EXPECT_TRUE(torch::equal(loaded_val, val));
+
+  std::filesystem::remove(file_name);
+}
+
+TEST(FoldedNetTest, FlatFileFromCheckpointMatchesNet)
+{
+  torch::manual_seed(42);
+
+  NetConfig config{.blocks=2, .filters=16, .value_hidden=16};
+  AlphaZeroNet net(config);
+  net.on_device(torch::kCPU);
+
+  // Move the running statistics away from their defaults, so the folded
+  // weights are only right if the checkpoint keeps them.
+  {
+    torch::NoGradGuard no_grad;
+    net.set_training_mode();
+    for (int i = 0; i < 3; ++i)
+      net.forward(torch::randn({4, 119, 8, 8}));
+  }
+  net.set_eval_mode();
+
+  auto tmp_dir = std::filesystem::temp_directory_path();
+  auto checkpoint_dir = tmp_dir / "blunder-folded-net-ckpt";
+  std::filesystem::remove_all(checkpoint_dir);
+  ASSERT_TRUE(net.create_checkpoint(checkpoint_dir));
+
+  // Export the checkpoint like export_net --format flat.
+  AlphaZeroNet loaded_net(config);
+  ASSERT_TRUE(loaded_net.load_checkpoint(checkpoint_dir));
+  std::filesystem::remove_all(checkpoint_dir);
+  loaded_net.on_device(torch::kCPU);
+  loaded_net.set_eval_mode();
+
+  auto file_name = tmp_dir / "blunder-folded-net-ckpt.bin";
+  FoldedNet(loaded_net).save(file_name);
+  auto flat_net = FoldedNet::load(file_name);
+
+  auto input = torch::randn({2, 119, 8, 8});
+  torch::NoGradGuard no_grad;
+  auto [pol, val] = net.forward(input);
+  auto [flat_pol, flat_val] = flat_net.predict(input);
+  std::filesystem::remove(file_name);
+
+  ASSERT_EQ(flat_pol.sizes(), pol.sizes());
+  ASSERT_EQ(flat_val.sizes(), val.sizes());
+  EXPECT_TRUE(torch::allclose(flat_pol, pol, /*rtol=*/1e-3, /*atol=*/1e-3));
+  EXPECT_TRUE(torch::allclose(flat_val, val, /*rtol=*/1e-3, /*atol=*/1e-4));
+}
+
+TEST(FoldedNetTest, LoadThrowsForInvalidFile)
+{
+  auto file_name =
+    std::filesystem::temp_directory_path() / "blunder-folded-net-test.txt";
+  {
+    std::ofstream out(file_name);
+    out << "not a flat weight file";
+  }
+
+  EXPECT_THROW(FoldedNet::load(file_name), std::runtime_error);
+  std::filesystem::remove(file_name);
+}
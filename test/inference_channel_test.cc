@@ -0,0 +1,213 @@
+#include "inference_channel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace blunder;
+
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr ChannelLayout kLayout{.slots=8, .input_size=4, .policy_size=3};
+
+// Answers up to |count| requests, with the sum of the input as the value, and
+// the input times the position in the policy as the policy. Returns the sizes
+// of the batches.
+std::vector<std::size_t>
+serve(InferenceChannel& channel, unsigned count, unsigned max_batch)
+{
+  std::vector<std::size_t> batches;
+  std::vector<unsigned> slots(max_batch);
+  unsigned served = 0;
+  while (served < count and not channel.is_closed()) {
+    auto n = channel.take(slots, 200us);
+    if (n)
+      batches.push_back(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      auto input = channel.request(slots[i]);
+      auto policy = channel.reply_policy(slots[i]);
+      for (std::size_t j = 0; j < policy.size(); ++j)
+        policy[j] = input[0] * j;
+      float sum = 0;
+      for (auto x : input)
+        sum += x;
+      channel.reply(slots[i], sum);
+    }
+    served += n;
+  }
+  return batches;
+}
+
+// Sends a request with all inputs set to |x|, and returns the value.
+float
+request(InferenceChannel& channel, float x)
+{
+  auto slot = channel.acquire();
+  std::ranges::fill(channel.input(slot), x);
+  channel.submit(slot);
+  channel.wait(slot);
+  EXPECT_THAT(channel.policy(slot), testing::ElementsAre(0, x, 2 * x));
+  auto value = channel.value(slot);
+  channel.release(slot);
+  return value;
+}
+
+} // namespace
+
+class InferenceChannelTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  { name = "/blunder-channel-test-" + std::to_string(::getpid()); }
+
+  std::string name;
+};
+
+TEST_F(InferenceChannelTest, OpensCreatedChannel)
+{
+  auto server = InferenceChannel::create(name, kLayout);
+  auto client = InferenceChannel::open(name);
+  EXPECT_EQ(client.layout().slots, 8u);
+  EXPECT_EQ(client.layout().input_size, 4u);
+  EXPECT_EQ(client.layout().policy_size, 3u);
+  EXPECT_EQ(client.input(0).size(), 4u);
+  EXPECT_EQ(client.policy(0).size(), 3u);
+  EXPECT_FALSE(client.is_closed());
+}
+
+TEST_F(InferenceChannelTest, RejectsInvalidChannels)
+{
+  EXPECT_THROW(InferenceChannel::create("no-slash", kLayout),
+               std::invalid_argument);
+  EXPECT_THROW(InferenceChannel::create(name, {.slots=6}),
+               std::invalid_argument);
+  EXPECT_THROW(InferenceChannel::open(name), std::runtime_error);
+
+  auto server = InferenceChannel::create(name, kLayout);
+  EXPECT_THROW(InferenceChannel::create(name, kLayout), std::runtime_error);
+}
+
+TEST_F(InferenceChannelTest, RemovesChannelWithCreator)
+{
+  InferenceChannel::create(name, kLayout);
+  EXPECT_THROW(InferenceChannel::open(name), std::runtime_error);
+}
+
+TEST_F(InferenceChannelTest, AnswersRequests)
+{
+  auto server = InferenceChannel::create(name, kLayout);
+  auto client = InferenceChannel::open(name);
+
+  std::jthread server_thread([&] { serve(server, 20, 4); });
+  for (int i = 0; i < 20; ++i)
+    EXPECT_EQ(request(client, i), 4 * i);
+}
+
+TEST_F(InferenceChannelTest, BatchesRequests)
+{
+  auto server = InferenceChannel::create(name, kLayout);
+  auto client = InferenceChannel::open(name);
+
+  // The requests are all submitted before the server takes them.
+  std::vector<unsigned> requests;
+  for (int i = 0; i < 5; ++i) {
+    auto slot = client.acquire();
+    std::ranges::fill(client.input(slot), i);
+    client.submit(slot);
+    requests.push_back(slot);
+  }
+
+  EXPECT_THAT(serve(server, 5, 3), testing::ElementsAre(3, 2));
+  for (int i = 0; i < 5; ++i) {
+    client.wait(requests[i]);
+    EXPECT_EQ(client.value(requests[i]), 4 * i);
+    client.release(requests[i]);
+  }
+}
+
+TEST_F(InferenceChannelTest, WaitsForBatch)
+{
+  auto server = InferenceChannel::create(name, kLayout);
+  std::vector<unsigned> slots(4);
+  EXPECT_EQ(server.take(slots, 100us), 0u);
+
+  auto client = InferenceChannel::open(name);
+  std::jthread client_thread([&] {
+    auto slot = client.acquire();
+    client.submit(slot);
+    std::this_thread::sleep_for(5ms);
+    slot = client.acquire();
+    client.submit(slot);
+  });
+
+  // The second request arrives after the wait for the first one ended.
+  std::size_t taken = 0;
+  while (not taken)
+    taken = server.take(slots, 1ms);
+  EXPECT_EQ(taken, 1u);
+  client_thread.join();
+  EXPECT_EQ(server.take(slots, 1ms), 1u);
+}
+
+TEST_F(InferenceChannelTest, ServesManyClients)
+{
+  auto server = InferenceChannel::create(name, kLayout);
+  std::jthread server_thread([&] { serve(server, 400, 8); });
+
+  // More clients than slots, such that clients wait for free slots.
+  std::vector<std::jthread> clients;
+  for (int c = 0; c < 10; ++c) {
+    clients.emplace_back([&, c] {
+      auto client = InferenceChannel::open(name);
+      for (int i = 0; i < 40; ++i)
+        EXPECT_EQ(request(client, c + i), 4 * (c + i));
+    });
+  }
+}
+
+TEST_F(InferenceChannelTest, ServesOtherProcesses)
+{
+  auto server = InferenceChannel::create(name, kLayout);
+
+  auto pid = ::fork();
+  ASSERT_NE(pid, -1);
+  if (not pid) {
+    auto client = InferenceChannel::open(name);
+    std::_Exit(request(client, 3) == 12 ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  serve(server, 1, 4);
+  int status = 0;
+  ASSERT_EQ(::waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), EXIT_SUCCESS);
+}
+
+TEST_F(InferenceChannelTest, ClosingWakesClients)
+{
+  auto server = InferenceChannel::create(name, kLayout);
+  auto client = InferenceChannel::open(name);
+
+  auto slot = client.acquire();
+  client.submit(slot);
+  std::jthread closer([&] {
+    std::this_thread::sleep_for(5ms);
+    server.close();
+  });
+
+  EXPECT_THROW(client.wait(slot), std::runtime_error);
+  EXPECT_THROW(client.acquire(), std::runtime_error);
+}
@@ -0,0 +1,155 @@
+#include "inference_server.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <torch/torch.h>
+
+#include "alpha_zero_decoder.h"
+#include "alpha_zero_encoder.h"
+#include "board.h"
+#include "board_path.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "inference_channel.h"
+#include "inference_net.h"
+#include "remote_evaluator.h"
+
+using namespace blunder;
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// A network with a uniform policy, whose value is the mean of the input, and
+// that records the size of every batch.
+class FakeNet : public InferenceNet {
+public:
+  std::pair<torch::Tensor, torch::Tensor>
+  predict(torch::Tensor x) const override
+  {
+    batch_sizes.push_back(x.size(0));
+    auto policy = torch::zeros({x.size(0), 73, 8, 8});
+    auto value = x.flatten(1).mean(1, /*keepdim=*/true);
+    return {policy, value};
+  }
+
+  torch::Device
+  device() const override
+  { return torch::kCPU; }
+
+  mutable std::vector<std::int64_t> batch_sizes;
+};
+
+} // namespace
+
+class InferenceServerTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  {
+    Board::register_magics();
+    channel = std::make_shared<InferenceChannel>(InferenceChannel::create(
+          "/blunder-server-test-" + std::to_string(::getpid()),
+          ChannelLayout{.slots=64}));
+    evaluator = std::make_shared<RemoteEvaluator>(
+        channel,
+        std::make_shared<AlphaZeroDecoder>(),
+        encoder);
+  }
+
+  std::shared_ptr<FakeNet> net = std::make_shared<FakeNet>();
+  std::shared_ptr<AlphaZeroEncoder> encoder =
+    std::make_shared<AlphaZeroEncoder>();
+  std::shared_ptr<InferenceChannel> channel;
+  std::shared_ptr<RemoteEvaluator> evaluator;
+};
+
+TEST_F(InferenceServerTest, ThrowsOnInvalidOptions)
+{
+  EXPECT_THROW(InferenceServer(nullptr, channel), std::invalid_argument);
+  EXPECT_THROW(InferenceServer(net, nullptr), std::invalid_argument);
+  EXPECT_THROW(InferenceServer(net, channel, {.max_batch=0}),
+               std::invalid_argument);
+  EXPECT_THROW(InferenceServer(net, channel, {.max_batch=65}),
+               std::invalid_argument);
+}
+
+TEST_F(InferenceServerTest, EvaluatesRemotely)
+{
+  InferenceServer server(net, channel);
+  std::jthread server_thread([&](std::stop_token stop_token) {
+    server.serve(std::move(stop_token));
+  });
+
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+
+  auto prediction = evaluator->predict(board_path);
+  EXPECT_FLOAT_EQ(prediction.value,
+                  encoder->encode_state(board_path).mean().item<float>());
+  ASSERT_EQ(prediction.move_probs.size(), 20u);
+  for (const auto& [child, prob] : prediction.move_probs)
+    EXPECT_FLOAT_EQ(prob, 1.0f / 20);
+
+  server_thread.request_stop();
+  server_thread.join();
+  EXPECT_EQ(server.requests(), 1u);
+  EXPECT_EQ(server.batches(), 1u);
+}
+
+TEST_F(InferenceServerTest, BatchesConcurrentRequests)
+{
+  auto board = Board::new_board();
+
+  std::vector<std::jthread> clients;
+  for (int i = 0; i < 8; ++i) {
+    clients.emplace_back([&] {
+      EvalBoardPath board_path;
+      board_path.push(board);
+      evaluator->predict(board_path);
+    });
+  }
+
+  // The requests that arrive within the wait are evaluated together.
+  InferenceServer server(net, channel, {.max_batch=8, .max_wait=50ms});
+  while (server.requests() < 8)
+    server.serve_batch();
+
+  EXPECT_EQ(server.requests(), 8u);
+  EXPECT_LT(server.batches(), 8u);
+  EXPECT_EQ(net->batch_sizes.size(), server.batches());
+}
+
+TEST_F(InferenceServerTest, ClosesChannelOnError)
+{
+  // The policy of the network does not fit the channel.
+  auto small_channel = std::make_shared<InferenceChannel>(
+      InferenceChannel::create(
+          "/blunder-server-test-small-" + std::to_string(::getpid()),
+          ChannelLayout{.slots=4, .policy_size=64}));
+  RemoteEvaluator small_evaluator(
+      small_channel,
+      std::make_shared<AlphaZeroDecoder>(),
+      encoder);
+
+  InferenceServer server(net, small_channel, {.max_batch=4});
+  std::jthread server_thread([&](std::stop_token stop_token) {
+    EXPECT_THROW(server.serve(std::move(stop_token)), std::logic_error);
+  });
+
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+  EXPECT_THROW(small_evaluator.predict(board_path), std::runtime_error);
+}
@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+class MappedFileTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  { path = fs::temp_directory_path() / "blunder-mapped-file-test"; }
+
+  void
+  TearDown() override
+  { fs::remove(path); }
+
+  void
+  write_file(const std::string& contents)
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << contents;
+  }
+
+  fs::path path;
+};
+
+TEST_F(MappedFileTest, MapsContents)
+{
+  write_file("blunder");
+
+  MappedFile file(path);
+  ASSERT_EQ(file.size(), 7u);
+  auto bytes = file.bytes();
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(bytes.data()),
+                        bytes.size()), "blunder");
+}
+
+TEST_F(MappedFileTest, MapsEmptyFile)
+{
+  write_file("");
+
+  MappedFile file(path);
+  EXPECT_EQ(file.size(), 0u);
+  EXPECT_TRUE(file.bytes().empty());
+}
+
+TEST_F(MappedFileTest, MoveTransfersMapping)
+{
+  write_file("blunder");
+
+  MappedFile file(path);
+  auto* data = file.bytes().data();
+
+  MappedFile other(std::move(file));
+  EXPECT_EQ(other.bytes().data(), data);
+  EXPECT_EQ(other.size(), 7u);
+  EXPECT_EQ(file.size(), 0u);
+}
+
+TEST_F(MappedFileTest, ThrowsForMissingFile)
+{ EXPECT_THROW(MappedFile(path / "missing"), std::runtime_error); }
@@ -0,0 +1,369 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "blunder_player.h"
+#include "board.h"
+#include "board_path.h"
+#include "evaluator.h"
+#include "fen.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "par.h"
+#include "search_limits.h"
+#include "tablebase.h"
+#include "tablebase_generator.h"
+
+using namespace blunder;
+
+// An evaluator with uniform priors and a value of zero, which counts the
+// number of evaluations, and can take some time to simulate a network.
+class UniformEvaluator : public Evaluator {
+public:
+  explicit
+  UniformEvaluator(Milliseconds delay = Milliseconds(0))
+    : delay(delay) {}
+
+  Prediction
+  predict(const EvalBoardPath& board_path) const override
+  {
+    ++evals;
+    if (delay != Milliseconds(0))
+      std::this_thread::sleep_for(delay);
+
+    Prediction pred;
+    pred.value = 0;
+    auto children = board_path.root()->get().next();
+    for (auto& child : children)
+      pred.move_probs.emplace_back(std::move(child), 1.0f / children.size());
+    return pred;
+  }
+
+  mutable unsigned evals = 0;
+  Milliseconds delay;
+};
+
+// An evaluator that puts almost all the prior on the first move, such that the
+// search visits it far more than the other moves.
+class FirstMoveEvaluator : public Evaluator {
+public:
+  Prediction
+  predict(const EvalBoardPath& board_path) const override
+  {
+    Prediction pred;
+    pred.value = 0;
+    auto children = board_path.root()->get().next();
+    float rest = children.size() > 1 ? 0.01f / (children.size() - 1) : 0;
+    for (std::size_t i = 0; i < children.size(); ++i)
+      pred.move_probs.emplace_back(std::move(children[i]), i ? rest : 0.99f);
+    return pred;
+  }
+};
+
+// An evaluator with uniform priors and the material balance for the player
+// moving next as the value, like a network trained on the outcomes of games.
+class MaterialEvaluator : public Evaluator {
+public:
+  Prediction
+  predict(const EvalBoardPath& board_path) const override
+  {
+    const auto& board = board_path.root()->get();
+    auto material = [](const PieceSet& pieces) {
+      return static_cast<int>(
+          pieces.pawn().count()
+          + 3 * (pieces.knight().count() + pieces.bishop().count())
+          + 5 * pieces.rook().count()
+          + 9 * pieces.queen().count());
+    };
+
+    Prediction pred;
+    pred.value = std::tanh(
+        (material(board.mine()) - material(board.other())) / 10.0f);
+    auto children = board.next();
+    for (auto& child : children)
+      pred.move_probs.emplace_back(std::move(child), 1.0f / children.size());
+    return pred;
+  }
+};
+
+class MctsTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  SearchResult
+  run(const Board& board, const SearchLimits& limits)
+  {
+    EvalBoardPath board_path;
+    board_path.push(board);
+    return mcts.run(board_path, limits);
+  }
+
+  std::shared_ptr<UniformEvaluator> evaluator =
+    std::make_shared<UniformEvaluator>();
+  Mcts mcts{evaluator, /*simulations=*/800, /*seed=*/1};
+};
+
+TEST_F(MctsTest, StopsAtSimulations)
+{
+  auto result = run(
+      Board::new_board(),
+      SearchLimits{.simulations=50, .stop_when_decided=false});
+  EXPECT_EQ(result.simulations, 50u);
+  // The root is evaluated before the simulations.
+  EXPECT_EQ(evaluator->evals, 51u);
+}
+
+TEST_F(MctsTest, StopsAtNodes)
+{
+  auto result = run(Board::new_board(), SearchLimits{.nodes=100});
+  EXPECT_GE(result.nodes_visited, 100u);
+  EXPECT_LT(result.nodes_visited, 100u + result.depth + 1);
+}
+
+TEST_F(MctsTest, StopsAtTime)
+{
+  auto slow_evaluator = std::make_shared<UniformEvaluator>(Milliseconds(2));
+  Mcts slow_mcts(slow_evaluator, /*simulations=*/800, /*seed=*/1);
+
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+  auto result = slow_mcts.run(
+      board_path, SearchLimits{.time=Milliseconds(30)});
+
+  EXPECT_GE(result.millis_search_time, 30);
+  EXPECT_LT(result.millis_search_time, 500);
+  EXPECT_LT(result.simulations, 800u);
+}
+
+TEST_F(MctsTest, StopsWhenStopIsRequested)
+{
+  std::stop_source stop_source;
+  stop_source.request_stop();
+
+  auto result = run(
+      Board::new_board(), SearchLimits{.stop_token=stop_source.get_token()});
+  EXPECT_EQ(result.simulations, 0u);
+  EXPECT_EQ(evaluator->evals, 1u);
+  EXPECT_TRUE(result.best.board.last_move());
+}
+
+TEST_F(MctsTest, StopsFromAnotherThread)
+{
+  std::stop_source stop_source;
+  std::jthread stopper([&stop_source] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    stop_source.request_stop();
+  });
+
+  auto result = run(
+      Board::new_board(), SearchLimits{.stop_token=stop_source.get_token()});
+  EXPECT_GT(result.simulations, 0u);
+}
+
+TEST_F(MctsTest, TakesHangingQueen)
+{
+  // The values of the evaluator are for the player moving next, so the search
+  // needs to negate them for the player making the move.
+  Mcts material_mcts(std::make_shared<MaterialEvaluator>(), 800, 1);
+  auto board = read_fen("q3k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+  ASSERT_TRUE(board);
+
+  EvalBoardPath board_path;
+  board_path.push(*board);
+  auto result = material_mcts.run(board_path);
+  EXPECT_EQ(result.best.board.last_move()->uci(), "a1a8");
+  EXPECT_GT(result.value, 0);
+}
+
+TEST_F(MctsTest, SingleLegalMoveReturnsAtOnce)
+{
+  // The only legal move is for the white king to capture the queen.
+  auto board = read_fen("k7/8/8/8/8/8/1q6/K7 w - - 0 1");
+  ASSERT_TRUE(board);
+
+  auto result = run(*board, SearchLimits{.simulations=50});
+  EXPECT_EQ(evaluator->evals, 0u);
+  EXPECT_EQ(result.simulations, 0u);
+  ASSERT_EQ(result.moves.size(), 1u);
+  EXPECT_EQ(result.best.board.last_move(), result.moves.front().mv);
+  EXPECT_EQ(result.moves.front().visits, 1u);
+  EXPECT_EQ(result.best.visits, 1u);
+  EXPECT_FALSE(result.has_value);
+  EXPECT_FALSE(result.policy_target);
+}
+
+TEST_F(MctsTest, SearchesFromRepeatedRoot)
+{
+  // The knights go out and back, so the root repeats the starting position.
+  std::vector<Board> boards{Board::new_board()};
+  for (std::string_view move : {"g1f3", "g8f6", "f3g1", "f6g8"}) {
+    auto children = boards.back().next();
+    auto child = std::ranges::find_if(children, [&](const auto& board) {
+      return board.last_move()->uci() == move;
+    });
+    ASSERT_NE(child, children.end());
+    child->find_repetition(boards | std::views::reverse);
+    boards.push_back(std::move(*child));
+  }
+  ASSERT_EQ(boards.back().repetitions(), 1u);
+
+  auto board_path = EvalBoardPath::rev(boards);
+  auto result = mcts.run(board_path, SearchLimits{.nodes=200});
+  EXPECT_GE(result.nodes_visited, 200u);
+  EXPECT_GT(result.nodes_expanded, 0u);
+}
+
+TEST_F(MctsTest, StopsWhenBestMoveIsDecided)
+{
+  Mcts first_mcts(
+      std::make_shared<FirstMoveEvaluator>(), /*simulations=*/800, /*seed=*/1);
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+
+  auto result = first_mcts.run(board_path, SearchLimits{.simulations=200});
+  EXPECT_GT(result.simulations_saved, 0u);
+  EXPECT_EQ(result.simulations + result.simulations_saved, 200u);
+
+  auto full_result = first_mcts.run(
+      board_path, SearchLimits{.simulations=200, .stop_when_decided=false});
+  EXPECT_EQ(full_result.simulations, 200u);
+  EXPECT_EQ(full_result.simulations_saved, 0u);
+  EXPECT_EQ(result.best.board.last_move(), full_result.best.board.last_move());
+}
+
+TEST_F(MctsTest, ThrowsWithoutLimits)
+{ EXPECT_THROW(run(Board::new_board(), SearchLimits()), std::invalid_argument); }
+
+TEST_F(MctsTest, RunWithoutLimitsUsesSimulations)
+{
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+  auto result = mcts.run(board_path);
+  EXPECT_EQ(result.simulations + result.simulations_saved, 800u);
+}
+
+TEST_F(MctsTest, TreeIsNotReusedByDefault)
+{
+  auto board = Board::new_board();
+  auto result = run(board, SearchLimits{.simulations=100});
+  EXPECT_EQ(result.reused_visits, 0u);
+
+  auto next_board = result.best.board;
+  EvalBoardPath board_path;
+  board_path.push(next_board);
+  board_path.push(board);
+  EXPECT_EQ(mcts.run(board_path, SearchLimits{.simulations=100}).reused_visits,
+            0u);
+}
+
+TEST_F(MctsTest, ReusesSubtreeOfNextPosition)
+{
+  mcts.set_tree_reuse(true);
+
+  auto board = Board::new_board();
+  auto result = run(
+      board, SearchLimits{.simulations=400, .stop_when_decided=false});
+  EXPECT_EQ(result.reused_visits, 0u);
+  ASSERT_GT(result.best.visits, 1u);
+
+  auto next_board = result.best.board;
+  EvalBoardPath board_path;
+  board_path.push(next_board);
+  board_path.push(board);
+
+  auto evals = evaluator->evals;
+  auto next_result = mcts.run(board_path, SearchLimits{.simulations=10});
+  EXPECT_EQ(next_result.reused_visits, result.best.visits);
+  // The root of the subtree is already evaluated.
+  EXPECT_LE(evaluator->evals - evals, 10u);
+}
+
+TEST_F(MctsTest, DiscardsTreeForUnrelatedPosition)
+{
+  mcts.set_tree_reuse(true);
+  run(Board::new_board(), SearchLimits{.simulations=100});
+
+  auto board = read_fen(
+      "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+  ASSERT_TRUE(board);
+  EXPECT_EQ(run(*board, SearchLimits{.simulations=100}).reused_visits, 0u);
+}
+
+TEST_F(MctsTest, PonderingReusesSearchOnOpponentsTurn)
+{
+  auto ponder_mcts = std::make_shared<Mcts>(
+      evaluator, /*simulations=*/100, /*seed=*/1);
+  ponder_mcts->set_tree_reuse(true);
+  BlunderPlayer player(ponder_mcts);
+  player.set_pondering(/*max_simulations=*/400);
+
+  std::vector<Board> boards;
+  boards.reserve(3);
+  GameBoardPath game_path;
+  game_path.push(boards.emplace_back(Board::new_board()));
+
+  auto result = player.make_move(game_path);
+  EXPECT_EQ(result.reused_visits, 0u);
+  game_path.push(boards.emplace_back(result.best.board));
+
+  // The opponent thinks for a while, and then replies.
+  std::this_thread::sleep_for(Milliseconds(200));
+  auto replies = boards.back().next();
+  ASSERT_FALSE(replies.empty());
+  game_path.push(boards.emplace_back(replies.front()));
+
+  auto next_result = player.make_move(game_path);
+  EXPECT_GT(next_result.reused_visits, 1u);
+  player.set_pondering(0);
+}
+
+TEST_F(MctsTest, FindsMateInOne)
+{
+  // Only Ra8 mates, and every visit of the mate counts for it.
+  auto board = read_fen("6k1/8/6K1/8/8/8/8/R7 w - - 0 1");
+  ASSERT_TRUE(board);
+  auto result = run(*board, SearchLimits{.simulations=200});
+  EXPECT_EQ(result.best.board.last_move()->uci(), "a1a8");
+  EXPECT_EQ(result.best.visits,
+            std::ranges::max(result.moves, {}, &MoveProb::visits).visits);
+  EXPECT_GT(result.best.visits, 1u);
+}
+
+TEST_F(MctsTest, ScoresLeavesFromTablebase)
+{
+  auto dir = std::filesystem::temp_directory_path() / "blunder-mcts-test";
+  TablebaseGenerator generator(dir, std::make_shared<par::WorkQ>());
+  generator.generate(Material::from_key("KQvK"));
+  auto tablebase = std::make_shared<const Tablebase>(dir);
+  std::filesystem::remove_all(dir);
+  mcts.set_tablebase(tablebase);
+
+  // Every child is in the tables, so only the root is evaluated. The queen
+  // hangs on c3 and d4, and the search keeps it.
+  auto board = read_fen("7Q/8/8/8/8/3k4/8/K7 w - - 0 1");
+  ASSERT_TRUE(board);
+  auto result = run(*board, SearchLimits{.simulations=200});
+  EXPECT_EQ(evaluator->evals, 1u);
+  EXPECT_EQ(result.value, 1);
+  EXPECT_EQ(tablebase->probe_wdl(result.best.board), Wdl::Loss);
+  EXPECT_EQ(result.best.visits,
+            std::ranges::max(result.moves, {}, &MoveProb::visits).visits);
+  EXPECT_GT(result.best.visits, 1u);
+}
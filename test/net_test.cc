@@ -0,0 +1,143 @@
+#include "net.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+#include <torch/torch.h>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+class NetTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  {
+    checkpoint_dir = fs::temp_directory_path() / "blunder-net-test";
+    fs::remove_all(checkpoint_dir);
+  }
+
+  void
+  TearDown() override
+  { fs::remove_all(checkpoint_dir); }
+
+  NetConfig small_config{.blocks=2, .filters=16, .value_hidden=32};
+  fs::path checkpoint_dir;
+};
+
+TEST_F(NetTest, ThrowsWithZeroSizes)
+{
+  EXPECT_THROW(AlphaZeroNet(NetConfig{.blocks=0}), std::invalid_argument);
+  EXPECT_THROW(AlphaZeroNet(NetConfig{.filters=0}), std::invalid_argument);
+  EXPECT_THROW(AlphaZeroNet(NetConfig{.value_hidden=0}), std::invalid_argument);
+}
+
+TEST_F(NetTest, OutputShapesDoNotDependOnSize)
+{
+  AlphaZeroNet net(small_config);
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+  EXPECT_EQ(net.config(), small_config);
+
+  torch::NoGradGuard no_grad;
+  auto [pol, val] = net.forward(torch::zeros({3, 119, 8, 8}));
+  EXPECT_EQ(pol.sizes(), torch::IntArrayRef({3, 73, 8, 8}));
+  EXPECT_EQ(val.sizes(), torch::IntArrayRef({3, 1}));
+}
+
+TEST_F(NetTest, CheckpointRecordsArchitecture)
+{
+  AlphaZeroNet net(small_config);
+  net.on_device(torch::kCPU);
+  ASSERT_TRUE(net.create_checkpoint(checkpoint_dir));
+
+  auto config = AlphaZeroNet::checkpoint_config(checkpoint_dir);
+  ASSERT_TRUE(config);
+  EXPECT_EQ(*config, small_config);
+
+  AlphaZeroNet loaded_net(*config);
+  loaded_net.on_device(torch::kCPU);
+  ASSERT_TRUE(loaded_net.load_checkpoint(checkpoint_dir));
+
+  auto params = net.all_parameters();
+  auto loaded_params = loaded_net.all_parameters();
+  ASSERT_EQ(params.size(), loaded_params.size());
+  for (std::size_t i = 0; i < params.size(); ++i)
+    EXPECT_TRUE(torch::equal(params[i], loaded_params[i]));
+}
+
+TEST_F(NetTest, CheckpointAndCloneKeepBatchNormStatistics)
+{
+  torch::manual_seed(42);
+
+  AlphaZeroNet net(small_config);
+  net.on_device(torch::kCPU);
+
+  // Move the running statistics away from their defaults.
+  {
+    torch::NoGradGuard no_grad;
+    net.set_training_mode();
+    for (int i = 0; i < 3; ++i)
+      net.forward(torch::randn({4, 119, 8, 8}));
+  }
+  ASSERT_TRUE(net.create_checkpoint(checkpoint_dir));
+
+  AlphaZeroNet loaded_net(small_config);
+  loaded_net.on_device(torch::kCPU);
+  ASSERT_TRUE(loaded_net.load_checkpoint(checkpoint_dir));
+  auto cloned_net = net.clone();
+
+  auto buffers = net.all_buffers();
+  auto loaded_buffers = loaded_net.all_buffers();
+  auto cloned_buffers = cloned_net.all_buffers();
+  ASSERT_EQ(buffers.size(), loaded_buffers.size());
+  ASSERT_EQ(buffers.size(), cloned_buffers.size());
+  for (std::size_t i = 0; i < buffers.size(); ++i) {
+    EXPECT_TRUE(torch::equal(buffers[i], loaded_buffers[i]));
+    EXPECT_TRUE(torch::equal(buffers[i], cloned_buffers[i]));
+  }
+}
+
+TEST_F(NetTest, LoadCheckpointRejectsOtherArchitecture)
+{
+  AlphaZeroNet net(small_config);
+  net.on_device(torch::kCPU);
+  ASSERT_TRUE(net.create_checkpoint(checkpoint_dir));
+
+  auto other_config = small_config;
+  other_config.filters = 8;
+  AlphaZeroNet other_net(other_config);
+  other_net.on_device(torch::kCPU);
+  EXPECT_FALSE(other_net.load_checkpoint(checkpoint_dir));
+}
+
+TEST_F(NetTest, ChannelsLastMatchesContiguous)
+{
+  torch::manual_seed(42);
+
+  AlphaZeroNet net(small_config);
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+
+  auto input = torch::randn({3, 119, 8, 8});
+  torch::NoGradGuard no_grad;
+  auto [pol, val] = net.forward(input);
+
+  net.set_memory_format(torch::MemoryFormat::ChannelsLast);
+  EXPECT_EQ(net.memory_format(), torch::MemoryFormat::ChannelsLast);
+  for (const auto& param : net.all_parameters()) {
+    if (param.dim() == 4)
+      EXPECT_TRUE(param.is_contiguous(torch::MemoryFormat::ChannelsLast));
+  }
+
+  auto [channels_last_pol, channels_last_val] = net.forward(input);
+  EXPECT_TRUE(torch::allclose(
+        channels_last_pol, pol, /*rtol=*/1e-4, /*atol=*/1e-4));
+  EXPECT_TRUE(torch::allclose(
+        channels_last_val, val, /*rtol=*/1e-4, /*atol=*/1e-5));
+}
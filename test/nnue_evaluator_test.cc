@@ -0,0 +1,142 @@
+#include "nnue_evaluator.h"
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "board_path.h"
+#include "fen.h"
+#include "gtest/gtest.h"
+#include "mcts.h"
+#include "nnue.h"
+#include "search_limits.h"
+
+using namespace blunder;
+
+class NnueEvaluatorTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  void
+  SetUp() override
+  {
+    // A network that only likes white pawns, so the evaluation of a position
+    // depends on more than the side to move.
+    NnueWeights weights{
+      .feature_weights=std::vector<float>(Nnue::kFeatures * Nnue::kHidden, 0),
+      .feature_biases=std::vector<float>(Nnue::kHidden, 0),
+      .output_weights=std::vector<float>(2 * Nnue::kHidden, 0),
+      .output_bias=0
+    };
+    for (unsigned square = 8; square < 56; ++square) {
+      auto feature = Nnue::feature(
+          Color::White, Color::White, Type::Pawn, square);
+      weights.feature_weights[feature * Nnue::kHidden] = 0.1;
+    }
+    weights.output_weights[0] = 1;
+    nnue = std::make_shared<Nnue>(weights);
+  }
+
+  std::shared_ptr<Nnue> nnue;
+};
+
+TEST_F(NnueEvaluatorTest, ThrowsOnNullNetwork)
+{ EXPECT_THROW(NnueEvaluator(nullptr), std::invalid_argument); }
+
+TEST_F(NnueEvaluatorTest, PredictsNetworkValueWithUniformPriors)
+{
+  NnueEvaluator evaluator(nnue);
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+
+  auto pred = evaluator.predict(board_path);
+  EXPECT_FLOAT_EQ(
+      pred.value,
+      std::tanh(static_cast<float>(nnue->evaluate(board)) / Nnue::kCentipawns));
+  EXPECT_GT(pred.value, 0);
+
+  ASSERT_EQ(pred.move_probs.size(), 20u);
+  for (const auto& [child, prior] : pred.move_probs)
+    EXPECT_FLOAT_EQ(prior, 1.0f / 20);
+}
+
+TEST_F(NnueEvaluatorTest, UpdatesAccumulatorOfParent)
+{
+  NnueEvaluator evaluator(nnue);
+  auto board = Board::new_board();
+  auto child = board.next().front();
+
+  EvalBoardPath board_path;
+  board_path.push(board);
+  evaluator.predict(board_path);
+  EXPECT_EQ(evaluator.updates(), 0u);
+
+  EvalBoardPath child_path;
+  child_path.push(child);
+  child_path.push(board);
+  auto pred = evaluator.predict(child_path);
+  EXPECT_EQ(evaluator.updates(), 1u);
+  EXPECT_EQ(evaluator.predictions(), 2u);
+  EXPECT_FLOAT_EQ(
+      pred.value,
+      std::tanh(static_cast<float>(nnue->evaluate(child)) / Nnue::kCentipawns));
+}
+
+TEST_F(NnueEvaluatorTest, MostMctsEvaluationsAreIncremental)
+{
+  auto evaluator = std::make_shared<NnueEvaluator>(nnue);
+  Mcts mcts(evaluator, /*simulations=*/200, /*seed=*/1);
+
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+  mcts.run(board_path, SearchLimits{.simulations=200, .root_noise=false});
+
+  // Besides the root, only the leaves whose parent was evicted from the table
+  // are computed from scratch.
+  EXPECT_GT(evaluator->predictions(), 100u);
+  EXPECT_GT(evaluator->updates(), evaluator->predictions() * 9 / 10);
+}
+
+TEST_F(NnueEvaluatorTest, MctsTakesWinningCapture)
+{
+  // A network that counts the material of each player, so the value of a
+  // position is the material balance for the player moving next.
+  NnueWeights weights{
+    .feature_weights=std::vector<float>(Nnue::kFeatures * Nnue::kHidden, 0),
+    .feature_biases=std::vector<float>(Nnue::kHidden, 0),
+    .output_weights=std::vector<float>(2 * Nnue::kHidden, 0),
+    .output_bias=0
+  };
+  const std::pair<Type, float> values[] = {
+    {Type::Pawn, .1}, {Type::Knight, .3}, {Type::Bishop, .3},
+    {Type::Rook, .5}, {Type::Queen, .9}
+  };
+  for (auto [type, value] : values) {
+    for (unsigned square = 0; square < 64; ++square) {
+      auto feature = Nnue::feature(Color::White, Color::White, type, square);
+      weights.feature_weights[feature * Nnue::kHidden] = value;
+    }
+  }
+  weights.output_weights[0] = 1;
+  weights.output_weights[Nnue::kHidden] = -1;
+
+  auto evaluator = std::make_shared<NnueEvaluator>(
+      std::make_shared<Nnue>(weights));
+  Mcts mcts(evaluator, /*simulations=*/400, /*seed=*/1);
+
+  // The rook takes the undefended queen.
+  auto board = read_fen("q3k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+  ASSERT_TRUE(board);
+  EvalBoardPath board_path;
+  board_path.push(*board);
+  auto result = mcts.run(board_path);
+  EXPECT_EQ(result.best.board.last_move()->uci(), "a1a8");
+  EXPECT_GT(result.value, 0);
+}
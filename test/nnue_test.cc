@@ -0,0 +1,175 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "board.h"
+#include "color.h"
+#include "fen.h"
+#include "gtest/gtest.h"
+#include "pieces.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+// Returns weights with random values in a range that does not saturate the
+// quantized network.
+NnueWeights
+random_weights(unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(-0.1, 0.1);
+
+  NnueWeights weights{
+    .feature_weights=std::vector<float>(Nnue::kFeatures * Nnue::kHidden),
+    .feature_biases=std::vector<float>(Nnue::kHidden),
+    .output_weights=std::vector<float>(2 * Nnue::kHidden),
+    .output_bias=0.05
+  };
+  for (auto& weight : weights.feature_weights)
+    weight = dist(gen);
+  for (auto& bias : weights.feature_biases)
+    bias = 0.5 + dist(gen);
+  for (auto& weight : weights.output_weights)
+    weight = 10 * dist(gen);
+  return weights;
+}
+
+class NnueTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  // Returns the board for |fen|.
+  static Board
+  board_from(std::string_view fen)
+  {
+    auto board = read_fen(fen);
+    if (not board)
+      throw std::invalid_argument("Invalid FEN in test.");
+    return *board;
+  }
+
+  // Expects the accumulator of every child of |board| updated from the
+  // accumulator of |board| to match the accumulator computed from scratch.
+  void
+  expect_updates_match(const Board& board)
+  {
+    Nnue::Accumulator parent;
+    nnue.refresh(board, parent);
+    for (const auto& child : board.next()) {
+      Nnue::Accumulator updated;
+      Nnue::Accumulator refreshed;
+      nnue.update(parent, child, updated);
+      nnue.refresh(child, refreshed);
+      EXPECT_EQ(updated.white, refreshed.white) << child.last_move()->uci();
+      EXPECT_EQ(updated.black, refreshed.black) << child.last_move()->uci();
+    }
+  }
+
+  Nnue nnue{random_weights(/*seed=*/1)};
+};
+
+TEST_F(NnueTest, ZeroNetworkEvaluatesEven)
+{
+  Nnue zero;
+  EXPECT_EQ(zero.evaluate(Board::new_board()), 0);
+}
+
+TEST_F(NnueTest, FeaturesAreFlippedForBlack)
+{
+  // The white king on e1 looks the same to white as the black king on e8 looks
+  // to black.
+  EXPECT_EQ(Nnue::feature(Color::White, Color::White, Type::King, 4),
+            Nnue::feature(Color::Black, Color::Black, Type::King, 60));
+  EXPECT_NE(Nnue::feature(Color::White, Color::White, Type::King, 4),
+            Nnue::feature(Color::White, Color::Black, Type::King, 4));
+
+  auto board = Board::new_board();
+  auto white = Nnue::features(board, Color::White);
+  auto black = Nnue::features(board, Color::Black);
+  EXPECT_EQ(white.size(), 32u);
+  std::ranges::sort(white);
+  std::ranges::sort(black);
+  EXPECT_EQ(white, black);
+}
+
+TEST_F(NnueTest, StartingPositionIsSymmetric)
+{
+  auto board = Board::new_board();
+
+  // Both players see the same pieces from their own side in the starting
+  // position.
+  Nnue::Accumulator acc;
+  nnue.refresh(board, acc);
+  EXPECT_EQ(acc.white, acc.black);
+  EXPECT_EQ(nnue.evaluate(acc, true), nnue.evaluate(acc, false));
+}
+
+TEST_F(NnueTest, IncrementalUpdatesMatchRefresh)
+{
+  std::mt19937 gen(7);
+  for (unsigned game = 0; game < 20; ++game) {
+    auto board = Board::new_board();
+    for (unsigned ply = 0; ply < 200 and not board.is_terminal(); ++ply) {
+      expect_updates_match(board);
+      auto children = board.next();
+      board = children[gen() % children.size()];
+    }
+  }
+}
+
+TEST_F(NnueTest, IncrementalUpdatesMatchRefreshForSpecialMoves)
+{
+  // Castling on both sides, en passant, and promotions with and without
+  // capture.
+  for (auto fen : {"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1",
+                   "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1",
+                   "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1",
+                   "4k3/8/8/8/3Pp3/8/8/4K3 b - d3 0 1",
+                   "1r2k3/P7/8/8/8/8/8/4K3 w - - 0 1",
+                   "4k3/8/8/8/8/8/p7/1R2K3 b - - 0 1"}) {
+    SCOPED_TRACE(fen);
+    expect_updates_match(board_from(fen));
+  }
+}
+
+TEST_F(NnueTest, SaveAndLoadRoundTrip)
+{
+  auto path = fs::temp_directory_path() / "nnue_test_round_trip.nnue";
+  nnue.save(path);
+  auto loaded = Nnue::load(path);
+  fs::remove(path);
+
+  auto board = board_from(
+      "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+  EXPECT_EQ(loaded.evaluate(board), nnue.evaluate(board));
+  EXPECT_NE(nnue.evaluate(board), 0);
+}
+
+TEST_F(NnueTest, LoadRejectsOtherFiles)
+{
+  auto path = fs::temp_directory_path() / "nnue_test_bad_file.nnue";
+  {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs("not a network", file);
+    std::fclose(file);
+  }
+  EXPECT_THROW(Nnue::load(path), std::runtime_error);
+  fs::remove(path);
+}
+
+TEST_F(NnueTest, ThrowsOnWrongWeightSizes)
+{
+  auto weights = random_weights(/*seed=*/1);
+  weights.output_weights.pop_back();
+  EXPECT_THROW(Nnue{weights}, std::invalid_argument);
+}
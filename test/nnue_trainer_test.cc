@@ -0,0 +1,120 @@
+#include "nnue_trainer.h"
+
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+
+#include "board.h"
+#include "color.h"
+#include "game_result.h"
+#include "gtest/gtest.h"
+#include "nnue.h"
+#include "search_result.h"
+
+using namespace blunder;
+
+class NnueTrainerTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  // Returns a game of random moves, won by the player with more pawns at the
+  // end, so the outcome can be learned from the board.
+  static GameResult
+  random_game(std::mt19937& gen)
+  {
+    GameResult game_result;
+    game_result.game_start = Board::new_board();
+    auto board = game_result.game_start;
+    for (unsigned ply = 0; ply < 60 and not board.is_terminal(); ++ply) {
+      auto children = board.next();
+      auto& child = children[gen() % children.size()];
+      SearchResult result;
+      result.best.board = child;
+      result.value = 0.5;
+      game_result.plies.push_back(PlyRecord::from(result));
+      board = child;
+    }
+
+    auto white = board.white().pawn().count();
+    auto black = board.black().pawn().count();
+    if (white > black)
+      game_result.winner = Color::White;
+    else if (black > white)
+      game_result.winner = Color::Black;
+    return game_result;
+  }
+};
+
+TEST_F(NnueTrainerTest, ThrowsOnInvalidResultWeight)
+{
+  EXPECT_THROW(NnueTrainer(1e-3, 1.5), std::invalid_argument);
+  EXPECT_THROW(NnueTrainer(1e-3, -0.5), std::invalid_argument);
+}
+
+TEST_F(NnueTrainerTest, ThrowsWithoutPositions)
+{
+  NnueTrainer trainer;
+  EXPECT_THROW(trainer.train(1), std::logic_error);
+}
+
+TEST_F(NnueTrainerTest, AddsPositionBeforeEveryPly)
+{
+  std::mt19937 gen(1);
+  auto game_result = random_game(gen);
+
+  NnueTrainer trainer;
+  trainer.add(game_result);
+  EXPECT_EQ(trainer.size(), game_result.plies.size());
+}
+
+TEST_F(NnueTrainerTest, TrainingReducesLoss)
+{
+  std::mt19937 gen(1);
+  NnueTrainer trainer(/*learning_rate=*/1e-3, /*result_weight=*/1, /*seed=*/1);
+  for (unsigned i = 0; i < 40; ++i)
+    trainer.add(random_game(gen));
+
+  auto initial_loss = trainer.loss();
+  auto final_loss = trainer.train(/*epochs=*/10, /*batch_size=*/64);
+  EXPECT_LT(final_loss, initial_loss / 2);
+  EXPECT_NEAR(trainer.loss(), final_loss, 0.1);
+}
+
+TEST_F(NnueTrainerTest, SearchValueIsPartOfTarget)
+{
+  // A drawn game, so the target is only from the search value.
+  GameResult game_result;
+  game_result.game_start = Board::new_board();
+  SearchResult result;
+  result.best.board = Board::new_board().next().front();
+  result.value = 0.5;
+  game_result.plies.push_back(PlyRecord::from(result));
+
+  NnueTrainer trainer(/*learning_rate=*/1e-3, /*result_weight=*/0.5);
+  trainer.add(game_result);
+  trainer.train(/*epochs=*/200, /*batch_size=*/1);
+  EXPECT_NEAR(trainer.predict(Board::new_board()), 0.25, 0.02);
+}
+
+TEST_F(NnueTrainerTest, QuantizedNetworkMatchesFloatNetwork)
+{
+  std::mt19937 gen(2);
+  NnueTrainer trainer(/*learning_rate=*/1e-3, /*result_weight=*/1, /*seed=*/2);
+  for (unsigned i = 0; i < 10; ++i)
+    trainer.add(random_game(gen));
+  trainer.train(/*epochs=*/5, /*batch_size=*/32);
+
+  auto nnue = trainer.network();
+  auto board = Board::new_board();
+  for (unsigned ply = 0; ply < 40 and not board.is_terminal(); ++ply) {
+    auto value = std::tanh(
+        static_cast<float>(nnue.evaluate(board)) / Nnue::kCentipawns);
+    EXPECT_NEAR(value, trainer.predict(board), 0.02);
+    auto children = board.next();
+    board = children[gen() % children.size()];
+  }
+}
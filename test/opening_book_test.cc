@@ -0,0 +1,202 @@
+#include "opening_book.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "board.h"
+#include "game_result.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "search_result.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+class OpeningBookTest : public testing::Test
+{
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  void
+  SetUp() override
+  { path = fs::temp_directory_path() / "blunder-opening-book-test"; }
+
+  void
+  TearDown() override
+  { fs::remove(path); }
+
+  // Returns a game that plays the first move of every position for |plies|,
+  // where the search at every position visited the first move |first_visits|
+  // times and the second move |second_visits| times.
+  static GameResult
+  make_game(
+      unsigned plies,
+      unsigned first_visits,
+      unsigned second_visits,
+      bool policy_target = true)
+  {
+    GameResult game_result;
+    game_result.game_start = Board::new_board();
+
+    auto board = game_result.game_start;
+    for (unsigned i = 0; i < plies; ++i) {
+      auto children = board.next();
+      SearchResult result;
+      result.best.board = children[0];
+      result.moves = {
+        MoveProb::from(BoardProb{.board=children[0], .visits=first_visits}),
+        MoveProb::from(BoardProb{.board=children[1], .visits=second_visits})
+      };
+      result.policy_target = policy_target;
+      game_result.plies.push_back(PlyRecord::from(result));
+      board = children[0];
+    }
+    return game_result;
+  }
+
+  fs::path path;
+};
+
+TEST_F(OpeningBookTest, SumsVisitsOfGames)
+{
+  OpeningBookBuilder builder(/*max_plies=*/4);
+  builder.add(make_game(/*plies=*/10, 30, 10));
+  builder.add(make_game(/*plies=*/10, 25, 15));
+  builder.write(path);
+
+  OpeningBook book(path);
+  EXPECT_EQ(book.max_plies(), 4u);
+  // Two moves for each of the first four positions.
+  EXPECT_EQ(book.entries().size(), 8u);
+
+  auto board = Board::new_board();
+  auto children = board.next();
+  auto moves = book.lookup(board);
+  ASSERT_EQ(moves.size(), 2u);
+
+  for (const auto& move : moves) {
+    if (move.board == children[0]) {
+      EXPECT_EQ(move.visits, 55u);
+      EXPECT_FLOAT_EQ(move.prior, 55.0 / 80);
+    } else {
+      EXPECT_EQ(move.board, children[1]);
+      EXPECT_EQ(move.visits, 25u);
+      EXPECT_FLOAT_EQ(move.prior, 25.0 / 80);
+    }
+  }
+}
+
+TEST_F(OpeningBookTest, OnlyAddsFirstPliesOfFullSearches)
+{
+  OpeningBookBuilder builder(/*max_plies=*/2);
+  builder.add(make_game(/*plies=*/10, 30, 10));
+  builder.add(make_game(/*plies=*/10, 0, 1000, /*policy_target=*/false));
+  builder.write(path);
+
+  OpeningBook book(path);
+  EXPECT_EQ(book.entries().size(), 4u);
+
+  // The third position of the game is past the book.
+  auto board = Board::new_board();
+  for (int i = 0; i < 2; ++i) {
+    auto moves = book.lookup(board);
+    ASSERT_EQ(moves.size(), 2u);
+    EXPECT_EQ(moves[0].visits + moves[1].visits, 40u);
+    board = board.next()[0];
+  }
+  EXPECT_TRUE(book.lookup(board).empty());
+}
+
+TEST_F(OpeningBookTest, SamplesWithTemperature)
+{
+  OpeningBookBuilder builder(/*max_plies=*/1);
+  builder.add(make_game(/*plies=*/1, 90, 10));
+  builder.write(path);
+  OpeningBook book(path);
+
+  auto board = Board::new_board();
+  auto children = board.next();
+  std::mt19937_64 rand_gen(1);
+
+  // Without temperature, the most visited move is always played.
+  for (int i = 0; i < 20; ++i) {
+    auto result = book.sample(board, BookOptions{.temperature=0}, rand_gen);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->best.board, children[0]);
+    EXPECT_FALSE(result->has_value);
+    EXPECT_FALSE(result->policy_target);
+    EXPECT_EQ(result->moves.size(), 2u);
+  }
+
+  // With a high temperature, both moves are played.
+  unsigned second = 0;
+  for (int i = 0; i < 200; ++i) {
+    auto result = book.sample(board, BookOptions{.temperature=100}, rand_gen);
+    ASSERT_TRUE(result);
+    if (result->best.board == children[1])
+      ++second;
+  }
+  EXPECT_GT(second, 50u);
+  EXPECT_LT(second, 150u);
+}
+
+TEST_F(OpeningBookTest, SkipsPositionsWithFewVisits)
+{
+  OpeningBookBuilder builder(/*max_plies=*/1);
+  builder.add(make_game(/*plies=*/1, 3, 2));
+  builder.write(path);
+  OpeningBook book(path);
+
+  auto board = Board::new_board();
+  std::mt19937_64 rand_gen(1);
+  EXPECT_TRUE(book.sample(board, BookOptions{.min_visits=5}, rand_gen));
+  EXPECT_FALSE(book.sample(board, BookOptions{.min_visits=6}, rand_gen));
+  EXPECT_FALSE(book.sample(board.next()[1], BookOptions{}, rand_gen));
+}
+
+TEST_F(OpeningBookTest, ExtendsExistingBook)
+{
+  {
+    OpeningBookBuilder builder(/*max_plies=*/1);
+    builder.add(make_game(/*plies=*/1, 30, 10));
+    builder.write(path);
+  }
+
+  // The old book stays mapped while the new book replaces the file.
+  OpeningBook old_book(path);
+  OpeningBookBuilder builder(/*max_plies=*/1);
+  builder.add(old_book);
+  builder.add(make_game(/*plies=*/1, 30, 10));
+  builder.write(path);
+
+  OpeningBook book(path);
+  auto board = Board::new_board();
+  auto old_moves = old_book.lookup(board);
+  auto moves = book.lookup(board);
+  ASSERT_EQ(old_moves.size(), 2u);
+  ASSERT_EQ(moves.size(), 2u);
+  EXPECT_EQ(moves[0].visits, 2 * old_moves[0].visits);
+  EXPECT_EQ(moves[1].visits, 2 * old_moves[1].visits);
+}
+
+TEST_F(OpeningBookTest, RejectsOtherFiles)
+{
+  {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs("not an opening book, but long enough", file);
+    std::fclose(file);
+  }
+  EXPECT_THROW(OpeningBook{path}, std::runtime_error);
+}
+
+TEST_F(OpeningBookTest, ThrowsOnZeroPlies)
+{
+  EXPECT_THROW(OpeningBookBuilder(/*max_plies=*/0), std::invalid_argument);
+}
@@ -0,0 +1,92 @@
+#include "packed_board.h"
+
+#include "board.h"
+#include "fen.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace blunder;
+
+class PackedBoardTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  { Board::register_magics(); }
+
+  // Checks that |board| and |other| represent the same position.
+  static void
+  expect_same_position(const Board& board, const Board& other)
+  {
+    EXPECT_EQ(board.white().all(), other.white().all());
+    EXPECT_EQ(board.white().king(), other.white().king());
+    EXPECT_EQ(board.white().queen(), other.white().queen());
+    EXPECT_EQ(board.white().rook(), other.white().rook());
+    EXPECT_EQ(board.white().bishop(), other.white().bishop());
+    EXPECT_EQ(board.white().knight(), other.white().knight());
+    EXPECT_EQ(board.white().pawn(), other.white().pawn());
+    EXPECT_EQ(board.black().all(), other.black().all());
+    EXPECT_EQ(board.black().king(), other.black().king());
+    EXPECT_EQ(board.black().queen(), other.black().queen());
+    EXPECT_EQ(board.black().rook(), other.black().rook());
+    EXPECT_EQ(board.black().bishop(), other.black().bishop());
+    EXPECT_EQ(board.black().knight(), other.black().knight());
+    EXPECT_EQ(board.black().pawn(), other.black().pawn());
+    EXPECT_EQ(board.is_white_next(), other.is_white_next());
+    EXPECT_EQ(board.hm_count(), other.hm_count());
+    EXPECT_EQ(board.fm_count(), other.fm_count());
+    EXPECT_EQ(board.has_white_king_castle(), other.has_white_king_castle());
+    EXPECT_EQ(board.has_white_queen_castle(), other.has_white_queen_castle());
+    EXPECT_EQ(board.has_black_king_castle(), other.has_black_king_castle());
+    EXPECT_EQ(board.has_black_queen_castle(), other.has_black_queen_castle());
+    EXPECT_EQ(board.has_enpassant(), other.has_enpassant());
+    EXPECT_EQ(board.enpassant_file(), other.enpassant_file());
+  }
+};
+
+TEST_F(PackedBoardTest, NewBoardRoundTrip)
+{
+  auto board = Board::new_board();
+  auto packed = PackedBoard::from(board);
+  EXPECT_TRUE(packed.is_white_next());
+
+  auto unpacked = packed.to_board();
+  expect_same_position(board, unpacked);
+  EXPECT_EQ(PackedBoard::from(unpacked), packed);
+}
+
+TEST_F(PackedBoardTest, EnPassantAndCastlingRoundTrip)
+{
+  auto board = read_fen(
+      "r3k2r/pp1p1ppp/8/2pPp3/8/8/PPP2PPP/R3K2R w Kq e6 3 12");
+  ASSERT_TRUE(board);
+
+  auto packed = PackedBoard::from(*board);
+  auto unpacked = packed.to_board();
+  expect_same_position(*board, unpacked);
+  EXPECT_EQ(PackedBoard::from(unpacked), packed);
+}
+
+TEST_F(PackedBoardTest, BlackToMoveRoundTrip)
+{
+  auto board = read_fen("8/8/4k3/8/2q5/8/1P6/K7 b - - 7 40");
+  ASSERT_TRUE(board);
+
+  auto packed = PackedBoard::from(*board);
+  EXPECT_FALSE(packed.is_white_next());
+  expect_same_position(*board, packed.to_board());
+}
+
+TEST_F(PackedBoardTest, PositionsAfterMovesAreDifferent)
+{
+  auto board = Board::new_board();
+  auto children = board.next();
+  ASSERT_FALSE(children.empty());
+
+  auto packed = PackedBoard::from(board);
+  for (const auto& child : children) {
+    auto packed_child = PackedBoard::from(child);
+    EXPECT_NE(packed_child, packed);
+    expect_same_position(child, packed_child.to_board());
+  }
+}
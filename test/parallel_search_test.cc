@@ -0,0 +1,96 @@
+#include "parallel_search.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "board_path.h"
+#include "evaluator.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "mcts.h"
+#include "search_limits.h"
+
+using namespace blunder;
+
+namespace {
+
+// An evaluator with uniform priors, which is safe to call from multiple
+// threads.
+class UniformEvaluator : public Evaluator {
+public:
+  Prediction
+  predict(const EvalBoardPath& board_path) const override
+  {
+    ++evals;
+    Prediction pred;
+    pred.value = 0;
+    auto children = board_path.root()->get().next();
+    for (auto& child : children)
+      pred.move_probs.emplace_back(std::move(child), 1.0f / children.size());
+    return pred;
+  }
+
+  mutable std::atomic<unsigned> evals = 0;
+};
+
+} // namespace
+
+class ParallelSearchTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  std::vector<std::shared_ptr<Search>>
+  make_searches(unsigned n)
+  {
+    std::vector<std::shared_ptr<Search>> searches;
+    for (unsigned i = 0; i < n; ++i)
+      searches.push_back(std::make_shared<Mcts>(evaluator, 100, i));
+    return searches;
+  }
+
+  std::shared_ptr<UniformEvaluator> evaluator =
+    std::make_shared<UniformEvaluator>();
+};
+
+TEST_F(ParallelSearchTest, ThrowsWithoutSearches)
+{
+  EXPECT_THROW(ParallelSearch({}), std::invalid_argument);
+  EXPECT_THROW(ParallelSearch({nullptr}), std::invalid_argument);
+}
+
+TEST_F(ParallelSearchTest, MergesVisitsOfAllSearches)
+{
+  ParallelSearch search(make_searches(4));
+  EXPECT_EQ(search.size(), 4u);
+
+  auto board = Board::new_board();
+  EvalBoardPath board_path;
+  board_path.push(board);
+
+  auto result = search.run(
+      board_path,
+      SearchLimits{.simulations=400, .stop_when_decided=false});
+
+  // Every search runs a quarter of the simulations.
+  EXPECT_EQ(result.simulations, 400u);
+
+  unsigned visits = 0;
+  unsigned max_visits = 0;
+  for (const auto& move : result.moves) {
+    visits += move.visits;
+    max_visits = std::max(max_visits, move.visits);
+  }
+  EXPECT_EQ(result.moves.size(), 20u);
+  EXPECT_GE(visits, 400u);
+  EXPECT_EQ(result.best.visits, max_visits);
+  ASSERT_TRUE(result.best.board.last_move());
+
+  auto children = board.next();
+  EXPECT_THAT(children, testing::Contains(result.best.board));
+}
@@ -0,0 +1,58 @@
+#include "quantized_net.h"
+
+#include <stdexcept>
+
+#include <torch/torch.h>
+
+#include "folded_net.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "net.h"
+
+using namespace blunder;
+
+class QuantizedNetTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  {
+    torch::manual_seed(42);
+    net.on_device(torch::kCPU);
+    net.set_eval_mode();
+  }
+
+  AlphaZeroNet net;
+};
+
+TEST_F(QuantizedNetTest, ThrowsWithoutCalibrationInputs)
+{
+  FoldedNet folded_net(net);
+  EXPECT_THROW(QuantizedNet(folded_net, torch::Tensor()),
+               std::invalid_argument);
+  EXPECT_THROW(QuantizedNet(folded_net, torch::zeros({0, 119, 8, 8})),
+               std::invalid_argument);
+}
+
+TEST_F(QuantizedNetTest, StaysCloseToFloatNet)
+{
+  FoldedNet folded_net(net);
+
+  // Positions are encoded as binary planes.
+  auto inputs = torch::bernoulli(torch::full({32, 119, 8, 8}, 0.2));
+  QuantizedNet quantized_net(folded_net, inputs);
+  EXPECT_EQ(quantized_net.device(), torch::Device(torch::kCPU));
+
+  auto input = inputs.narrow(0, 0, 4);
+  auto [pol, val] = folded_net.predict(input);
+  auto [quantized_pol, quantized_val] = quantized_net.predict(input);
+
+  ASSERT_EQ(quantized_pol.sizes(), pol.sizes());
+  ASSERT_EQ(quantized_val.sizes(), val.sizes());
+
+  // The quantization error is small relative to the magnitude of the outputs.
+  auto similarity = torch::cosine_similarity(
+      quantized_pol.flatten(/*start_dim=*/1), pol.flatten(/*start_dim=*/1), 1);
+  EXPECT_GT(similarity.min().item<float>(), 0.95);
+  EXPECT_LT((quantized_val - val).abs().max().item<float>(), 0.1);
+}
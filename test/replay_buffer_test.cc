@@ -0,0 +1,174 @@
+#include "replay_buffer.h"
+
+#include <vector>
+
+#include "board.h"
+#include "game_result.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "search_result.h"
+
+using namespace blunder;
+
+namespace {
+
+// Creates a position where the value identifies the position.
+TrainingPosition
+make_position(float value)
+{
+  return TrainingPosition{
+    .board=PackedBoard::from(Board::new_board()),
+    .policy={PolicyEntry{.index=1, .visits=1}},
+    .value=value
+  };
+}
+
+} // namespace
+
+class ReplayBufferTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  { Board::register_magics(); }
+};
+
+TEST_F(ReplayBufferTest, ZeroCapacityThrows)
+{
+  EXPECT_THROW(ReplayBuffer(0), std::invalid_argument);
+}
+
+TEST_F(ReplayBufferTest, AddUntilFull)
+{
+  ReplayBuffer buffer(3);
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(buffer.capacity(), 3);
+
+  buffer.add(make_position(0));
+  buffer.add(make_position(1));
+  EXPECT_EQ(buffer.size(), 2);
+  EXPECT_EQ(buffer[0].value, 0);
+  EXPECT_EQ(buffer[1].value, 1);
+}
+
+TEST_F(ReplayBufferTest, EvictsOldestPosition)
+{
+  ReplayBuffer buffer(3);
+  for (int i = 0; i < 5; ++i)
+    buffer.add(make_position(i));
+
+  EXPECT_EQ(buffer.size(), 3);
+  EXPECT_EQ(buffer[0].value, 2);
+  EXPECT_EQ(buffer[1].value, 3);
+  EXPECT_EQ(buffer[2].value, 4);
+}
+
+TEST_F(ReplayBufferTest, SampleFromEmptyBuffer)
+{
+  ReplayBuffer buffer(3);
+  EXPECT_TRUE(buffer.sample(10).empty());
+}
+
+TEST_F(ReplayBufferTest, UniformSampleOnlyReturnsPositionsInWindow)
+{
+  ReplayBuffer buffer(4, ReplaySampling::Uniform, 7);
+  for (int i = 0; i < 10; ++i)
+    buffer.add(make_position(i));
+
+  auto samples = buffer.sample(100);
+  EXPECT_EQ(samples.size(), 100);
+  for (const auto& position : samples) {
+    EXPECT_GE(position.value, 6);
+    EXPECT_LE(position.value, 9);
+  }
+}
+
+TEST_F(ReplayBufferTest, RecencySampleFavorsNewPositions)
+{
+  ReplayBuffer buffer(10, ReplaySampling::Recency, 7);
+  for (int i = 0; i < 10; ++i)
+    buffer.add(make_position(i));
+
+  unsigned old_count = 0;
+  unsigned new_count = 0;
+  for (const auto& position : buffer.sample(2000)) {
+    if (position.value < 5)
+      ++old_count;
+    else
+      ++new_count;
+  }
+
+  // The newer half of the window should get about 3/4 of the samples.
+  EXPECT_GT(new_count, 2 * old_count);
+}
+
+TEST_F(ReplayBufferTest, AddGameResult)
+{
+  GameResult game_result;
+  game_result.game_start = Board::new_board();
+  game_result.winner = Color::White;
+
+  // Play two plies, where the second one does not have visit counts.
+  auto children = game_result.game_start.next();
+  ASSERT_FALSE(children.empty());
+
+  SearchResult search_result;
+  search_result.best.board = children[0];
+  for (const auto& child : children)
+    search_result.moves.push_back(MoveProb{.mv=*child.last_move(), .visits=2});
+  game_result.plies.push_back(PlyRecord::from(search_result));
+
+  auto grand_children = children[0].next();
+  ASSERT_FALSE(grand_children.empty());
+  search_result.best.board = grand_children[0];
+  search_result.moves.clear();
+  game_result.plies.push_back(PlyRecord::from(search_result));
+
+  auto boards = game_result.replay();
+  ASSERT_EQ(boards.size(), 3);
+  EXPECT_EQ(PackedBoard::from(boards[1]), PackedBoard::from(children[0]));
+  EXPECT_EQ(PackedBoard::from(boards[2]), PackedBoard::from(grand_children[0]));
+
+  ReplayBuffer buffer(10);
+  buffer.add(game_result);
+
+  ASSERT_EQ(buffer.size(), 1);
+  EXPECT_EQ(buffer[0].value, 1);
+  EXPECT_EQ(buffer[0].board, PackedBoard::from(game_result.game_start));
+  EXPECT_EQ(buffer[0].policy.size(), children.size());
+}
+
+TEST_F(ReplayBufferTest, AddGameResultKeepsPolicyTargetMark)
+{
+  GameResult game_result;
+  game_result.game_start = Board::new_board();
+
+  // The first ply is from a cheap search, and the second from a full search.
+  auto children = game_result.game_start.next();
+  ASSERT_FALSE(children.empty());
+
+  SearchResult search_result;
+  search_result.best.board = children[0];
+  search_result.moves.push_back(
+      MoveProb{.mv=*children[0].last_move(), .visits=1});
+  search_result.policy_target = false;
+  game_result.plies.push_back(PlyRecord::from(search_result));
+
+  auto grand_children = children[0].next();
+  ASSERT_FALSE(grand_children.empty());
+  search_result.best.board = grand_children[0];
+  search_result.moves = {
+    MoveProb{.mv=*grand_children[0].last_move(), .visits=1}
+  };
+  search_result.policy_target = true;
+  game_result.plies.push_back(PlyRecord::from(search_result));
+
+  EXPECT_FLOAT_EQ(game_result.stats().policy_target_frac, 0.5);
+
+  ReplayBuffer buffer(10);
+  buffer.add(game_result);
+
+  ASSERT_EQ(buffer.size(), 2);
+  EXPECT_FALSE(buffer[0].policy_target);
+  EXPECT_TRUE(buffer[1].policy_target);
+}
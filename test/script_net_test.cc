@@ -0,0 +1,85 @@
+#include "script_net.h"
+
+#include <filesystem>
+
+#include <torch/torch.h>
+
+#include "folded_net.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "net.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+TEST(ScriptNetTest, ExportFromCheckpointMatchesNet)
+{
+  torch::manual_seed(42);
+
+  NetConfig config{.blocks=2, .filters=16, .value_hidden=32};
+  AlphaZeroNet net(config);
+  net.on_device(torch::kCPU);
+
+  // Move the running statistics away from their defaults, which the exported
+  // network needs to fold its BatchNorm layers.
+  {
+    torch::NoGradGuard no_grad;
+    net.set_training_mode();
+    for (int i = 0; i < 3; ++i)
+      net.forward(torch::randn({4, 119, 8, 8}));
+  }
+  net.set_eval_mode();
+
+  auto checkpoint_dir = fs::temp_directory_path() / "blunder-script-net-ckpt";
+  fs::remove_all(checkpoint_dir);
+  ASSERT_TRUE(net.create_checkpoint(checkpoint_dir));
+
+  // Export the checkpoint like export_net.
+  AlphaZeroNet loaded_net(config);
+  ASSERT_TRUE(loaded_net.load_checkpoint(checkpoint_dir));
+  fs::remove_all(checkpoint_dir);
+  loaded_net.on_device(torch::kCPU);
+  loaded_net.set_eval_mode();
+
+  auto file_name = fs::temp_directory_path() / "blunder-script-net-ckpt.pt";
+  ScriptNet::save(FoldedNet(loaded_net), file_name);
+  ScriptNet script_net(file_name);
+  fs::remove(file_name);
+
+  auto input = torch::randn({2, 119, 8, 8});
+  torch::NoGradGuard no_grad;
+  auto [pol, val] = net.forward(input);
+  auto [script_pol, script_val] = script_net.predict(input);
+
+  ASSERT_EQ(script_pol.sizes(), pol.sizes());
+  ASSERT_EQ(script_val.sizes(), val.sizes());
+  EXPECT_TRUE(torch::allclose(script_pol, pol, /*rtol=*/1e-3, /*atol=*/1e-3));
+  EXPECT_TRUE(torch::allclose(script_val, val, /*rtol=*/1e-3, /*atol=*/1e-4));
+}
+
+TEST(ScriptNetTest, MatchesFoldedNetAfterSaveAndLoad)
+{
+  torch::manual_seed(42);
+
+  AlphaZeroNet net;
+  net.on_device(torch::kCPU);
+  net.set_eval_mode();
+  FoldedNet folded_net(net);
+
+  auto file_name = fs::temp_directory_path() / "blunder-script-net-test.pt";
+  ScriptNet::save(folded_net, file_name);
+  ScriptNet script_net(file_name);
+  fs::remove(file_name);
+
+  EXPECT_EQ(script_net.device(), torch::Device(torch::kCPU));
+
+  auto input = torch::randn({2, 119, 8, 8});
+  auto [pol, val] = folded_net.predict(input);
+  auto [script_pol, script_val] = script_net.predict(input);
+
+  ASSERT_EQ(script_pol.sizes(), pol.sizes());
+  ASSERT_EQ(script_val.sizes(), val.sizes());
+  EXPECT_TRUE(torch::allclose(script_pol, pol, /*rtol=*/1e-3, /*atol=*/1e-3));
+  EXPECT_TRUE(torch::allclose(script_val, val, /*rtol=*/1e-3, /*atol=*/1e-4));
+}
@@ -0,0 +1,257 @@
+#include "simple_game.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "blunder_player.h"
+#include "board.h"
+#include "board_path.h"
+#include "evaluator.h"
+#include "game_result.h"
+#include "gtest/gtest.h"
+#include "mcts.h"
+#include "player.h"
+#include "search_result.h"
+
+using namespace blunder;
+
+namespace {
+
+// A player that plays random moves, and reports the values in |values| in
+// turn as the values of its searches, where a missing value is a search
+// without a value, like a forced move.
+class FakePlayer : public Player {
+public:
+  FakePlayer(std::vector<std::optional<float>> values, std::uint64_t seed)
+    : values(std::move(values)),
+      rand_gen(seed)
+  {}
+
+  SearchResult
+  make_move(const GameBoardPath& boards) override
+  {
+    auto moves = boards.fast_back().next();
+    std::uniform_int_distribution<std::size_t> pick(0, moves.size() - 1);
+
+    SearchResult result;
+    result.best.board = moves[pick(rand_gen)];
+    const auto& value = values[num_moves++ % values.size()];
+    result.value = value.value_or(0);
+    result.has_value = value.has_value();
+    return result;
+  }
+
+  std::string_view
+  name() const noexcept override
+  { return "FakePlayer"; }
+
+private:
+  std::vector<std::optional<float>> values;
+  std::mt19937_64 rand_gen;
+  unsigned num_moves = 0;
+};
+
+// An evaluator with uniform priors and the material balance for the player
+// moving next as the value.
+class MaterialEvaluator : public Evaluator {
+public:
+  Prediction
+  predict(const EvalBoardPath& board_path) const override
+  {
+    const auto& board = board_path.root()->get();
+    auto material = [](const PieceSet& pieces) {
+      return static_cast<int>(
+          pieces.pawn().count()
+          + 3 * (pieces.knight().count() + pieces.bishop().count())
+          + 5 * pieces.rook().count()
+          + 9 * pieces.queen().count());
+    };
+
+    Prediction pred;
+    pred.value = std::tanh(
+        (material(board.mine()) - material(board.other())) / 10.0f);
+    auto children = board.next();
+    for (auto& child : children)
+      pred.move_probs.emplace_back(std::move(child), 1.0f / children.size());
+    return pred;
+  }
+};
+
+SimpleGame
+make_game(
+    std::vector<std::optional<float>> white_values,
+    std::vector<std::optional<float>> black_values,
+    unsigned max_moves = 20)
+{
+  return SimpleGame(
+      std::make_unique<FakePlayer>(std::move(white_values), 1),
+      std::make_unique<FakePlayer>(std::move(black_values), 2),
+      max_moves);
+}
+
+} // namespace
+
+class SimpleGameTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  { Board::register_magics(); }
+};
+
+TEST_F(SimpleGameTest, PlaysToMoveLimitWithoutAdjudication)
+{
+  auto game = make_game({-1}, {-1});
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 20u);
+  EXPECT_EQ(result.game_end, GameEnd::MoveLimit);
+  EXPECT_FALSE(result.winner);
+  EXPECT_FALSE(result.would_resign);
+}
+
+TEST_F(SimpleGameTest, LosingPlayerResigns)
+{
+  auto game = make_game({.99}, {-.99});
+  game.set_adjudication(Adjudication{
+    .resign_threshold=-.9,
+    .resign_plies=2,
+    .no_resign_prob=0
+  }, 0);
+
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 4u);
+  EXPECT_EQ(result.game_end, GameEnd::Resignation);
+  EXPECT_EQ(result.winner, Color::White);
+  EXPECT_FALSE(result.would_resign);
+  EXPECT_EQ(result.replay().size(), 5u);
+}
+
+TEST_F(SimpleGameTest, ResignationNeedsConsecutivePlies)
+{
+  auto game = make_game({.99}, {-.99, 0});
+  game.set_adjudication(Adjudication{
+    .resign_threshold=-.9,
+    .resign_plies=2,
+    .no_resign_prob=0
+  }, 0);
+
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 20u);
+  EXPECT_EQ(result.game_end, GameEnd::MoveLimit);
+  EXPECT_FALSE(result.winner);
+}
+
+TEST_F(SimpleGameTest, ForcedMovesKeepLosingStreak)
+{
+  // Every other move of black is forced, which neither ends nor extends the
+  // streak.
+  auto game = make_game({.99}, {-.99, std::nullopt});
+  game.set_adjudication(Adjudication{
+    .resign_threshold=-.9,
+    .resign_plies=2,
+    .no_resign_prob=0
+  }, 0);
+
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 6u);
+  EXPECT_EQ(result.game_end, GameEnd::Resignation);
+  EXPECT_EQ(result.winner, Color::White);
+}
+
+TEST_F(SimpleGameTest, ForcedMovesDoNotCountAsDrawn)
+{
+  // Every move of white is forced, so only the values of black count.
+  auto game = make_game({std::nullopt}, {.01, .5});
+  game.set_adjudication(Adjudication{
+    .draw_threshold=.05,
+    .draw_plies=2,
+    .draw_min_plies=0
+  }, 0);
+
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 20u);
+  EXPECT_EQ(result.game_end, GameEnd::MoveLimit);
+}
+
+TEST_F(SimpleGameTest, LosingSearchResigns)
+{
+  // Black barely searches, so it loses material to the search of white, and
+  // its values need to be for itself to resign.
+  auto evaluator = std::make_shared<MaterialEvaluator>();
+  auto white_mcts = std::make_shared<Mcts>(evaluator, /*simulations=*/400, 1);
+  auto black_mcts = std::make_shared<Mcts>(evaluator, /*simulations=*/1, 2);
+  SimpleGame game(
+      std::make_unique<BlunderPlayer>(white_mcts),
+      std::make_unique<BlunderPlayer>(black_mcts),
+      200);
+  game.set_adjudication(Adjudication{
+    .resign_threshold=-.25,
+    .resign_plies=2,
+    .no_resign_prob=0
+  }, 0);
+
+  auto result = game.play();
+  EXPECT_EQ(result.game_end, GameEnd::Resignation);
+  EXPECT_EQ(result.winner, Color::White);
+
+  // White moves next after black resigned, and is ahead in material.
+  auto boards = result.replay();
+  ASSERT_TRUE(boards.back().is_white_next());
+  EvalBoardPath board_path;
+  board_path.push(boards.back());
+  EXPECT_GT(evaluator->predict(board_path).value, 0);
+}
+
+TEST_F(SimpleGameTest, PlaysOutGamesWithoutResignation)
+{
+  auto game = make_game({-.99}, {.99});
+  game.set_adjudication(Adjudication{
+    .resign_threshold=-.9,
+    .resign_plies=2,
+    .no_resign_prob=1
+  }, 0);
+
+  // White would have resigned, but did not lose, so the resignation would have
+  // been wrong.
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 20u);
+  EXPECT_EQ(result.game_end, GameEnd::MoveLimit);
+  EXPECT_EQ(result.would_resign, Color::White);
+  EXPECT_TRUE(result.is_false_resignation());
+}
+
+TEST_F(SimpleGameTest, AdjudicatesDraws)
+{
+  auto game = make_game({.01}, {-.02});
+  game.set_adjudication(Adjudication{
+    .draw_threshold=.05,
+    .draw_plies=4,
+    .draw_min_plies=10
+  }, 0);
+
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 10u);
+  EXPECT_EQ(result.game_end, GameEnd::DrawAdjudication);
+  EXPECT_FALSE(result.winner);
+  EXPECT_EQ(result.stats().game_winner, GameWinner::Draw);
+}
+
+TEST_F(SimpleGameTest, DrawNeedsBothPlayers)
+{
+  auto game = make_game({0}, {-.5});
+  game.set_adjudication(Adjudication{
+    .draw_threshold=.05,
+    .draw_plies=4,
+    .draw_min_plies=0
+  }, 0);
+
+  auto result = game.play();
+  EXPECT_EQ(result.plies.size(), 20u);
+  EXPECT_EQ(result.game_end, GameEnd::MoveLimit);
+}
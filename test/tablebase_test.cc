@@ -0,0 +1,210 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "fen.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "par.h"
+#include "tablebase_generator.h"
+
+using namespace blunder;
+
+namespace fs = std::filesystem;
+
+class TablebaseTest : public testing::Test
+{
+protected:
+  // Generates the tables with three pieces once for all the tests.
+  static void
+  SetUpTestSuite()
+  {
+    Board::register_magics();
+    dir = fs::temp_directory_path() / "blunder-tablebase-test";
+    fs::remove_all(dir);
+
+    TablebaseGenerator generator(dir, std::make_shared<par::WorkQ>());
+    for (const auto& material : TablebaseGenerator::all_materials(3))
+      generator.generate(material);
+  }
+
+  static void
+  TearDownTestSuite()
+  { fs::remove_all(dir); }
+
+  static Board
+  board_of(std::string_view fen)
+  {
+    auto board = read_fen(fen);
+    EXPECT_TRUE(board);
+    return *board;
+  }
+
+  // Returns the longest distance to mate of the positions in the table of
+  // |key|.
+  static unsigned
+  max_dtm(const Tablebase& tb, const std::string& key)
+  {
+    const auto material = Material::from_key(key);
+    unsigned max = 0;
+    for (std::uint64_t i = 0; i < material.positions(); ++i) {
+      auto board = Tablebase::board_at(material, i);
+      if (not board)
+        continue;
+      auto result = tb.probe(*board);
+      EXPECT_TRUE(result);
+      if (result and result->wdl == Wdl::Win)
+        max = std::max(max, result->dtm);
+    }
+    return max;
+  }
+
+  static fs::path dir;
+};
+
+fs::path TablebaseTest::dir;
+
+TEST_F(TablebaseTest, ParsesMaterialKeys)
+{
+  auto material = Material::from_key("KQvKR");
+  EXPECT_EQ(material.white, std::vector{Type::Queen});
+  EXPECT_EQ(material.black, std::vector{Type::Rook});
+  EXPECT_EQ(material.key(), "KQvKR");
+  EXPECT_EQ(material.men(), 4u);
+  EXPECT_EQ(material.pawns(), 0u);
+  EXPECT_TRUE(material.is_canonical());
+  EXPECT_FALSE(Material::from_key("KRvKQ").is_canonical());
+  EXPECT_FALSE(Material::from_key("KvKP").is_canonical());
+  EXPECT_TRUE(Material::from_key("KRvKR").is_canonical());
+
+  EXPECT_EQ(Material::from_key("KQvK").positions(), 2u * 10 * 64 * 64);
+  EXPECT_EQ(Material::from_key("KPvK").positions(), 2u * 32 * 64 * 64);
+
+  EXPECT_THROW(Material::from_key("KQK"), std::invalid_argument);
+  EXPECT_THROW(Material::from_key("KXvK"), std::invalid_argument);
+  EXPECT_THROW(Material::from_key("KPQvK"), std::invalid_argument);
+}
+
+TEST_F(TablebaseTest, OrdersMaterialsForGeneration)
+{
+  auto materials = TablebaseGenerator::all_materials(3);
+  std::vector<std::string> keys;
+  for (const auto& material : materials)
+    keys.push_back(material.key());
+  EXPECT_THAT(keys, testing::ElementsAre(
+        "KQvK", "KRvK", "KBvK", "KNvK", "KPvK"));
+
+  // The tables with pawns come after the tables that they promote to.
+  materials = TablebaseGenerator::all_materials(4);
+  EXPECT_EQ(materials.size(), 5u + 15 + 15);
+  EXPECT_EQ(materials.back().key(), "KPPvK");
+  EXPECT_THROW(TablebaseGenerator::all_materials(5), std::invalid_argument);
+}
+
+TEST_F(TablebaseTest, MapsGeneratedTables)
+{
+  Tablebase tb(dir);
+  EXPECT_EQ(tb.size(), 5u);
+  EXPECT_TRUE(tb.has_table("KQvK"));
+  EXPECT_TRUE(tb.has_table("KPvK"));
+  EXPECT_FALSE(tb.has_table("KQvKR"));
+}
+
+TEST_F(TablebaseTest, FindsMates)
+{
+  Tablebase tb(dir);
+
+  auto board = board_of("k7/8/1K6/8/8/8/7Q/8 w - - 0 1");
+  auto result = tb.probe(board);
+  ASSERT_TRUE(result);
+  EXPECT_EQ(result->wdl, Wdl::Win);
+  EXPECT_EQ(result->dtm, 1u);
+
+  // After the mate, the probe returns the loss without a table lookup.
+  board = board_of("k6Q/8/1K6/8/8/8/8/8 b - - 1 1");
+  result = tb.probe(board);
+  ASSERT_TRUE(result);
+  EXPECT_EQ(result->wdl, Wdl::Loss);
+  EXPECT_EQ(result->dtm, 0u);
+}
+
+TEST_F(TablebaseTest, HasLongestMates)
+{
+  // The longest mates are ten moves with a queen and sixteen with a rook.
+  Tablebase tb(dir);
+  EXPECT_EQ(max_dtm(tb, "KQvK"), 19u);
+  EXPECT_EQ(max_dtm(tb, "KRvK"), 31u);
+  EXPECT_EQ(max_dtm(tb, "KBvK"), 0u);
+}
+
+TEST_F(TablebaseTest, FindsOpposition)
+{
+  Tablebase tb(dir);
+  EXPECT_EQ(tb.probe_wdl(board_of("8/4k3/8/4K3/4P3/8/8/8 w - - 0 1")),
+            Wdl::Draw);
+  EXPECT_EQ(tb.probe_wdl(board_of("8/4k3/8/4K3/4P3/8/8/8 b - - 0 1")),
+            Wdl::Loss);
+}
+
+TEST_F(TablebaseTest, ProbesSymmetricPositions)
+{
+  Tablebase tb(dir);
+
+  // The same position mirrored across the board, and with the colors
+  // flipped.
+  auto result = tb.probe(board_of("8/8/8/3k4/8/8/2K5/6R1 w - - 0 1"));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(result->wdl, Wdl::Win);
+  for (auto fen : {"8/8/8/4k3/8/8/5K2/1R6 w - - 0 1",
+                   "6R1/2K5/8/8/3k4/8/8/8 w - - 0 1",
+                   "6r1/2k5/8/8/3K4/8/8/8 b - - 0 1",
+                   "1r6/5k2/8/8/4K3/8/8/8 b - - 0 1"}) {
+    EXPECT_EQ(tb.probe(board_of(fen))->dtm, result->dtm) << fen;
+  }
+}
+
+TEST_F(TablebaseTest, WdlMatchesDtm)
+{
+  Tablebase tb(dir);
+  const auto material = Material::from_key("KPvK");
+  for (std::uint64_t i = 0; i < material.positions(); i += 37) {
+    auto board = Tablebase::board_at(material, i);
+    if (not board)
+      continue;
+    auto wdl = tb.probe_wdl(*board);
+    auto result = tb.probe(*board);
+    ASSERT_TRUE(wdl);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(*wdl, result->wdl);
+  }
+}
+
+TEST_F(TablebaseTest, SkipsMissingTables)
+{
+  Tablebase tb;
+  EXPECT_FALSE(tb.probe(board_of("8/8/8/3k4/8/8/2K5/6R1 w - - 0 1")));
+  EXPECT_FALSE(tb.probe(Board::new_board()));
+
+  tb.load(dir / "KRvK.wdl");
+  EXPECT_EQ(tb.probe_wdl(board_of("8/8/8/3k4/8/8/2K5/6R1 w - - 0 1")),
+            Wdl::Win);
+  // Without the DTM file, only the WDL is found.
+  EXPECT_FALSE(tb.probe(board_of("8/8/8/3k4/8/8/2K5/6R1 w - - 0 1")));
+}
+
+TEST_F(TablebaseTest, ThrowsOnMissingTables)
+{
+  auto other_dir = dir / "other";
+  TablebaseGenerator generator(other_dir, std::make_shared<par::WorkQ>());
+  EXPECT_THROW(generator.generate(Material::from_key("KPvK")),
+               std::logic_error);
+  EXPECT_THROW(generator.generate(Material::from_key("KvKQ")),
+               std::invalid_argument);
+}
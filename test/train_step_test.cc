@@ -0,0 +1,79 @@
+#include "train_step.h"
+
+#include <limits>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "chess_data_set.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "net.h"
+
+using namespace blunder;
+
+class TrainStepTest : public testing::Test
+{
+protected:
+  void
+  SetUp() override
+  {
+    torch::manual_seed(42);
+    net.on_device(torch::kCPU);
+    net.set_training_mode();
+
+    // A batch of random inputs, where each position has a policy target of
+    // two moves and a value target of zero.
+    SparsePolicy policy{
+      .indices=torch::tensor({{0, 100}, {5, 200}}, torch::kLong),
+      .probs=torch::tensor({{0.5, 0.5}, {0.5, 0.5}})
+    };
+    batch = ChessDataExample(
+        torch::randn({2, 119, 8, 8}),
+        ChessTarget(std::move(policy), torch::zeros({2, 1})));
+  }
+
+  // Returns the loss of the batch over a few steps.
+  std::vector<float>
+  train(TrainingPrecision precision, float loss_scale)
+  {
+    torch::optim::SGD optimizer(net.all_parameters(), /*lr=*/0.01);
+    std::vector<float> losses;
+    for (int i = 0; i < 5; ++i) {
+      auto loss = train_step(net, optimizer, batch, precision, loss_scale);
+      losses.push_back(loss.item<float>());
+    }
+    return losses;
+  }
+
+  AlphaZeroNet net{NetConfig{.blocks=1, .filters=16, .value_hidden=16}};
+  ChessDataExample batch;
+};
+
+TEST_F(TrainStepTest, Float32ReducesLoss)
+{
+  auto losses = train(TrainingPrecision::Float32, /*loss_scale=*/1);
+  EXPECT_LT(losses.back(), losses.front());
+}
+
+TEST_F(TrainStepTest, BFloat16ReducesLossWithFloat32Weights)
+{
+  auto losses = train(TrainingPrecision::BFloat16, /*loss_scale=*/128);
+  EXPECT_LT(losses.back(), losses.front());
+
+  for (const auto& param : net.all_parameters())
+    EXPECT_EQ(param.scalar_type(), torch::kFloat);
+}
+
+TEST_F(TrainStepTest, SkipsUpdateWithNonFiniteGrads)
+{
+  std::vector<torch::Tensor> params_before;
+  for (const auto& param : net.all_parameters())
+    params_before.push_back(param.detach().clone());
+
+  train(TrainingPrecision::Float32, std::numeric_limits<float>::infinity());
+
+  auto params = net.all_parameters();
+  for (std::size_t i = 0; i < params.size(); ++i)
+    EXPECT_TRUE(torch::equal(params[i], params_before[i]));
+}
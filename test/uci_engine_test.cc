@@ -0,0 +1,155 @@
+#include "uci_engine.h"
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "board.h"
+#include "board_path.h"
+#include "evaluator.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "time_types.h"
+
+using namespace blunder;
+using testing::HasSubstr;
+
+namespace {
+
+// An evaluator with uniform priors, which is safe to call from multiple
+// threads.
+class UniformEvaluator : public Evaluator {
+public:
+  Prediction
+  predict(const EvalBoardPath& board_path) const override
+  {
+    Prediction pred;
+    pred.value = 0;
+    auto children = board_path.root()->get().next();
+    for (auto& child : children)
+      pred.move_probs.emplace_back(std::move(child), 1.0f / children.size());
+    return pred;
+  }
+};
+
+} // namespace
+
+class UciEngineTest : public testing::Test {
+protected:
+  static void
+  SetUpTestSuite()
+  { Board::register_magics(); }
+
+  std::ostringstream out;
+  UciEngine engine{std::make_shared<UniformEvaluator>(), out};
+};
+
+TEST_F(UciEngineTest, Handshake)
+{
+  EXPECT_TRUE(engine.handle("uci"));
+  EXPECT_TRUE(engine.handle("isready"));
+  EXPECT_FALSE(engine.handle("quit"));
+
+  auto output = out.str();
+  EXPECT_THAT(output, HasSubstr("id name blunder\n"));
+  EXPECT_THAT(output, HasSubstr("option name Threads type spin"));
+  EXPECT_THAT(output, HasSubstr("option name Hash type spin"));
+  EXPECT_THAT(output, HasSubstr("uciok\n"));
+  EXPECT_THAT(output, HasSubstr("readyok\n"));
+}
+
+TEST_F(UciEngineTest, GoNodesPrintsBestMove)
+{
+  engine.handle("position startpos moves e2e4 e7e5");
+  engine.handle("go nodes 200");
+  engine.wait();
+
+  auto output = out.str();
+  EXPECT_THAT(output, HasSubstr("info depth "));
+  EXPECT_THAT(output, HasSubstr("bestmove "));
+  EXPECT_THAT(output, testing::Not(HasSubstr("info string")));
+}
+
+TEST_F(UciEngineTest, PositionFromFen)
+{
+  // Only one legal move, which is returned without searching.
+  engine.handle("position fen k7/8/8/8/8/8/1q6/K7 w - - 0 1");
+  engine.handle("go movetime 1000");
+  engine.wait();
+
+  EXPECT_THAT(out.str(), HasSubstr("bestmove a1b2\n"));
+}
+
+TEST_F(UciEngineTest, PromotionMove)
+{
+  engine.handle("position fen 8/P6k/8/8/8/8/8/K7 w - - 0 1 moves a7a8q h7g7");
+  engine.handle("go nodes 50");
+  engine.wait();
+
+  auto output = out.str();
+  EXPECT_THAT(output, HasSubstr("bestmove "));
+  EXPECT_THAT(output, testing::Not(HasSubstr("info string")));
+}
+
+TEST_F(UciEngineTest, StopEndsInfiniteSearch)
+{
+  engine.handle("position startpos");
+  engine.handle("go infinite");
+  std::this_thread::sleep_for(Milliseconds(50));
+  EXPECT_THAT(out.str(), testing::Not(HasSubstr("bestmove")));
+
+  engine.handle("stop");
+  EXPECT_THAT(out.str(), HasSubstr("bestmove "));
+}
+
+TEST_F(UciEngineTest, GoWithClockStopsInTime)
+{
+  engine.handle("position startpos");
+  engine.handle("go wtime 3000 btime 3000");
+  engine.wait();
+
+  EXPECT_THAT(out.str(), HasSubstr("bestmove "));
+}
+
+TEST_F(UciEngineTest, SetOption)
+{
+  engine.handle("setoption name Threads value 2");
+  engine.handle("setoption name Hash value 1");
+  engine.handle("position startpos");
+  engine.handle("go nodes 100");
+  engine.wait();
+
+  auto output = out.str();
+  EXPECT_THAT(output, HasSubstr("bestmove "));
+  EXPECT_THAT(output, testing::Not(HasSubstr("info string")));
+}
+
+TEST_F(UciEngineTest, ReportsInvalidCommands)
+{
+  engine.handle("setoption name Threads value 0");
+  engine.handle("position startpos moves e2e5");
+  engine.handle("position fen not a fen");
+  engine.handle("go nodes x");
+  engine.handle("dance");
+
+  auto output = out.str();
+  EXPECT_THAT(output, HasSubstr("Invalid Threads 0"));
+  EXPECT_THAT(output, HasSubstr("Illegal move e2e5"));
+  EXPECT_THAT(output, HasSubstr("Invalid FEN not a fen"));
+  EXPECT_THAT(output, HasSubstr("Error in go"));
+  EXPECT_THAT(output, HasSubstr("Unknown command dance"));
+  EXPECT_THAT(output, testing::Not(HasSubstr("bestmove")));
+}
+
+TEST_F(UciEngineTest, Bench)
+{
+  auto result = engine.bench(/*nodes=*/100);
+  EXPECT_GE(result.nodes, 8u * 100u);
+
+  auto output = out.str();
+  EXPECT_THAT(output, HasSubstr("Nodes searched  : "));
+  EXPECT_THAT(output, HasSubstr("Nodes/second    : "));
+}